@@ -41,6 +41,12 @@ namespace SFP10X_wrapper
         {
             IntPtr sfp_handle;
             int sfp_device_num;
+            int sfp_baud_rate;
+            int sfp_backend;
+            int sfp_fd;
+            int sfp_timeout_ms;
+            int sfp_tty_vmin;
+            IntPtr sfp_observers;
         };
         
         // Initialize  
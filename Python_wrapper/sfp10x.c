@@ -0,0 +1,1181 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    sfp10x.c
+
+ Abstract:
+    Python extension module over the SFP10X_COM library.
+
+        sfp10x.Device       open port (D2XX device number or tty path),
+                            single reads and writes, batched reads;
+        sfp10x.SampleBuffer preallocated block of timestamped samples,
+                            exported through the buffer protocol;
+        sfp10x.Acquisition  poll schedule executed by the acquisition
+                            thread (SFP10X_ACQ) into a sample ring
+                            (SFP10X_BUS), read in blocks.
+
+    A block of samples is filled in place by the C code with the GIL
+    released, and is seen from Python as a structured array (one record per
+    sample) or as one strided column per field, without a Python object per
+    sample:
+
+        buffer = sfp10x.SampleBuffer(4096)
+        device.read_batch(buffer, [(0x32, sfp10x.BYTES_3)])
+        current = numpy.asarray(buffer.value) * 0.00006119
+
+    Views share the memory of the buffer: a later read changes them in
+    place. Failures raise sfp10x.Error, whose rc attribute is the status
+    flag.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pythread.h>
+#include "SFP10X_ACQ.h"
+#include "SFP10X_BUS.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+
+// Maximum number of registers of a batched read.
+#define MAX_BATCH_REGISTERS SFP_POLL_MAX_ENTRIES
+
+
+// sfp10x.Error exception type.
+static PyObject * SFPError = NULL;
+
+// Record format of a sample (PEP 3118), built at import.
+static char entry_format[256];
+
+
+// Raises sfp10x.Error for a status flag. Returns NULL.
+static PyObject * RaiseStatus(byte rc)
+{
+
+    PyObject * error = PyObject_CallFunction(SFPError, "s", FlagLookup(rc));
+    if (error == NULL)
+        return NULL;
+
+    PyObject * value = PyLong_FromLong(rc);
+    if (value == NULL || PyObject_SetAttrString(error, "rc", value) < 0)
+    {
+        Py_XDECREF(value);
+        Py_DECREF(error);
+        return NULL;
+    }
+    Py_DECREF(value);
+
+    PyErr_SetObject(SFPError, error);
+    Py_DECREF(error);
+    return NULL;
+
+}
+
+
+// Sample buffer.
+
+typedef struct
+{
+    PyObject_HEAD
+    SFPBusEntry * entries;              // Samples and their channels.
+    Py_ssize_t capacity;
+    Py_ssize_t count;                   // Samples of the last fill.
+} SampleBufferObject;
+
+
+// Field of the samples exported as a column.
+typedef struct
+{
+    Py_ssize_t offset;
+    const char * format;
+    Py_ssize_t itemsize;
+} ColumnSpec;
+
+
+// Strided view of one field of a sample buffer.
+typedef struct
+{
+    PyObject_HEAD
+    SampleBufferObject * buffer;
+    const ColumnSpec * spec;
+} ColumnObject;
+
+
+static PyTypeObject SampleBufferType;
+static PyTypeObject ColumnType;
+
+
+// Exports the samples of a buffer, whole or one field, as a read-only
+// one-dimensional array.
+static int ExportSamples(SampleBufferObject * buffer,
+                         PyObject * owner,
+                         Py_buffer * view,
+                         int flags,
+                         Py_ssize_t offset,
+                         const char * format,
+                         Py_ssize_t itemsize)
+{
+
+    if (flags & PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "sample buffers are read-only");
+        return -1;
+    }
+
+    // A column is not contiguous.
+    const int strided = itemsize != (Py_ssize_t)sizeof(SFPBusEntry);
+    if (strided && (flags & PyBUF_STRIDES) != PyBUF_STRIDES)
+    {
+        PyErr_SetString(PyExc_BufferError, "columns are strided");
+        return -1;
+    }
+
+    // Shape and strides of this export; the count may change afterwards.
+    Py_ssize_t * layout = PyMem_Malloc(2 * sizeof(Py_ssize_t));
+    if (layout == NULL)
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    layout[0] = buffer->count;
+    layout[1] = sizeof(SFPBusEntry);
+
+    view->buf = (char *)buffer->entries + offset;
+    view->obj = owner;
+    Py_INCREF(owner);
+    view->len = buffer->count * itemsize;
+    view->readonly = 1;
+    view->itemsize = itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? (char *)format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? layout : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? layout + 1
+                                                             : NULL;
+    view->suboffsets = NULL;
+    view->internal = layout;
+
+    return 0;
+
+}
+
+
+// Releases an export of ExportSamples().
+static void ReleaseSamples(PyObject * owner, Py_buffer * view)
+{
+    (void)owner;
+    PyMem_Free(view->internal);
+}
+
+
+static PyObject * SampleBufferNew(PyTypeObject * type,
+                                  PyObject * args,
+                                  PyObject * kwargs)
+{
+
+    static char * keywords[] = { "capacity", NULL };
+    Py_ssize_t capacity;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n", keywords, &capacity))
+        return NULL;
+
+    if (capacity <= 0 || capacity > PY_SSIZE_T_MAX / (Py_ssize_t)
+                                    sizeof(SFPBusEntry))
+    {
+        PyErr_SetString(PyExc_ValueError, "invalid capacity");
+        return NULL;
+    }
+
+    SampleBufferObject * self = (SampleBufferObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+
+    self->entries = PyMem_Calloc((size_t)capacity, sizeof(SFPBusEntry));
+    if (self->entries == NULL)
+    {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    self->capacity = capacity;
+
+    return (PyObject *)self;
+
+}
+
+
+static void SampleBufferDealloc(SampleBufferObject * self)
+{
+    PyMem_Free(self->entries);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+
+static Py_ssize_t SampleBufferLength(SampleBufferObject * self)
+{
+    return self->count;
+}
+
+
+static int SampleBufferGetBuffer(SampleBufferObject * self,
+                                 Py_buffer * view,
+                                 int flags)
+{
+    return ExportSamples(self, (PyObject *)self, view, flags, 0,
+                         entry_format, sizeof(SFPBusEntry));
+}
+
+
+static PyObject * SampleBufferCapacity(SampleBufferObject * self,
+                                       void * closure)
+{
+    (void)closure;
+    return PyLong_FromSsize_t(self->capacity);
+}
+
+
+// Returns the column of a field (closure: ColumnSpec pointer).
+static PyObject * SampleBufferColumn(SampleBufferObject * self,
+                                     void * closure)
+{
+
+    ColumnObject * column = PyObject_New(ColumnObject, &ColumnType);
+    if (column == NULL)
+        return NULL;
+
+    Py_INCREF(self);
+    column->buffer = self;
+    column->spec = (const ColumnSpec *)closure;
+
+    return (PyObject *)column;
+
+}
+
+
+#define FIELD(member) offsetof(SFPBusEntry, member)
+
+static const ColumnSpec value_column =
+    { FIELD(sample.value), "q", sizeof(long long) };
+static const ColumnSpec timestamp_column =
+    { FIELD(sample.timestamp_ns), "Q", sizeof(unsigned long long) };
+static const ColumnSpec send_column =
+    { FIELD(sample.send_ns), "Q", sizeof(unsigned long long) };
+static const ColumnSpec done_column =
+    { FIELD(sample.done_ns), "Q", sizeof(unsigned long long) };
+static const ColumnSpec address_column =
+    { FIELD(sample.reg_address), "B", sizeof(byte) };
+static const ColumnSpec length_column =
+    { FIELD(sample.number_of_bytes), "B", sizeof(byte) };
+static const ColumnSpec status_column =
+    { FIELD(sample.status), "B", sizeof(byte) };
+static const ColumnSpec rc_column =
+    { FIELD(sample.rc), "B", sizeof(byte) };
+static const ColumnSpec channel_column =
+    { FIELD(channel), "i", sizeof(int) };
+
+#undef FIELD
+
+
+#define COLUMN(name, spec, doc) \
+    { name, (getter)SampleBufferColumn, NULL, doc, (void *)&spec }
+
+static PyGetSetDef SampleBufferGetSet[] =
+{
+    { "capacity", (getter)SampleBufferCapacity, NULL,
+      "Number of samples the buffer holds.", NULL },
+    COLUMN("value", value_column, "Register data in counts (int64)."),
+    COLUMN("timestamp_ns", timestamp_column,
+           "Estimated sampling instant (uint64)."),
+    COLUMN("send_ns", send_column, "Request time (uint64)."),
+    COLUMN("done_ns", done_column, "Response time (uint64)."),
+    COLUMN("reg_address", address_column, "Register address (uint8)."),
+    COLUMN("number_of_bytes", length_column,
+           "Transaction size, DataLength (uint8)."),
+    COLUMN("status", status_column, "Module status byte (uint8)."),
+    COLUMN("rc", rc_column, "Status flag of the read (uint8)."),
+    COLUMN("channel", channel_column,
+           "Register index of the read (int32)."),
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+#undef COLUMN
+
+
+static PySequenceMethods SampleBufferSequence =
+{
+    .sq_length = (lenfunc)SampleBufferLength,
+};
+
+static PyBufferProcs SampleBufferBuffer =
+{
+    .bf_getbuffer = (getbufferproc)SampleBufferGetBuffer,
+    .bf_releasebuffer = (releasebufferproc)ReleaseSamples,
+};
+
+static PyTypeObject SampleBufferType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "sfp10x.SampleBuffer",
+    .tp_doc = "SampleBuffer(capacity)\n\n"
+              "Preallocated block of samples, filled by read_batch() and\n"
+              "Acquisition.read(). Exports one record per sample through\n"
+              "the buffer protocol; each field is also exported as a\n"
+              "strided column (value, timestamp_ns, ...).",
+    .tp_basicsize = sizeof(SampleBufferObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = SampleBufferNew,
+    .tp_dealloc = (destructor)SampleBufferDealloc,
+    .tp_as_sequence = &SampleBufferSequence,
+    .tp_as_buffer = &SampleBufferBuffer,
+    .tp_getset = SampleBufferGetSet,
+};
+
+
+static void ColumnDealloc(ColumnObject * self)
+{
+    Py_DECREF(self->buffer);
+    PyObject_Free(self);
+}
+
+
+static int ColumnGetBuffer(ColumnObject * self, Py_buffer * view, int flags)
+{
+    return ExportSamples(self->buffer, (PyObject *)self, view, flags,
+                         self->spec->offset, self->spec->format,
+                         self->spec->itemsize);
+}
+
+
+static Py_ssize_t ColumnLength(ColumnObject * self)
+{
+    return self->buffer->count;
+}
+
+
+static PySequenceMethods ColumnSequence =
+{
+    .sq_length = (lenfunc)ColumnLength,
+};
+
+static PyBufferProcs ColumnBuffer =
+{
+    .bf_getbuffer = (getbufferproc)ColumnGetBuffer,
+    .bf_releasebuffer = (releasebufferproc)ReleaseSamples,
+};
+
+static PyTypeObject ColumnType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "sfp10x.Column",
+    .tp_doc = "Strided view of one field of a SampleBuffer.",
+    .tp_basicsize = sizeof(ColumnObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)ColumnDealloc,
+    .tp_as_sequence = &ColumnSequence,
+    .tp_as_buffer = &ColumnBuffer,
+};
+
+
+// Device.
+
+typedef struct
+{
+    PyObject_HEAD
+    SFPDevice device;
+    int open;
+    int acquiring;                      // Owned by an acquisition.
+    PyThread_type_lock lock;            // One transaction at a time.
+} DeviceObject;
+
+
+static PyTypeObject DeviceType;
+
+
+// Raises the exception of a closed device.
+static PyObject * DeviceClosed(void)
+{
+    PyErr_SetString(PyExc_ValueError, "device is closed");
+    return NULL;
+}
+
+
+// Checks that a device can be used by the calling thread. Returns 0 with
+// an exception set if not.
+static int DeviceUsable(DeviceObject * self)
+{
+
+    if (!self->open)
+    {
+        DeviceClosed();
+        return 0;
+    }
+
+    if (self->acquiring)
+    {
+        RaiseStatus(DEVICE_BUSY);
+        return 0;
+    }
+
+    return 1;
+
+}
+
+
+// Takes the transaction lock of a device, with the GIL released. The device
+// may have been closed by another thread since DeviceUsable(): the open flag
+// is only cleared with the lock held, and 0 is returned, without the lock,
+// if it is.
+static int DeviceLock(DeviceObject * self)
+{
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    if (self->open)
+        return 1;
+    PyThread_release_lock(self->lock);
+    return 0;
+}
+
+
+static PyObject * DeviceNew(PyTypeObject * type,
+                            PyObject * args,
+                            PyObject * kwargs)
+{
+
+    static char * keywords[] = { "port", NULL };
+    PyObject * port;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", keywords, &port))
+        return NULL;
+
+    int device_num = 0;
+    const char * tty_path = NULL;
+    if (PyUnicode_Check(port))
+    {
+        tty_path = PyUnicode_AsUTF8(port);
+        if (tty_path == NULL)
+            return NULL;
+    }
+    else
+    {
+        device_num = PyLong_AsLong(port);
+        if (device_num == -1 && PyErr_Occurred())
+            return NULL;
+    }
+
+    DeviceObject * self = (DeviceObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == NULL)
+    {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+
+    byte rc;
+    Py_BEGIN_ALLOW_THREADS
+    rc = tty_path != NULL ? InitializeTTY(tty_path, &self->device)
+                          : Initialize(device_num, &self->device);
+    Py_END_ALLOW_THREADS
+    if (rc != SFP_OK)
+    {
+        Py_DECREF(self);
+        return RaiseStatus(rc);
+    }
+    self->open = 1;
+
+    return (PyObject *)self;
+
+}
+
+
+static void DeviceDealloc(DeviceObject * self)
+{
+    if (self->open)
+        ClosePort(&self->device);
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+
+static PyObject * DeviceClose(DeviceObject * self, PyObject * unused)
+{
+
+    (void)unused;
+    if (self->acquiring)
+        return RaiseStatus(DEVICE_BUSY);
+
+    // The open flag is cleared with the lock held, so that a transaction
+    // waiting for the lock sees it (see DeviceLock()).
+    if (self->open)
+    {
+        Py_BEGIN_ALLOW_THREADS
+        if (DeviceLock(self))
+        {
+            ClosePort(&self->device);
+            self->open = 0;
+            PyThread_release_lock(self->lock);
+        }
+        Py_END_ALLOW_THREADS
+    }
+
+    Py_RETURN_NONE;
+
+}
+
+
+static PyObject * DeviceEnter(DeviceObject * self, PyObject * unused)
+{
+    (void)unused;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static PyObject * DeviceExit(DeviceObject * self, PyObject * args)
+{
+    (void)args;
+    return DeviceClose(self, NULL);
+}
+
+
+static PyObject * DeviceRead(DeviceObject * self, PyObject * args)
+{
+
+    unsigned char reg_address;
+    unsigned char number_of_bytes;
+    if (!PyArg_ParseTuple(args, "bb", &reg_address, &number_of_bytes))
+        return NULL;
+    if (!DeviceUsable(self))
+        return NULL;
+
+    SFPSample sample;
+    byte rc = SFP_OK;
+    int open;
+    Py_BEGIN_ALLOW_THREADS
+    open = DeviceLock(self);
+    if (open)
+    {
+        rc = ReadSample(&self->device, reg_address, number_of_bytes, &sample);
+        PyThread_release_lock(self->lock);
+    }
+    Py_END_ALLOW_THREADS
+    if (!open)
+        return DeviceClosed();
+    if (rc != SFP_OK)
+        return RaiseStatus(rc);
+
+    return PyLong_FromLongLong(sample.value);
+
+}
+
+
+static PyObject * DeviceWrite(DeviceObject * self, PyObject * args)
+{
+
+    unsigned char reg_address;
+    unsigned char number_of_bytes;
+    Py_buffer data;
+    if (!PyArg_ParseTuple(args, "bby*", &reg_address, &number_of_bytes,
+                          &data))
+        return NULL;
+
+    // Copied, the exporter may change while the GIL is released. Invalid
+    // sizes are reported by WriteRegister().
+    char packet[8] = { 0 };
+    const Py_ssize_t size = DataBytes(number_of_bytes);
+    if (data.len < size)
+    {
+        PyBuffer_Release(&data);
+        PyErr_SetString(PyExc_ValueError, "not enough data bytes");
+        return NULL;
+    }
+    memcpy(packet, data.buf, (size_t)size);
+    PyBuffer_Release(&data);
+    if (!DeviceUsable(self))
+        return NULL;
+
+    byte rc = SFP_OK;
+    int open;
+    Py_BEGIN_ALLOW_THREADS
+    open = DeviceLock(self);
+    if (open)
+    {
+        rc = WriteRegister(&self->device, reg_address, number_of_bytes, packet);
+        PyThread_release_lock(self->lock);
+    }
+    Py_END_ALLOW_THREADS
+    if (!open)
+        return DeviceClosed();
+    if (rc != SFP_OK)
+        return RaiseStatus(rc);
+
+    Py_RETURN_NONE;
+
+}
+
+
+// Parses a sequence of (address, length) pairs.
+// Returns the number of registers, -1 with an exception set on error.
+static int ParseRegisters(PyObject * registers,
+                          byte * addresses,
+                          byte * lengths)
+{
+
+    PyObject * sequence = PySequence_Fast(registers,
+                                          "registers must be a sequence");
+    if (sequence == NULL)
+        return -1;
+
+    const Py_ssize_t count = PySequence_Fast_GET_SIZE(sequence);
+    if (count == 0 || count > MAX_BATCH_REGISTERS)
+    {
+        Py_DECREF(sequence);
+        PyErr_SetString(PyExc_ValueError, "invalid number of registers");
+        return -1;
+    }
+
+    for (Py_ssize_t i = 0; i < count; i++)
+    {
+        unsigned char address;
+        unsigned char length;
+        if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(sequence, i), "bb",
+                              &address, &length))
+        {
+            Py_DECREF(sequence);
+            return -1;
+        }
+        addresses[i] = address;
+        lengths[i] = length;
+    }
+
+    Py_DECREF(sequence);
+    return (int)count;
+
+}
+
+
+static PyObject * DeviceReadBatch(DeviceObject * self,
+                                  PyObject * args,
+                                  PyObject * kwargs)
+{
+
+    static char * keywords[] = { "buffer", "registers", "count", NULL };
+    SampleBufferObject * buffer;
+    PyObject * registers;
+    Py_ssize_t count = -1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O|n", keywords,
+                                     &SampleBufferType, &buffer, &registers,
+                                     &count))
+        return NULL;
+
+    byte addresses[MAX_BATCH_REGISTERS];
+    byte lengths[MAX_BATCH_REGISTERS];
+    const int register_count = ParseRegisters(registers, addresses, lengths);
+    if (register_count < 0)
+        return NULL;
+    if (count < 0 || count > buffer->capacity)
+        count = buffer->capacity;
+    if (!DeviceUsable(self))
+        return NULL;
+
+    // The registers are read in turn; failed reads keep their status flag.
+    int open;
+    Py_BEGIN_ALLOW_THREADS
+    open = DeviceLock(self);
+    for (Py_ssize_t i = 0; open && i < count; i++)
+    {
+        const int channel = (int)(i % register_count);
+        SFPBusEntry * entry = &buffer->entries[i];
+        ReadSample(&self->device, addresses[channel], lengths[channel],
+                   &entry->sample);
+        entry->channel = channel;
+    }
+    if (open)
+        PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (!open)
+        return DeviceClosed();
+    buffer->count = count;
+
+    return PyLong_FromSsize_t(count);
+
+}
+
+
+static PyObject * DeviceChangeBaudRate(DeviceObject * self, PyObject * args)
+{
+
+    unsigned char baud_rate;
+    if (!PyArg_ParseTuple(args, "b", &baud_rate))
+        return NULL;
+    if (!DeviceUsable(self))
+        return NULL;
+
+    byte rc = SFP_OK;
+    int open;
+    Py_BEGIN_ALLOW_THREADS
+    open = DeviceLock(self);
+    if (open)
+    {
+        rc = ChangeBaudRate(&self->device, baud_rate);
+        PyThread_release_lock(self->lock);
+    }
+    Py_END_ALLOW_THREADS
+    if (!open)
+        return DeviceClosed();
+    if (rc != SFP_OK)
+        return RaiseStatus(rc);
+
+    Py_RETURN_NONE;
+
+}
+
+
+static PyObject * DeviceChangeTimeout(DeviceObject * self, PyObject * args)
+{
+
+    int timeout_ms;
+    if (!PyArg_ParseTuple(args, "i", &timeout_ms))
+        return NULL;
+    if (!DeviceUsable(self))
+        return NULL;
+
+    byte rc = SFP_OK;
+    int open;
+    Py_BEGIN_ALLOW_THREADS
+    open = DeviceLock(self);
+    if (open)
+    {
+        rc = ChangeTimeout(&self->device, timeout_ms);
+        PyThread_release_lock(self->lock);
+    }
+    Py_END_ALLOW_THREADS
+    if (!open)
+        return DeviceClosed();
+    if (rc != SFP_OK)
+        return RaiseStatus(rc);
+
+    Py_RETURN_NONE;
+
+}
+
+
+static PyMethodDef DeviceMethods[] =
+{
+    { "read", (PyCFunction)DeviceRead, METH_VARARGS,
+      "read(reg_address, number_of_bytes) -> int\n\n"
+      "Reads a register (signed value in counts)." },
+    { "write", (PyCFunction)DeviceWrite, METH_VARARGS,
+      "write(reg_address, number_of_bytes, data)\n\n"
+      "Writes a register from a bytes-like object." },
+    { "read_batch", (PyCFunction)(void (*)(void))DeviceReadBatch,
+      METH_VARARGS | METH_KEYWORDS,
+      "read_batch(buffer, registers, count=-1) -> int\n\n"
+      "Reads count samples (the buffer capacity by default) into a\n"
+      "SampleBuffer, reading the (reg_address, number_of_bytes) pairs in\n"
+      "turn. The channel of a sample is the index of its register. Failed\n"
+      "reads are kept with their status flag (rc column)." },
+    { "change_baud_rate", (PyCFunction)DeviceChangeBaudRate, METH_VARARGS,
+      "change_baud_rate(baud_rate)\n\n"
+      "Changes the baudrate of the module and of the host (BAUD_*)." },
+    { "change_timeout", (PyCFunction)DeviceChangeTimeout, METH_VARARGS,
+      "change_timeout(timeout_ms)\n\nChanges the response timeout." },
+    { "close", (PyCFunction)DeviceClose, METH_NOARGS,
+      "close()\n\nCloses the port." },
+    { "__enter__", (PyCFunction)DeviceEnter, METH_NOARGS, NULL },
+    { "__exit__", (PyCFunction)DeviceExit, METH_VARARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyTypeObject DeviceType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "sfp10x.Device",
+    .tp_doc = "Device(port)\n\n"
+              "Opens a module by D2XX device number (int) or tty path\n"
+              "(str). Blocking calls release the GIL; calls from several\n"
+              "threads are serialized.",
+    .tp_basicsize = sizeof(DeviceObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = DeviceNew,
+    .tp_dealloc = (destructor)DeviceDealloc,
+    .tp_methods = DeviceMethods,
+};
+
+
+// Acquisition.
+
+typedef struct
+{
+    PyObject_HEAD
+    DeviceObject * device;
+    SFPPollSchedule * schedule;
+    SFPBus * bus;
+    SFPAcquisition * acquisition;
+    int subscriber;
+    int running;
+    PyThread_type_lock lock;            // One reader at a time.
+} AcquisitionObject;
+
+
+// Stops the acquisition thread and gives the device back.
+// The bus is closed first: a BLOCK subscriber that no longer reads would
+// otherwise keep the thread waiting in BusPublish().
+static byte StopAcquisition(AcquisitionObject * self)
+{
+
+    if (!self->running)
+        return SFP_OK;
+
+    byte rc;
+    Py_BEGIN_ALLOW_THREADS
+    BusClose(self->bus);
+    rc = AcquisitionStop(self->acquisition);
+    Py_END_ALLOW_THREADS
+    self->running = 0;
+    self->device->acquiring = 0;
+
+    return rc;
+
+}
+
+
+static PyObject * AcquisitionNew(PyTypeObject * type,
+                                 PyObject * args,
+                                 PyObject * kwargs)
+{
+
+    static char * keywords[] = { "device", "registers", "capacity", "policy",
+                                 "depth", "cpu", "priority", NULL };
+    DeviceObject * device;
+    PyObject * registers;
+    unsigned int capacity = SFP_BUS_MAX_CAPACITY;
+    unsigned char policy = SFP_BUS_DROP_OLDEST;
+    unsigned int depth = 0;
+    SFPAcqConfig config = { -1, 0, 0 };
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!O|IbIii", keywords,
+                                     &DeviceType, &device, &registers,
+                                     &capacity, &policy, &depth,
+                                     &config.cpu, &config.priority))
+        return NULL;
+    if (!DeviceUsable(device))
+        return NULL;
+
+    AcquisitionObject * self = (AcquisitionObject *)type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    Py_INCREF(device);
+    self->device = device;
+    self->schedule = PyMem_Malloc(sizeof(SFPPollSchedule));
+    self->bus = PyMem_Malloc(sizeof(SFPBus));
+    self->acquisition = PyMem_Malloc(sizeof(SFPAcquisition));
+    self->lock = PyThread_allocate_lock();
+    if (self->schedule == NULL || self->bus == NULL
+        || self->acquisition == NULL || self->lock == NULL)
+    {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+
+    // Registers: (address, length, rate_hz); the channel is the index.
+    PyObject * sequence = PySequence_Fast(registers,
+                                          "registers must be a sequence");
+    if (sequence == NULL)
+    {
+        Py_DECREF(self);
+        return NULL;
+    }
+    byte rc = PollScheduleInit(self->schedule, SFP_POLL_CYCLIC);
+    for (Py_ssize_t i = 0; rc == SFP_OK
+                           && i < PySequence_Fast_GET_SIZE(sequence); i++)
+    {
+        unsigned char address;
+        unsigned char length;
+        double rate_hz;
+        if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(sequence, i), "bbd",
+                              &address, &length, &rate_hz))
+        {
+            Py_DECREF(sequence);
+            Py_DECREF(self);
+            return NULL;
+        }
+        rc = PollScheduleAdd(self->schedule, address, length, rate_hz,
+                             (int)i, NULL);
+    }
+    Py_DECREF(sequence);
+    if (rc == SFP_OK)
+        rc = PollScheduleBuild(self->schedule, &device->device);
+    if (rc == SFP_OK)
+        rc = BusInit(self->bus, capacity);
+    if (rc == SFP_OK)
+        rc = BusSubscribe(self->bus, policy, depth, &self->subscriber);
+    if (rc != SFP_OK)
+    {
+        Py_DECREF(self);
+        return RaiseStatus(rc);
+    }
+
+    // The thread owns the device until the acquisition stops.
+    device->acquiring = 1;
+    int open;
+    Py_BEGIN_ALLOW_THREADS
+    open = DeviceLock(device);
+    if (open)
+    {
+        rc = AcquisitionStart(self->acquisition, &device->device,
+                              self->schedule, BusSink, self->bus, &config);
+        PyThread_release_lock(device->lock);
+    }
+    Py_END_ALLOW_THREADS
+    if (!open || rc != SFP_OK)
+    {
+        device->acquiring = 0;
+        Py_DECREF(self);
+        return open ? RaiseStatus(rc) : DeviceClosed();
+    }
+    self->running = 1;
+
+    return (PyObject *)self;
+
+}
+
+
+static void AcquisitionDealloc(AcquisitionObject * self)
+{
+    if (self->device != NULL)
+        StopAcquisition(self);
+    Py_XDECREF(self->device);
+    PyMem_Free(self->schedule);
+    PyMem_Free(self->bus);
+    PyMem_Free(self->acquisition);
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+
+static PyObject * AcquisitionRead(AcquisitionObject * self,
+                                  PyObject * args,
+                                  PyObject * kwargs)
+{
+
+    static char * keywords[] = { "buffer", "timeout", NULL };
+    SampleBufferObject * buffer;
+    double timeout = 0.1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O!|d", keywords,
+                                     &SampleBufferType, &buffer, &timeout))
+        return NULL;
+
+    const int max_entries = buffer->capacity < INT_MAX
+                            ? (int)buffer->capacity : INT_MAX;
+    const unsigned long long timeout_ns = timeout > 0.0
+        ? (unsigned long long)(timeout * 1e9) : 0;
+    int count = 0;
+    byte rc;
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    rc = BusRead(self->bus, self->subscriber, buffer->entries, max_entries,
+                 timeout_ns, &count);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (rc != SFP_OK && rc != RESPONSE_TIMEOUT)
+        return RaiseStatus(rc);
+    buffer->count = count;
+
+    return PyLong_FromLong(count);
+
+}
+
+
+static PyObject * AcquisitionStopMethod(AcquisitionObject * self,
+                                        PyObject * unused)
+{
+
+    (void)unused;
+    const byte rc = StopAcquisition(self);
+    if (rc != SFP_OK)
+        return RaiseStatus(rc);
+
+    Py_RETURN_NONE;
+
+}
+
+
+static PyObject * AcquisitionStatsMethod(AcquisitionObject * self,
+                                         PyObject * unused)
+{
+
+    (void)unused;
+    SFPAcqStats acq;
+    SFPBusStats bus;
+    AcquisitionStats(self->acquisition, &acq);
+    BusStats(self->bus, self->subscriber, &bus);
+
+    return Py_BuildValue(
+        "{s:K,s:K,s:d,s:d,s:d,s:d,s:K,s:K,s:K}",
+        "frames", acq.frames,
+        "overruns", acq.overruns,
+        "latency_mean_us", acq.latency_mean_us,
+        "latency_max_us", acq.latency_max_us,
+        "jitter_mean_us", acq.jitter_mean_us,
+        "jitter_max_us", acq.jitter_max_us,
+        "received", bus.received,
+        "dropped", bus.dropped,
+        "lost", bus.overruns);
+
+}
+
+
+static PyObject * AcquisitionEnter(AcquisitionObject * self, PyObject * unused)
+{
+    (void)unused;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+
+static PyObject * AcquisitionExit(AcquisitionObject * self, PyObject * args)
+{
+    (void)args;
+    return AcquisitionStopMethod(self, NULL);
+}
+
+
+static PyMethodDef AcquisitionMethods[] =
+{
+    { "read", (PyCFunction)(void (*)(void))AcquisitionRead,
+      METH_VARARGS | METH_KEYWORDS,
+      "read(buffer, timeout=0.1) -> int\n\n"
+      "Reads the pending samples into a SampleBuffer, waiting at most\n"
+      "timeout seconds for the first one. Returns the number of samples\n"
+      "(0 on timeout). The channel of a sample is the index of its\n"
+      "register." },
+    { "stop", (PyCFunction)AcquisitionStopMethod, METH_NOARGS,
+      "stop()\n\nStops the acquisition thread." },
+    { "stats", (PyCFunction)AcquisitionStatsMethod, METH_NOARGS,
+      "stats() -> dict\n\n"
+      "Frames, overruns, wake-up latency and jitter of the thread, and\n"
+      "samples received, dropped and lost by the reader." },
+    { "__enter__", (PyCFunction)AcquisitionEnter, METH_NOARGS, NULL },
+    { "__exit__", (PyCFunction)AcquisitionExit, METH_VARARGS, NULL },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyTypeObject AcquisitionType =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "sfp10x.Acquisition",
+    .tp_doc = "Acquisition(device, registers, capacity=4096,\n"
+              "            policy=DROP_OLDEST, depth=0, cpu=-1, priority=0)\n"
+              "\n"
+              "Polls the (reg_address, number_of_bytes, rate_hz) registers\n"
+              "on the acquisition thread into a sample ring of capacity\n"
+              "samples (power of 2). The device is busy until stop().",
+    .tp_basicsize = sizeof(AcquisitionObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = AcquisitionNew,
+    .tp_dealloc = (destructor)AcquisitionDealloc,
+    .tp_methods = AcquisitionMethods,
+};
+
+
+// Module.
+
+// Builds the record format of a sample, with its padding.
+static void BuildEntryFormat(void)
+{
+    const int rc_end = (int)(offsetof(SFPBusEntry, sample)
+                             + offsetof(SFPSample, rc) + 1);
+    const int channel = (int)offsetof(SFPBusEntry, channel);
+    const int end = channel + (int)sizeof(int);
+    snprintf(entry_format, sizeof(entry_format),
+             "T{q:value:Q:timestamp_ns:Q:send_ns:Q:done_ns:"
+             "B:reg_address:B:number_of_bytes:B:status:B:rc:"
+             "%dxi:channel:%dx}",
+             channel - rc_end, (int)sizeof(SFPBusEntry) - end);
+}
+
+
+static struct PyModuleDef SFP10XModule =
+{
+    PyModuleDef_HEAD_INIT,
+    .m_name = "sfp10x",
+    .m_doc = "Python interface to Sendyne's SFP modules (SFP10X_COM).",
+    .m_size = -1,
+};
+
+
+PyMODINIT_FUNC PyInit_sfp10x(void)
+{
+
+    BuildEntryFormat();
+    if (PyType_Ready(&SampleBufferType) < 0 || PyType_Ready(&ColumnType) < 0
+        || PyType_Ready(&DeviceType) < 0 || PyType_Ready(&AcquisitionType) < 0)
+        return NULL;
+
+    PyObject * module = PyModule_Create(&SFP10XModule);
+    if (module == NULL)
+        return NULL;
+
+    SFPError = PyErr_NewException("sfp10x.Error", PyExc_RuntimeError, NULL);
+    if (SFPError == NULL || PyModule_AddObjectRef(module, "Error", SFPError) < 0
+        || PyModule_AddObjectRef(module, "SampleBuffer",
+                                 (PyObject *)&SampleBufferType) < 0
+        || PyModule_AddObjectRef(module, "Device",
+                                 (PyObject *)&DeviceType) < 0
+        || PyModule_AddObjectRef(module, "Acquisition",
+                                 (PyObject *)&AcquisitionType) < 0)
+    {
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    // DataLength, Baudrate, BusPolicy and Status enums.
+    if (PyModule_AddIntConstant(module, "BYTES_1", BYTES_1) < 0
+        || PyModule_AddIntConstant(module, "BYTES_2", BYTES_2) < 0
+        || PyModule_AddIntConstant(module, "BYTES_3", BYTES_3) < 0
+        || PyModule_AddIntConstant(module, "BYTES_6", BYTES_6) < 0
+        || PyModule_AddIntConstant(module, "BAUD_9600", SFP_BAUD_9600) < 0
+        || PyModule_AddIntConstant(module, "BAUD_19200", SFP_BAUD_19200) < 0
+        || PyModule_AddIntConstant(module, "BAUD_115200",
+                                   SFP_BAUD_115200) < 0
+        || PyModule_AddIntConstant(module, "BLOCK", SFP_BUS_BLOCK) < 0
+        || PyModule_AddIntConstant(module, "DROP_OLDEST",
+                                   SFP_BUS_DROP_OLDEST) < 0
+        || PyModule_AddIntConstant(module, "DROP_NEWEST",
+                                   SFP_BUS_DROP_NEWEST) < 0
+        || PyModule_AddIntConstant(module, "SFP_OK", SFP_OK) < 0
+        || PyModule_AddIntConstant(module, "RESPONSE_TIMEOUT",
+                                   RESPONSE_TIMEOUT) < 0
+        || PyModule_AddIntConstant(module, "CRC_ERROR", CRC_ERROR) < 0
+        || PyModule_AddIntConstant(module, "DEVICE_BUSY", DEVICE_BUSY) < 0)
+    {
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    return module;
+
+}
+
+
+#undef MAX_BATCH_REGISTERS
@@ -0,0 +1,179 @@
+"""
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    test_sfp10x.py
+
+ Abstract:
+    Tests of the sfp10x extension module against a simulated module on a
+    pseudo-terminal (POSIX only). The responder answers read requests with
+    the register contents and stores the data of write requests; frames
+    carry the CRC-8 (polynomial 0x07) of the library.
+
+    Build the module with the line of the README (-DSFP_NO_D2XX and no
+    -lftd2xx without the D2XX library), then from its directory:
+
+        PYTHONPATH=. python3 Python_wrapper/test_sfp10x.py
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+"""
+
+
+import os
+import select
+import threading
+import time
+import tty
+import unittest
+
+import sfp10x
+
+
+# Number of data bytes of a transaction size (DataLength enum).
+DATA_BYTES = {sfp10x.BYTES_1: 1, sfp10x.BYTES_2: 2,
+              sfp10x.BYTES_3: 3, sfp10x.BYTES_6: 6}
+
+
+def crc8(data):
+    """CRC-8, polynomial 0x07, as computed by the module and the library."""
+    rem = 0
+    for value in data:
+        rem ^= value
+        for _ in range(8):
+            rem = ((rem << 1) ^ 0x07) & 0xFF if rem & 0x80 else rem << 1
+    return rem
+
+
+class Responder(threading.Thread):
+    """Simulated module on the master side of a pseudo-terminal."""
+
+    def __init__(self):
+        super().__init__(daemon=True)
+        self.master, self.slave = os.openpty()
+        tty.setraw(self.slave)
+        self.path = os.ttyname(self.slave)
+        self.registers = {}
+        self.running = True
+
+    def receive(self, length):
+        data = b""
+        while len(data) < length and self.running:
+            ready, _, _ = select.select([self.master], [], [], 0.05)
+            if ready:
+                data += os.read(self.master, length - len(data))
+        return data
+
+    def run(self):
+        while self.running:
+            request = self.receive(2)
+            if len(request) < 2:
+                continue
+            mode, address = request
+            size = DATA_BYTES[mode & 0x03]
+            if mode & 0x80:
+                payload = self.registers.get(address, bytes(size))[:size]
+                frame = request + bytes([0x00]) + payload
+                os.write(self.master, frame[2:] + bytes([crc8(frame)]))
+            else:
+                data = self.receive(size + 1)
+                if crc8(request + data) == 0:
+                    self.registers[address] = data[:size]
+
+    def stop(self):
+        self.running = False
+        self.join()
+        os.close(self.master)
+        os.close(self.slave)
+
+
+class DeviceTest(unittest.TestCase):
+
+    def setUp(self):
+        self.responder = Responder()
+        self.responder.start()
+        self.device = sfp10x.Device(self.responder.path)
+
+    def tearDown(self):
+        self.device.close()
+        self.responder.stop()
+
+    def test_read_sign_extends(self):
+        self.responder.registers[0x52] = (-123456).to_bytes(3, "little",
+                                                            signed=True)
+        self.assertEqual(self.device.read(0x52, sfp10x.BYTES_3), -123456)
+
+    def test_write_then_read(self):
+        self.device.write(0x10, sfp10x.BYTES_2, b"\x34\x12")
+        self.assertEqual(self.device.read(0x10, sfp10x.BYTES_2), 0x1234)
+
+    def test_read_batch(self):
+        self.responder.registers[0x32] = (7).to_bytes(3, "little")
+        self.responder.registers[0x52] = (-7).to_bytes(3, "little",
+                                                       signed=True)
+        buffer = sfp10x.SampleBuffer(8)
+        registers = [(0x32, sfp10x.BYTES_3), (0x52, sfp10x.BYTES_3)]
+        self.assertEqual(self.device.read_batch(buffer, registers), 8)
+        self.assertEqual(memoryview(buffer.value).tolist(), [7, -7] * 4)
+        self.assertEqual(memoryview(buffer.channel).tolist(), [0, 1] * 4)
+
+    def test_closed_device_raises(self):
+        self.device.close()
+        with self.assertRaises(ValueError):
+            self.device.read(0x52, sfp10x.BYTES_3)
+
+    def test_close_while_reading(self):
+        # Reads racing a close either complete or report a closed device,
+        # never a transaction on a closed port.
+        errors = []
+
+        def reader():
+            try:
+                while True:
+                    self.device.read(0x52, sfp10x.BYTES_3)
+            except ValueError:
+                pass
+            except Exception as error:
+                errors.append(error)
+
+        threads = [threading.Thread(target=reader) for _ in range(4)]
+        for thread in threads:
+            thread.start()
+        self.device.close()
+        for thread in threads:
+            thread.join(5.0)
+            self.assertFalse(thread.is_alive())
+        self.assertEqual(errors, [])
+
+    def test_stop_with_stalled_block_subscriber(self):
+        # A BLOCK subscriber that stops reading fills the ring; stopping
+        # must not wait for it.
+        acquisition = sfp10x.Acquisition(
+            self.device, [(0x32, sfp10x.BYTES_3, 20.0)], capacity=16,
+            policy=sfp10x.BLOCK)
+        time.sleep(1.5)
+        stopper = threading.Thread(target=acquisition.stop)
+        stopper.start()
+        stopper.join(5.0)
+        self.assertFalse(stopper.is_alive())
+        buffer = sfp10x.SampleBuffer(32)
+        self.assertEqual(acquisition.read(buffer, timeout=0), 16)
+
+
+if __name__ == "__main__":
+    unittest.main()
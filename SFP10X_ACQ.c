@@ -0,0 +1,342 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_ACQ.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+// CPU sets (thread affinity) are GNU extensions on Linux.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_ACQ.h"
+#include <string.h>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+
+// Poll interval of the start handshake.
+#define SETUP_POLL_NS 100000ULL
+
+
+// Returns the histogram bin of a duration in ns.
+static int HistogramBin(unsigned long long duration_ns)
+{
+    unsigned long long us = duration_ns / 1000ULL;
+    int bin = 0;
+    while (us > 1 && bin < SFP_ACQ_HISTOGRAM_BINS - 1)
+    {
+        us >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+
+// Increments a counter read by other threads (single writer).
+static void Increment(volatile unsigned long long * counter,
+                      unsigned long long value)
+{
+    SFPAtomicStore(counter, *counter + value);
+}
+
+
+// Pins the calling thread to a CPU.
+static byte SetAffinity(int cpu)
+{
+#if defined(_WIN32)
+    if (cpu >= (int)(8 * sizeof(DWORD_PTR)))
+        return BYTES_INVALID;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu)
+           != 0 ? SFP_OK : SCHEDULE_FAIL;
+#elif defined(__linux__)
+    if (cpu >= CPU_SETSIZE)
+        return BYTES_INVALID;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0
+           ? SFP_OK : SCHEDULE_FAIL;
+#else
+    (void)cpu;
+    return SCHEDULE_FAIL;
+#endif
+}
+
+
+// Gives the calling thread a real-time priority.
+static byte SetPriority(int priority)
+{
+#ifdef _WIN32
+    (void)priority;
+    return SetThreadPriority(GetCurrentThread(),
+                             THREAD_PRIORITY_TIME_CRITICAL)
+           ? SFP_OK : SCHEDULE_FAIL;
+#else
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    if (priority < sched_get_priority_min(SCHED_FIFO)
+        || priority > sched_get_priority_max(SCHED_FIFO))
+        return BYTES_INVALID;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0
+           ? SFP_OK : SCHEDULE_FAIL;
+#endif
+}
+
+
+// Touches the stack so that the loop does not take page faults.
+static void PrefaultStack(void)
+{
+    volatile byte stack[SFP_ACQ_STACK_PREFAULT];
+    for (int i = 0; i < SFP_ACQ_STACK_PREFAULT; i += 256)
+        stack[i] = 0;
+    (void)stack[0];
+}
+
+
+// Applies the real-time settings to the calling thread.
+static byte SetupThread(const SFPAcqConfig * config)
+{
+
+    if (config->cpu >= 0)
+    {
+        byte rc = SetAffinity(config->cpu);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    if (config->priority > 0)
+    {
+        byte rc = SetPriority(config->priority);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    if (config->lock_memory)
+        PrefaultStack();
+
+    return SFP_OK;
+
+}
+
+
+// Records the wake-up latency and the period jitter of a frame.
+static void RecordWakeup(SFPAcquisition * acquisition,
+                         unsigned long long scheduled_ns,
+                         unsigned long long wake_ns)
+{
+
+    const unsigned long long latency = wake_ns > scheduled_ns
+                                       ? wake_ns - scheduled_ns : 0;
+    Increment(&acquisition->latency_sum_ns, latency);
+    if (latency > acquisition->latency_max_ns)
+        SFPAtomicStore(&acquisition->latency_max_ns, latency);
+    Increment(&acquisition->latency_histogram[HistogramBin(latency)], 1);
+
+    if (acquisition->previous_ns != 0)
+    {
+        const unsigned long long period = wake_ns - acquisition->previous_ns;
+        const unsigned long long frame = acquisition->schedule->frame_length_ns;
+        const unsigned long long jitter = period > frame ? period - frame
+                                                         : frame - period;
+        Increment(&acquisition->jitter_count, 1);
+        Increment(&acquisition->jitter_sum_ns, jitter);
+        if (jitter > acquisition->jitter_max_ns)
+            SFPAtomicStore(&acquisition->jitter_max_ns, jitter);
+        Increment(&acquisition->jitter_histogram[HistogramBin(jitter)], 1);
+    }
+    acquisition->previous_ns = wake_ns;
+
+}
+
+
+// Acquisition thread: sets itself up, then executes the schedule.
+static SFP_THREAD_FUNC(AcquisitionThread, arg)
+{
+
+    SFPAcquisition * acquisition = (SFPAcquisition *)arg;
+    SFPPollSchedule * schedule = acquisition->schedule;
+
+    acquisition->setup_rc = SetupThread(&acquisition->config);
+    SFPAtomicStore(&acquisition->ready, 1);
+    if (acquisition->setup_rc != SFP_OK)
+        SFP_THREAD_RETURN;
+
+    schedule->next_frame_ns = 0;
+    while (SFPAtomicLoad(&acquisition->running))
+    {
+
+        // Resynchronize if we are more than one frame late.
+        const unsigned long long now = SFPNowNs();
+        if (schedule->next_frame_ns == 0
+            || schedule->next_frame_ns + schedule->frame_length_ns < now)
+        {
+            if (schedule->next_frame_ns != 0)
+                Increment(&acquisition->overruns, 1);
+            schedule->next_frame_ns = now;
+            acquisition->previous_ns = 0;
+        }
+
+        const unsigned long long scheduled = schedule->next_frame_ns;
+        SFPSleepUntilNs(scheduled);
+        RecordWakeup(acquisition, scheduled, SFPNowNs());
+        schedule->next_frame_ns += schedule->frame_length_ns;
+
+        byte rc = PollScheduleStep(acquisition->device, schedule,
+                                   acquisition->sink, acquisition->ctx);
+        Increment(&acquisition->frames, 1);
+        if (rc != SFP_OK)
+        {
+            acquisition->rc = rc;
+            SFPAtomicStore(&acquisition->running, 0);
+        }
+
+    }
+
+    SFP_THREAD_RETURN;
+
+}
+
+
+// Starts executing a built poll schedule on a real-time thread.
+byte AcquisitionStart(SFPAcquisition * acquisition,
+                      SFPDevice * device,
+                      SFPPollSchedule * schedule,
+                      SFPSampleSink sink,
+                      void * ctx,
+                      const SFPAcqConfig * config)
+{
+
+    if (acquisition == NULL || device == NULL || schedule == NULL)
+        return MEM_FAIL;
+
+    if (!schedule->built || schedule->baud_rate != device->sfp_baud_rate)
+        return SCHEDULE_FAIL;
+
+    memset(acquisition, 0, sizeof(SFPAcquisition));
+    acquisition->device = device;
+    acquisition->schedule = schedule;
+    acquisition->sink = sink;
+    acquisition->ctx = ctx;
+    acquisition->config.cpu = -1;
+    if (config != NULL)
+        acquisition->config = *config;
+    acquisition->rc = SFP_OK;
+
+    // Memory locking applies to the whole process.
+    if (acquisition->config.lock_memory)
+    {
+#ifdef _WIN32
+        return MEM_FAIL;
+#else
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+            return MEM_FAIL;
+#endif
+    }
+
+    SFPAtomicStore(&acquisition->running, 1);
+    if (SFPThreadStart(&acquisition->thread, AcquisitionThread,
+                       acquisition) != 0)
+        return MEM_FAIL;
+
+    while (!SFPAtomicLoad(&acquisition->ready))
+        SFPSleepUntilNs(SFPNowNs() + SETUP_POLL_NS);
+
+    if (acquisition->setup_rc != SFP_OK)
+    {
+        SFPThreadJoin(acquisition->thread);
+        return acquisition->setup_rc;
+    }
+    acquisition->started = 1;
+
+    return SFP_OK;
+
+}
+
+
+// Stops an acquisition.
+byte AcquisitionStop(SFPAcquisition * acquisition)
+{
+
+    if (acquisition == NULL)
+        return MEM_FAIL;
+
+    if (!acquisition->started)
+        return DEVICE_BUSY;
+
+    SFPAtomicStore(&acquisition->running, 0);
+    SFPThreadJoin(acquisition->thread);
+    acquisition->started = 0;
+
+    return acquisition->rc;
+
+}
+
+
+// Gets the acquisition statistics.
+byte AcquisitionStats(SFPAcquisition * acquisition, SFPAcqStats * stats)
+{
+
+    if (acquisition == NULL || stats == NULL)
+        return MEM_FAIL;
+
+    memset(stats, 0, sizeof(SFPAcqStats));
+    stats->overruns = SFPAtomicLoad(&acquisition->overruns);
+    for (int i = 0; i < SFP_ACQ_HISTOGRAM_BINS; i++)
+    {
+        stats->latency_histogram[i] =
+            SFPAtomicLoad(&acquisition->latency_histogram[i]);
+        stats->jitter_histogram[i] =
+            SFPAtomicLoad(&acquisition->jitter_histogram[i]);
+    }
+
+    // The wake-up count is the sum of the histogram, read in the same pass.
+    unsigned long long wakeups = 0;
+    for (int i = 0; i < SFP_ACQ_HISTOGRAM_BINS; i++)
+        wakeups += stats->latency_histogram[i];
+    stats->frames = SFPAtomicLoad(&acquisition->frames);
+
+    const unsigned long long jitters =
+        SFPAtomicLoad(&acquisition->jitter_count);
+    if (wakeups > 0)
+        stats->latency_mean_us = (double)SFPAtomicLoad(
+            &acquisition->latency_sum_ns) / (double)wakeups / 1e3;
+    stats->latency_max_us =
+        (double)SFPAtomicLoad(&acquisition->latency_max_ns) / 1e3;
+    if (jitters > 0)
+        stats->jitter_mean_us = (double)SFPAtomicLoad(
+            &acquisition->jitter_sum_ns) / (double)jitters / 1e3;
+    stats->jitter_max_us =
+        (double)SFPAtomicLoad(&acquisition->jitter_max_ns) / 1e3;
+
+    return SFP_OK;
+
+}
+
+
+#undef SETUP_POLL_NS
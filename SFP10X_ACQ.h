@@ -0,0 +1,162 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_ACQ.h
+
+ Abstract:
+    Real-time acquisition. A poll schedule (see SFP10X_POLL.h) is executed
+    by a thread owned by the library, which can be pinned to a CPU, run with
+    the SCHED_FIFO real-time policy and have the process memory locked. The
+    loop itself performs no allocation, no logging and no system call other
+    than the sleep and the device I/O; the samples are passed to the sink
+    from the acquisition thread.
+
+    Every minor frame, the thread records its wake-up latency (the delay
+    between the scheduled frame start and the actual wake-up) and its period
+    jitter (the deviation of the interval between two wake-ups from the
+    minor frame length), in histograms that can be read at any time.
+
+    CPU affinity is supported on Linux and Windows, the real-time priority
+    on POSIX platforms (time critical priority on Windows) and memory
+    locking on POSIX platforms. Requesting a setting that cannot be applied
+    (unsupported, or insufficient privileges) makes the start fail rather
+    than run without it.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_ACQ_LIB
+#define SFP10X_ACQ_LIB
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_POLL.h"
+
+
+// Number of histogram bins. Bin i counts the values in [2^i, 2^(i+1))
+// microseconds (bin 0 everything below 2 us), the last bin everything above.
+#define SFP_ACQ_HISTOGRAM_BINS 24
+
+// Stack touched by the acquisition thread when memory is locked.
+#define SFP_ACQ_STACK_PREFAULT 65536
+
+
+// Data structure for the real-time settings of the acquisition thread.
+typedef struct SFPAcqConfig_
+{
+    int cpu;                            // CPU of the thread, -1 for any.
+    int priority;                       // SCHED_FIFO priority (1 to 99), 0
+                                        // for the default policy.
+    int lock_memory;                    // Non-zero to lock the current and
+                                        // future pages of the process.
+} SFPAcqConfig;
+
+
+// Data structure for the acquisition statistics.
+typedef struct SFPAcqStats_
+{
+    unsigned long long frames;          // Minor frames executed.
+    unsigned long long overruns;        // Frames started more than one frame
+                                        // late (the schedule resynchronized).
+    double latency_mean_us;             // Mean wake-up latency.
+    double latency_max_us;              // Largest wake-up latency.
+    double jitter_mean_us;              // Mean absolute period deviation.
+    double jitter_max_us;               // Largest absolute period deviation.
+    unsigned long long latency_histogram[SFP_ACQ_HISTOGRAM_BINS];
+    unsigned long long jitter_histogram[SFP_ACQ_HISTOGRAM_BINS];
+} SFPAcqStats;
+
+
+// Data structure for an acquisition.
+// Members are managed by the Acquisition functions.
+typedef struct SFPAcquisition_
+{
+    SFPDevice * device;                 // Device read by the thread.
+    SFPPollSchedule * schedule;         // Executed schedule.
+    SFPSampleSink sink;
+    void * ctx;
+    SFPAcqConfig config;
+    SFPThread thread;                   // Acquisition thread.
+    int started;                        // Non-zero until stopped.
+    volatile unsigned long long running;    // Cleared to stop the thread.
+    volatile unsigned long long ready;      // Set once the thread is set up.
+    byte setup_rc;                      // Status of the thread setup.
+    byte rc;                            // Status of the loop.
+    unsigned long long previous_ns;     // Previous wake-up, 0 after a resync.
+    volatile unsigned long long frames;
+    volatile unsigned long long overruns;
+    volatile unsigned long long latency_sum_ns;
+    volatile unsigned long long latency_max_ns;
+    volatile unsigned long long jitter_count;
+    volatile unsigned long long jitter_sum_ns;
+    volatile unsigned long long jitter_max_ns;
+    volatile unsigned long long latency_histogram[SFP_ACQ_HISTOGRAM_BINS];
+    volatile unsigned long long jitter_histogram[SFP_ACQ_HISTOGRAM_BINS];
+} SFPAcquisition;
+
+
+/** Starts executing a built poll schedule on a real-time thread.
+ *
+ *	Accepts         SFPAcquisition pointer, SFPDevice pointer, SFPPollSchedule
+ *                  pointer, a sample sink, its context and an (optional)
+ *                  SFPAcqConfig pointer.
+ *
+ *	config          real-time settings, NULL for none.
+ *
+ *	Returns         status flag. SCHEDULE_FAIL is returned if the schedule is
+ *                  not built or if the thread cannot get the requested CPU
+ *                  or priority, BYTES_INVALID if the CPU or the priority is
+ *                  out of range and MEM_FAIL if memory cannot be locked.
+ *
+ *  Until the acquisition is stopped, the device and the schedule must not
+ *  be used by other threads. Locked memory stays locked after the stop.
+ */
+byte AcquisitionStart(SFPAcquisition * acquisition,
+                      SFPDevice * device,
+                      SFPPollSchedule * schedule,
+                      SFPSampleSink sink,
+                      void * ctx,
+                      const SFPAcqConfig * config);
+
+
+/** Stops an acquisition.
+ *
+ *	Accepts         SFPAcquisition pointer.
+ *
+ *	Returns         status flag. The status of the loop is returned (PORT_FAIL
+ *                  if the port was closed) and DEVICE_BUSY if the acquisition
+ *                  was not running.
+ *
+ *  A sink that may block must be released first (BusClose() for BusSink).
+ */
+byte AcquisitionStop(SFPAcquisition * acquisition);
+
+
+/** Gets the acquisition statistics (any thread).
+ *
+ *	Accepts         SFPAcquisition pointer and SFPAcqStats pointer.
+ *
+ *	Returns         status flag.
+ */
+byte AcquisitionStats(SFPAcquisition * acquisition, SFPAcqStats * stats);
+
+
+#endif  // SFP10X_ACQ_LIB
@@ -0,0 +1,224 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_AGG.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_AGG.h"
+#include <math.h>
+#include <string.h>
+
+
+// Emits the summary of a window and resets it.
+static void CloseWindow(SFPAggregator * aggregator, int index)
+{
+
+    SFPAggWindow * window = &aggregator->windows[index];
+    if (window->count > 0 || window->errors > 0)
+    {
+        SFPSummary summary;
+        summary.window = index;
+        summary.channel = window->channel;
+        summary.start_ns = window->start_ns;
+        summary.length_ns = window->length_ns;
+        summary.count = window->count;
+        summary.errors = window->errors;
+        summary.first_ns = window->first_ns;
+        summary.last_ns = window->last_ns;
+        if (window->count > 0)
+        {
+            const double n = (double)window->count;
+            summary.min = window->min;
+            summary.max = window->max;
+            summary.mean = window->sum / n;
+            summary.rms = sqrt(window->sum2 / n);
+        }
+        else
+        {
+            summary.min = summary.max = summary.mean = summary.rms = 0.0;
+        }
+
+        if (aggregator->sink != NULL)
+            aggregator->sink(aggregator->ctx, &summary);
+        aggregator->summaries++;
+    }
+
+    window->count = 0;
+    window->errors = 0;
+    window->sum = 0.0;
+    window->sum2 = 0.0;
+    window->first_ns = 0;
+    window->last_ns = 0;
+
+}
+
+
+// Initializes an aggregator.
+byte AggregatorInit(SFPAggregator * aggregator,
+                    SFPSummarySink sink,
+                    void * ctx)
+{
+
+    if (aggregator == NULL)
+        return MEM_FAIL;
+
+    memset(aggregator, 0, sizeof(SFPAggregator));
+    aggregator->sink = sink;
+    aggregator->ctx = ctx;
+
+    return SFP_OK;
+
+}
+
+
+// Adds a window to an aggregator.
+byte AggregatorAddWindow(SFPAggregator * aggregator,
+                         int channel,
+                         unsigned long long length_ns,
+                         int * window)
+{
+
+    if (aggregator == NULL)
+        return MEM_FAIL;
+
+    if (aggregator->window_count == SFP_AGG_MAX_WINDOWS)
+        return MEM_FAIL;
+
+    if (length_ns == 0)
+        return BYTES_INVALID;
+
+    SFPAggWindow * added = &aggregator->windows[aggregator->window_count];
+    memset(added, 0, sizeof(SFPAggWindow));
+    added->channel = channel;
+    added->length_ns = length_ns;
+    if (window != NULL)
+        *window = aggregator->window_count;
+    aggregator->window_count++;
+
+    return SFP_OK;
+
+}
+
+
+// Aggregates a sample of a channel.
+byte AggregatorPush(SFPAggregator * aggregator,
+                    int channel,
+                    const SFPSample * sample)
+{
+
+    if (aggregator == NULL || sample == NULL)
+        return MEM_FAIL;
+
+    const unsigned long long t = sample->timestamp_ns;
+    const double value = (double)sample->value;
+
+    for (int i = 0; i < aggregator->window_count; i++)
+    {
+
+        SFPAggWindow * window = &aggregator->windows[i];
+        if (window->channel != channel)
+            continue;
+
+        // Move to the window of the sample.
+        if (t >= window->start_ns + window->length_ns)
+        {
+            CloseWindow(aggregator, i);
+            window->start_ns = t - t % window->length_ns;
+        }
+
+        if (sample->rc != SFP_OK)
+        {
+            window->errors++;
+            continue;
+        }
+
+        if (window->count == 0)
+        {
+            window->min = value;
+            window->max = value;
+            window->first_ns = t;
+        }
+        else
+        {
+            if (value < window->min)
+                window->min = value;
+            if (value > window->max)
+                window->max = value;
+        }
+        window->count++;
+        window->sum += value;
+        window->sum2 += value * value;
+        window->last_ns = t;
+
+    }
+
+    aggregator->samples++;
+
+    return SFP_OK;
+
+}
+
+
+// Closes the windows that end at or before a given time.
+byte AggregatorAdvance(SFPAggregator * aggregator, unsigned long long now_ns)
+{
+
+    if (aggregator == NULL)
+        return MEM_FAIL;
+
+    for (int i = 0; i < aggregator->window_count; i++)
+    {
+        SFPAggWindow * window = &aggregator->windows[i];
+        if (now_ns >= window->start_ns + window->length_ns)
+        {
+            CloseWindow(aggregator, i);
+            window->start_ns = now_ns - now_ns % window->length_ns;
+        }
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Closes all the open windows.
+byte AggregatorFlush(SFPAggregator * aggregator)
+{
+
+    if (aggregator == NULL)
+        return MEM_FAIL;
+
+    for (int i = 0; i < aggregator->window_count; i++)
+        CloseWindow(aggregator, i);
+
+    return SFP_OK;
+
+}
+
+
+// Sample sink feeding an aggregator.
+void AggregatorSink(void * ctx, int channel, const SFPSample * sample)
+{
+    AggregatorPush((SFPAggregator *)ctx, channel, sample);
+}
@@ -0,0 +1,176 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_AGG.h
+
+ Abstract:
+    Streaming aggregation of sampled channels. An aggregator keeps, for each
+    declared window, the count, minimum, maximum, sum and sum of squares of
+    the samples of a channel, and emits a summary (min, max, mean, RMS,
+    count, first and last timestamps) when the window closes. A channel may
+    have several windows of different lengths (e.g. 1 s and 1 min).
+
+    Windows are consecutive intervals of their length on the host monotonic
+    clock, aligned on multiples of the length. A window closes when a sample
+    of a later window arrives, or when AggregatorAdvance() is called past its
+    end. Windows without samples are not reported.
+
+    Each sample costs a constant amount of work per window of its channel;
+    the state is preallocated and nothing is allocated per sample.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_AGG_LIB
+#define SFP10X_AGG_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum number of windows of an aggregator.
+#define SFP_AGG_MAX_WINDOWS 32
+
+
+// Data structure for the summary of a closed window.
+typedef struct SFPSummary_
+{
+    int window;                         // Window index.
+    int channel;                        // Channel of the window.
+    unsigned long long start_ns;        // Start of the window.
+    unsigned long long length_ns;       // Length of the window.
+    unsigned long long count;           // Number of samples.
+    unsigned long long errors;          // Number of failed reads.
+    double min;                         // Smallest value, in counts.
+    double max;                         // Largest value, in counts.
+    double mean;                        // Mean value, in counts.
+    double rms;                         // Root mean square, in counts.
+    unsigned long long first_ns;        // Timestamp of the first sample.
+    unsigned long long last_ns;         // Timestamp of the last sample.
+} SFPSummary;
+
+
+// Summary consumer callback.
+typedef void (*SFPSummarySink)(void * ctx, const SFPSummary * summary);
+
+
+// Data structure for an aggregation window.
+// Members are managed by the Aggregator functions.
+typedef struct SFPAggWindow_
+{
+    int channel;                        // Aggregated channel.
+    unsigned long long length_ns;       // Window length.
+    unsigned long long start_ns;        // Start of the open window.
+    unsigned long long count;           // Samples in the open window.
+    unsigned long long errors;          // Failed reads in the open window.
+    double sum;                         // Sum of the values.
+    double sum2;                        // Sum of the squared values.
+    double min;
+    double max;
+    unsigned long long first_ns;
+    unsigned long long last_ns;
+} SFPAggWindow;
+
+
+// Data structure for an aggregator.
+typedef struct SFPAggregator_
+{
+    SFPAggWindow windows[SFP_AGG_MAX_WINDOWS];
+    int window_count;                   // Number of windows.
+    SFPSummarySink sink;                // Summary consumer.
+    void * ctx;                         // Summary consumer context.
+    unsigned long long samples;         // Number of aggregated samples.
+    unsigned long long summaries;       // Number of emitted summaries.
+} SFPAggregator;
+
+
+/** Initializes an aggregator.
+ *
+ *	Accepts         SFPAggregator pointer and a summary sink with its context.
+ *
+ *	Returns         status flag.
+ */
+byte AggregatorInit(SFPAggregator * aggregator,
+                    SFPSummarySink sink,
+                    void * ctx);
+
+
+/** Adds a window to an aggregator.
+ *
+ *	Accepts         SFPAggregator pointer, channel, window length and an
+ *                  (optional) int pointer receiving the window index.
+ *
+ *	channel         channel of the samples to aggregate (e.g. the poll
+ *                  schedule entry).
+ *
+ *	length_ns       window length, in nanoseconds.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if there are too many
+ *                  windows and BYTES_INVALID if the length is 0.
+ */
+byte AggregatorAddWindow(SFPAggregator * aggregator,
+                         int channel,
+                         unsigned long long length_ns,
+                         int * window);
+
+
+/** Aggregates a sample of a channel.
+ *
+ *	Accepts         SFPAggregator pointer, channel and SFPSample pointer.
+ *
+ *	Returns         status flag. Failed samples (rc) are only counted as
+ *                  errors of the window.
+ *
+ *  The samples of a channel must be pushed in time order.
+ */
+byte AggregatorPush(SFPAggregator * aggregator,
+                    int channel,
+                    const SFPSample * sample);
+
+
+/** Closes the windows that end at or before a given time.
+ *
+ *	Accepts         SFPAggregator pointer and a host monotonic time.
+ *
+ *	Returns         status flag.
+ *
+ *  Lets windows close on time when their channel is not sampled anymore.
+ */
+byte AggregatorAdvance(SFPAggregator * aggregator, unsigned long long now_ns);
+
+
+/** Closes all the open windows, e.g. at the end of an acquisition.
+ *
+ *	Accepts         SFPAggregator pointer.
+ *
+ *	Returns         status flag.
+ */
+byte AggregatorFlush(SFPAggregator * aggregator);
+
+
+/** Sample sink feeding an aggregator (see SFPSampleSink).
+ *
+ *	ctx             SFPAggregator pointer.
+ */
+void AggregatorSink(void * ctx, int channel, const SFPSample * sample);
+
+
+#endif  // SFP10X_AGG_LIB
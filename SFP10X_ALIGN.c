@@ -0,0 +1,235 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_ALIGN.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_ALIGN.h"
+#include <string.h>
+
+
+// Ring index of the i-th kept sample of a channel (0 is the oldest).
+#define AT(channel, i) (((channel)->head + (i)) % SFP_ALIGN_HISTORY)
+
+
+// Returns non-zero if the frame at next_ns can be emitted.
+static int FrameReady(const SFPAligner * aligner)
+{
+
+    const unsigned long long t = aligner->next_ns;
+
+    for (int c = 0; c < aligner->channel_count; c++)
+    {
+        const SFPAlignChannel * channel = &aligner->channels[c];
+        if (channel->count > 0
+            && channel->times[AT(channel, channel->count - 1)] >= t)
+            continue;
+
+        // A lagging channel only holds the frame back for max_delay_ns.
+        if (aligner->max_delay_ns == 0
+            || aligner->newest_ns < t + aligner->max_delay_ns)
+            return 0;
+    }
+
+    return 1;
+
+}
+
+
+// Resamples a channel at instant t. Returns zero if there is no value.
+static int Resample(const SFPAlignChannel * channel,
+                    unsigned long long t,
+                    double * value)
+{
+
+    // Last sample at or before t, and the sample after it.
+    int a = -1;
+    while (a + 1 < channel->count && channel->times[AT(channel, a + 1)] <= t)
+        a++;
+    const int b = a + 1 < channel->count ? a + 1 : -1;
+
+    if (a < 0)
+    {
+        // Only the nearest method may look ahead of the first sample.
+        if (channel->method != SFP_ALIGN_NEAREST || b < 0)
+            return 0;
+        *value = channel->values[AT(channel, b)];
+        return 1;
+    }
+
+    const unsigned long long ta = channel->times[AT(channel, a)];
+    const double va = channel->values[AT(channel, a)];
+    if (b < 0 || channel->method == SFP_ALIGN_HOLD || ta == t)
+    {
+        *value = va;
+        return 1;
+    }
+
+    const unsigned long long tb = channel->times[AT(channel, b)];
+    const double vb = channel->values[AT(channel, b)];
+    if (channel->method == SFP_ALIGN_NEAREST)
+        *value = (t - ta) <= (tb - t) ? va : vb;
+    else
+        *value = va + (vb - va) * (double)(t - ta) / (double)(tb - ta);
+
+    return 1;
+
+}
+
+
+// Emits the frame at next_ns and moves to the next frame.
+static void EmitFrame(SFPAligner * aligner)
+{
+
+    SFPAlignedFrame * frame = &aligner->frame;
+    frame->timestamp_ns = aligner->next_ns;
+    frame->channel_count = aligner->channel_count;
+    for (int c = 0; c < aligner->channel_count; c++)
+    {
+        frame->valid[c] = (byte)Resample(&aligner->channels[c],
+                                         aligner->next_ns,
+                                         &frame->values[c]);
+        if (!frame->valid[c])
+            frame->values[c] = 0.0;
+    }
+
+    if (aligner->sink != NULL)
+        aligner->sink(aligner->ctx, frame);
+    aligner->frames++;
+    aligner->next_ns += aligner->period_ns;
+
+    // Only the last sample at or before the next frame is still needed.
+    for (int c = 0; c < aligner->channel_count; c++)
+    {
+        SFPAlignChannel * channel = &aligner->channels[c];
+        while (channel->count >= 2
+               && channel->times[AT(channel, 1)] <= aligner->next_ns)
+        {
+            channel->head = AT(channel, 1);
+            channel->count--;
+        }
+    }
+
+}
+
+
+// Initializes an aligner.
+byte AlignerInit(SFPAligner * aligner,
+                 unsigned long long period_ns,
+                 SFPFrameSink sink,
+                 void * ctx)
+{
+
+    if (aligner == NULL)
+        return MEM_FAIL;
+
+    if (period_ns == 0)
+        return BYTES_INVALID;
+
+    memset(aligner, 0, sizeof(SFPAligner));
+    aligner->period_ns = period_ns;
+    aligner->sink = sink;
+    aligner->ctx = ctx;
+
+    return SFP_OK;
+
+}
+
+
+// Adds a channel to an aligner.
+byte AlignerAddChannel(SFPAligner * aligner, byte method, int * channel)
+{
+
+    if (aligner == NULL)
+        return MEM_FAIL;
+
+    if (aligner->channel_count == SFP_ALIGN_MAX_CHANNELS)
+        return MEM_FAIL;
+
+    if (method > SFP_ALIGN_HOLD || aligner->next_ns != 0)
+        return BYTES_INVALID;
+
+    aligner->channels[aligner->channel_count].method = method;
+    if (channel != NULL)
+        *channel = aligner->channel_count;
+    aligner->channel_count++;
+
+    return SFP_OK;
+
+}
+
+
+// Pushes a sample of a channel and emits the frames it completes.
+byte AlignerPush(SFPAligner * aligner, int channel, const SFPSample * sample)
+{
+
+    if (aligner == NULL || sample == NULL)
+        return MEM_FAIL;
+
+    if (channel < 0 || channel >= aligner->channel_count)
+        return BYTES_INVALID;
+
+    SFPAlignChannel * target = &aligner->channels[channel];
+    const unsigned long long t = sample->timestamp_ns;
+    if (sample->rc != SFP_OK
+        || (target->count > 0 && t <= target->times[AT(target, target->count - 1)]))
+    {
+        target->dropped++;
+        return SFP_OK;
+    }
+
+    if (target->count == SFP_ALIGN_HISTORY)
+    {
+        target->head = AT(target, 1);
+        target->count--;
+        target->overruns++;
+    }
+    target->times[AT(target, target->count)] = t;
+    target->values[AT(target, target->count)] = (double)sample->value;
+    target->count++;
+
+    if (t > aligner->newest_ns)
+        aligner->newest_ns = t;
+
+    // The timebase is the grid of multiples of the period.
+    if (aligner->next_ns == 0)
+        aligner->next_ns = (t + aligner->period_ns - 1)
+                           / aligner->period_ns * aligner->period_ns;
+
+    while (FrameReady(aligner))
+        EmitFrame(aligner);
+
+    return SFP_OK;
+
+}
+
+
+// Sample sink feeding an aligner.
+void AlignerSink(void * ctx, int channel, const SFPSample * sample)
+{
+    AlignerPush((SFPAligner *)ctx, channel, sample);
+}
+
+
+#undef AT
@@ -0,0 +1,166 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_ALIGN.h
+
+ Abstract:
+    Time alignment of sampled channels. An aligner resamples channels from
+    one or more devices onto a common timebase: a regular grid of instants,
+    multiple of the aligner period on the host monotonic clock, so that the
+    frames of aligners with the same period line up. Each channel is
+    resampled by nearest neighbour, linear interpolation or zero-order hold
+    of its sample timestamps (SFPSample timestamp_ns).
+
+    The aligner is streaming: samples are pushed as they are read, per
+    channel in time order, and a frame is emitted as soon as every channel
+    has a sample at or after the frame instant. A channel that lags by more
+    than max_delay_ns no longer holds the frames back; its last value is
+    held instead. The aligner does not allocate memory.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_ALIGN_LIB
+#define SFP10X_ALIGN_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum number of channels of an aligner.
+#define SFP_ALIGN_MAX_CHANNELS 16
+
+// Number of samples kept per channel while waiting for the other channels.
+#define SFP_ALIGN_HISTORY 32
+
+
+// Enumeration type for the resampling methods.
+enum AlignMethod
+{
+    SFP_ALIGN_NEAREST = 0x00,   // Sample closest to the frame instant.
+    SFP_ALIGN_LINEAR = 0x01,    // Linear interpolation between the samples
+                                // around the frame instant.
+    SFP_ALIGN_HOLD = 0x02       // Last sample at or before the frame instant.
+};
+
+
+// Data structure for an aligned frame.
+typedef struct SFPAlignedFrame_
+{
+    unsigned long long timestamp_ns;            // Frame instant.
+    int channel_count;                          // Number of channels.
+    double values[SFP_ALIGN_MAX_CHANNELS];      // Resampled values, in counts.
+    byte valid[SFP_ALIGN_MAX_CHANNELS];         // Zero if a channel has no
+                                                // value at the frame instant.
+} SFPAlignedFrame;
+
+
+// Aligned frame consumer callback.
+typedef void (*SFPFrameSink)(void * ctx, const SFPAlignedFrame * frame);
+
+
+// Data structure for an aligned channel.
+// Members are managed by the Aligner functions.
+typedef struct SFPAlignChannel_
+{
+    byte method;                                // AlignMethod enum.
+    int head;                                   // Oldest kept sample.
+    int count;                                  // Number of kept samples.
+    unsigned long long times[SFP_ALIGN_HISTORY];// Sample timestamps.
+    double values[SFP_ALIGN_HISTORY];           // Sample values.
+    unsigned long long dropped;                 // Failed or out of order
+                                                // samples.
+    unsigned long long overruns;                // Samples discarded because
+                                                // the history was full.
+} SFPAlignChannel;
+
+
+// Data structure for an aligner.
+// The max_delay_ns member may be changed at any time.
+typedef struct SFPAligner_
+{
+    SFPAlignChannel channels[SFP_ALIGN_MAX_CHANNELS];
+    int channel_count;                  // Number of channels.
+    unsigned long long period_ns;       // Frame period.
+    unsigned long long max_delay_ns;    // Largest lag of a channel behind the
+                                        // newest sample before its value is
+                                        // held, 0 to always wait.
+    unsigned long long next_ns;         // Instant of the next frame, 0 until
+                                        // the first sample.
+    unsigned long long newest_ns;       // Newest sample timestamp.
+    unsigned long long frames;          // Number of emitted frames.
+    SFPFrameSink sink;                  // Frame consumer.
+    void * ctx;                         // Frame consumer context.
+    SFPAlignedFrame frame;              // Frame being emitted.
+} SFPAligner;
+
+
+/** Initializes an aligner.
+ *
+ *	Accepts         SFPAligner pointer, frame period and a frame sink with its
+ *                  context.
+ *
+ *	period_ns       frame period, in nanoseconds.
+ *
+ *	Returns         status flag.
+ */
+byte AlignerInit(SFPAligner * aligner,
+                 unsigned long long period_ns,
+                 SFPFrameSink sink,
+                 void * ctx);
+
+
+/** Adds a channel to an aligner.
+ *
+ *	Accepts         SFPAligner pointer, resampling method and an (optional)
+ *                  int pointer receiving the channel index.
+ *
+ *	method          resampling method, see the AlignMethod enum.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if there are too many
+ *                  channels and BYTES_INVALID if the method is invalid or
+ *                  samples were already pushed.
+ *
+ *  Channels must be added before the first sample is pushed.
+ */
+byte AlignerAddChannel(SFPAligner * aligner, byte method, int * channel);
+
+
+/** Pushes a sample of a channel and emits the frames it completes.
+ *
+ *	Accepts         SFPAligner pointer, channel index and SFPSample pointer.
+ *
+ *	Returns         status flag. Failed samples (rc) and samples older than
+ *                  the previous sample of the channel are ignored and
+ *                  counted as dropped.
+ */
+byte AlignerPush(SFPAligner * aligner, int channel, const SFPSample * sample);
+
+
+/** Sample sink feeding an aligner (see SFPSampleSink).
+ *
+ *	ctx             SFPAligner pointer. The producer's channel is used as
+ *                  the aligner channel (e.g. the poll schedule entry).
+ */
+void AlignerSink(void * ctx, int channel, const SFPSample * sample);
+
+
+#endif  // SFP10X_ALIGN_LIB
@@ -0,0 +1,384 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_BUS.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_BUS.h"
+#include <string.h>
+
+
+// Polls before a waiting thread starts sleeping, and sleep between polls.
+#define SPIN_COUNT 256
+#define SLEEP_NS 20000ULL
+
+
+// Waits a little, spinning first.
+static void Backoff(int * spins)
+{
+    if (*spins < SPIN_COUNT)
+        (*spins)++;
+    else
+        SFPSleepUntilNs(SFPNowNs() + SLEEP_NS);
+}
+
+
+// Observer callback publishing the reads of the attached device.
+static void BusOnRead(void * ctx, SFPDevice * device, const SFPSample * sample)
+{
+    (void)device;
+    BusPublish((SFPBus *)ctx, sample->reg_address, sample);
+}
+
+
+// Updates the lag statistics of a subscriber.
+static void RecordLag(SFPBusSubscriber * sub, unsigned long long lag)
+{
+    SFPAtomicStore(&sub->lag, lag);
+    if (lag > sub->max_lag)
+        SFPAtomicStore(&sub->max_lag, lag);
+}
+
+
+// Applies the drop policy of a subscriber before a read.
+static void ApplyPolicy(SFPBusSubscriber * sub,
+                        unsigned long long cursor,
+                        unsigned long long head,
+                        unsigned long long * next)
+{
+
+    *next = cursor;
+    if (sub->policy == SFP_BUS_DROP_OLDEST && head - cursor > sub->depth)
+    {
+        *next = head - sub->depth;
+    }
+    else if (sub->policy == SFP_BUS_DROP_NEWEST)
+    {
+        // The kept samples were read, skip to the newest sample.
+        if (sub->window_end != 0 && cursor >= sub->window_end)
+        {
+            *next = head;
+            sub->window_end = 0;
+        }
+        else if (sub->window_end == 0 && head - cursor > sub->depth)
+        {
+            sub->window_end = cursor + sub->depth;
+        }
+    }
+
+    if (*next != cursor)
+        SFPAtomicStore(&sub->dropped, sub->dropped + (*next - cursor));
+
+}
+
+
+// Initializes a bus.
+byte BusInit(SFPBus * bus, unsigned int capacity)
+{
+
+    if (bus == NULL)
+        return MEM_FAIL;
+
+    if (capacity < 2 || capacity > SFP_BUS_MAX_CAPACITY
+        || (capacity & (capacity - 1)) != 0)
+        return BYTES_INVALID;
+
+    memset(bus, 0, sizeof(SFPBus));
+    bus->capacity = capacity;
+    bus->observer.on_read = BusOnRead;
+    bus->observer.ctx = bus;
+
+    return SFP_OK;
+
+}
+
+
+// Adds a subscriber.
+byte BusSubscribe(SFPBus * bus,
+                  byte policy,
+                  unsigned int depth,
+                  int * subscriber)
+{
+
+    if (bus == NULL || subscriber == NULL)
+        return MEM_FAIL;
+
+    if (policy > SFP_BUS_DROP_NEWEST || depth > bus->capacity)
+        return BYTES_INVALID;
+
+    for (int i = 0; i < SFP_BUS_MAX_SUBSCRIBERS; i++)
+    {
+        SFPBusSubscriber * sub = &bus->subscribers[i];
+        if (SFPAtomicLoad(&sub->active))
+            continue;
+
+        sub->policy = policy;
+        sub->depth = depth != 0 ? depth : bus->capacity / 2;
+        sub->window_end = 0;
+        SFPAtomicStore(&sub->received, 0);
+        SFPAtomicStore(&sub->dropped, 0);
+        SFPAtomicStore(&sub->overruns, 0);
+        SFPAtomicStore(&sub->lag, 0);
+        SFPAtomicStore(&sub->max_lag, 0);
+        SFPAtomicStore(&sub->active, 1);
+
+        // A publication that started before the subscriber was active may
+        // not have waited for it; start after it.
+        SFPAtomicStore(&sub->cursor, SFPAtomicLoad(&bus->claimed));
+
+        *subscriber = i;
+        return SFP_OK;
+    }
+
+    return MEM_FAIL;
+
+}
+
+
+// Removes a subscriber.
+byte BusUnsubscribe(SFPBus * bus, int subscriber)
+{
+
+    if (bus == NULL)
+        return MEM_FAIL;
+
+    if (subscriber < 0 || subscriber >= SFP_BUS_MAX_SUBSCRIBERS)
+        return BYTES_INVALID;
+
+    SFPAtomicStore(&bus->subscribers[subscriber].active, 0);
+
+    return SFP_OK;
+
+}
+
+
+// Publishes a sample.
+byte BusPublish(SFPBus * bus, int channel, const SFPSample * sample)
+{
+
+    if (bus == NULL || sample == NULL)
+        return MEM_FAIL;
+
+    const unsigned long long sequence = bus->claimed;
+
+    // Wait for the blocking subscribers to release the slot, unless the
+    // bus is closed.
+    unsigned long long wait_start_ns = 0;
+    for (int i = 0; i < SFP_BUS_MAX_SUBSCRIBERS; i++)
+    {
+        SFPBusSubscriber * sub = &bus->subscribers[i];
+        int spins = 0;
+        while (SFPAtomicLoad(&sub->active) && sub->policy == SFP_BUS_BLOCK
+               && sequence - SFPAtomicLoad(&sub->cursor) >= bus->capacity
+               && !SFPAtomicLoad(&bus->closed))
+        {
+            if (wait_start_ns == 0)
+                wait_start_ns = SFPNowNs();
+            Backoff(&spins);
+        }
+    }
+    if (wait_start_ns != 0)
+    {
+        bus->blocked++;
+        bus->blocked_ns += SFPNowNs() - wait_start_ns;
+    }
+    if (SFPAtomicLoad(&bus->closed))
+        return DEVICE_BUSY;
+
+    // Readers that see a partly written slot also see the claim.
+    SFPAtomicStore(&bus->claimed, sequence + 1);
+    SFPFenceRelease();
+
+    SFPBusEntry * entry = &bus->entries[sequence & (bus->capacity - 1)];
+    entry->sample = *sample;
+    entry->channel = channel;
+
+    SFPAtomicStore(&bus->published, sequence + 1);
+
+    return SFP_OK;
+
+}
+
+
+// Closes a bus.
+byte BusClose(SFPBus * bus)
+{
+
+    if (bus == NULL)
+        return MEM_FAIL;
+
+    SFPAtomicStore(&bus->closed, 1);
+
+    return SFP_OK;
+
+}
+
+
+// Sample sink publishing samples.
+void BusSink(void * ctx, int channel, const SFPSample * sample)
+{
+    BusPublish((SFPBus *)ctx, channel, sample);
+}
+
+
+// Reads the pending samples of a subscriber.
+byte BusRead(SFPBus * bus,
+             int subscriber,
+             SFPBusEntry * entries,
+             int max_entries,
+             unsigned long long timeout_ns,
+             int * count)
+{
+
+    if (bus == NULL || entries == NULL || count == NULL)
+        return MEM_FAIL;
+
+    if (subscriber < 0 || subscriber >= SFP_BUS_MAX_SUBSCRIBERS
+        || max_entries <= 0)
+        return BYTES_INVALID;
+
+    SFPBusSubscriber * sub = &bus->subscribers[subscriber];
+    const unsigned long long cursor = sub->cursor;
+    *count = 0;
+
+    unsigned long long head = SFPAtomicLoad(&bus->published);
+    if (head <= cursor && timeout_ns != 0)
+    {
+        const unsigned long long deadline_ns = SFPNowNs() + timeout_ns;
+        int spins = 0;
+        while ((head = SFPAtomicLoad(&bus->published)) <= cursor
+               && SFPNowNs() < deadline_ns)
+            Backoff(&spins);
+    }
+    // The cursor of a new subscriber can be ahead of a pending publication.
+    if (head <= cursor)
+        return RESPONSE_TIMEOUT;
+
+    RecordLag(sub, head - cursor);
+
+    unsigned long long next;
+    ApplyPolicy(sub, cursor, head, &next);
+
+    unsigned long long available = head - next;
+    if (sub->window_end != 0 && sub->window_end - next < available)
+        available = sub->window_end - next;
+    const int n = available < (unsigned long long)max_entries
+                  ? (int)available : max_entries;
+
+    const unsigned int mask = bus->capacity - 1;
+    for (int i = 0; i < n; i++)
+        entries[i] = bus->entries[(next + i) & mask];
+
+    // Discard the entries overwritten while they were copied.
+    SFPFenceAcquire();
+    const unsigned long long claimed = SFPAtomicLoad(&bus->claimed);
+    const unsigned long long oldest = claimed > bus->capacity
+                                      ? claimed - bus->capacity : 0;
+    int valid = n;
+    if (next < oldest)
+    {
+        const unsigned long long lost = oldest - next;
+        const int skip = lost < (unsigned long long)n ? (int)lost : n;
+        memmove(entries, entries + skip, (n - skip) * sizeof(SFPBusEntry));
+        valid = n - skip;
+        SFPAtomicStore(&sub->overruns, sub->overruns + lost);
+        next = skip < n ? next + n : oldest;
+        if (sub->window_end != 0 && sub->window_end < next)
+            sub->window_end = next;
+    }
+    else
+    {
+        next += n;
+    }
+
+    SFPAtomicStore(&sub->received, sub->received + valid);
+    SFPAtomicStore(&sub->cursor, next);
+    *count = valid;
+
+    return SFP_OK;
+
+}
+
+
+// Gets the statistics of a subscriber.
+byte BusStats(SFPBus * bus, int subscriber, SFPBusStats * stats)
+{
+
+    if (bus == NULL || stats == NULL)
+        return MEM_FAIL;
+
+    if (subscriber < 0 || subscriber >= SFP_BUS_MAX_SUBSCRIBERS)
+        return BYTES_INVALID;
+
+    SFPBusSubscriber * sub = &bus->subscribers[subscriber];
+    stats->received = SFPAtomicLoad(&sub->received);
+    stats->dropped = SFPAtomicLoad(&sub->dropped);
+    stats->overruns = SFPAtomicLoad(&sub->overruns);
+    stats->lag = SFPAtomicLoad(&sub->lag);
+    stats->max_lag = SFPAtomicLoad(&sub->max_lag);
+
+    return SFP_OK;
+
+}
+
+
+// Publishes every read of a device.
+byte BusAttach(SFPBus * bus, SFPDevice * device)
+{
+
+    if (bus == NULL || device == NULL)
+        return MEM_FAIL;
+
+    if (bus->device != NULL)
+        return DEVICE_BUSY;
+
+    byte rc = AddObserver(device, &bus->observer);
+    if (rc == SFP_OK)
+        bus->device = device;
+
+    return rc;
+
+}
+
+
+// Stops publishing the reads of the attached device.
+byte BusDetach(SFPBus * bus)
+{
+
+    if (bus == NULL)
+        return MEM_FAIL;
+
+    if (bus->device == NULL)
+        return SFP_OK;
+
+    byte rc = RemoveObserver(bus->device, &bus->observer);
+    bus->device = NULL;
+
+    return rc;
+
+}
+
+
+#undef SPIN_COUNT
+#undef SLEEP_NS
@@ -0,0 +1,257 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_BUS.h
+
+ Abstract:
+    In-process sample fan-out. The acquisition thread publishes every
+    sample once into a sequenced ring; each subscriber (control loop,
+    logger, user interface, ...) reads the ring at its own pace through its
+    own cursor. Publishing and reading take no lock and allocate nothing:
+    a subscriber only copies the samples it reads.
+
+    The ring is written by a single producer (one sink, or one device
+    observer with all reads of that device made from one thread). A
+    subscriber is read by a single thread.
+
+    Each subscriber chooses what happens when it falls behind:
+
+    - SFP_BUS_BLOCK: the producer waits for the subscriber before
+      overwriting a sample it has not read (no loss, but a stalled
+      subscriber stalls the acquisition until it is removed or the bus is
+      closed);
+    - SFP_BUS_DROP_OLDEST: the subscriber keeps the newest depth samples
+      and skips the older ones;
+    - SFP_BUS_DROP_NEWEST: once depth samples are pending, the subscriber
+      reads these and skips the samples published until it caught up.
+
+    A dropping subscriber that does not read for longer than the ring
+    capacity loses the overwritten samples (counted as overruns).
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_BUS_LIB
+#define SFP10X_BUS_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum ring capacity (samples).
+#define SFP_BUS_MAX_CAPACITY 4096
+
+// Maximum number of subscribers.
+#define SFP_BUS_MAX_SUBSCRIBERS 16
+
+// Size of a cache line, to keep the producer and subscriber cursors apart.
+#define SFP_BUS_CACHE_LINE 64
+
+
+// Enumeration type for the back-pressure policies.
+enum BusPolicy
+{
+    SFP_BUS_BLOCK = 0x00,           // The producer waits.
+    SFP_BUS_DROP_OLDEST = 0x01,     // Skip the oldest pending samples.
+    SFP_BUS_DROP_NEWEST = 0x02      // Skip the samples published while full.
+};
+
+
+// Data structure for a published sample.
+typedef struct SFPBusEntry_
+{
+    SFPSample sample;
+    int channel;                        // Producer channel.
+} SFPBusEntry;
+
+
+// Data structure for the statistics of a subscriber.
+typedef struct SFPBusStats_
+{
+    unsigned long long received;        // Samples read.
+    unsigned long long dropped;         // Samples skipped by the policy.
+    unsigned long long overruns;        // Samples overwritten before read.
+    unsigned long long lag;             // Pending samples at the last read.
+    unsigned long long max_lag;         // Largest lag seen by a read.
+} SFPBusStats;
+
+
+// Data structure for a subscriber.
+// Members are managed by the Bus functions.
+typedef struct SFPBusSubscriber_
+{
+    volatile unsigned long long cursor; // Next sequence to read.
+    byte pad[SFP_BUS_CACHE_LINE - sizeof(unsigned long long)];
+    volatile unsigned long long active; // Non-zero while subscribed.
+    byte policy;                        // BusPolicy enum.
+    unsigned int depth;                 // Pending samples kept (drop).
+    unsigned long long window_end;      // End of the kept samples, 0 if not
+                                        // dropping (SFP_BUS_DROP_NEWEST).
+    volatile unsigned long long received;
+    volatile unsigned long long dropped;
+    volatile unsigned long long overruns;
+    volatile unsigned long long lag;
+    volatile unsigned long long max_lag;
+} SFPBusSubscriber;
+
+
+// Data structure for a bus.
+// Members are managed by the Bus functions.
+typedef struct SFPBus_
+{
+    volatile unsigned long long claimed;    // Sequences being written.
+    volatile unsigned long long published;  // Sequences readable.
+    byte pad[SFP_BUS_CACHE_LINE - 2 * sizeof(unsigned long long)];
+    unsigned int capacity;                  // Ring capacity, power of 2.
+    unsigned long long blocked;             // Publications that waited.
+    unsigned long long blocked_ns;          // Time spent waiting.
+    volatile unsigned long long closed;     // Non-zero once closed.
+    SFPBusSubscriber subscribers[SFP_BUS_MAX_SUBSCRIBERS];
+    SFPObserver observer;                   // Used by BusAttach().
+    SFPDevice * device;                     // Attached device, if any.
+    SFPBusEntry entries[SFP_BUS_MAX_CAPACITY];
+} SFPBus;
+
+
+/** Initializes a bus.
+ *
+ *	Accepts         SFPBus pointer and ring capacity.
+ *
+ *	capacity        power of 2, at most SFP_BUS_MAX_CAPACITY.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if the capacity is
+ *                  invalid.
+ */
+byte BusInit(SFPBus * bus, unsigned int capacity);
+
+
+/** Adds a subscriber. It receives the samples published from now on.
+ *
+ *	Accepts         SFPBus pointer, policy, depth and an int pointer
+ *                  receiving the subscriber index.
+ *
+ *	policy          see the BusPolicy enum.
+ *
+ *	depth           pending samples kept by the drop policies, at most the
+ *                  capacity (0 for half the capacity).
+ *
+ *	Returns         status flag. MEM_FAIL is returned if there are too many
+ *                  subscribers and BYTES_INVALID if the policy or the depth
+ *                  is invalid.
+ *
+ *  Subscribers are added and removed by one thread at a time, possibly
+ *  while the producer publishes.
+ */
+byte BusSubscribe(SFPBus * bus,
+                  byte policy,
+                  unsigned int depth,
+                  int * subscriber);
+
+
+/** Removes a subscriber.
+ *
+ *	Accepts         SFPBus pointer and subscriber index.
+ *
+ *	Returns         status flag.
+ */
+byte BusUnsubscribe(SFPBus * bus, int subscriber);
+
+
+/** Publishes a sample (producer thread only).
+ *
+ *	Accepts         SFPBus pointer, producer channel and SFPSample pointer.
+ *
+ *	Returns         status flag. DEVICE_BUSY is returned if the bus is closed
+ *                  (the sample is not published).
+ */
+byte BusPublish(SFPBus * bus, int channel, const SFPSample * sample);
+
+
+/** Closes a bus (any thread).
+ *
+ *	Accepts         SFPBus pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  A publication waiting for a blocking subscriber returns and no sample is
+ *  published anymore; the pending samples can still be read. The owner of
+ *  the producer closes the bus before stopping it (e.g. before
+ *  AcquisitionStop()), since a stalled subscriber would otherwise block it.
+ *  BusInit() opens the bus again.
+ */
+byte BusClose(SFPBus * bus);
+
+
+/** Sample sink publishing samples (see SFPSampleSink).
+ *
+ *	ctx             SFPBus pointer.
+ */
+void BusSink(void * ctx, int channel, const SFPSample * sample);
+
+
+/** Reads the pending samples of a subscriber (subscriber thread only).
+ *
+ *	Accepts         SFPBus pointer, subscriber index, entry array, its
+ *                  capacity, timeout in nanoseconds and an int pointer
+ *                  receiving the number of entries read.
+ *
+ *	timeout_ns      maximum wait for a sample if none is pending, 0 to return
+ *                  immediately.
+ *
+ *	Returns         status flag. RESPONSE_TIMEOUT is returned if no sample was
+ *                  published within the timeout.
+ */
+byte BusRead(SFPBus * bus,
+             int subscriber,
+             SFPBusEntry * entries,
+             int max_entries,
+             unsigned long long timeout_ns,
+             int * count);
+
+
+/** Gets the statistics of a subscriber (any thread).
+ *
+ *	Accepts         SFPBus pointer, subscriber index and SFPBusStats pointer.
+ *
+ *	Returns         status flag.
+ */
+byte BusStats(SFPBus * bus, int subscriber, SFPBusStats * stats);
+
+
+/** Publishes every read of a device, with the register address as channel.
+ *
+ *	Accepts         SFPBus pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ */
+byte BusAttach(SFPBus * bus, SFPDevice * device);
+
+
+/** Stops publishing the reads of the attached device.
+ *
+ *	Accepts         SFPBus pointer.
+ *
+ *	Returns         status flag.
+ */
+byte BusDetach(SFPBus * bus);
+
+
+#endif  // SFP10X_BUS_LIB
@@ -0,0 +1,286 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_CLIENT.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_CLIENT.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+// A send to a daemon that has gone away must fail with EPIPE instead of
+// raising SIGPIPE: MSG_NOSIGNAL where available, SO_NOSIGPIPE otherwise.
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+
+// Sends or receives a whole message; a closed connection is reported as
+// PORT_FAIL.
+static byte TransferAll(int fd, void * buffer, size_t length, int sending)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = sending
+            ? send(fd, (char *)buffer + done, length - done, SEND_FLAGS)
+            : recv(fd, (char *)buffer + done, length - done, 0);
+        if (n > 0)
+            done += (size_t)n;
+        else if (n == 0 || errno == EPIPE || errno == ECONNRESET)
+            return PORT_FAIL;
+        else if (errno != EINTR)
+            return sending ? WRITE_FAIL : READ_FAIL;
+    }
+    return SFP_OK;
+}
+
+
+// Sends a request and waits for its response.
+static byte ClientTransact(SFPClient * client,
+                          SFPProtoRequest * request,
+                          SFPProtoResponse * response)
+{
+
+    byte rc = ClientSend(client, request);
+    if (rc != SFP_OK)
+        return rc;
+
+    // Responses to earlier asynchronous requests are discarded.
+    do
+    {
+        rc = ClientReceive(client, response);
+        if (rc != SFP_OK)
+            return rc;
+    } while (response->tag != request->tag);
+
+    return response->rc;
+
+}
+
+
+// Builds the default daemon socket path.
+byte ClientDefaultSocket(char * path, int size)
+{
+
+    if (path == NULL || size <= 0)
+        return MEM_FAIL;
+
+    const char * directory = getenv("XDG_RUNTIME_DIR");
+    if (directory == NULL || directory[0] == '\0')
+        directory = SFP_CLIENT_RUNTIME_DIR;
+
+    const int length = snprintf(path, (size_t)size, "%s/%s", directory,
+                                SFP_CLIENT_SOCKET_NAME);
+    if (length < 0 || length >= size)
+        return PORT_FAIL;
+
+    return SFP_OK;
+
+}
+
+
+// Connects to the daemon.
+byte ClientConnect(SFPClient * client, const char * socket_path)
+{
+
+    if (client == NULL)
+        return MEM_FAIL;
+
+    client->fd = -1;
+    client->next_tag = 1;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path == NULL)
+    {
+        byte rc = ClientDefaultSocket(address.sun_path,
+                                      sizeof(address.sun_path));
+        if (rc != SFP_OK)
+            return rc;
+    }
+    else
+    {
+        if (strlen(socket_path) >= sizeof(address.sun_path))
+            return PORT_FAIL;
+        strcpy(address.sun_path, socket_path);
+    }
+
+    client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client->fd < 0)
+        return PORT_FAIL;
+
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+    const int on = 1;
+    setsockopt(client->fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    if (connect(client->fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+        return PORT_FAIL;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Closes the connection to the daemon.
+byte ClientClose(SFPClient * client)
+{
+
+    if (client == NULL)
+        return MEM_FAIL;
+
+    if (client->fd < 0)
+        return PORT_FAIL;
+
+    close(client->fd);
+    client->fd = -1;
+
+    return SFP_OK;
+
+}
+
+
+// Sends a request without waiting for the response.
+byte ClientSend(SFPClient * client, SFPProtoRequest * request)
+{
+
+    if (client == NULL || request == NULL)
+        return MEM_FAIL;
+
+    request->tag = client->next_tag++;
+    return TransferAll(client->fd, request, sizeof(SFPProtoRequest), 1);
+
+}
+
+
+// Receives the next response.
+byte ClientReceive(SFPClient * client, SFPProtoResponse * response)
+{
+
+    if (client == NULL || response == NULL)
+        return MEM_FAIL;
+
+    return TransferAll(client->fd, response, sizeof(SFPProtoResponse), 0);
+
+}
+
+
+// Reads a register through the daemon.
+byte ClientReadRegister(SFPClient * client,
+                        byte device,
+                        byte SFP_reg_address,
+                        byte number_of_bytes,
+                        char * const data)
+{
+
+    if (data == NULL)
+        return MEM_FAIL;
+
+    SFPProtoRequest request;
+    memset(&request, 0, sizeof(request));
+    request.op = SFP_OP_READ;
+    request.device = device;
+    request.reg_address = SFP_reg_address;
+    request.number_of_bytes = number_of_bytes;
+
+    SFPProtoResponse response;
+    byte rc = ClientTransact(client, &request, &response);
+    if (rc == SFP_OK)
+        memcpy(data, response.data, sizeof(response.data));
+
+    return rc;
+
+}
+
+
+// Reads a signed register through the daemon.
+byte ClientReadSignedRegister(SFPClient * client,
+                              byte device,
+                              byte SFP_reg_address,
+                              byte number_of_bytes,
+                              long long * signed_data)
+{
+
+    if (signed_data == NULL)
+        return MEM_FAIL;
+
+    char data[8];
+    byte rc = ClientReadRegister(client, device, SFP_reg_address,
+                                 number_of_bytes, data);
+    if (rc != SFP_OK)
+    {
+        // A lost connection and an unknown device are reported as such;
+        // any other failure is a failed read, as with ReadSignedRegister().
+        *signed_data = 0;
+        return rc == PORT_FAIL || rc == BYTES_INVALID ? rc : READ_FAIL;
+    }
+
+    *signed_data = SignExtend((const byte *)data, number_of_bytes);
+
+    return SFP_OK;
+
+}
+
+
+// Writes a register through the daemon.
+byte ClientWriteRegister(SFPClient * client,
+                         byte device,
+                         byte SFP_reg_address,
+                         byte number_of_bytes,
+                         char * const data)
+{
+
+    if (data == NULL)
+        return MEM_FAIL;
+
+    SFPProtoRequest request;
+    memset(&request, 0, sizeof(request));
+    request.op = SFP_OP_WRITE;
+    request.device = device;
+    request.reg_address = SFP_reg_address;
+    request.number_of_bytes = number_of_bytes;
+    for (int i = 0; i < 6; i++)
+        request.data[i] = data[i];
+
+    SFPProtoResponse response;
+    return ClientTransact(client, &request, &response);
+
+}
+
+
+#undef SEND_FLAGS
@@ -0,0 +1,198 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_CLIENT.h
+
+ Abstract:
+    Client side of the sfp10xd daemon (see sfp10xd/sfp10xd.c). The daemon
+    owns the devices and serves register reads and writes to local clients
+    over a Unix domain socket, so that several tools can share a module.
+
+    The protocol exchanges fixed-size binary messages in host byte order
+    (the socket is local). Every request carries a tag which is echoed in
+    its response; a client may send several requests before reading the
+    responses, which may then arrive out of order.
+
+    Responses carry the status flag of the operation; BYTES_INVALID is
+    returned for a device index the daemon does not serve and READ_FAIL for
+    an unknown operation. A client whose daemon has gone away gets PORT_FAIL
+    (never SIGPIPE).
+
+    The socket lives in the runtime directory of the user ($XDG_RUNTIME_DIR),
+    or in SFP_CLIENT_RUNTIME_DIR when that variable is not set, and is only
+    accessible to the owner and the group of the daemon.
+
+    Available on POSIX platforms only.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_CLIENT_LIB
+#define SFP10X_CLIENT_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Name of the daemon socket in the runtime directory.
+#define SFP_CLIENT_SOCKET_NAME "sfp10xd.sock"
+
+// Runtime directory used when XDG_RUNTIME_DIR is not set.
+#define SFP_CLIENT_RUNTIME_DIR "/run/sfp10xd"
+
+
+// Enumeration type for the protocol operations.
+enum ProtocolOp
+{
+    SFP_OP_READ = 0x01,     // Register read, data holds the response frame.
+    SFP_OP_WRITE = 0x02     // Register write, data holds the register data.
+};
+
+
+// Data structure for a request message (16 bytes).
+typedef struct SFPProtoRequest_
+{
+    unsigned int tag;           // Echoed in the response.
+    byte op;                    // Operation (ProtocolOp enum).
+    byte device;                // Device index on the daemon command line.
+    byte reg_address;           // SFP register address.
+    byte number_of_bytes;       // Transaction size (DataLength enum).
+    char data[8];               // Register data (writes).
+} SFPProtoRequest;
+
+
+// Data structure for a response message (24 bytes).
+typedef struct SFPProtoResponse_
+{
+    unsigned int tag;                   // Tag of the request.
+    byte rc;                            // Status flag of the operation.
+    byte device;                        // Device index.
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size.
+    char data[8];                       // Response frame (reads).
+    unsigned long long timestamp_ns;    // Daemon monotonic time of the
+                                        // transaction completion.
+} SFPProtoResponse;
+
+
+// Data structure for a client connection.
+typedef struct SFPClient_
+{
+    int fd;                     // Socket.
+    unsigned int next_tag;      // Tag of the next request.
+} SFPClient;
+
+
+/** Builds the default daemon socket path.
+ *
+ *	Accepts         char array and its size.
+ *
+ *	path            $XDG_RUNTIME_DIR/sfp10xd.sock, or
+ *                  SFP_CLIENT_RUNTIME_DIR/sfp10xd.sock.
+ *
+ *	Returns         status flag (PORT_FAIL if the path does not fit).
+ */
+byte ClientDefaultSocket(char * path, int size);
+
+
+/** Connects to the daemon.
+ *
+ *	Accepts         SFPClient pointer and the daemon socket path.
+ *
+ *	socket_path     daemon socket, ClientDefaultSocket() if NULL.
+ *
+ *	Returns         status flag.
+ */
+byte ClientConnect(SFPClient * client, const char * socket_path);
+
+
+/** Closes the connection to the daemon.
+ *
+ *	Accepts         SFPClient pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ClientClose(SFPClient * client);
+
+
+/** Sends a request without waiting for the response.
+ *
+ *	Accepts         SFPClient pointer and SFPProtoRequest pointer.
+ *
+ *	request         the tag is assigned by the function.
+ *
+ *	Returns         status flag.
+ */
+byte ClientSend(SFPClient * client, SFPProtoRequest * request);
+
+
+/** Receives the next response.
+ *
+ *	Accepts         SFPClient pointer and SFPProtoResponse pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ClientReceive(SFPClient * client, SFPProtoResponse * response);
+
+
+/** Reads a register through the daemon (see ReadRegister()).
+ *
+ *	Accepts         SFPClient pointer, daemon device index, register address,
+ *                  number of bytes and a char array of length 8.
+ *
+ *	Returns         status flag.
+ */
+byte ClientReadRegister(SFPClient * client,
+                        byte device,
+                        byte SFP_reg_address,
+                        byte number_of_bytes,
+                        char * const data);
+
+
+/** Reads a signed register through the daemon (see ReadSignedRegister()).
+ *
+ *	Accepts         SFPClient pointer, daemon device index, register address,
+ *                  number of bytes and a long long pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ClientReadSignedRegister(SFPClient * client,
+                              byte device,
+                              byte SFP_reg_address,
+                              byte number_of_bytes,
+                              long long * signed_data);
+
+
+/** Writes a register through the daemon (see WriteRegister()).
+ *
+ *	Accepts         SFPClient pointer, daemon device index, register address,
+ *                  number of bytes and a char array with the data.
+ *
+ *	Returns         status flag.
+ */
+byte ClientWriteRegister(SFPClient * client,
+                         byte device,
+                         byte SFP_reg_address,
+                         byte number_of_bytes,
+                         char * const data);
+
+
+#endif  // SFP10X_CLIENT_LIB
@@ -0,0 +1,326 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_CODEC.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_CODEC.h"
+
+
+// Block magic.
+#define MAGIC_0 'S'
+#define MAGIC_1 'C'
+
+
+// Little-endian stores and loads.
+static void Store32(byte * p, unsigned int v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (byte)(v >> (8 * i));
+}
+
+static void Store64(byte * p, unsigned long long v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (byte)(v >> (8 * i));
+}
+
+static unsigned int Load32(const byte * p)
+{
+    unsigned int v = 0;
+    for (int i = 0; i < 4; i++)
+        v |= (unsigned int)p[i] << (8 * i);
+    return v;
+}
+
+static unsigned long long Load64(const byte * p)
+{
+    unsigned long long v = 0;
+    for (int i = 0; i < 8; i++)
+        v |= (unsigned long long)p[i] << (8 * i);
+    return v;
+}
+
+
+// Zigzag mapping of signed integers to unsigned integers (0, -1, 1, -2, ...).
+static unsigned long long ZigZag(long long v)
+{
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static long long UnZigZag(unsigned long long v)
+{
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+
+// Writes a varint (7 bits per byte, least significant first).
+static size_t PutVarint(byte * p, unsigned long long v)
+{
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = (byte)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (byte)v;
+    return n;
+}
+
+// Reads a varint. Returns the number of bytes read, 0 if malformed.
+static size_t GetVarint(const byte * p, size_t available,
+                        unsigned long long * v)
+{
+    unsigned long long result = 0;
+    for (size_t n = 0; n < available && n < 10; n++)
+    {
+        result |= (unsigned long long)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80))
+        {
+            *v = result;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+
+// Initializes a stream encoder.
+byte CodecEncoderInit(SFPCodecEncoder * encoder,
+                      byte mode,
+                      unsigned int resolution_ns,
+                      unsigned int block_samples,
+                      SFPBlockSink sink,
+                      void * ctx)
+{
+
+    if (encoder == NULL)
+        return MEM_FAIL;
+
+    if (mode > SFP_CODEC_DELTA2 || resolution_ns == 0
+        || block_samples == 0 || block_samples > SFP_CODEC_MAX_BLOCK_SAMPLES)
+        return BYTES_INVALID;
+
+    encoder->mode = mode;
+    encoder->resolution_ns = resolution_ns;
+    encoder->block_samples = block_samples;
+    encoder->sink = sink;
+    encoder->ctx = ctx;
+    encoder->count = 0;
+    encoder->size = SFP_CODEC_HEADER_SIZE;
+    encoder->samples = 0;
+    encoder->blocks = 0;
+    encoder->encoded_bytes = 0;
+
+    return SFP_OK;
+
+}
+
+
+// Encodes a sample.
+byte CodecEncode(SFPCodecEncoder * encoder,
+                 unsigned long long timestamp_ns,
+                 long long value)
+{
+
+    if (encoder == NULL)
+        return MEM_FAIL;
+
+    if (encoder->count == 0)
+    {
+        // The first sample is stored in the header.
+        encoder->first_ns = timestamp_ns;
+        encoder->previous_ticks = 0;
+        encoder->previous_tick_delta = 0;
+        encoder->previous_value = value;
+        encoder->previous_delta = 0;
+        Store64(encoder->block + 16, timestamp_ns);
+        Store64(encoder->block + 24, (unsigned long long)value);
+    }
+    else
+    {
+        if (timestamp_ns < encoder->first_ns)
+            return BYTES_INVALID;
+
+        const unsigned long long ticks = (timestamp_ns - encoder->first_ns)
+                                         / encoder->resolution_ns;
+        const long long tick_delta = (long long)(ticks - encoder->previous_ticks);
+        const long long delta = value - encoder->previous_value;
+
+        byte * p = encoder->block + encoder->size;
+        size_t n = PutVarint(p, ZigZag(tick_delta - encoder->previous_tick_delta));
+        if (encoder->mode == SFP_CODEC_DELTA2)
+            n += PutVarint(p + n, ZigZag(delta - encoder->previous_delta));
+        else
+            n += PutVarint(p + n, ZigZag(delta));
+        encoder->size += n;
+
+        encoder->previous_ticks = ticks;
+        encoder->previous_tick_delta = tick_delta;
+        encoder->previous_value = value;
+        encoder->previous_delta = delta;
+    }
+
+    encoder->count++;
+    encoder->samples++;
+    if (encoder->count == encoder->block_samples)
+        return CodecEncoderFlush(encoder);
+
+    return SFP_OK;
+
+}
+
+
+// Emits the current block.
+byte CodecEncoderFlush(SFPCodecEncoder * encoder)
+{
+
+    if (encoder == NULL)
+        return MEM_FAIL;
+
+    if (encoder->count == 0)
+        return SFP_OK;
+
+    byte * block = encoder->block;
+    block[0] = MAGIC_0;
+    block[1] = MAGIC_1;
+    block[2] = SFP_CODEC_VERSION;
+    block[3] = encoder->mode;
+    Store32(block + 4, encoder->count);
+    Store32(block + 8, (unsigned int)(encoder->size - SFP_CODEC_HEADER_SIZE));
+    Store32(block + 12, encoder->resolution_ns);
+
+    if (encoder->sink != NULL)
+        encoder->sink(encoder->ctx, block, encoder->size);
+    encoder->blocks++;
+    encoder->encoded_bytes += encoder->size;
+
+    encoder->count = 0;
+    encoder->size = SFP_CODEC_HEADER_SIZE;
+
+    return SFP_OK;
+
+}
+
+
+// Sample sink encoding the successful samples.
+void CodecEncoderSink(void * ctx, int channel, const SFPSample * sample)
+{
+    (void)channel;
+    if (sample->rc == SFP_OK)
+        CodecEncode((SFPCodecEncoder *)ctx, sample->timestamp_ns, sample->value);
+}
+
+
+// Reads the header of a block.
+byte CodecBlockInfo(const byte * block,
+                    size_t size,
+                    SFPCodecBlockInfo * info)
+{
+
+    if (block == NULL || info == NULL)
+        return MEM_FAIL;
+
+    if (size < SFP_CODEC_HEADER_SIZE
+        || block[0] != MAGIC_0 || block[1] != MAGIC_1
+        || block[2] != SFP_CODEC_VERSION || block[3] > SFP_CODEC_DELTA2)
+        return BYTES_INVALID;
+
+    info->mode = block[3];
+    info->count = Load32(block + 4);
+    info->size = SFP_CODEC_HEADER_SIZE + (size_t)Load32(block + 8);
+    info->resolution_ns = Load32(block + 12);
+    info->first_ns = Load64(block + 16);
+    info->first_value = (long long)Load64(block + 24);
+
+    if (info->count == 0 || info->resolution_ns == 0 || info->size > size)
+        return BYTES_INVALID;
+
+    return SFP_OK;
+
+}
+
+
+// Decodes a block.
+byte CodecDecodeBlock(const byte * block,
+                      size_t size,
+                      unsigned long long * timestamps,
+                      long long * values,
+                      int capacity,
+                      int * count)
+{
+
+    if (timestamps == NULL || values == NULL || count == NULL)
+        return MEM_FAIL;
+
+    SFPCodecBlockInfo info;
+    byte rc = CodecBlockInfo(block, size, &info);
+    if (rc != SFP_OK)
+        return rc;
+
+    if (info.count > (unsigned int)capacity)
+        return MEM_FAIL;
+
+    timestamps[0] = info.first_ns;
+    values[0] = info.first_value;
+
+    const byte * p = block + SFP_CODEC_HEADER_SIZE;
+    const byte * end = block + info.size;
+    unsigned long long ticks = 0;
+    long long tick_delta = 0;
+    long long value = info.first_value;
+    long long delta = 0;
+    for (unsigned int i = 1; i < info.count; i++)
+    {
+        unsigned long long t, v;
+        size_t n = GetVarint(p, (size_t)(end - p), &t);
+        if (n == 0)
+            return BYTES_INVALID;
+        p += n;
+        n = GetVarint(p, (size_t)(end - p), &v);
+        if (n == 0)
+            return BYTES_INVALID;
+        p += n;
+
+        tick_delta += UnZigZag(t);
+        ticks += (unsigned long long)tick_delta;
+        if (info.mode == SFP_CODEC_DELTA2)
+            delta += UnZigZag(v);
+        else
+            delta = UnZigZag(v);
+        value += delta;
+
+        timestamps[i] = info.first_ns + ticks * info.resolution_ns;
+        values[i] = value;
+    }
+
+    *count = (int)info.count;
+
+    return SFP_OK;
+
+}
+
+
+#undef MAGIC_0
+#undef MAGIC_1
@@ -0,0 +1,208 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_CODEC.h
+
+ Abstract:
+    Compact encoding of recorded sample streams. A stream (one channel) is
+    cut into blocks of at most block_samples samples; every block is self
+    contained and can be decoded on its own, so a recording can be accessed
+    by block (e.g. by seeking to the block that contains a given time using
+    the block headers).
+
+    Within a block, the timestamps are quantized to the stream resolution and
+    stored as zigzag varint deltas of deltas (regularly sampled streams take
+    about one byte per timestamp); the values are stored as zigzag varint
+    deltas, or deltas of deltas for smooth signals. A 24-bit register
+    typically takes two to four bytes per sample instead of sixteen.
+
+    Block layout (little-endian):
+
+        offset  size    field
+        0       2       magic "SC"
+        2       1       version (SFP_CODEC_VERSION)
+        3       1       value mode (CodecMode enum)
+        4       4       number of samples
+        8       4       payload size, in bytes
+        12      4       timestamp resolution, in ns
+        16      8       first timestamp, in ns
+        24      8       first value
+        32      ...     payload
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_CODEC_LIB
+#define SFP10X_CODEC_LIB
+
+
+#include "SFP10X_COM.h"
+#include <stddef.h>
+
+
+// Block format version.
+#define SFP_CODEC_VERSION 1
+
+// Size of a block header.
+#define SFP_CODEC_HEADER_SIZE 32
+
+// Maximum number of samples in a block.
+#define SFP_CODEC_MAX_BLOCK_SAMPLES 1024
+
+// Maximum encoded size of a sample (two 64-bit varints).
+#define SFP_CODEC_MAX_SAMPLE_SIZE 20
+
+// Maximum size of a block.
+#define SFP_CODEC_MAX_BLOCK_SIZE \
+    (SFP_CODEC_HEADER_SIZE + SFP_CODEC_MAX_BLOCK_SAMPLES * SFP_CODEC_MAX_SAMPLE_SIZE)
+
+
+// Enumeration type for the value encodings.
+enum CodecMode
+{
+    SFP_CODEC_DELTA = 0x00,     // Differences between consecutive values.
+    SFP_CODEC_DELTA2 = 0x01     // Differences between consecutive deltas.
+};
+
+
+// Block consumer callback.
+// The block is only valid during the call.
+typedef void (*SFPBlockSink)(void * ctx, const byte * block, size_t size);
+
+
+// Data structure for the header of a block.
+typedef struct SFPCodecBlockInfo_
+{
+    byte mode;                          // CodecMode enum.
+    unsigned int count;                 // Number of samples.
+    size_t size;                        // Block size (header and payload).
+    unsigned int resolution_ns;         // Timestamp resolution.
+    unsigned long long first_ns;        // First timestamp.
+    long long first_value;              // First value.
+} SFPCodecBlockInfo;
+
+
+// Data structure for a stream encoder.
+// Members are managed by the Codec functions.
+typedef struct SFPCodecEncoder_
+{
+    byte mode;                          // CodecMode enum.
+    unsigned int resolution_ns;         // Timestamp resolution.
+    unsigned int block_samples;         // Samples per block.
+    SFPBlockSink sink;                  // Block consumer.
+    void * ctx;                         // Block consumer context.
+    unsigned int count;                 // Samples in the current block.
+    size_t size;                        // Bytes in the current block.
+    unsigned long long first_ns;        // First timestamp of the block.
+    unsigned long long previous_ticks;  // Previous timestamp, in resolution
+                                        // units from first_ns.
+    long long previous_tick_delta;
+    long long previous_value;
+    long long previous_delta;
+    unsigned long long samples;         // Number of encoded samples.
+    unsigned long long blocks;          // Number of emitted blocks.
+    unsigned long long encoded_bytes;   // Size of the emitted blocks.
+    byte block[SFP_CODEC_MAX_BLOCK_SIZE];
+} SFPCodecEncoder;
+
+
+/** Initializes a stream encoder.
+ *
+ *	Accepts         SFPCodecEncoder pointer, value mode, timestamp resolution,
+ *                  number of samples per block and a block sink with its
+ *                  context.
+ *
+ *	mode            value encoding, see the CodecMode enum.
+ *
+ *	resolution_ns   timestamp resolution; timestamps are rounded down to a
+ *                  multiple of it from the first timestamp of their block.
+ *                  Use 1 for lossless timestamps.
+ *
+ *	block_samples   at most SFP_CODEC_MAX_BLOCK_SAMPLES.
+ *
+ *	Returns         status flag.
+ */
+byte CodecEncoderInit(SFPCodecEncoder * encoder,
+                      byte mode,
+                      unsigned int resolution_ns,
+                      unsigned int block_samples,
+                      SFPBlockSink sink,
+                      void * ctx);
+
+
+/** Encodes a sample. A block is emitted when it is full.
+ *
+ *	Accepts         SFPCodecEncoder pointer, timestamp and value.
+ *
+ *	Returns         status flag.
+ *
+ *  Timestamps must not decrease.
+ */
+byte CodecEncode(SFPCodecEncoder * encoder,
+                 unsigned long long timestamp_ns,
+                 long long value);
+
+
+/** Emits the current block, if not empty.
+ *
+ *	Accepts         SFPCodecEncoder pointer.
+ *
+ *	Returns         status flag.
+ */
+byte CodecEncoderFlush(SFPCodecEncoder * encoder);
+
+
+/** Sample sink encoding the successful samples (see SFPSampleSink).
+ *
+ *	ctx             SFPCodecEncoder pointer.
+ */
+void CodecEncoderSink(void * ctx, int channel, const SFPSample * sample);
+
+
+/** Reads the header of a block.
+ *
+ *	Accepts         block, available size and SFPCodecBlockInfo pointer.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if the header is
+ *                  not valid or the block is truncated.
+ */
+byte CodecBlockInfo(const byte * block,
+                    size_t size,
+                    SFPCodecBlockInfo * info);
+
+
+/** Decodes a block.
+ *
+ *	Accepts         block, available size, timestamp and value arrays, their
+ *                  capacity and an int pointer receiving the sample count.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if the arrays are too
+ *                  small and BYTES_INVALID if the block is malformed.
+ */
+byte CodecDecodeBlock(const byte * block,
+                      size_t size,
+                      unsigned long long * timestamps,
+                      long long * values,
+                      int capacity,
+                      int * count);
+
+
+#endif  // SFP10X_CODEC_LIB
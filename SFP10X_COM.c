@@ -24,9 +24,22 @@
 */
 
 
+#include "SFP10X_PLATFORM.h"
 #include "SFP10X_COM.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#endif
+#endif
 
 
 // Default timeout value.
@@ -42,6 +55,357 @@
 byte CRC(int, const byte * const);
 
 
+// Serial port layer.
+//
+// The functions below hide the backend (D2XX or tty) of a device. They
+// return FT_STATUS codes so that the callers can use FTHasError() for both
+// backends.
+
+#ifndef _WIN32
+
+// Returns the termios speed for a baudrate in bits per second.
+static speed_t TTYSpeed(int rate)
+{
+    switch (rate)
+    {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    default:
+        return B115200;
+    }
+}
+
+
+// Sets the minimum number of bytes of a blocking tty read.
+// A read then completes with a single wake-up once the whole response frame
+// (3 to 8 bytes) has been received. VTIME bounds the gap between bytes to
+// 100 ms. The value is cached to avoid a tcsetattr() per transaction.
+static FT_STATUS TTYSetMinBytes(SFPDevice * device, int min_bytes)
+{
+    if (device->sfp_tty_vmin == min_bytes)
+        return FT_OK;
+
+    struct termios tio;
+    if (tcgetattr(device->sfp_fd, &tio) != 0)
+        return FT_IO_ERROR;
+    tio.c_cc[VMIN] = (cc_t)min_bytes;
+    tio.c_cc[VTIME] = 1;
+    if (tcsetattr(device->sfp_fd, TCSANOW, &tio) != 0)
+        return FT_IO_ERROR;
+
+    device->sfp_tty_vmin = min_bytes;
+    return FT_OK;
+}
+
+
+// Waits with poll() until the tty is ready for events, up to deadline_ns.
+// Returns 1 if ready, 0 on timeout and -1 on error.
+static int TTYWait(int fd, short events, unsigned long long deadline_ns)
+{
+    for (;;)
+    {
+        const unsigned long long now = SFPNowNs();
+        if (now >= deadline_ns)
+            return 0;
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = events;
+        pfd.revents = 0;
+        const int timeout_ms = (int)((deadline_ns - now + 999999ULL)
+                                     / 1000000ULL);
+        const int rc = poll(&pfd, 1, timeout_ms);
+        if (rc > 0)
+            return (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) ? -1 : 1;
+        if (rc < 0 && errno != EINTR)
+            return -1;
+    }
+}
+
+#endif
+
+
+// Writes bytes to the port.
+static FT_STATUS PortWrite(SFPDevice * device, void * buffer, DWORD length,
+                           DWORD * written)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+#ifndef _WIN32
+        const unsigned long long deadline = SFPNowNs()
+            + (unsigned long long)device->sfp_timeout_ms * 1000000ULL;
+        *written = 0;
+        while (*written < length)
+        {
+            ssize_t n = write(device->sfp_fd, (char *)buffer + *written,
+                              length - *written);
+            if (n > 0)
+            {
+                *written += (DWORD)n;
+                continue;
+            }
+            if (n < 0 && errno != EINTR && errno != EAGAIN)
+                return FT_IO_ERROR;
+            if (TTYWait(device->sfp_fd, POLLOUT, deadline) <= 0)
+                return FT_IO_ERROR;
+        }
+        return FT_OK;
+#else
+        return FT_DEVICE_NOT_OPENED;
+#endif
+    }
+
+#ifndef SFP_NO_D2XX
+    return FT_Write(device->sfp_handle, buffer, length, written);
+#else
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Reads bytes from the port.
+// As FT_Read(), returns FT_OK with fewer bytes than requested on timeout.
+static FT_STATUS PortRead(SFPDevice * device, void * buffer, DWORD length,
+                          DWORD * received)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+#ifndef _WIN32
+        const unsigned long long deadline = SFPNowNs()
+            + (unsigned long long)device->sfp_timeout_ms * 1000000ULL;
+        *received = 0;
+        while (*received < length)
+        {
+            const int ready = TTYWait(device->sfp_fd, POLLIN, deadline);
+            if (ready < 0)
+                return FT_IO_ERROR;
+            if (ready == 0)
+                break;
+
+            if (TTYSetMinBytes(device, (int)(length - *received)) != FT_OK)
+                return FT_IO_ERROR;
+            ssize_t n = read(device->sfp_fd, (char *)buffer + *received,
+                             length - *received);
+            if (n > 0)
+                *received += (DWORD)n;
+            else if (n < 0 && errno != EINTR && errno != EAGAIN)
+                return FT_IO_ERROR;
+        }
+        return FT_OK;
+#else
+        return FT_DEVICE_NOT_OPENED;
+#endif
+    }
+
+#ifndef SFP_NO_D2XX
+    return FT_Read(device->sfp_handle, buffer, length, received);
+#else
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Discards the pending input and output of the port.
+static FT_STATUS PortPurge(SFPDevice * device)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+#ifndef _WIN32
+        return tcflush(device->sfp_fd, TCIOFLUSH) == 0 ? FT_OK : FT_IO_ERROR;
+#else
+        return FT_DEVICE_NOT_OPENED;
+#endif
+    }
+
+#ifndef SFP_NO_D2XX
+    return FT_Purge(device->sfp_handle, FT_PURGE_RX | FT_PURGE_TX);
+#else
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Closes the port.
+static FT_STATUS PortClose(SFPDevice * device)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+#ifndef _WIN32
+        if (device->sfp_fd < 0)
+            return FT_DEVICE_NOT_OPENED;
+        const int rc = close(device->sfp_fd);
+        device->sfp_fd = -1;
+        device->sfp_tty_vmin = 0;
+        return rc == 0 ? FT_OK : FT_IO_ERROR;
+#else
+        return FT_DEVICE_NOT_OPENED;
+#endif
+    }
+
+#ifndef SFP_NO_D2XX
+    return FT_Close(device->sfp_handle);
+#else
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Sets the port line speed, in bits per second.
+static FT_STATUS PortSetBaudRate(SFPDevice * device, int rate)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+#ifndef _WIN32
+        struct termios tio;
+        if (tcgetattr(device->sfp_fd, &tio) != 0)
+            return FT_IO_ERROR;
+        cfsetispeed(&tio, TTYSpeed(rate));
+        cfsetospeed(&tio, TTYSpeed(rate));
+        if (tcsetattr(device->sfp_fd, TCSANOW, &tio) != 0)
+            return FT_IO_ERROR;
+        return tcflush(device->sfp_fd, TCIOFLUSH) == 0 ? FT_OK : FT_IO_ERROR;
+#else
+        return FT_DEVICE_NOT_OPENED;
+#endif
+    }
+
+#ifndef SFP_NO_D2XX
+    return FT_SetBaudRate(device->sfp_handle, rate);
+#else
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Sets the port data characteristics (8 data bits, 1 stop bit, no parity).
+static FT_STATUS PortSetDataCharacteristics(SFPDevice * device)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+#ifndef _WIN32
+        // Raw mode, no flow control, blocking reads completed by VMIN/VTIME.
+        struct termios tio;
+        if (tcgetattr(device->sfp_fd, &tio) != 0)
+            return FT_IO_ERROR;
+        tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR
+                         | ICRNL | IXON | IXOFF | IXANY);
+        tio.c_oflag &= ~OPOST;
+        tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+        tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB);
+#ifdef CRTSCTS
+        tio.c_cflag &= ~CRTSCTS;
+#endif
+        tio.c_cflag |= CS8 | CREAD | CLOCAL;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 1;
+        if (tcsetattr(device->sfp_fd, TCSANOW, &tio) != 0)
+            return FT_IO_ERROR;
+        device->sfp_tty_vmin = 1;
+        return FT_OK;
+#else
+        return FT_DEVICE_NOT_OPENED;
+#endif
+    }
+
+#ifndef SFP_NO_D2XX
+    return FT_SetDataCharacteristics(device->sfp_handle,
+                                     FT_BITS_8, FT_STOP_BITS_1,
+                                     FT_PARITY_NONE);
+#else
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Sets the port read and write timeouts in milliseconds.
+static FT_STATUS PortSetTimeouts(SFPDevice * device, int time_ms)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+        // Applied by PortRead() and PortWrite().
+        device->sfp_timeout_ms = time_ms;
+        return FT_OK;
+    }
+
+#ifndef SFP_NO_D2XX
+    FT_STATUS rc = FT_SetTimeouts(device->sfp_handle, time_ms, time_ms);
+    if (rc == FT_OK)
+        device->sfp_timeout_ms = time_ms;
+    return rc;
+#else
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Sets the USB latency timer of the port in milliseconds.
+static FT_STATUS PortSetLatencyTimer(SFPDevice * device, int latency_ms)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+        // Managed by the kernel driver (see PortOpen()).
+        (void)latency_ms;
+        return FT_OK;
+    }
+
+#ifndef SFP_NO_D2XX
+    return FT_SetLatencyTimer(device->sfp_handle, (UCHAR)latency_ms);
+#else
+    (void)latency_ms;
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
+// Opens the port of a device: D2XX device number (name is NULL), D2XX serial
+// number or tty path.
+static FT_STATUS PortOpen(SFPDevice * device, const char * name)
+{
+    if (device->sfp_backend == SFP_BACKEND_TTY)
+    {
+#ifndef _WIN32
+        // O_NONBLOCK avoids waiting for the carrier on open; it is cleared
+        // right after since reads block until VMIN bytes are available.
+        device->sfp_fd = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (device->sfp_fd < 0)
+            return FT_DEVICE_NOT_OPENED;
+        const int flags = fcntl(device->sfp_fd, F_GETFL);
+        fcntl(device->sfp_fd, F_SETFL, flags & ~O_NONBLOCK);
+
+#ifdef __linux__
+        // Ask the kernel driver to forward received bytes immediately (for
+        // ftdi_sio this sets the FTDI latency timer to 1 ms). Not supported
+        // by every tty, hence not checked.
+        struct serial_struct serial;
+        if (ioctl(device->sfp_fd, TIOCGSERIAL, &serial) == 0)
+        {
+            serial.flags |= ASYNC_LOW_LATENCY;
+            ioctl(device->sfp_fd, TIOCSSERIAL, &serial);
+        }
+#endif
+
+        return FT_OK;
+#else
+        (void)name;
+        return FT_DEVICE_NOT_OPENED;
+#endif
+    }
+
+#ifndef SFP_NO_D2XX
+    // Opening by serial number does not enumerate the devices.
+    if (name != NULL)
+        return FT_OpenEx((PVOID)name, FT_OPEN_BY_SERIAL_NUMBER,
+                         &device->sfp_handle);
+    return FT_Open(device->sfp_device_num, &device->sfp_handle);
+#else
+    (void)name;
+    return FT_DEVICE_NOT_OPENED;
+#endif
+}
+
+
 // FT error check function.
 // code: FT return code to be tested.
 // flag: SFP10X_COM flag to return if we detect an error.
@@ -58,8 +422,8 @@ bool FTHasError(FT_STATUS code, SFPDevice * sfp_device) {
         // We do not check return codes as we might be in error mode already.
         if (sfp_device != NULL) 
 		{
-            FT_Purge(sfp_device->sfp_handle, FT_PURGE_RX | FT_PURGE_TX);
-            FT_Close(sfp_device->sfp_handle);
+            PortPurge(sfp_device);
+            PortClose(sfp_device);
             sfp_device->sfp_handle = NULL;
             sfp_device->sfp_device_num = -99;
         };
@@ -127,47 +491,41 @@ char* FlagLookup(byte flag)
         case MEM_FAIL:
             // 0x0B - Memory allocation error.
             return "MEM_FAIL";
+        case SCHEDULE_FAIL:
+            // 0x0C - The poll schedule is invalid or does not fit in the link
+            // budget, or its thread cannot be scheduled as requested.
+            return "SCHEDULE_FAIL";
         default:
             return "FLAG NOT FOUND";
     }
 }
 
 
-// Initializes the communication with a specified device number.
-byte Initialize(int device_num, SFPDevice * sfp_dev)
+// Opens and sets up the port of an SFPDevice structure.
+static byte OpenPort(SFPDevice * sfp_dev, const char * name)
 {
-    
-    // Check that the SFPDevice pointer points to an allocated structure.
-    if (sfp_dev == NULL) 
-		return MEM_FAIL;
-    
-	// Initialize the struct.
-	sfp_dev->sfp_device_num = device_num;
-	sfp_dev->sfp_handle = NULL;
 
-	// Open the FTDI id that the user requested.
-	FT_STATUS rc = FT_Open(sfp_dev->sfp_device_num, &sfp_dev->sfp_handle);
+	// Open the port that the user requested.
+	FT_STATUS rc = PortOpen(sfp_dev, name);
 
 	// Check status.
     if (FTHasError(rc, sfp_dev))
         return PORT_FAIL;
     
     // Successful opening, we proceed with setting up the connection.
-    
+
     // Set baudrate to 19200 - SFP default.
-    rc = FT_SetBaudRate(sfp_dev->sfp_handle, DEFAULT_BAUDRATE);
+    rc = PortSetBaudRate(sfp_dev, DEFAULT_BAUDRATE);
     if (FTHasError(rc, sfp_dev))
         return BAUD_FAIL;
 
     // Set parity bits (8 data bits, 1 stop bit and no parity).
-    rc = FT_SetDataCharacteristics(sfp_dev->sfp_handle,
-                                   FT_BITS_8, FT_STOP_BITS_1, FT_PARITY_NONE);
+    rc = PortSetDataCharacteristics(sfp_dev);
     if (FTHasError(rc, sfp_dev))
         return DATA_CH_FAIL;
 
-    // Set the timeout for the FTDI read and write.
-    rc = FT_SetTimeouts(sfp_dev->sfp_handle,
-                        DEFAULT_TIMEOUT, DEFAULT_TIMEOUT);
+    // Set the timeout for the read and write.
+    rc = PortSetTimeouts(sfp_dev, DEFAULT_TIMEOUT);
     if (FTHasError(rc, sfp_dev))
         return PORT_FAIL;
 
@@ -177,12 +535,81 @@ byte Initialize(int device_num, SFPDevice * sfp_dev)
 }
 
 
+// Initializes the communication with a specified device number.
+byte Initialize(int device_num, SFPDevice * sfp_dev)
+{
+    
+    // Check that the SFPDevice pointer points to an allocated structure.
+    if (sfp_dev == NULL) 
+		return MEM_FAIL;
+    
+	// Initialize the struct.
+	sfp_dev->sfp_device_num = device_num;
+	sfp_dev->sfp_handle = NULL;
+	sfp_dev->sfp_baud_rate = SFP_BAUD_19200;
+	sfp_dev->sfp_backend = SFP_BACKEND_D2XX;
+	sfp_dev->sfp_fd = -1;
+	sfp_dev->sfp_timeout_ms = DEFAULT_TIMEOUT;
+	sfp_dev->sfp_tty_vmin = 0;
+	sfp_dev->sfp_observers = NULL;
+
+	return OpenPort(sfp_dev, NULL);
+
+}
+
+
+// Initializes the communication with a serial port device.
+byte InitializeTTY(const char * tty_path, SFPDevice * sfp_dev)
+{
+
+    // Check that the SFPDevice pointer points to an allocated structure.
+    if (sfp_dev == NULL || tty_path == NULL)
+		return MEM_FAIL;
+
+	// Initialize the struct.
+	sfp_dev->sfp_device_num = 0;
+	sfp_dev->sfp_handle = NULL;
+	sfp_dev->sfp_baud_rate = SFP_BAUD_19200;
+	sfp_dev->sfp_backend = SFP_BACKEND_TTY;
+	sfp_dev->sfp_fd = -1;
+	sfp_dev->sfp_timeout_ms = DEFAULT_TIMEOUT;
+	sfp_dev->sfp_tty_vmin = 0;
+	sfp_dev->sfp_observers = NULL;
+
+	return OpenPort(sfp_dev, tty_path);
+
+}
+
+
+// Initializes the communication with a device by its FTDI serial number.
+byte InitializeSerial(const char * serial, SFPDevice * sfp_dev)
+{
+
+    // Check that the SFPDevice pointer points to an allocated structure.
+    if (sfp_dev == NULL || serial == NULL)
+		return MEM_FAIL;
+
+	// Initialize the struct; the device number is not known.
+	sfp_dev->sfp_device_num = -1;
+	sfp_dev->sfp_handle = NULL;
+	sfp_dev->sfp_baud_rate = SFP_BAUD_19200;
+	sfp_dev->sfp_backend = SFP_BACKEND_D2XX;
+	sfp_dev->sfp_fd = -1;
+	sfp_dev->sfp_timeout_ms = DEFAULT_TIMEOUT;
+	sfp_dev->sfp_tty_vmin = 0;
+	sfp_dev->sfp_observers = NULL;
+
+	return OpenPort(sfp_dev, serial);
+
+}
+
+
 // Changes the timeout time for write and read to and from the device.
 byte ChangeTimeout(SFPDevice * device, int time_ms)
 {
     
 	// Change the timeout in ms.
-	FT_STATUS rc = FT_SetTimeouts(device->sfp_handle, time_ms, time_ms);
+	FT_STATUS rc = PortSetTimeouts(device, time_ms);
     if (FTHasError(rc, device))
         return PORT_FAIL;
     
@@ -191,19 +618,161 @@ byte ChangeTimeout(SFPDevice * device, int time_ms)
 }
 
 
-// Reads data from a specific register on the SFP module.
-byte ReadRegister(SFPDevice * device,
-                  byte SFP_reg_address,
-                  byte number_of_bytes,
-                  char * const data)
+// Changes the USB latency timer of the device.
+byte ChangeLatencyTimer(SFPDevice * device, int latency_ms)
+{
+
+    if (latency_ms < 1 || latency_ms > 255)
+        return BYTES_INVALID;
+
+    FT_STATUS rc = PortSetLatencyTimer(device, latency_ms);
+    if (FTHasError(rc, device))
+        return PORT_FAIL;
+
+    return SFP_OK;
+
+}
+
+
+// CRC8 (polynomial 0x07) of every byte value.
+static const byte crc_table[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65,
+    0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5,
+    0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85,
+    0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2,
+    0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2,
+    0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32,
+    0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42,
+    0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C,
+    0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC,
+    0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C,
+    0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C,
+    0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B,
+    0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B,
+    0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB,
+    0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB,
+    0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+
+
+// Continues a CRC8 computation over length more bytes.
+static byte CRCUpdate(byte rem, int length, const byte * const data)
+{
+    for (int i = 0; i < length; ++i)
+        rem = crc_table[rem ^ data[i]];
+    return rem;
+}
+
+
+// Length of the response frame of a read.
+int ResponseLength(byte number_of_bytes)
+{
+
+    switch (number_of_bytes)
+    {
+    case BYTES_1:
+        return 3;       // 1 data byte, 1 status, and 1 crc
+    case BYTES_2:
+        return 4;       // 2 data byte, 1 status, and 1 crc
+    case BYTES_3:
+        return 5;       // 3 data byte, 1 status, and 1 crc
+    case BYTES_6:
+        return 8;       // 6 data byte, 1 status, and 1 crc
+    default:
+        return 0;
+    }
+
+}
+
+
+// Number of data bytes of a transaction.
+int DataBytes(byte number_of_bytes)
+{
+
+    const int length = ResponseLength(number_of_bytes);
+
+    // The status byte and the CRC are not data.
+    return length != 0 ? length - 2 : 0;
+
+}
+
+
+// Transaction size of a number of data bytes.
+byte DataLengthFor(int data_bytes)
+{
+
+    switch (data_bytes)
+    {
+    case 1:
+        return BYTES_1;
+    case 2:
+        return BYTES_2;
+    case 3:
+        return BYTES_3;
+    case 6:
+        return BYTES_6;
+    default:
+        return 0xFF;
+    }
+
+}
+
+
+// Line speed of a baudrate.
+int BaudRateBps(int baud_rate)
+{
+
+    switch (baud_rate)
+    {
+    case SFP_BAUD_9600:
+        return 9600;
+    case SFP_BAUD_19200:
+        return 19200;
+    case SFP_BAUD_115200:
+        return 115200;
+    default:
+        return 0;
+    }
+
+}
+
+
+// Reads a response frame from a specific register on the SFP module.
+// This is ReadRegister() without the observer notification; send_ns (if not
+// NULL) receives the host time the request was sent, or 0. The response is
+// received straight into data and checked there.
+static byte ReadFrame(SFPDevice * device,
+                      byte SFP_reg_address,
+                      byte number_of_bytes,
+                      char * const data,
+                      unsigned long long * send_ns)
 {
     
+    if (send_ns != NULL)
+        *send_ns = 0;
+
     // Check that the data array is properly allocated.
     if (data == NULL)
         return MEM_FAIL;
 
 	// Construct the message for sending.
-    char packet[10] = { 0 };
+    byte packet[2];
 
 	// Mode - read orred with the number of bytes requested.
 	packet[0] = 0x80 | number_of_bytes;
@@ -215,56 +784,34 @@ byte ReadRegister(SFPDevice * device,
 	DWORD bytes_written = 0;
 
     // Determine how many bytes we are expecting back.
-	int bytes_expected;
-	switch (number_of_bytes)
-	{
-	case BYTES_1:
-		bytes_expected = 3;     // 1 data byte, 1 status, and 1 crc
-		break;
-	case BYTES_2:
-		bytes_expected = 4;     // 2 data byte, 1 status, and 1 crc
-		break;
-	case BYTES_3:
-		bytes_expected = 5;     // 3 data byte, 1 status, and 1 crc
-		break;
-	case BYTES_6:
-		bytes_expected = 8;     // 6 data byte, 1 status, and 1 crc
-		break;
-	default:
+	const int bytes_expected = ResponseLength(number_of_bytes);
+	if (bytes_expected == 0)
         return BYTES_INVALID;   // error
-	}
 
-	// Recieve buffer.
-    byte m_rx_buffer[10] = { 0 };
-    
 	// Number of bytes recieved.
     DWORD m_bytes_received = 0;
 
 	// Write the request on the line.
-	FT_STATUS rc = FT_Write(device->sfp_handle, &packet, 2, &bytes_written);
+	if (send_ns != NULL)
+		*send_ns = SFPNowNs();
+	FT_STATUS rc = PortWrite(device, packet, 2, &bytes_written);
 	if (!FTHasError(rc,device))
 	{
         
-		// Clean the rx_buffer before writing to it.
-		for (int i = 0; i < 10; i++)
-			m_rx_buffer[i] = '\0';
+		// Clean the users buffer before writing to it.
+		memset(data, 0, bytes_expected);
 
 		// Wait for the answer from the SFP module.
-		rc = FT_Read(device->sfp_handle, m_rx_buffer, bytes_expected,
-                     &m_bytes_received);
+		rc = PortRead(device, data, bytes_expected, &m_bytes_received);
 		if (!FTHasError(rc, device))
 		{
-            
-			// Save the data into the users buffer.
-			for (int i = 0; i < bytes_expected; i++)
-				data[i] = m_rx_buffer[i];
 
 			// Check to make sure we have the expected number of bytes.
 			if (m_bytes_received != bytes_expected)
 			{
 				// Something went wrong, clear the buffers.
 				// Purge both Rx and Tx buffers.
-				rc = FT_Purge(device->sfp_handle, FT_PURGE_RX | FT_PURGE_TX);
+				rc = PortPurge(device);
 				if (FTHasError(rc, device))
 					return PORT_FAIL;
 				else
@@ -284,34 +831,130 @@ byte ReadRegister(SFPDevice * device,
 		return WRITE_FAIL;
 	}
 
-	// Put the data in a packet array.
-	for (int i = 2; i < bytes_expected + 2; i++)
-		packet[i] = m_rx_buffer[i - 2];
-
-	// Run a crc on the data.
-	if (CRC(bytes_expected + 2, (byte *)packet) == 0x00)
-	{
-		// Save the data into the users buffer.
-		for (int i = 0; i < bytes_expected; i++)
-			data[i] = m_rx_buffer[i];
+	// Run a crc over the request and the response.
+	if (CRCUpdate(CRCUpdate(0, 2, packet), bytes_expected,
+                  (const byte *)data) == 0x00)
 		return SFP_OK;
-	}
-	else
-	{
 
-		// Something went wrong, clear the buffers.
-        // Purge both Rx and Tx buffers.
-		rc = FT_Purge(device->sfp_handle, FT_PURGE_RX | FT_PURGE_TX);
-        if (FTHasError(rc, device))
-			return PORT_FAIL;
-		else
-			// Return crc error.
-			return CRC_ERROR;
-			
-	}
-    
-    // We should not arrive here.
-    return SFP_OK;
+	// Something went wrong, clear the buffers.
+	// Purge both Rx and Tx buffers.
+	rc = PortPurge(device);
+	if (FTHasError(rc, device))
+		return PORT_FAIL;
+
+	// Return crc error.
+	return CRC_ERROR;
+
+}
+
+
+// Decodes little-endian two's complement register data.
+static long long DecodePayload(const byte * const payload, int length)
+{
+    unsigned long long raw = 0;
+    for (int i = length - 1; i >= 0; i--)
+        raw = (raw << 8) | payload[i];
+
+    // Sign extend.
+    const int shift = 64 - 8 * length;
+    return (long long)(raw << shift) >> shift;
+}
+
+
+// Fills a response view of a frame whose CRC outcome is known.
+static void FillResponse(SFPResponse * response,
+                         byte SFP_reg_address,
+                         byte number_of_bytes,
+                         const byte * frame,
+                         byte rc)
+{
+    const int length = ResponseLength(number_of_bytes);
+
+    response->reg_address = SFP_reg_address;
+    response->number_of_bytes = number_of_bytes;
+    response->frame = frame;
+    response->payload = length != 0 && frame != NULL ? frame + 1 : NULL;
+    response->payload_length = response->payload != NULL ? length - 2 : 0;
+    response->rc = rc;
+    if (rc == SFP_OK || rc == CRC_ERROR)
+    {
+        response->status = frame[0];
+        response->value = DecodePayload(response->payload,
+                                         response->payload_length);
+    }
+    else
+    {
+        response->status = 0;
+        response->value = 0;
+    }
+}
+
+
+// Fills a sample from the outcome of a read.
+static void FillSample(SFPSample * sample,
+                       byte SFP_reg_address,
+                       byte number_of_bytes,
+                       byte rc,
+                       const byte * const data,
+                       unsigned long long send_ns)
+{
+
+    // The module samples the register between the request and the response;
+    // without a request the completion time is the only estimate.
+    sample->done_ns = SFPNowNs();
+    sample->send_ns = send_ns;
+    if (send_ns != 0)
+        sample->timestamp_ns = send_ns + (sample->done_ns - send_ns) / 2;
+    else
+        sample->timestamp_ns = sample->done_ns;
+    sample->reg_address = SFP_reg_address;
+    sample->number_of_bytes = number_of_bytes;
+    sample->rc = rc;
+    if (rc != SFP_OK)
+    {
+        sample->value = 0;
+        sample->status = 0;
+        return;
+    }
+
+    // Store the status byte and the signed data.
+    sample->status = data[0];
+    sample->value = SignExtend(data, number_of_bytes);
+
+}
+
+
+// Notifies the observers of a device.
+static void NotifyObservers(SFPDevice * device, const SFPSample * sample)
+{
+    for (SFPObserver * observer = device->sfp_observers;
+         observer != NULL;
+         observer = observer->next)
+        observer->on_read(observer->ctx, device, sample);
+}
+
+
+// Reads data from a specific register on the SFP module.
+byte ReadRegister(SFPDevice * device,
+                  byte SFP_reg_address,
+                  byte number_of_bytes,
+                  char * const data)
+{
+
+    // The sample is only timestamped and decoded when somebody is listening.
+    if (device->sfp_observers == NULL)
+        return ReadFrame(device, SFP_reg_address, number_of_bytes, data, NULL);
+
+    unsigned long long send_ns;
+    byte rc = ReadFrame(device, SFP_reg_address, number_of_bytes, data,
+                        &send_ns);
+
+    SFPSample sample;
+    FillSample(&sample, SFP_reg_address, number_of_bytes, rc,
+               (const byte *)data, send_ns);
+    NotifyObservers(device, &sample);
+
+    return rc;
 
 }
 
@@ -332,9 +975,6 @@ byte ReadSignedRegister(SFPDevice * device,
 	// Data buffer.
 	byte data[10] = { 0 };
 
-	// unsigned data holder
-	unsigned long long long_data[10] = { 0 };
-
 	// Querry ReadRegister to obtain data from the SFP module.
 	byte rc = ReadRegister(device, SFP_reg_address, number_of_bytes,
                            (char*)data);
@@ -344,82 +984,182 @@ byte ReadSignedRegister(SFPDevice * device,
         return READ_FAIL;
     }
 
-	// copy the byte data into an unsigned long long
-	for (int i = 0; i < 10; i++)
-	{
-		long_data[i] = data[i];
-	}
+	// Store data and return OK.
+    *signed_data = SignExtend(data, number_of_bytes);
+	return SFP_OK;
 
-	// Unsigned register data holder.
-	unsigned long long unsigned_register_data = 0;
+}
 
-	// Signed register data holder.
-	long long signed_register_data = 0;
 
-	switch (number_of_bytes)
-	{
-	case 0x0:
-		// Concatinate the data.
-		unsigned_register_data = long_data[1];
+// Reads a specific register on the SFP module into a timestamped sample.
+byte ReadSample(SFPDevice * device,
+                byte SFP_reg_address,
+                byte number_of_bytes,
+                SFPSample * sample)
+{
 
-		// Sign extend.
-		signed_register_data = (unsigned_register_data << 56);
+    // Check memory allocation.
+    if (sample == NULL)
+        return MEM_FAIL;
 
-		// Shift back.
-		signed_register_data = (signed_register_data >> 56);
-		break;
+    // Data buffer.
+    byte data[10] = { 0 };
 
-	case 0x1:
-		unsigned_register_data = 
-								((long_data[2] << 8)
-								+ long_data[1]);
+    // Querry ReadFrame to obtain data from the SFP module.
+    unsigned long long send_ns;
+    byte rc = ReadFrame(device, SFP_reg_address, number_of_bytes,
+                        (char*)data, &send_ns);
 
-		// Sign extend.
-		signed_register_data = (unsigned_register_data << 48);
+    FillSample(sample, SFP_reg_address, number_of_bytes, rc, data, send_ns);
+    if (device->sfp_observers != NULL)
+        NotifyObservers(device, sample);
 
-		// Shift back.
-		signed_register_data = (signed_register_data >> 48);
-		break;
+    return rc;
 
-	case 0x2:
-		unsigned_register_data = 
-								((long_data[3] << 16)
-								+ (long_data[2] << 8)
-								+ long_data[1]);
+}
 
-		// Sign extend.
-		signed_register_data = (unsigned_register_data << 40);
 
-		// Shift back.
-		signed_register_data = (signed_register_data >> 40);
-		break;
+// Parses a read response in place.
+byte ParseResponse(byte SFP_reg_address,
+                   byte number_of_bytes,
+                   const byte * frame,
+                   SFPResponse * response)
+{
 
-	case 0x3:
-		unsigned_register_data =
-								((long_data[6] << 40)
-								+ (long_data[5] << 32)
-								+ (long_data[4] << 24)
-								+ (long_data[3] << 16)
-								+ (long_data[2] << 8)
-								+ long_data[1]);
-		// Sign extend.
-		signed_register_data = (unsigned_register_data << 16);
-
-		// Shift back.
-		signed_register_data = (signed_register_data >> 16);
-		
-		break;
+    // Check memory allocation.
+    if (frame == NULL || response == NULL)
+        return MEM_FAIL;
 
-	default:
-		unsigned_register_data = 0;
-		signed_register_data = 0;
-		break;
+    const int length = ResponseLength(number_of_bytes);
+    if (length == 0)
+    {
+        FillResponse(response, SFP_reg_address, number_of_bytes, NULL,
+                     BYTES_INVALID);
+        return BYTES_INVALID;
+    }
 
-	}
+    // The CRC covers the request as well.
+    const byte request[2] = { (byte)(0x80 | number_of_bytes),
+                              SFP_reg_address };
+    const byte rc = CRCUpdate(CRCUpdate(0, 2, request), length, frame) == 0
+                  ? SFP_OK : CRC_ERROR;
+    FillResponse(response, SFP_reg_address, number_of_bytes, frame, rc);
+    return rc;
 
-	// Store data and return OK.
-    *signed_data = signed_register_data;
-	return SFP_OK;
+}
+
+
+// Parses consecutive read responses from one receive buffer.
+byte ParseResponses(const byte * buffer,
+                    int length,
+                    SFPResponse * responses,
+                    int count)
+{
+
+    // Check memory allocation.
+    if (buffer == NULL || responses == NULL)
+        return MEM_FAIL;
+
+    byte result = SFP_OK;
+    int offset = 0;
+    for (int i = 0; i < count; i++)
+    {
+        SFPResponse * response = &responses[i];
+        const int frame_length = ResponseLength(response->number_of_bytes);
+
+        byte rc;
+        if (frame_length != 0 && offset + frame_length > length)
+        {
+            rc = RESPONSE_TIMEOUT;
+            FillResponse(response, response->reg_address,
+                         response->number_of_bytes, NULL, rc);
+        }
+        else
+            rc = ParseResponse(response->reg_address,
+                               response->number_of_bytes,
+                               buffer + offset, response);
+        offset += frame_length;
+
+        if (result == SFP_OK)
+            result = rc;
+    }
+
+    return result;
+
+}
+
+
+// Reads a specific register on the SFP module into a response view.
+byte ReadResponse(SFPDevice * device,
+                  byte SFP_reg_address,
+                  byte number_of_bytes,
+                  byte * frame,
+                  SFPResponse * response)
+{
+
+    // Check memory allocation.
+    if (response == NULL)
+        return MEM_FAIL;
+
+    // The sample is only timestamped when somebody is listening.
+    unsigned long long send_ns;
+    const byte rc = ReadFrame(device, SFP_reg_address, number_of_bytes,
+                              (char*)frame,
+                              device->sfp_observers != NULL
+                              ? &send_ns : NULL);
+    FillResponse(response, SFP_reg_address, number_of_bytes, frame, rc);
+
+    if (device->sfp_observers != NULL)
+    {
+        SFPSample sample;
+        FillSample(&sample, SFP_reg_address, number_of_bytes, rc, frame,
+                   send_ns);
+        NotifyObservers(device, &sample);
+    }
+
+    return rc;
+
+}
+
+
+// Reads several registers into consecutive frames of one buffer.
+byte ReadResponses(SFPDevice * device,
+                   byte * buffer,
+                   int length,
+                   SFPResponse * responses,
+                   int count)
+{
+
+    // Check memory allocation.
+    if (buffer == NULL || responses == NULL)
+        return MEM_FAIL;
+
+    // Every frame must fit in the buffer.
+    int needed = 0;
+    for (int i = 0; i < count; i++)
+        needed += ResponseLength(responses[i].number_of_bytes);
+    if (needed > length)
+        return MEM_FAIL;
+
+    byte rc = SFP_OK;
+    int offset = 0;
+    for (int i = 0; i < count; i++)
+    {
+        SFPResponse * response = &responses[i];
+        if (rc != SFP_OK)
+        {
+            FillResponse(response, response->reg_address,
+                         response->number_of_bytes, NULL, rc);
+            continue;
+        }
+
+        rc = ReadResponse(device, response->reg_address,
+                          response->number_of_bytes, buffer + offset,
+                          response);
+        offset += ResponseLength(response->number_of_bytes);
+    }
+
+    return rc;
 
 }
 
@@ -472,8 +1212,8 @@ byte WriteRegister(SFPDevice * device, byte SFP_reg_address, byte number_of_byte
 	packet[bytes_to_write + 2] = CRC(bytes_to_write + 2, (byte *)packet);
 
 	// Write the packet onto the wire.
-	FT_STATUS rc = FT_Write(device->sfp_handle, &packet, bytes_to_write + 3,
-                            &bytes_written);
+	FT_STATUS rc = PortWrite(device, packet, bytes_to_write + 3,
+                             &bytes_written);
 	if (FTHasError(rc, device))
 		// Failed writing to the wire.
 		return WRITE_FAIL;
@@ -514,7 +1254,7 @@ byte ChangeBaudRate(SFPDevice * device, byte baud_rate)
 	packet[3] = CRC(3, (byte *)packet);
 
 	// Write the packet on the wire.
-	rc = FT_Write(device->sfp_handle, &packet, 4, &bytes_written);
+	rc = PortWrite(device, packet, 4, &bytes_written);
 	if (FTHasError(rc, device))
 	{
 		// Failed writing to the wire.
@@ -530,7 +1270,7 @@ byte ChangeBaudRate(SFPDevice * device, byte baud_rate)
 	packet[1] = 0x01;
 
 	// Write the packet on the wire.
-	rc = FT_Write(device->sfp_handle, &packet, 2, &bytes_written);
+	rc = PortWrite(device, packet, 2, &bytes_written);
 	if (FTHasError(rc, device))
 	{
 		// Failed writing to the wire.
@@ -542,7 +1282,7 @@ byte ChangeBaudRate(SFPDevice * device, byte baud_rate)
 		m_rx_buffer[i] = '\0';
 
 	// Wait for the response and if everything verifies, change the baudrate.
-	rc = FT_Read(device->sfp_handle, m_rx_buffer, 3, &m_bytes_received);
+	rc = PortRead(device, m_rx_buffer, 3, &m_bytes_received);
 	if (!FTHasError(rc, device))
 	{
 		// Check to make sure we have the 3 bytes expected.
@@ -550,7 +1290,7 @@ byte ChangeBaudRate(SFPDevice * device, byte baud_rate)
 		{
 			// Something went wrong, clear the buffers.
 			// Purge both Rx and Tx buffers.
-			rc = FT_Purge(device->sfp_handle, FT_PURGE_RX | FT_PURGE_TX);
+			rc = PortPurge(device);
 			if (FTHasError(rc, device))
 				return PORT_FAIL;
 			else
@@ -575,7 +1315,7 @@ byte ChangeBaudRate(SFPDevice * device, byte baud_rate)
 	{
 		// Something went wrong, clear the buffers.
 		// Purge both Rx and Tx buffers.
-		rc = FT_Purge(device->sfp_handle, FT_PURGE_RX | FT_PURGE_TX);
+		rc = PortPurge(device);
         if (FTHasError(rc, device))
             return PORT_FAIL;
         else
@@ -610,31 +1350,44 @@ byte ChangeOnlyHostBaudRate(SFPDevice * device, byte baud_rate)
 		new_rate = 115200;
 	}
 
+	// Serial ports change speed in place, as D2XX devices opened by serial
+	// number (see InitializeSerial()) that cannot be reopened by number.
+	if (device->sfp_backend == SFP_BACKEND_TTY || device->sfp_device_num == -1)
+	{
+		rc = PortSetBaudRate(device, new_rate);
+		if (FTHasError(rc, device))
+			return BAUD_FAIL;
+		device->sfp_baud_rate = baud_rate;
+		return SFP_OK;
+	}
+
 	// Close port.
-	rc = FT_Close(device->sfp_handle);
+	rc = PortClose(device);
     if (FTHasError(rc, device))
         return PORT_FAIL;
 
 	// Open the FTDI id that the user wants.
-	rc = FT_Open(device->sfp_device_num, &device->sfp_handle);
+	rc = PortOpen(device, NULL);
     if (FTHasError(rc, device))
         return PORT_FAIL;
         
     // Set baudrate to specified baudrate.
-    rc = FT_SetBaudRate(device->sfp_handle, new_rate);
+    rc = PortSetBaudRate(device, new_rate);
     if (FTHasError(rc, device))
         return BAUD_FAIL;
 
     // Set parity bits (8 data bits, 1 stop bit and no parity).
-    rc = FT_SetDataCharacteristics(device->sfp_handle, FT_BITS_8, FT_STOP_BITS_1,
-        FT_PARITY_NONE);
+    rc = PortSetDataCharacteristics(device);
     if (FTHasError(rc, device))
         return DATA_CH_FAIL;
 
-	// Set the timeout for the FTDI read and write.
-	rc = FT_SetTimeouts(device->sfp_handle, DEFAULT_TIMEOUT, DEFAULT_TIMEOUT);
+	// Restore the timeout for the FTDI read and write.
+	rc = PortSetTimeouts(device, device->sfp_timeout_ms);
     if (FTHasError(rc, device))
 		return PORT_FAIL;
+
+	// Keep track of the host baudrate.
+	device->sfp_baud_rate = baud_rate;
     
 	// Everything ok.
 	return SFP_OK;
@@ -642,14 +1395,65 @@ byte ChangeOnlyHostBaudRate(SFPDevice * device, byte baud_rate)
 }
 
 
+// Adds a read observer to a device.
+byte AddObserver(SFPDevice * device, SFPObserver * observer)
+{
+
+    if (device == NULL || observer == NULL || observer->on_read == NULL)
+        return MEM_FAIL;
+
+    // Observers are notified in the order they were added.
+    observer->next = NULL;
+    SFPObserver ** link = &device->sfp_observers;
+    while (*link != NULL)
+    {
+        if (*link == observer)
+            return DEVICE_BUSY;
+        link = &(*link)->next;
+    }
+    *link = observer;
+
+    return SFP_OK;
+
+}
+
+
+// Removes a read observer from a device.
+byte RemoveObserver(SFPDevice * device, SFPObserver * observer)
+{
+
+    if (device == NULL || observer == NULL)
+        return MEM_FAIL;
+
+    for (SFPObserver ** link = &device->sfp_observers;
+         *link != NULL;
+         link = &(*link)->next)
+    {
+        if (*link == observer)
+        {
+            *link = observer->next;
+            observer->next = NULL;
+            return SFP_OK;
+        }
+    }
+
+    return DEVICE_BUSY;
+
+}
+
+
 // Closes the open port.
 byte ClosePort(SFPDevice * device)
 {
     
 	// Close the port.
-    FT_STATUS rc = FT_Close(device->sfp_handle);
+    FT_STATUS rc = PortClose(device);
     if (FTHasError(rc, device))
         return PORT_FAIL;
+
+    // The handle is released: mark the device closed, as on errors.
+    device->sfp_handle = NULL;
+    device->sfp_device_num = -99;
     
     return SFP_OK;
     
@@ -662,6 +1466,11 @@ byte ClosePort(SFPDevice * device)
 int GetFTDIDeviceCount()
 {
     
+#ifdef SFP_NO_D2XX
+    // No FTDI devices without the D2XX library.
+    return -1;
+#else
+
     // Check and return how many devices are connected.
     DWORD num_of_devices = 0;
     FT_STATUS rc = FT_ListDevices(&num_of_devices,
@@ -671,6 +1480,8 @@ int GetFTDIDeviceCount()
         return -1;
 
     return num_of_devices;
+
+#endif
     
 }
 
@@ -686,6 +1497,12 @@ byte GetFTDIDeviceInfo(int device_num, char *  buffer)
 	}
 		
 	
+#ifdef SFP_NO_D2XX
+    // No FTDI devices without the D2XX library.
+    (void)device_num;
+    return DEVICE_BUSY;
+#else
+
 	// Querry for the device info.
 	FT_STATUS rc = FT_ListDevices((PVOID)((intptr_t)device_num),
                                   buffer,
@@ -695,33 +1512,34 @@ byte GetFTDIDeviceInfo(int device_num, char *  buffer)
     
     return SFP_OK;
 
+#endif
+
 }
 
 
-// CRC function.
+// Sign extension function.
 //
-// This functions computes the CRC8 of the byte array data.
-byte CRC(int length, const byte * const data)
+// Concatenates the little-endian register data of a read response (the status
+// byte being data[0]) and sign extends it to 64 bits.
+long long SignExtend(const byte * const data, byte number_of_bytes)
 {
-	byte rem = 0;
-	for (int i = 0; i < length; ++i)
-	{
 
-		rem = (byte)(rem ^ (data[i]));
+    // Status byte, then the register data.
+    const int length = ResponseLength(number_of_bytes);
+    if (length == 0)
+        return 0;
 
-		for (int j = 0; j < 8; ++j)
-		{
-			if ((rem & 0x80) > 0)
-			{
-				rem = (byte)((rem << 1) ^ 0x07);
-			}
-			else
-			{
-				rem = (byte)(rem << 1);
-			}
-		}
-	}
-	return rem;
+    return DecodePayload(data + 1, length - 2);
+
+}
+
+
+// CRC function.
+//
+// This functions computes the CRC8 (polynomial 0x07) of the byte array data.
+byte CRC(int length, const byte * const data)
+{
+	return CRCUpdate(0, length, data);
 }
 
 
@@ -24,6 +24,11 @@
  
     The SFP10X_COM libary requires the FTDI FTD2XX driver library:
     http://www.ftdichip.com/Drivers/D2XX.htm
+
+    On POSIX platforms, devices can also be accessed through a serial port
+    (e.g. /dev/ttyUSB0 with the ftdi_sio kernel driver) with InitializeTTY().
+    Defining SFP_NO_D2XX builds the library without the D2XX library, in
+    which case only serial port devices are available.
  
  GitHub project page:
     http://github.com/sendyne
@@ -44,23 +49,111 @@
 #define SFP10X_COM_LIB
 
 
+#ifndef SFP_NO_D2XX
+
 // FTDI D2XX library header.
 #include "ftd2xx.h"
 
+#else
+
+// Minimal D2XX definitions used by the library when it is built without the
+// FTDI D2XX library.
+typedef void * FT_HANDLE;
+typedef unsigned long FT_STATUS;
+typedef unsigned long DWORD;
+#define FT_OK 0
+#define FT_DEVICE_NOT_OPENED 3
+#define FT_IO_ERROR 4
+#define FT_OTHER_ERROR 18
+
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 // Byte type definition.
 typedef unsigned char byte;
 
 
+// Read observer, see AddObserver().
+typedef struct SFPObserver_ SFPObserver;
+
+
 // Data structure for storing device number and communication handle to the
 // device.
 typedef struct SFPDevice_
 {
     FT_HANDLE sfp_handle;   // Communication handle.
     int sfp_device_num;     // Device number.
+    int sfp_baud_rate;      // Current host baudrate (see Baudrate enum).
+    int sfp_backend;        // Port backend (see PortBackend enum).
+    int sfp_fd;             // File descriptor (serial port backend).
+    int sfp_timeout_ms;     // Read and write timeout in milliseconds.
+    int sfp_tty_vmin;       // Current VMIN setting (serial port backend).
+    SFPObserver * sfp_observers;    // Read observers (see AddObserver()).
 } SFPDevice;
 
 
+// Data structure for a single timestamped register sample.
+typedef struct SFPSample_
+{
+    long long value;                    // Signed register data, in counts.
+    unsigned long long timestamp_ns;    // Estimated sampling instant, the
+                                        // midpoint of send_ns and done_ns.
+    unsigned long long send_ns;         // Host monotonic time the request
+                                        // was sent (0 if it was not sent).
+    unsigned long long done_ns;         // Host monotonic time the response
+                                        // completed (or failed).
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    byte status;                        // Module status byte.
+    byte rc;                            // Status flag of the read.
+} SFPSample;
+
+
+// Largest response frame (status byte, six data bytes and CRC).
+#define SFP_MAX_RESPONSE_LENGTH 8
+
+
+// Data structure for a read response parsed in place (see ParseResponse()).
+// The pointers refer to the frame buffer, which must outlive the view.
+typedef struct SFPResponse_
+{
+    byte reg_address;                   // SFP register address (request).
+    byte number_of_bytes;               // Transaction size (request).
+    const byte * frame;                 // Response frame: status byte,
+                                        // little-endian data and CRC.
+    const byte * payload;               // Register data within the frame.
+    int payload_length;                 // Number of data bytes.
+    long long value;                    // Signed register data, in counts.
+    byte status;                        // Module status byte.
+    byte rc;                            // SFP_OK, CRC_ERROR or the status
+                                        // flag of the read.
+} SFPResponse;
+
+
+// Sample consumer callback.
+// ctx is the user context, channel identifies the producer's channel (e.g.
+// the poll schedule entry) and sample points to the sample.
+typedef void (*SFPSampleSink)(void * ctx, int channel,
+                              const SFPSample * sample);
+
+
+// Data structure for a read observer.
+// The observer is owned by the caller and must stay valid while attached.
+struct SFPObserver_
+{
+    // Called after every read of the device, including failed ones, from the
+    // thread performing the read.
+    void (*on_read)(void * ctx, SFPDevice * device, const SFPSample * sample);
+    void * ctx;                     // User context passed to on_read.
+    struct SFPObserver_ * next;     // Managed by AddObserver().
+};
+
+
 // Enumeration type for operation status.
 enum Status
 {
@@ -79,7 +172,10 @@ enum Status
                             // time frame.
     DEVICE_BUSY,		// 0x0A - The requested device is taken or in an 
                             // unknown state.
-    MEM_FAIL            // 0x0B - Memory allocation error.
+    MEM_FAIL,           // 0x0B - Memory allocation error.
+    SCHEDULE_FAIL       // 0x0C - The poll schedule is invalid or does not
+                            // fit in the link budget, or its thread cannot
+                            // be scheduled as requested.
 };
 
 
@@ -93,6 +189,14 @@ enum DataLength
 };
 
 
+// Enumeration type for the port backend of a device.
+enum PortBackend
+{
+    SFP_BACKEND_D2XX = 0x00,    // FTDI D2XX library (Initialize()).
+    SFP_BACKEND_TTY = 0x01      // POSIX serial port (InitializeTTY()).
+};
+
+
 // Enumeration type for baudrate selection.
 enum Baudrate
 {
@@ -128,6 +232,44 @@ char* FlagLookup(byte flag);
 byte Initialize(int device_num, SFPDevice * sfp_dev);
 
 
+/** Initializes the communication with a serial port device.
+ *
+ *	Accepts         a serial port path and a SFPDevice pointer.
+ *
+ *	tty_path        is the path of the serial port, e.g. /dev/ttyUSB0.
+ *
+ *	sfp_dev         is an allocated SFPDevice structure pointer which is
+ *                  initialized upon return.
+ *
+ *	Returns         status flag.
+ *
+ *  The port is set in raw mode through termios; on Linux the low_latency
+ *  flag of the serial driver is also requested. Contrary to the D2XX
+ *  library, the kernel driver does not need to be unloaded and the user only
+ *  needs read and write access to the port. Not available on Windows.
+ */
+byte InitializeTTY(const char * tty_path, SFPDevice * sfp_dev);
+
+
+/** Initializes the communication with a device by its FTDI serial number.
+ *
+ *	Accepts         a serial number and a SFPDevice pointer.
+ *
+ *	serial          is the serial number of the FTDI device as returned by
+ *                  GetFTDIDeviceInfo().
+ *
+ *	sfp_dev         is an allocated SFPDevice structure pointer which is
+ *                  initialized upon return.
+ *
+ *	Returns         status flag.
+ *
+ *  The device is opened without enumerating the connected devices; its
+ *  device number is then unknown (sfp_device_num is -1) and the host
+ *  baudrate is changed without reopening the device.
+ */
+byte InitializeSerial(const char * serial, SFPDevice * sfp_dev);
+
+
 /** Changes the timeout time for write and read to and from the device. 
  *
  *	Accepts         SFPDevice pointer and new timeout value in milliseconds.
@@ -143,6 +285,23 @@ byte Initialize(int device_num, SFPDevice * sfp_dev);
 byte ChangeTimeout(SFPDevice * device, int time_ms);
 
 
+/** Changes the USB latency timer of the device.
+ *
+ *	Accepts         SFPDevice pointer and latency in milliseconds.
+ *
+ *	latency_ms      time, from 1 to 255 ms, the FTDI chip waits before
+ *                  sending a partial USB packet to the host (16 ms by
+ *                  default). Short responses arrive sooner with a low value.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if latency_ms is
+ *                  out of range.
+ *
+ *  Serial port devices use the latency of the kernel driver (see
+ *  InitializeTTY()) and are not changed.
+ */
+byte ChangeLatencyTimer(SFPDevice * device, int latency_ms);
+
+
 /** Reads data from a specific register on the SFP module.
  *
  *	Accepts         SFPDevice pointer, register address, number of bytes
@@ -183,6 +342,164 @@ byte ReadSignedRegister(SFPDevice * device,
                         long long * signed_data);
 
 
+/** Reads a specific register on the SFP module into a timestamped sample.
+ *
+ *	Accepts         SFPDevice pointer, register address, number of bytes
+ *                  requested and a SFPSample pointer.
+ *
+ *	SFP_reg_address SFP register address to be passed-in. The register addresses
+ *                  are to be taken from the datasheet for the module.
+ *
+ *	number_of_bytes the number of bytes to be requested from the SFP module, the
+ *                  definitions can be found under the DataLength enum.
+ *
+ *	sample          is filled with the signed data, the module status byte and
+ *                  the host monotonic times at which the request was sent and
+ *                  the response completed. The module samples the register
+ *                  in between, timestamp_ns is the midpoint estimate. The rc
+ *                  field is always set, even on failure.
+ *
+ *	Returns         status flag.
+ */
+byte ReadSample(SFPDevice * device,
+                byte SFP_reg_address,
+                byte number_of_bytes,
+                SFPSample * sample);
+
+
+/** Sign extends the data of a read response.
+ *
+ *	Accepts         a read response and its number of bytes.
+ *
+ *	data            response as returned by ReadRegister() (status byte,
+ *                  little-endian register data and CRC).
+ *
+ *	number_of_bytes the transaction size, see the DataLength enum.
+ *
+ *	Returns         signed data, in counts (0 if number_of_bytes is invalid).
+ */
+long long SignExtend(const byte * const data, byte number_of_bytes);
+
+
+/** Length of the response frame of a read.
+ *
+ *	Accepts         number of bytes requested (see the DataLength enum).
+ *
+ *	Returns         the frame length (status byte, data and CRC) or 0 if
+ *                  number_of_bytes is invalid.
+ */
+int ResponseLength(byte number_of_bytes);
+
+
+/** Number of data bytes of a transaction.
+ *
+ *	Accepts         number of bytes requested (see the DataLength enum).
+ *
+ *	Returns         the number of data bytes or 0 if number_of_bytes is
+ *                  invalid.
+ */
+int DataBytes(byte number_of_bytes);
+
+
+/** Transaction size of a number of data bytes (inverse of DataBytes()).
+ *
+ *	Accepts         number of data bytes (1, 2, 3 or 6).
+ *
+ *	Returns         the DataLength enum value or 0xFF if there is none.
+ */
+byte DataLengthFor(int data_bytes);
+
+
+/** Line speed of a baudrate.
+ *
+ *	Accepts         baudrate (see the Baudrate enum).
+ *
+ *	Returns         the bits per second or 0 if baud_rate is invalid.
+ */
+int BaudRateBps(int baud_rate);
+
+
+/** Parses a read response in place, without copying it.
+ *
+ *	Accepts         register address and number of bytes of the request, the
+ *                  response frame and a SFPResponse pointer.
+ *
+ *	frame           ResponseLength(number_of_bytes) bytes as received.
+ *
+ *	response        view filled with pointers into the frame, the status
+ *                  byte, the signed data and the CRC check (rc).
+ *
+ *	Returns         status flag (CRC_ERROR if the frame is corrupted, in which
+ *                  case the view is still filled).
+ */
+byte ParseResponse(byte SFP_reg_address,
+                   byte number_of_bytes,
+                   const byte * frame,
+                   SFPResponse * response);
+
+
+/** Parses consecutive read responses from one receive buffer.
+ *
+ *	Accepts         buffer, its length in bytes, an array of SFPResponse and
+ *                  the number of responses.
+ *
+ *	responses       the reg_address and number_of_bytes of each element
+ *                  describe the request; the rest of the view is filled.
+ *                  Responses past the end of the buffer get RESPONSE_TIMEOUT.
+ *
+ *	Returns         status flag, SFP_OK if every response is valid or the rc
+ *                  of the first invalid one.
+ */
+byte ParseResponses(const byte * buffer,
+                    int length,
+                    SFPResponse * responses,
+                    int count);
+
+
+/** Reads a specific register on the SFP module into a response view.
+ *
+ *	Accepts         SFPDevice pointer, register address, number of bytes
+ *                  requested, the frame buffer and a SFPResponse pointer.
+ *
+ *	frame           receives the response straight from the port, it must
+ *                  hold ResponseLength(number_of_bytes) bytes (at most
+ *                  SFP_MAX_RESPONSE_LENGTH).
+ *
+ *	response        view of the frame, see ParseResponse(). The rc field is
+ *                  always set, even on failure.
+ *
+ *	Returns         status flag.
+ *
+ *  The response is neither copied nor parsed twice; observers are notified
+ *  as for ReadRegister().
+ */
+byte ReadResponse(SFPDevice * device,
+                  byte SFP_reg_address,
+                  byte number_of_bytes,
+                  byte * frame,
+                  SFPResponse * response);
+
+
+/** Reads several registers into consecutive frames of one buffer.
+ *
+ *	Accepts         SFPDevice pointer, buffer, its length in bytes, an array
+ *                  of SFPResponse and the number of responses.
+ *
+ *	responses       the reg_address and number_of_bytes of each element
+ *                  select the register to read; the rest of the view is
+ *                  filled (see ReadResponse()).
+ *
+ *	Returns         status flag. MEM_FAIL is returned if the buffer cannot
+ *                  hold every frame. The reads stop at the first failure,
+ *                  the remaining views get its rc.
+ */
+byte ReadResponses(SFPDevice * device,
+                   byte * buffer,
+                   int length,
+                   SFPResponse * responses,
+                   int count);
+
+
 /** Writes to a specific register on the SFP module.
  *
  *	Accepts         SFPDevice pointer, register address, number of bytes
@@ -233,6 +550,31 @@ byte ChangeBaudRate(SFPDevice * device, byte baud_rate);
 byte ChangeOnlyHostBaudRate(SFPDevice * device, byte baud_rate);
 
 
+/** Adds a read observer to a device.
+ *
+ *	Accepts         SFPDevice pointer and SFPObserver pointer.
+ *
+ *	observer        on_read and ctx must be set. The observer is notified of
+ *                  every read (ReadRegister(), ReadSignedRegister() and
+ *                  ReadSample()) with the decoded sample.
+ *
+ *	Returns         status flag.
+ *
+ *  Observers must not be added or removed while another thread reads the
+ *  device. The device must be initialized first.
+ */
+byte AddObserver(SFPDevice * device, SFPObserver * observer);
+
+
+/** Removes a read observer from a device.
+ *
+ *	Accepts         SFPDevice pointer and SFPObserver pointer.
+ *
+ *	Returns         status flag.
+ */
+byte RemoveObserver(SFPDevice * device, SFPObserver * observer);
+
+
 /** Closes the open port.
  *
  *	Accepts         SFPDevice pointer.
@@ -240,6 +582,7 @@ byte ChangeOnlyHostBaudRate(SFPDevice * device, byte baud_rate);
  *	Returns         status flag.
  *
  *  If a port is open, it closes it, else it does nothing and returns an error.
+ *  The device is then marked closed (sfp_device_num is set to -99).
  */
 byte ClosePort(SFPDevice * device);
 
@@ -273,4 +616,9 @@ int GetFTDIDeviceCount();
 byte GetFTDIDeviceInfo(int device_num, char *  buffer);
 
 
+#ifdef __cplusplus
+}
+#endif
+
+
 #endif  // SFP10X_COM_LIB
@@ -0,0 +1,278 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_COM.hpp
+
+ Abstract:
+    Header-only C++11 layer over the SFP10X_COM library. Registers are
+    described at compile time (address, transaction size, signedness and
+    conversion to a typed value), so that a read resolves the frame size,
+    the response buffer and the sign extension as template constants:
+
+        sfp::Device device(0);
+        sfp::Amperes current = device.read<sfp::sfp101::Current>();
+
+    sfp::Device owns the port (RAII, move only) and exposes the underlying
+    SFPDevice for the rest of the C API. Failures are reported either by a
+    status flag (read(value)) or by an sfp::Error exception (read()).
+
+    A product catalogue is a namespace of register types. Additional
+    registers or products are described the same way, deriving from
+    sfp::Register and providing value_type and Decode().
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_COM_HPP
+#define SFP10X_COM_HPP
+
+
+#include "SFP10X_COM.h"
+#include <stdexcept>
+#include <string>
+
+
+namespace sfp
+{
+
+
+// Exception carrying a status flag (see Status enum).
+class Error : public std::runtime_error
+{
+public:
+    explicit Error(byte rc)
+        : std::runtime_error(std::string("SFP10X_COM: ") + FlagLookup(rc)),
+          rc_(rc)
+    {}
+
+    // Status flag.
+    byte rc() const { return rc_; }
+
+private:
+    byte rc_;
+};
+
+
+// Number of data bytes of a transaction size (DataLength enum), 0 if invalid.
+constexpr int DataSize(byte length)
+{
+    return length == BYTES_1 ? 1
+         : length == BYTES_2 ? 2
+         : length == BYTES_3 ? 3
+         : length == BYTES_6 ? 6
+         : 0;
+}
+
+
+// Assembles little-endian data bytes.
+constexpr unsigned long long Assemble(const byte * data, int size)
+{
+    return size == 0 ? 0ULL
+         : static_cast<unsigned long long>(data[0])
+           | (Assemble(data + 1, size - 1) << 8);
+}
+
+
+// Register description: address, transaction size and signedness.
+// Register types derive from it and add value_type and Decode(counts).
+template <byte Address, byte Length, bool Signed>
+struct Register
+{
+    static_assert(DataSize(Length) != 0, "invalid DataLength");
+
+    static constexpr byte address = Address;
+    static constexpr byte length = Length;
+    static constexpr bool is_signed = Signed;
+
+    // Data bytes, and response frame size (status, data and CRC).
+    static constexpr int data_size = DataSize(Length);
+    static constexpr int frame_size = data_size + 2;
+
+    // Sign extension shift.
+    static constexpr int shift = 64 - 8 * data_size;
+
+    // Register data of a response frame, in counts.
+    static constexpr long long Counts(const byte * frame)
+    {
+        return Signed
+            ? static_cast<long long>(Assemble(frame + 1, data_size) << shift)
+                  >> shift
+            : static_cast<long long>(Assemble(frame + 1, data_size));
+    }
+};
+
+
+// Value in a unit, to keep quantities of different registers apart.
+template <typename Unit>
+struct Quantity
+{
+    constexpr Quantity() : value(0.0) {}
+    constexpr explicit Quantity(double v) : value(v) {}
+
+    double value;
+};
+
+struct AmpereUnit {};
+struct VoltUnit {};
+
+typedef Quantity<AmpereUnit> Amperes;
+typedef Quantity<VoltUnit> Volts;
+
+
+// SFP101 register catalogue (see the SFP101 datasheet).
+namespace sfp101
+{
+
+// Serial number, 0x1E to 0x20.
+struct SerialNumber : Register<0x1E, BYTES_3, false>
+{
+    typedef unsigned long long value_type;
+    static constexpr value_type Decode(long long counts)
+    {
+        return static_cast<value_type>(counts);
+    }
+};
+
+// Current, with a 100 uOhm shunt.
+struct Current : Register<0x32, BYTES_3, true>
+{
+    typedef Amperes value_type;
+    static constexpr double scale = 0.00006119;
+    static constexpr value_type Decode(long long counts)
+    {
+        return Amperes(counts * scale);
+    }
+};
+
+// Voltage, 28.7 uV per count.
+struct Voltage : Register<0x52, BYTES_3, true>
+{
+    typedef Volts value_type;
+    static constexpr double scale = 0.0000287;
+    static constexpr value_type Decode(long long counts)
+    {
+        return Volts(counts * scale);
+    }
+};
+
+}   // namespace sfp101
+
+
+// Device owning an open port. The port is closed on destruction.
+class Device
+{
+public:
+    // Opens a D2XX device number (see Initialize()).
+    explicit Device(int device_num)
+    {
+        const byte rc = Initialize(device_num, &device_);
+        if (rc != SFP_OK)
+            throw Error(rc);
+    }
+
+    // Opens a serial port device (see InitializeTTY()).
+    explicit Device(const char * tty_path)
+    {
+        const byte rc = InitializeTTY(tty_path, &device_);
+        if (rc != SFP_OK)
+            throw Error(rc);
+    }
+
+    // Moving transfers the port; pointers returned by native() before the
+    // move (e.g. held by a poll schedule or a group) are invalidated.
+    Device(Device && other) : device_(other.device_), open_(other.open_)
+    {
+        other.open_ = false;
+    }
+
+    Device & operator=(Device && other)
+    {
+        if (this != &other)
+        {
+            Close();
+            device_ = other.device_;
+            open_ = other.open_;
+            other.open_ = false;
+        }
+        return *this;
+    }
+
+    Device(const Device &) = delete;
+    Device & operator=(const Device &) = delete;
+
+    ~Device() { Close(); }
+
+    // Underlying device, for the rest of the C API.
+    SFPDevice * native() { return &device_; }
+
+    // Reads a register into its typed value. Returns the status flag; value
+    // is left unchanged on failure.
+    template <typename R>
+    byte read(typename R::value_type & value)
+    {
+        byte frame[R::frame_size];
+        const byte rc = ReadRegister(&device_, R::address, R::length,
+                                     reinterpret_cast<char *>(frame));
+        if (rc == SFP_OK)
+            value = R::Decode(R::Counts(frame));
+        return rc;
+    }
+
+    // Reads a register into its typed value. Throws Error on failure.
+    template <typename R>
+    typename R::value_type read()
+    {
+        typename R::value_type value;
+        const byte rc = read<R>(value);
+        if (rc != SFP_OK)
+            throw Error(rc);
+        return value;
+    }
+
+    // Reads a register in counts. Returns the status flag.
+    template <typename R>
+    byte counts(long long & value)
+    {
+        byte frame[R::frame_size];
+        const byte rc = ReadRegister(&device_, R::address, R::length,
+                                     reinterpret_cast<char *>(frame));
+        if (rc == SFP_OK)
+            value = R::Counts(frame);
+        return rc;
+    }
+
+private:
+    void Close()
+    {
+        if (open_)
+            ClosePort(&device_);
+        open_ = false;
+    }
+
+    SFPDevice device_;
+    bool open_ = true;
+};
+
+
+}   // namespace sfp
+
+
+#endif  // SFP10X_COM_HPP
@@ -0,0 +1,591 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_CORO.hpp
+
+ Abstract:
+    Header-only C++20 coroutine layer over the reactor (SFP10X_REACTOR.h).
+    Register transactions are awaited instead of blocking, so that one
+    thread drives many devices, each from straight-line code:
+
+        sfp::Task<> Monitor(sfp::AsyncDevice device)
+        {
+            for (;;)
+            {
+                SFPSample sample = co_await device.read(0x32, BYTES_3);
+                ...
+            }
+        }
+
+        sfp::Reactor reactor;
+        for (sfp::Device & device : devices)
+            reactor.spawn(Monitor(reactor.add(device)));
+        reactor.run();
+
+    The transfer of a transaction lives in the awaiter, that is in the
+    coroutine frame: nothing is allocated per transaction, the frame of a
+    task is allocated once when the task is created. Every transaction has
+    a timeout (the device timeout by default) and may be cancelled through
+    a std::stop_token; a cancelled transaction completes with DEVICE_BUSY.
+
+    Tasks are lazy and resumed by the reactor thread only. A task may await
+    other tasks (co_await Task<T> returns its result or rethrows its
+    exception). Stop requests must be made from the reactor thread.
+    Destroying the reactor destroys the tasks not done without resuming
+    them (their transfers are withdrawn), then removes the devices; the
+    devices must outlive the reactor. Available on POSIX platforms only.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_CORO_HPP
+#define SFP10X_CORO_HPP
+
+
+#include "SFP10X_COM.hpp"
+#include "SFP10X_REACTOR.h"
+#include <chrono>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <stop_token>
+#include <utility>
+
+
+namespace sfp
+{
+
+
+template <typename T = void>
+class Task;
+
+
+namespace detail
+{
+
+// Promise members common to all the task types.
+struct PromiseBase
+{
+    // Resumes the awaiting coroutine, if any, once the task is done.
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        template <typename P>
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<P> handle) noexcept
+        {
+            const std::coroutine_handle<> next =
+                handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template <typename T>
+struct Promise : PromiseBase
+{
+    Task<T> get_return_object();
+    void return_value(T value) { result.emplace(std::move(value)); }
+
+    T get()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+        return std::move(*result);
+    }
+
+    std::optional<T> result;
+};
+
+template <>
+struct Promise<void> : PromiseBase
+{
+    Task<void> get_return_object();
+    void return_void() {}
+
+    void get()
+    {
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+};
+
+}   // namespace detail
+
+
+// Coroutine task. It starts when it is awaited or spawned (see Reactor).
+template <typename T>
+class Task
+{
+public:
+    typedef detail::Promise<T> promise_type;
+
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : handle_(handle)
+    {}
+
+    Task(Task && other) noexcept : handle_(std::exchange(other.handle_, {}))
+    {}
+
+    Task & operator=(Task && other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task & operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    // Awaiting runs the task and returns its result.
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume() { return handle_.promise().get(); }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+
+namespace detail
+{
+
+template <typename T>
+Task<T> Promise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object()
+{
+    return Task<void>(
+        std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+
+// Awaiter submitting a transfer and resuming the coroutine on completion.
+class TransferAwaiter
+{
+public:
+    TransferAwaiter(SFPReactor * reactor,
+                    SFPDevice * device,
+                    byte type,
+                    byte reg_address,
+                    byte number_of_bytes,
+                    std::chrono::nanoseconds timeout,
+                    std::stop_token token)
+        : reactor_(reactor), device_(device), token_(std::move(token))
+    {
+        std::memset(&transfer_, 0, sizeof(transfer_));
+        transfer_.type = type;
+        transfer_.reg_address = reg_address;
+        transfer_.number_of_bytes = number_of_bytes;
+        transfer_.timeout_ns =
+            static_cast<unsigned long long>(timeout.count());
+        transfer_.callback = &TransferAwaiter::OnComplete;
+        transfer_.ctx = this;
+    }
+
+    // The transfer is referenced by the reactor once submitted.
+    TransferAwaiter(const TransferAwaiter &) = delete;
+    TransferAwaiter & operator=(const TransferAwaiter &) = delete;
+
+    // A coroutine destroyed while suspended withdraws its transfer
+    // without being resumed.
+    ~TransferAwaiter()
+    {
+        if (pending_)
+        {
+            submitting_ = true;
+            cancel_.reset();
+            ReactorCancel(reactor_, &transfer_);
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        if (token_.stop_requested())
+            return Finish(DEVICE_BUSY);
+
+        // A transfer may complete within ReactorSubmit() (writes, closed
+        // ports): the coroutine then continues without suspending.
+        handle_ = handle;
+        pending_ = true;
+        submitting_ = true;
+        const byte rc = ReactorSubmit(reactor_, device_, &transfer_);
+        submitting_ = false;
+        if (rc != SFP_OK)
+            return Finish(rc);
+        if (!pending_)
+            return false;
+
+        if (token_.stop_possible())
+            cancel_.emplace(token_, Cancel{reactor_, &transfer_});
+        return true;
+    }
+
+protected:
+    // Cancels the transfer on a stop request.
+    struct Cancel
+    {
+        SFPReactor * reactor;
+        SFPTransfer * transfer;
+
+        void operator()() const noexcept { ReactorCancel(reactor, transfer); }
+    };
+
+    // Status flag of the completed transfer.
+    byte Result()
+    {
+        cancel_.reset();
+        return transfer_.rc;
+    }
+
+    SFPTransfer transfer_;
+
+private:
+    static void OnComplete(void * ctx, SFPTransfer * transfer)
+    {
+        TransferAwaiter * awaiter = static_cast<TransferAwaiter *>(ctx);
+        (void)transfer;
+        awaiter->pending_ = false;
+        if (!awaiter->submitting_)
+            awaiter->handle_.resume();
+    }
+
+    // Completes a transfer that was not submitted.
+    bool Finish(byte rc)
+    {
+        pending_ = false;
+        transfer_.rc = rc;
+        transfer_.sample.rc = rc;
+        transfer_.sample.reg_address = transfer_.reg_address;
+        transfer_.sample.number_of_bytes = transfer_.number_of_bytes;
+        return false;
+    }
+
+    SFPReactor * reactor_;
+    SFPDevice * device_;
+    std::stop_token token_;
+    std::optional<std::stop_callback<Cancel>> cancel_;
+    std::coroutine_handle<> handle_;
+    bool pending_ = false;
+    bool submitting_ = false;
+};
+
+
+// Register read; returns the sample (see ReadSample()).
+class ReadAwaiter : public TransferAwaiter
+{
+public:
+    ReadAwaiter(SFPReactor * reactor,
+                SFPDevice * device,
+                byte reg_address,
+                byte number_of_bytes,
+                std::chrono::nanoseconds timeout,
+                std::stop_token token)
+        : TransferAwaiter(reactor, device, SFP_TRANSFER_READ, reg_address,
+                          number_of_bytes, timeout, std::move(token))
+    {}
+
+    SFPSample await_resume()
+    {
+        Result();
+        return transfer_.sample;
+    }
+};
+
+
+// Typed register read; returns the value or throws Error.
+template <typename R>
+class TypedReadAwaiter : public TransferAwaiter
+{
+public:
+    TypedReadAwaiter(SFPReactor * reactor,
+                     SFPDevice * device,
+                     std::chrono::nanoseconds timeout,
+                     std::stop_token token)
+        : TransferAwaiter(reactor, device, SFP_TRANSFER_READ, R::address,
+                          R::length, timeout, std::move(token))
+    {}
+
+    typename R::value_type await_resume()
+    {
+        const byte rc = Result();
+        if (rc != SFP_OK)
+            throw Error(rc);
+        return R::Decode(R::Counts(
+            reinterpret_cast<const byte *>(transfer_.data)));
+    }
+};
+
+
+// Register write; returns the status flag (see WriteRegister()).
+class WriteAwaiter : public TransferAwaiter
+{
+public:
+    WriteAwaiter(SFPReactor * reactor,
+                 SFPDevice * device,
+                 byte reg_address,
+                 byte number_of_bytes,
+                 const char * data,
+                 std::chrono::nanoseconds timeout,
+                 std::stop_token token)
+        : TransferAwaiter(reactor, device, SFP_TRANSFER_WRITE, reg_address,
+                          number_of_bytes, timeout, std::move(token))
+    {
+        if (data != nullptr)
+            std::memcpy(transfer_.data, data, DataSize(number_of_bytes));
+    }
+
+    byte await_resume() { return Result(); }
+};
+
+}   // namespace detail
+
+
+// Device of a reactor, for awaiting transactions. Copyable handle; the
+// device and the reactor must outlive it.
+class AsyncDevice
+{
+public:
+    AsyncDevice(SFPReactor * reactor, SFPDevice * device)
+        : reactor_(reactor), device_(device)
+    {}
+
+    // Reads a register. A zero timeout uses the device timeout.
+    detail::ReadAwaiter read(byte reg_address,
+                             byte number_of_bytes,
+                             std::chrono::nanoseconds timeout = {},
+                             std::stop_token token = {}) const
+    {
+        return detail::ReadAwaiter(reactor_, device_, reg_address,
+                                   number_of_bytes, timeout,
+                                   std::move(token));
+    }
+
+    // Reads a register into its typed value (see Device::read()).
+    template <typename R>
+    detail::TypedReadAwaiter<R> read(std::chrono::nanoseconds timeout = {},
+                                     std::stop_token token = {}) const
+    {
+        return detail::TypedReadAwaiter<R>(reactor_, device_, timeout,
+                                            std::move(token));
+    }
+
+    // Writes a register.
+    detail::WriteAwaiter write(byte reg_address,
+                               byte number_of_bytes,
+                               const char * data,
+                               std::chrono::nanoseconds timeout = {},
+                               std::stop_token token = {}) const
+    {
+        return detail::WriteAwaiter(reactor_, device_, reg_address,
+                                    number_of_bytes, data, timeout,
+                                    std::move(token));
+    }
+
+    // Underlying device, for the rest of the C API.
+    SFPDevice * native() const { return device_; }
+
+private:
+    SFPReactor * reactor_;
+    SFPDevice * device_;
+};
+
+
+// Reactor running tasks on the calling thread.
+class Reactor
+{
+public:
+    Reactor() { ReactorInit(&reactor_); }
+
+    // Awaiters and devices refer to the reactor.
+    Reactor(const Reactor &) = delete;
+    Reactor & operator=(const Reactor &) = delete;
+
+    // Tasks not done are destroyed first, without being resumed: their
+    // awaiters withdraw their transfers while the devices are still in the
+    // reactor. The devices are removed next, with no transfer left to
+    // complete (their blocking mode is restored).
+    ~Reactor()
+    {
+        while (launched_ != nullptr)
+            std::coroutine_handle<Detached::promise_type>::from_promise(
+                *launched_).destroy();
+        for (int i = 0; i < reactor_.device_count; i++)
+            if (reactor_.devices[i].device != nullptr)
+                ReactorRemove(&reactor_, reactor_.devices[i].device);
+    }
+
+    // Adds a device (serial port backend). Throws Error on failure.
+    AsyncDevice add(SFPDevice * device)
+    {
+        const byte rc = ReactorAdd(&reactor_, device);
+        if (rc != SFP_OK)
+            throw Error(rc);
+        return AsyncDevice(&reactor_, device);
+    }
+
+    AsyncDevice add(Device & device) { return add(device.native()); }
+
+    // Removes a device; its transactions complete with DEVICE_BUSY.
+    void remove(const AsyncDevice & device)
+    {
+        ReactorRemove(&reactor_, device.native());
+    }
+
+    // Starts a task. It runs until its first transaction is awaited.
+    void spawn(Task<> task)
+    {
+        tasks_++;
+        Launch(this, std::move(task));
+    }
+
+    // Drives the transactions until every task is done, or until no task
+    // can make progress. Rethrows the first exception of a task.
+    void run()
+    {
+        while (tasks_ > 0 && ReactorPending(&reactor_) > 0)
+            ReactorRun(&reactor_, kSliceNs);
+        Rethrow();
+    }
+
+    // Drives the transactions for at most a timeout. Returns true if a
+    // transaction completed.
+    bool run_once(std::chrono::nanoseconds timeout)
+    {
+        const byte rc = ReactorRun(
+            &reactor_, static_cast<unsigned long long>(timeout.count()));
+        Rethrow();
+        return rc == SFP_OK;
+    }
+
+    // Number of tasks not done.
+    int tasks() const { return tasks_; }
+
+    // Underlying reactor, for the rest of the C API.
+    SFPReactor * native() { return &reactor_; }
+
+private:
+    // Coroutine owning a spawned task; its frame is freed once done, or by
+    // the destructor of the reactor, which links the frames not done.
+    struct Detached
+    {
+        struct promise_type
+        {
+            promise_type(Reactor * owner, Task<> &)
+                : reactor(owner), next(owner->launched_)
+            {
+                if (next != nullptr)
+                    next->previous = this;
+                reactor->launched_ = this;
+            }
+
+            ~promise_type()
+            {
+                if (next != nullptr)
+                    next->previous = previous;
+                if (previous != nullptr)
+                    previous->next = next;
+                else
+                    reactor->launched_ = next;
+            }
+
+            promise_type(const promise_type &) = delete;
+            promise_type & operator=(const promise_type &) = delete;
+
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+
+            Reactor * reactor;
+            promise_type * previous = nullptr;
+            promise_type * next;
+        };
+    };
+
+    static Detached Launch(Reactor * reactor, Task<> task)
+    {
+        try
+        {
+            co_await task;
+        }
+        catch (...)
+        {
+            if (!reactor->exception_)
+                reactor->exception_ = std::current_exception();
+        }
+        reactor->tasks_--;
+    }
+
+    void Rethrow()
+    {
+        if (exception_)
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+    }
+
+    // Wait of run() between checks of the task count.
+    static constexpr unsigned long long kSliceNs = 100000000ULL;
+
+    SFPReactor reactor_;
+    int tasks_ = 0;
+    std::exception_ptr exception_;
+    Detached::promise_type * launched_ = nullptr;
+};
+
+
+}   // namespace sfp
+
+
+#endif  // SFP10X_CORO_HPP
@@ -0,0 +1,327 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_DEADBAND.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_DEADBAND.h"
+#include <math.h>
+#include <string.h>
+
+
+// Forwards a sample downstream and makes it the filter reference.
+static void Forward(SFPDeadband * deadband,
+                    SFPDeadbandFilter * filter,
+                    int channel,
+                    const SFPSample * sample)
+{
+    filter->forwarded = *sample;
+    filter->started = 1;
+    filter->forwarded_count++;
+    if (deadband->sink != NULL)
+        deadband->sink(deadband->ctx, channel, sample);
+}
+
+
+// Opens the swinging door from the last forwarded sample.
+static void OpenDoor(SFPDeadbandFilter * filter)
+{
+    filter->upper = HUGE_VAL;
+    filter->lower = -HUGE_VAL;
+    filter->held = 0;
+}
+
+
+// Narrows the swinging door with a sample. Returns zero once the door is
+// closed, i.e. the sample no longer fits on a line from the last forwarded
+// sample together with the samples since.
+static int NarrowDoor(SFPDeadbandFilter * filter, const SFPSample * sample)
+{
+
+    const double dv = (double)sample->value - (double)filter->forwarded.value;
+    if (sample->timestamp_ns <= filter->forwarded.timestamp_ns)
+        return fabs(dv) <= filter->threshold;
+
+    const double dt = (double)(sample->timestamp_ns
+                               - filter->forwarded.timestamp_ns);
+    const double upper = (dv + filter->threshold) / dt;
+    const double lower = (dv - filter->threshold) / dt;
+    if (upper < filter->upper)
+        filter->upper = upper;
+    if (lower > filter->lower)
+        filter->lower = lower;
+
+    return filter->lower <= filter->upper;
+
+}
+
+
+// Filters a sample with the swinging door.
+static void SwingingDoor(SFPDeadband * deadband,
+                         SFPDeadbandFilter * filter,
+                         int channel,
+                         const SFPSample * sample)
+{
+
+    if (NarrowDoor(filter, sample))
+    {
+        filter->sample = *sample;
+        filter->held_channel = channel;
+        filter->held = 1;
+        return;
+    }
+
+    if (filter->held)
+    {
+        // The last sample that fitted ends the segment.
+        Forward(deadband, filter, filter->held_channel, &filter->sample);
+        OpenDoor(filter);
+        if (NarrowDoor(filter, sample))
+        {
+            filter->sample = *sample;
+            filter->held_channel = channel;
+            filter->held = 1;
+            return;
+        }
+    }
+
+    // Even the next sample alone does not fit.
+    Forward(deadband, filter, channel, sample);
+    OpenDoor(filter);
+
+}
+
+
+// Forwards a sample regardless of the filter (status change, heartbeat).
+static void ForceForward(SFPDeadband * deadband,
+                         SFPDeadbandFilter * filter,
+                         int channel,
+                         const SFPSample * sample)
+{
+
+    // A held sample that the line to this one would not cover is a vertex.
+    if (filter->held && !NarrowDoor(filter, sample))
+        Forward(deadband, filter, filter->held_channel, &filter->sample);
+
+    Forward(deadband, filter, channel, sample);
+    OpenDoor(filter);
+
+}
+
+
+// Observer callback filtering the reads of the attached device.
+static void DeadbandOnRead(void * ctx,
+                           SFPDevice * device,
+                           const SFPSample * sample)
+{
+    (void)device;
+    DeadbandPush((SFPDeadband *)ctx, sample->reg_address, sample);
+}
+
+
+// Initializes a deadband stage.
+byte DeadbandInit(SFPDeadband * deadband, SFPSampleSink sink, void * ctx)
+{
+
+    if (deadband == NULL)
+        return MEM_FAIL;
+
+    memset(deadband, 0, sizeof(SFPDeadband));
+    memset(deadband->index, SFP_DEADBAND_NONE, sizeof(deadband->index));
+    deadband->sink = sink;
+    deadband->ctx = ctx;
+    deadband->observer.on_read = DeadbandOnRead;
+    deadband->observer.ctx = deadband;
+
+    return SFP_OK;
+
+}
+
+
+// Adds the filter of a register.
+byte DeadbandAdd(SFPDeadband * deadband,
+                 byte SFP_reg_address,
+                 byte mode,
+                 double threshold,
+                 unsigned long long heartbeat_ns,
+                 int * filter)
+{
+
+    if (deadband == NULL)
+        return MEM_FAIL;
+
+    if (deadband->filter_count == SFP_DEADBAND_MAX_FILTERS)
+        return MEM_FAIL;
+
+    if (mode > SFP_DEADBAND_SWINGING_DOOR || threshold < 0.0
+        || deadband->index[SFP_reg_address] != SFP_DEADBAND_NONE)
+        return BYTES_INVALID;
+
+    SFPDeadbandFilter * added = &deadband->filters[deadband->filter_count];
+    memset(added, 0, sizeof(SFPDeadbandFilter));
+    added->reg_address = SFP_reg_address;
+    added->mode = mode;
+    added->threshold = threshold;
+    added->heartbeat_ns = heartbeat_ns;
+    OpenDoor(added);
+
+    deadband->index[SFP_reg_address] = (byte)deadband->filter_count;
+    if (filter != NULL)
+        *filter = deadband->filter_count;
+    deadband->filter_count++;
+
+    return SFP_OK;
+
+}
+
+
+// Filters a sample.
+byte DeadbandPush(SFPDeadband * deadband,
+                  int channel,
+                  const SFPSample * sample)
+{
+
+    if (deadband == NULL || sample == NULL)
+        return MEM_FAIL;
+
+    const byte index = deadband->index[sample->reg_address];
+    if (index == SFP_DEADBAND_NONE)
+    {
+        if (deadband->sink != NULL)
+            deadband->sink(deadband->ctx, channel, sample);
+        return SFP_OK;
+    }
+
+    SFPDeadbandFilter * filter = &deadband->filters[index];
+    filter->received++;
+
+    // Failures, status changes and heartbeats are always reported.
+    if (sample->rc != SFP_OK)
+    {
+        filter->forwarded_count++;
+        if (deadband->sink != NULL)
+            deadband->sink(deadband->ctx, channel, sample);
+        return SFP_OK;
+    }
+
+    const SFPSample * last = &filter->forwarded;
+    if (!filter->started || sample->status != last->status)
+    {
+        ForceForward(deadband, filter, channel, sample);
+        return SFP_OK;
+    }
+
+    if (filter->heartbeat_ns != 0
+        && sample->timestamp_ns >= last->timestamp_ns + filter->heartbeat_ns)
+    {
+        filter->heartbeats++;
+        ForceForward(deadband, filter, channel, sample);
+        return SFP_OK;
+    }
+
+    const double change = fabs((double)sample->value - (double)last->value);
+    switch (filter->mode)
+    {
+    case SFP_DEADBAND_ABSOLUTE:
+        if (change > filter->threshold)
+            Forward(deadband, filter, channel, sample);
+        break;
+    case SFP_DEADBAND_PERCENT:
+        if (change > filter->threshold / 100.0 * fabs((double)last->value))
+            Forward(deadband, filter, channel, sample);
+        break;
+    case SFP_DEADBAND_SWINGING_DOOR:
+        SwingingDoor(deadband, filter, channel, sample);
+        break;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Sample sink filtering samples.
+void DeadbandSink(void * ctx, int channel, const SFPSample * sample)
+{
+    DeadbandPush((SFPDeadband *)ctx, channel, sample);
+}
+
+
+// Forwards the samples held by the swinging door filters.
+byte DeadbandFlush(SFPDeadband * deadband)
+{
+
+    if (deadband == NULL)
+        return MEM_FAIL;
+
+    for (int i = 0; i < deadband->filter_count; i++)
+    {
+        SFPDeadbandFilter * filter = &deadband->filters[i];
+        if (filter->held)
+        {
+            Forward(deadband, filter, filter->held_channel, &filter->sample);
+            OpenDoor(filter);
+        }
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Filters every read of a device.
+byte DeadbandAttach(SFPDeadband * deadband, SFPDevice * device)
+{
+
+    if (deadband == NULL || device == NULL)
+        return MEM_FAIL;
+
+    if (deadband->device != NULL)
+        return DEVICE_BUSY;
+
+    byte rc = AddObserver(device, &deadband->observer);
+    if (rc == SFP_OK)
+        deadband->device = device;
+
+    return rc;
+
+}
+
+
+// Stops filtering the reads of the attached device.
+byte DeadbandDetach(SFPDeadband * deadband)
+{
+
+    if (deadband == NULL)
+        return MEM_FAIL;
+
+    if (deadband->device == NULL)
+        return SFP_OK;
+
+    byte rc = RemoveObserver(deadband->device, &deadband->observer);
+    deadband->device = NULL;
+
+    return rc;
+
+}
@@ -0,0 +1,190 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_DEADBAND.h
+
+ Abstract:
+    Change-only reporting. A deadband stage sits between the acquisition
+    (poll schedule sink or device observer) and a downstream sample sink,
+    and only forwards the samples of a register that differ significantly
+    from the last forwarded one:
+
+    - absolute deadband: the value moved by more than a number of counts;
+    - percentage deadband: the value moved by more than a percentage of the
+      last forwarded value;
+    - swinging door: the samples no longer fit, within the deviation, on a
+      straight line from the last forwarded sample. The last sample that
+      fitted is then forwarded, so the forwarded samples are the vertices of
+      a piecewise linear approximation of the signal (forwarding is delayed
+      by one sample).
+
+    A sample is also forwarded when its status byte changes, when the read
+    failed, and as a heartbeat when nothing was forwarded for a given time.
+    Registers without a filter are forwarded unchanged.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_DEADBAND_LIB
+#define SFP10X_DEADBAND_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum number of filtered registers.
+#define SFP_DEADBAND_MAX_FILTERS 32
+
+// Index of a register without a filter.
+#define SFP_DEADBAND_NONE 0xFF
+
+
+// Enumeration type for the filter modes.
+enum DeadbandMode
+{
+    SFP_DEADBAND_ABSOLUTE = 0x00,       // Threshold in counts.
+    SFP_DEADBAND_PERCENT = 0x01,        // Threshold in percent.
+    SFP_DEADBAND_SWINGING_DOOR = 0x02   // Deviation in counts.
+};
+
+
+// Data structure for the filter of a register.
+// Members are managed by the Deadband functions.
+typedef struct SFPDeadbandFilter_
+{
+    byte reg_address;                   // Filtered register.
+    byte mode;                          // DeadbandMode enum.
+    double threshold;                   // Threshold or deviation.
+    unsigned long long heartbeat_ns;    // Heartbeat period, 0 for none.
+    int started;                        // Non-zero once a sample was
+                                        // forwarded.
+    SFPSample forwarded;                // Last forwarded sample.
+    int held;                           // Non-zero if sample holds the last
+                                        // sample that was not forwarded.
+    int held_channel;                   // Producer channel of that sample.
+    SFPSample sample;                   // Last sample not forwarded (swinging
+                                        // door).
+    double upper;                       // Swinging door slopes, in counts
+    double lower;                       // per ns.
+    unsigned long long received;        // Number of received samples.
+    unsigned long long forwarded_count; // Number of forwarded samples.
+    unsigned long long heartbeats;      // Forwarded as heartbeats.
+} SFPDeadbandFilter;
+
+
+// Data structure for a deadband stage.
+typedef struct SFPDeadband_
+{
+    SFPDeadbandFilter filters[SFP_DEADBAND_MAX_FILTERS];
+    int filter_count;                   // Number of filters.
+    byte index[256];                    // Filter of each register address.
+    SFPSampleSink sink;                 // Downstream sink.
+    void * ctx;                         // Downstream sink context.
+    SFPObserver observer;               // Device observer.
+    SFPDevice * device;                 // Attached device, if any.
+} SFPDeadband;
+
+
+/** Initializes a deadband stage.
+ *
+ *	Accepts         SFPDeadband pointer and the downstream sample sink with
+ *                  its context.
+ *
+ *	Returns         status flag.
+ */
+byte DeadbandInit(SFPDeadband * deadband, SFPSampleSink sink, void * ctx);
+
+
+/** Adds the filter of a register.
+ *
+ *	Accepts         SFPDeadband pointer, register address, mode, threshold,
+ *                  heartbeat period and an (optional) int pointer receiving
+ *                  the filter index.
+ *
+ *	threshold       counts (absolute, swinging door deviation) or percent.
+ *
+ *	heartbeat_ns    a sample is forwarded when nothing was forwarded for
+ *                  this time, 0 for no heartbeat.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if there are too many
+ *                  filters and BYTES_INVALID if the mode or the threshold is
+ *                  invalid or the register already has a filter.
+ */
+byte DeadbandAdd(SFPDeadband * deadband,
+                 byte SFP_reg_address,
+                 byte mode,
+                 double threshold,
+                 unsigned long long heartbeat_ns,
+                 int * filter);
+
+
+/** Filters a sample.
+ *
+ *	Accepts         SFPDeadband pointer, producer channel and SFPSample
+ *                  pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  The samples of a register must be pushed in time order.
+ */
+byte DeadbandPush(SFPDeadband * deadband,
+                  int channel,
+                  const SFPSample * sample);
+
+
+/** Sample sink filtering samples (see SFPSampleSink).
+ *
+ *	ctx             SFPDeadband pointer.
+ */
+void DeadbandSink(void * ctx, int channel, const SFPSample * sample);
+
+
+/** Forwards the samples held by the swinging door filters, e.g. at the end
+ *  of an acquisition.
+ *
+ *	Accepts         SFPDeadband pointer.
+ *
+ *	Returns         status flag.
+ */
+byte DeadbandFlush(SFPDeadband * deadband);
+
+
+/** Filters every read of a device.
+ *
+ *	Accepts         SFPDeadband pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  The downstream sink receives the register address as channel.
+ */
+byte DeadbandAttach(SFPDeadband * deadband, SFPDevice * device);
+
+
+/** Stops filtering the reads of the attached device.
+ *
+ *	Accepts         SFPDeadband pointer.
+ *
+ *	Returns         status flag.
+ */
+byte DeadbandDetach(SFPDeadband * deadband);
+
+
+#endif  // SFP10X_DEADBAND_LIB
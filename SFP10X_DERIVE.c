@@ -0,0 +1,350 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_DERIVE.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_DERIVE.h"
+#include <math.h>
+#include <string.h>
+
+
+// Appends a step to the plan.
+static byte AddStep(SFPDeriveEngine * engine,
+                    const SFPDeriveStep * step,
+                    int * slot)
+{
+
+    if (engine->slot_count == SFP_DERIVE_MAX_SLOTS)
+        return MEM_FAIL;
+
+    engine->steps[engine->slot_count] = *step;
+    if (slot != NULL)
+        *slot = engine->slot_count;
+    engine->slot_count++;
+
+    return SFP_OK;
+
+}
+
+
+// Accumulates the trapezoid between the previous and the current integrand.
+static void Integrate(SFPDeriveStep * step,
+                      double value,
+                      unsigned long long timestamp_ns)
+{
+    if (step->started)
+        step->integral += step->scale * 0.5 * (step->previous + value)
+                          * (double)(timestamp_ns - step->previous_ns)
+                          / SFP_NS_PER_S;
+    step->previous = value;
+    step->previous_ns = timestamp_ns;
+    step->started = 1;
+}
+
+
+// Integrates a column value by value, skipping invalid (NaN) values; the
+// integral is NaN until its first valid value, as in DeriveUpdate().
+static void IntegrateColumn(SFPDeriveStep * step,
+                            const unsigned long long * timestamps,
+                            const double * values,
+                            int count,
+                            double * out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!isnan(values[i]))
+            Integrate(step, values[i], timestamps[i]);
+        out[i] = step->started ? step->integral : NAN;
+    }
+}
+
+
+// Initializes a derived channel engine.
+byte DeriveInit(SFPDeriveEngine * engine, SFPDerivedSink sink, void * ctx)
+{
+
+    if (engine == NULL)
+        return MEM_FAIL;
+
+    memset(engine, 0, sizeof(SFPDeriveEngine));
+    engine->sink = sink;
+    engine->ctx = ctx;
+
+    return SFP_OK;
+
+}
+
+
+// Declares a scaled input.
+byte DeriveInput(SFPDeriveEngine * engine,
+                 int channel,
+                 double scale,
+                 double offset,
+                 int * slot)
+{
+
+    if (engine == NULL)
+        return MEM_FAIL;
+
+    if (channel < 0 || channel >= SFP_ALIGN_MAX_CHANNELS)
+        return BYTES_INVALID;
+
+    SFPDeriveStep step;
+    memset(&step, 0, sizeof(step));
+    step.op = SFP_DERIVE_INPUT;
+    step.a = channel;
+    step.scale = scale;
+    step.offset = offset;
+
+    return AddStep(engine, &step, slot);
+
+}
+
+
+// Declares an arithmetic combination of two earlier slots.
+byte DeriveBinary(SFPDeriveEngine * engine,
+                  byte op,
+                  int a,
+                  int b,
+                  int * slot)
+{
+
+    if (engine == NULL)
+        return MEM_FAIL;
+
+    // Operands must be evaluated first.
+    if (op < SFP_DERIVE_ADD || op > SFP_DERIVE_DIV
+        || a < 0 || a >= engine->slot_count
+        || b < 0 || b >= engine->slot_count)
+        return BYTES_INVALID;
+
+    SFPDeriveStep step;
+    memset(&step, 0, sizeof(step));
+    step.op = op;
+    step.a = a;
+    step.b = b;
+
+    return AddStep(engine, &step, slot);
+
+}
+
+
+// Declares the time integral of an earlier slot.
+byte DeriveIntegral(SFPDeriveEngine * engine, int a, double scale, int * slot)
+{
+
+    if (engine == NULL)
+        return MEM_FAIL;
+
+    if (a < 0 || a >= engine->slot_count)
+        return BYTES_INVALID;
+
+    SFPDeriveStep step;
+    memset(&step, 0, sizeof(step));
+    step.op = SFP_DERIVE_INTEGRAL;
+    step.a = a;
+    step.scale = scale;
+
+    return AddStep(engine, &step, slot);
+
+}
+
+
+// Evaluates the plan on an aligned frame.
+byte DeriveUpdate(SFPDeriveEngine * engine, const SFPAlignedFrame * frame)
+{
+
+    if (engine == NULL || frame == NULL)
+        return MEM_FAIL;
+
+    double * const v = engine->values;
+    byte * const ok = engine->valid;
+    const unsigned long long t = frame->timestamp_ns;
+
+    for (int s = 0; s < engine->slot_count; s++)
+    {
+
+        SFPDeriveStep * step = &engine->steps[s];
+        const int a = step->a;
+        const int b = step->b;
+        switch (step->op)
+        {
+        case SFP_DERIVE_INPUT:
+            ok[s] = a < frame->channel_count && frame->valid[a];
+            v[s] = ok[s] ? frame->values[a] * step->scale + step->offset : 0.0;
+            break;
+        case SFP_DERIVE_ADD:
+            ok[s] = ok[a] && ok[b];
+            v[s] = v[a] + v[b];
+            break;
+        case SFP_DERIVE_SUB:
+            ok[s] = ok[a] && ok[b];
+            v[s] = v[a] - v[b];
+            break;
+        case SFP_DERIVE_MUL:
+            ok[s] = ok[a] && ok[b];
+            v[s] = v[a] * v[b];
+            break;
+        case SFP_DERIVE_DIV:
+            ok[s] = ok[a] && ok[b] && v[b] != 0.0;
+            v[s] = ok[s] ? v[a] / v[b] : 0.0;
+            break;
+        case SFP_DERIVE_INTEGRAL:
+            if (ok[a])
+                Integrate(step, v[a], t);
+            ok[s] = (byte)step->started;
+            v[s] = step->integral;
+            break;
+        }
+
+    }
+
+    engine->timestamp_ns = t;
+    if (engine->sink != NULL)
+        engine->sink(engine->ctx, t, v, ok, engine->slot_count);
+
+    return SFP_OK;
+
+}
+
+
+// Aligned frame sink feeding an engine.
+void DeriveFrameSink(void * ctx, const SFPAlignedFrame * frame)
+{
+    DeriveUpdate((SFPDeriveEngine *)ctx, frame);
+}
+
+
+// Evaluates the plan over columns of recorded frames.
+byte DeriveBulk(SFPDeriveEngine * engine,
+                const unsigned long long * timestamps,
+                const double * const * inputs,
+                int count,
+                double * const * outputs)
+{
+
+    if (engine == NULL || timestamps == NULL || inputs == NULL
+        || outputs == NULL)
+        return MEM_FAIL;
+
+    if (count <= 0)
+        return SFP_OK;
+
+    // One step at a time over the whole block, so that every loop is a
+    // simple element-wise operation.
+    for (int s = 0; s < engine->slot_count; s++)
+    {
+
+        SFPDeriveStep * step = &engine->steps[s];
+        double * restrict out = outputs[s];
+        const double * restrict a = step->op == SFP_DERIVE_INPUT
+                                    ? inputs[step->a] : outputs[step->a];
+        const double * restrict b = outputs[step->b];
+        if (out == NULL || a == NULL)
+            return MEM_FAIL;
+
+        switch (step->op)
+        {
+        case SFP_DERIVE_INPUT:
+        {
+            const double scale = step->scale;
+            const double offset = step->offset;
+            for (int i = 0; i < count; i++)
+                out[i] = a[i] * scale + offset;
+            break;
+        }
+        case SFP_DERIVE_ADD:
+            for (int i = 0; i < count; i++)
+                out[i] = a[i] + b[i];
+            break;
+        case SFP_DERIVE_SUB:
+            for (int i = 0; i < count; i++)
+                out[i] = a[i] - b[i];
+            break;
+        case SFP_DERIVE_MUL:
+            for (int i = 0; i < count; i++)
+                out[i] = a[i] * b[i];
+            break;
+        case SFP_DERIVE_DIV:
+            // A zero divisor gives an invalid value, as in DeriveUpdate().
+            for (int i = 0; i < count; i++)
+                out[i] = b[i] != 0.0 ? a[i] / b[i] : NAN;
+            break;
+        case SFP_DERIVE_INTEGRAL:
+        {
+            int invalid = 0;
+            for (int i = 0; i < count; i++)
+                invalid |= isnan(a[i]);
+            if (invalid || !step->started)
+            {
+                IntegrateColumn(step, timestamps, a, count, out);
+                break;
+            }
+
+            // Trapezoids first (element-wise), then their running sum.
+            const double k = step->scale * 0.5 / SFP_NS_PER_S;
+            out[0] = k * (step->previous + a[0])
+                     * (double)(timestamps[0] - step->previous_ns);
+            for (int i = 1; i < count; i++)
+                out[i] = k * (a[i - 1] + a[i])
+                         * (double)(timestamps[i] - timestamps[i - 1]);
+
+            double integral = step->integral;
+            for (int i = 0; i < count; i++)
+            {
+                integral += out[i];
+                out[i] = integral;
+            }
+
+            step->integral = integral;
+            step->previous = a[count - 1];
+            step->previous_ns = timestamps[count - 1];
+            break;
+        }
+        }
+
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Resets the integrals of an engine.
+byte DeriveReset(SFPDeriveEngine * engine)
+{
+
+    if (engine == NULL)
+        return MEM_FAIL;
+
+    for (int s = 0; s < engine->slot_count; s++)
+    {
+        engine->steps[s].integral = 0.0;
+        engine->steps[s].started = 0;
+    }
+
+    return SFP_OK;
+
+}
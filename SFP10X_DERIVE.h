@@ -0,0 +1,219 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_DERIVE.h
+
+ Abstract:
+    Derived channels computed from aligned frames (see SFP10X_ALIGN.h), e.g.
+    power, energy or charge from the current and voltage registers.
+
+    Derived channels are declared as steps of an evaluation plan: scaled
+    inputs (counts to physical units), arithmetic on earlier steps and time
+    integrals (trapezoidal rule). Every step refers to its operands by slot
+    index, so evaluating a frame is a single pass over a flat array without
+    any lookup or parsing. For recorded or replayed data, DeriveBulk()
+    evaluates the plan step by step over whole columns; these loops are
+    simple enough for the compiler to vectorize.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_DERIVE_LIB
+#define SFP10X_DERIVE_LIB
+
+
+#include "SFP10X_ALIGN.h"
+
+
+// Maximum number of slots (steps) of a plan.
+#define SFP_DERIVE_MAX_SLOTS 32
+
+// Conversion factors of the SFP10X current and voltage registers (see main.c).
+#define SFP_AMPS_PER_COUNT 0.00006119
+#define SFP_VOLTS_PER_COUNT 0.0000287
+
+// Seconds per hour, to express charge integrals in amp-hours.
+#define SFP_SECONDS_PER_HOUR 3600.0
+
+
+// Enumeration type for the plan operations.
+enum DeriveOp
+{
+    SFP_DERIVE_INPUT = 0x00,    // Frame channel * scale + offset.
+    SFP_DERIVE_ADD = 0x01,      // a + b.
+    SFP_DERIVE_SUB = 0x02,      // a - b.
+    SFP_DERIVE_MUL = 0x03,      // a * b.
+    SFP_DERIVE_DIV = 0x04,      // a / b.
+    SFP_DERIVE_INTEGRAL = 0x05  // scale * integral of a dt (dt in seconds).
+};
+
+
+// Derived values consumer callback.
+// values and valid hold one element per slot.
+typedef void (*SFPDerivedSink)(void * ctx,
+                               unsigned long long timestamp_ns,
+                               const double * values,
+                               const byte * valid,
+                               int slot_count);
+
+
+// Data structure for a plan step.
+// Members are managed by the Derive functions.
+typedef struct SFPDeriveStep_
+{
+    byte op;                            // DeriveOp enum.
+    int a;                              // Operand slot (frame channel for
+                                        // inputs).
+    int b;                              // Second operand slot.
+    double scale;                       // Input and integral scale.
+    double offset;                      // Input offset.
+    double integral;                    // Integral value.
+    double previous;                    // Integrand at the previous frame.
+    unsigned long long previous_ns;     // Time of the previous frame.
+    int started;                        // Non-zero once previous is set.
+} SFPDeriveStep;
+
+
+// Data structure for a derived channel engine.
+typedef struct SFPDeriveEngine_
+{
+    SFPDeriveStep steps[SFP_DERIVE_MAX_SLOTS];  // Plan, in evaluation order.
+    int slot_count;                             // Number of steps.
+    double values[SFP_DERIVE_MAX_SLOTS];        // Values at the last frame.
+    byte valid[SFP_DERIVE_MAX_SLOTS];           // Validity at the last frame.
+    unsigned long long timestamp_ns;            // Time of the last frame.
+    SFPDerivedSink sink;                        // Consumer, may be NULL.
+    void * ctx;                                 // Consumer context.
+} SFPDeriveEngine;
+
+
+/** Initializes a derived channel engine.
+ *
+ *	Accepts         SFPDeriveEngine pointer and an (optional) derived values
+ *                  sink with its context.
+ *
+ *	Returns         status flag.
+ */
+byte DeriveInit(SFPDeriveEngine * engine, SFPDerivedSink sink, void * ctx);
+
+
+/** Declares a scaled input.
+ *
+ *	Accepts         SFPDeriveEngine pointer, aligned frame channel, scale,
+ *                  offset and an (optional) int pointer receiving the slot.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if the plan is full and
+ *                  BYTES_INVALID if the channel is out of range.
+ */
+byte DeriveInput(SFPDeriveEngine * engine,
+                 int channel,
+                 double scale,
+                 double offset,
+                 int * slot);
+
+
+/** Declares an arithmetic combination of two earlier slots.
+ *
+ *	Accepts         SFPDeriveEngine pointer, operation (SFP_DERIVE_ADD, SUB,
+ *                  MUL or DIV), operand slots and an (optional) int pointer
+ *                  receiving the slot.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if the plan is full and
+ *                  BYTES_INVALID if the operation or an operand is invalid.
+ */
+byte DeriveBinary(SFPDeriveEngine * engine,
+                  byte op,
+                  int a,
+                  int b,
+                  int * slot);
+
+
+/** Declares the time integral of an earlier slot.
+ *
+ *	Accepts         SFPDeriveEngine pointer, integrand slot, scale and an
+ *                  (optional) int pointer receiving the slot.
+ *
+ *	scale           multiplies the integral in unit seconds, e.g. 1 for
+ *                  joules from watts or 1 / SFP_SECONDS_PER_HOUR for
+ *                  amp-hours from amps.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if the plan is full and
+ *                  BYTES_INVALID if the integrand is invalid.
+ *
+ *  Frames where the integrand is invalid are bridged linearly.
+ */
+byte DeriveIntegral(SFPDeriveEngine * engine, int a, double scale, int * slot);
+
+
+/** Evaluates the plan on an aligned frame.
+ *
+ *	Accepts         SFPDeriveEngine pointer and SFPAlignedFrame pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  A slot is invalid if one of its operands is invalid or on a division by
+ *  zero. Integrals are valid once started.
+ */
+byte DeriveUpdate(SFPDeriveEngine * engine, const SFPAlignedFrame * frame);
+
+
+/** Aligned frame sink feeding an engine (see SFPFrameSink).
+ *
+ *	ctx             SFPDeriveEngine pointer.
+ */
+void DeriveFrameSink(void * ctx, const SFPAlignedFrame * frame);
+
+
+/** Evaluates the plan over columns of recorded frames.
+ *
+ *	Accepts         SFPDeriveEngine pointer, frame timestamps, input columns,
+ *                  number of frames and output columns.
+ *
+ *	inputs          inputs[c] holds the values of frame channel c.
+ *
+ *	outputs         outputs[s] receives the values of slot s; all the slots
+ *                  need a column.
+ *
+ *	Returns         status flag.
+ *
+ *  Invalid values are NaN: a NaN input, a division by zero and an integral
+ *  before its first valid value follow the validity rules of
+ *  DeriveUpdate(), and NaN propagates through the arithmetic steps.
+ *  Integrals skip invalid values and continue from (and update) the state
+ *  of the engine, so a long recording can be processed in blocks.
+ */
+byte DeriveBulk(SFPDeriveEngine * engine,
+                const unsigned long long * timestamps,
+                const double * const * inputs,
+                int count,
+                double * const * outputs);
+
+
+/** Resets the integrals of an engine.
+ *
+ *	Accepts         SFPDeriveEngine pointer.
+ *
+ *	Returns         status flag.
+ */
+byte DeriveReset(SFPDeriveEngine * engine);
+
+
+#endif  // SFP10X_DERIVE_LIB
@@ -0,0 +1,467 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_EXPORT.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_EXPORT.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+
+// Size of the header and of the trailer.
+#define HEADER_SIZE 64
+#define TRAILER_SIZE 16
+
+
+// Moves to an offset from the start or the end of a file (64-bit offsets).
+static int Seek(FILE * file, long long offset, int whence)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, whence);
+#else
+    return fseeko(file, (off_t)offset, whence);
+#endif
+}
+
+
+// Returns the current offset of a file (64-bit offsets).
+static long long Tell(FILE * file)
+{
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return (long long)ftello(file);
+#endif
+}
+
+
+// Writes bytes and tracks the file offset; the first error is kept.
+static void Put(SFPExporter * exporter, const void * data, size_t size)
+{
+    if (exporter->rc != SFP_OK)
+        return;
+    if (size > 0 && fwrite(data, 1, size, exporter->file) != size)
+    {
+        exporter->rc = WRITE_FAIL;
+        return;
+    }
+    exporter->position += size;
+}
+
+
+// Pads the file to the array alignment.
+static void Align(SFPExporter * exporter)
+{
+    static const byte zeros[SFP_EXPORT_ALIGNMENT] = { 0 };
+    const size_t misalignment = (size_t)(exporter->position
+                                         % SFP_EXPORT_ALIGNMENT);
+    if (misalignment != 0)
+        Put(exporter, zeros, SFP_EXPORT_ALIGNMENT - misalignment);
+}
+
+
+// Writes one column array and records its extent.
+static void PutArray(SFPExporter * exporter,
+                     int channel,
+                     byte column,
+                     const void * data,
+                     size_t element_size,
+                     unsigned int count)
+{
+
+    if (exporter->extent_count == exporter->extent_capacity)
+    {
+        const int capacity = exporter->extent_capacity * 2 + 16;
+        SFPExportExtent * extents = realloc(exporter->extents,
+                                            capacity * sizeof(SFPExportExtent));
+        if (extents == NULL)
+        {
+            exporter->rc = MEM_FAIL;
+            return;
+        }
+        exporter->extents = extents;
+        exporter->extent_capacity = capacity;
+    }
+
+    Align(exporter);
+    SFPExportExtent * extent = &exporter->extents[exporter->extent_count++];
+    extent->channel = (unsigned int)channel;
+    extent->column = column;
+    extent->offset = exporter->position;
+    extent->count = count;
+    extent->first_row = exporter->buffers[channel].written_rows;
+    Put(exporter, data, element_size * count);
+
+}
+
+
+// Writes the buffered rows of a channel as a row group.
+static void WriteGroup(SFPExporter * exporter, int channel)
+{
+
+    SFPExportBuffer * buffer = &exporter->buffers[channel];
+    if (buffer->rows == 0)
+        return;
+
+    PutArray(exporter, channel, SFP_EXPORT_TIMESTAMP, buffer->timestamps,
+             sizeof(unsigned long long), buffer->rows);
+    PutArray(exporter, channel, SFP_EXPORT_RAW, buffer->raw,
+             sizeof(long long), buffer->rows);
+    PutArray(exporter, channel, SFP_EXPORT_VALUE, buffer->values,
+             sizeof(double), buffer->rows);
+    PutArray(exporter, channel, SFP_EXPORT_STATUS, buffer->status,
+             sizeof(byte), buffer->rows);
+
+    buffer->written_rows += buffer->rows;
+    buffer->rows = 0;
+
+}
+
+
+// Releases the buffers of an exporter.
+static void FreeBuffers(SFPExporter * exporter)
+{
+    for (int c = 0; c < exporter->channel_count; c++)
+    {
+        free(exporter->buffers[c].timestamps);
+        free(exporter->buffers[c].raw);
+        free(exporter->buffers[c].values);
+        free(exporter->buffers[c].status);
+    }
+    free(exporter->extents);
+    exporter->extents = NULL;
+    exporter->channel_count = 0;
+}
+
+
+// Creates an export file.
+byte ExporterOpen(SFPExporter * exporter,
+                  const char * path,
+                  unsigned int group_rows)
+{
+
+    if (exporter == NULL || path == NULL)
+        return MEM_FAIL;
+
+    memset(exporter, 0, sizeof(SFPExporter));
+    exporter->group_rows = group_rows != 0 ? group_rows
+                                           : SFP_EXPORT_DEFAULT_GROUP_ROWS;
+    exporter->rc = SFP_OK;
+
+    exporter->file = fopen(path, "wb");
+    if (exporter->file == NULL)
+        return PORT_FAIL;
+
+    byte header[HEADER_SIZE] = { 0 };
+    const unsigned int fields[3] = { SFP_EXPORT_VERSION,
+                                     SFP_EXPORT_BYTE_ORDER,
+                                     SFP_EXPORT_ALIGNMENT };
+    memcpy(header, SFP_EXPORT_MAGIC, 8);
+    memcpy(header + 8, fields, sizeof(fields));
+    Put(exporter, header, sizeof(header));
+
+    return exporter->rc;
+
+}
+
+
+// Adds a channel.
+byte ExporterAddChannel(SFPExporter * exporter,
+                        const char * name,
+                        byte SFP_reg_address,
+                        double scale,
+                        double offset,
+                        int * channel)
+{
+
+    if (exporter == NULL || name == NULL || exporter->file == NULL)
+        return MEM_FAIL;
+
+    if (exporter->channel_count == SFP_EXPORT_MAX_CHANNELS)
+        return MEM_FAIL;
+
+    const int index = exporter->channel_count;
+    SFPExportChannelInfo * info = &exporter->channels[index];
+    memset(info, 0, sizeof(SFPExportChannelInfo));
+    strncpy(info->name, name, sizeof(info->name) - 1);
+    info->reg_address = SFP_reg_address;
+    info->scale = scale;
+    info->offset = offset;
+
+    SFPExportBuffer * buffer = &exporter->buffers[index];
+    memset(buffer, 0, sizeof(SFPExportBuffer));
+    const size_t rows = exporter->group_rows;
+    buffer->timestamps = malloc(rows * sizeof(unsigned long long));
+    buffer->raw = malloc(rows * sizeof(long long));
+    buffer->values = malloc(rows * sizeof(double));
+    buffer->status = malloc(rows * sizeof(byte));
+    if (buffer->timestamps == NULL || buffer->raw == NULL
+        || buffer->values == NULL || buffer->status == NULL)
+    {
+        free(buffer->timestamps);
+        free(buffer->raw);
+        free(buffer->values);
+        free(buffer->status);
+        memset(buffer, 0, sizeof(SFPExportBuffer));
+        exporter->rc = MEM_FAIL;
+        return MEM_FAIL;
+    }
+    exporter->channel_count++;
+
+    if (channel != NULL)
+        *channel = index;
+
+    return SFP_OK;
+
+}
+
+
+// Exports a sample of a channel.
+byte ExporterWrite(SFPExporter * exporter,
+                   int channel,
+                   const SFPSample * sample)
+{
+
+    if (exporter == NULL || sample == NULL)
+        return MEM_FAIL;
+
+    if (channel < 0 || channel >= exporter->channel_count)
+        return MEM_FAIL;
+
+    // A failed exporter keeps its first error and buffers nothing more.
+    if (exporter->rc != SFP_OK)
+        return exporter->rc;
+
+    if (sample->rc != SFP_OK)
+    {
+        exporter->skipped++;
+        return SFP_OK;
+    }
+
+    const SFPExportChannelInfo * info = &exporter->channels[channel];
+    SFPExportBuffer * buffer = &exporter->buffers[channel];
+    const unsigned int row = buffer->rows++;
+    buffer->timestamps[row] = sample->timestamp_ns;
+    buffer->raw[row] = sample->value;
+    buffer->values[row] = (double)sample->value * info->scale + info->offset;
+    buffer->status[row] = sample->status;
+
+    if (buffer->rows == exporter->group_rows)
+        WriteGroup(exporter, channel);
+
+    return exporter->rc;
+
+}
+
+
+// Sample sink exporting samples.
+void ExporterSink(void * ctx, int channel, const SFPSample * sample)
+{
+    ExporterWrite((SFPExporter *)ctx, channel, sample);
+}
+
+
+// Writes the buffered rows and the footer, and closes the file.
+byte ExporterClose(SFPExporter * exporter)
+{
+
+    if (exporter == NULL)
+        return MEM_FAIL;
+
+    if (exporter->file == NULL)
+        return PORT_FAIL;
+
+    for (int c = 0; c < exporter->channel_count; c++)
+        WriteGroup(exporter, c);
+
+    Align(exporter);
+    const unsigned long long footer = exporter->position;
+    const unsigned int counts[2] = { (unsigned int)exporter->channel_count,
+                                     (unsigned int)exporter->extent_count };
+    Put(exporter, counts, sizeof(counts));
+    Put(exporter, exporter->channels,
+        exporter->channel_count * sizeof(SFPExportChannelInfo));
+    Put(exporter, exporter->extents,
+        exporter->extent_count * sizeof(SFPExportExtent));
+    Put(exporter, &footer, sizeof(footer));
+    Put(exporter, SFP_EXPORT_MAGIC, 8);
+
+    if (fclose(exporter->file) != 0 && exporter->rc == SFP_OK)
+        exporter->rc = WRITE_FAIL;
+    exporter->file = NULL;
+    FreeBuffers(exporter);
+
+    return exporter->rc;
+
+}
+
+
+// Reads the header, trailer and footer of an open export file.
+static byte ReadFooter(FILE * file, SFPExportReader * reader)
+{
+
+    byte header[HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)
+        || memcmp(header, SFP_EXPORT_MAGIC, 8) != 0)
+        return BYTES_INVALID;
+
+    unsigned int fields[3];
+    memcpy(fields, header + 8, sizeof(fields));
+    if (fields[0] != SFP_EXPORT_VERSION || fields[1] != SFP_EXPORT_BYTE_ORDER)
+        return BYTES_INVALID;
+
+    byte trailer[TRAILER_SIZE];
+    if (Seek(file, -TRAILER_SIZE, SEEK_END) != 0
+        || fread(trailer, 1, sizeof(trailer), file) != sizeof(trailer)
+        || memcmp(trailer + 8, SFP_EXPORT_MAGIC, 8) != 0)
+        return BYTES_INVALID;
+
+    const long long end = Tell(file);
+    if (end < HEADER_SIZE + TRAILER_SIZE)
+        return BYTES_INVALID;
+
+    // The footer must lie between the header and the trailer.
+    unsigned long long footer;
+    memcpy(&footer, trailer, sizeof(footer));
+    const unsigned long long trailer_offset =
+        (unsigned long long)(end - TRAILER_SIZE);
+    if (footer < HEADER_SIZE || footer > trailer_offset)
+        return BYTES_INVALID;
+
+    unsigned int counts[2];
+    if (Seek(file, (long long)footer, SEEK_SET) != 0
+        || fread(counts, sizeof(unsigned int), 2, file) != 2
+        || counts[0] > SFP_EXPORT_MAX_CHANNELS)
+        return BYTES_INVALID;
+
+    // The counts are bounded by the bytes the footer actually holds before
+    // anything is allocated.
+    const unsigned long long tables = (unsigned long long)counts[0]
+                                      * sizeof(SFPExportChannelInfo)
+                                      + 2 * sizeof(unsigned int);
+    if (trailer_offset - footer < tables
+        || counts[1] > (trailer_offset - footer - tables)
+                       / sizeof(SFPExportExtent)
+        || counts[1] > (unsigned int)INT_MAX)
+        return BYTES_INVALID;
+
+    // The size is computed in 64 bits and must also fit in a size_t.
+    const unsigned long long size = ((unsigned long long)counts[1] + 1)
+                                    * sizeof(SFPExportExtent);
+    if ((size_t)size != size)
+        return BYTES_INVALID;
+
+    reader->extents = malloc((size_t)size);
+    if (reader->extents == NULL)
+        return MEM_FAIL;
+
+    if (fread(reader->channels, sizeof(SFPExportChannelInfo), counts[0], file)
+            != counts[0]
+        || fread(reader->extents, sizeof(SFPExportExtent), counts[1], file)
+            != counts[1])
+        return BYTES_INVALID;
+
+    reader->channel_count = (int)counts[0];
+    reader->extent_count = (int)counts[1];
+
+    return SFP_OK;
+
+}
+
+
+// Reads the footer of an export file.
+byte ExportReaderOpen(SFPExportReader * reader, const char * path)
+{
+
+    if (reader == NULL || path == NULL)
+        return MEM_FAIL;
+
+    memset(reader, 0, sizeof(SFPExportReader));
+
+    FILE * file = fopen(path, "rb");
+    if (file == NULL)
+        return PORT_FAIL;
+
+    byte rc = ReadFooter(file, reader);
+    fclose(file);
+    if (rc != SFP_OK)
+        ExportReaderClose(reader);
+
+    return rc;
+
+}
+
+
+// Finds an array of a column.
+byte ExportReaderExtent(const SFPExportReader * reader,
+                        int channel,
+                        byte column,
+                        int index,
+                        SFPExportExtent * extent)
+{
+
+    if (reader == NULL || extent == NULL)
+        return MEM_FAIL;
+
+    for (int i = 0; i < reader->extent_count; i++)
+    {
+        const SFPExportExtent * candidate = &reader->extents[i];
+        if (candidate->channel == (unsigned int)channel
+            && candidate->column == column
+            && index-- == 0)
+        {
+            *extent = *candidate;
+            return SFP_OK;
+        }
+    }
+
+    return READ_FAIL;
+
+}
+
+
+// Releases a reader.
+byte ExportReaderClose(SFPExportReader * reader)
+{
+
+    if (reader == NULL)
+        return MEM_FAIL;
+
+    free(reader->extents);
+    reader->extents = NULL;
+    reader->extent_count = 0;
+    reader->channel_count = 0;
+
+    return SFP_OK;
+
+}
+
+
+#undef HEADER_SIZE
+#undef TRAILER_SIZE
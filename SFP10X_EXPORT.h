@@ -0,0 +1,254 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_EXPORT.h
+
+ Abstract:
+    Columnar export of decoded channels. Every channel is stored as four
+    typed columns (timestamp, raw counts, engineering value, status byte).
+    Rows are buffered per channel and written as row groups: in a row group,
+    each column is one contiguous array aligned on 64 bytes. The schema and
+    the location of every array are stored in a footer, so that a reader
+    can map any column straight from the file without parsing the data
+    (e.g. numpy.memmap with the offset and count of the extent). With a row
+    group size larger than the number of rows, each column is a single
+    array.
+
+    File layout (host byte order, see byte_order):
+
+        header (64 bytes)
+            char[8]     magic "SFPCOLS1"
+            uint32      version (SFP_EXPORT_VERSION)
+            uint32      byte_order, 0x01020304 as written by the host
+            uint32      alignment (64)
+            ...         zero padding
+        column arrays, each aligned on 64 bytes
+        footer
+            uint32      channel count
+            uint32      extent count
+            channel descriptors (SFPExportChannelInfo layout, 56 bytes)
+                char[32]    name
+                uint32      register address
+                uint32      reserved
+                float64     scale (value = raw * scale + offset)
+                float64     offset
+            extent descriptors (SFPExportExtent layout, 32 bytes)
+                uint32      channel
+                uint32      column (ExportColumn enum)
+                uint64      file offset of the array
+                uint64      number of elements
+                uint64      row index of the first element
+        trailer (16 bytes)
+            uint64      file offset of the footer
+            char[8]     magic "SFPCOLS1"
+
+    Column types: timestamp uint64 (host monotonic ns, SFPSample
+    timestamp_ns), raw int64 (counts), value float64, status uint8.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_EXPORT_LIB
+#define SFP10X_EXPORT_LIB
+
+
+#include "SFP10X_COM.h"
+#include <stdio.h>
+
+
+// File identification.
+#define SFP_EXPORT_MAGIC "SFPCOLS1"
+#define SFP_EXPORT_VERSION 1
+#define SFP_EXPORT_BYTE_ORDER 0x01020304u
+
+// Alignment of the header and of the column arrays.
+#define SFP_EXPORT_ALIGNMENT 64
+
+// Maximum number of channels in a file.
+#define SFP_EXPORT_MAX_CHANNELS 32
+
+// Default number of rows per row group.
+#define SFP_EXPORT_DEFAULT_GROUP_ROWS 1048576
+
+
+// Enumeration type for the columns of a channel.
+enum ExportColumn
+{
+    SFP_EXPORT_TIMESTAMP = 0x00,    // uint64, ns.
+    SFP_EXPORT_RAW = 0x01,          // int64, counts.
+    SFP_EXPORT_VALUE = 0x02,        // float64, engineering unit.
+    SFP_EXPORT_STATUS = 0x03        // uint8, module status byte.
+};
+
+
+// Data structure for a channel descriptor (footer layout).
+typedef struct SFPExportChannelInfo_
+{
+    char name[32];                      // Channel name, NUL terminated.
+    unsigned int reg_address;           // SFP register address.
+    unsigned int reserved;
+    double scale;                       // Engineering unit per count.
+    double offset;                      // Engineering unit offset.
+} SFPExportChannelInfo;
+
+
+// Data structure for a column array (footer layout).
+typedef struct SFPExportExtent_
+{
+    unsigned int channel;               // Channel index.
+    unsigned int column;                // ExportColumn enum.
+    unsigned long long offset;          // File offset of the array.
+    unsigned long long count;           // Number of elements.
+    unsigned long long first_row;       // Row index of the first element.
+} SFPExportExtent;
+
+
+// Data structure for the rows buffered for a channel.
+// Members are managed by the Exporter functions.
+typedef struct SFPExportBuffer_
+{
+    unsigned int rows;                  // Buffered rows.
+    unsigned long long written_rows;    // Rows already written.
+    unsigned long long * timestamps;
+    long long * raw;
+    double * values;
+    byte * status;
+} SFPExportBuffer;
+
+
+// Data structure for an exporter.
+// Members are managed by the Exporter functions.
+typedef struct SFPExporter_
+{
+    FILE * file;                        // Output file.
+    unsigned long long position;        // Current file offset.
+    unsigned int group_rows;            // Rows per row group.
+    SFPExportChannelInfo channels[SFP_EXPORT_MAX_CHANNELS];
+    SFPExportBuffer buffers[SFP_EXPORT_MAX_CHANNELS];
+    int channel_count;                  // Number of channels.
+    SFPExportExtent * extents;          // Written arrays.
+    int extent_count;
+    int extent_capacity;
+    unsigned long long skipped;         // Failed samples not exported.
+    byte rc;                            // First write error, SFP_OK if none.
+} SFPExporter;
+
+
+// Data structure for a reader (footer only; the arrays are mapped or read
+// by the user from the extent offsets).
+typedef struct SFPExportReader_
+{
+    int channel_count;
+    SFPExportChannelInfo channels[SFP_EXPORT_MAX_CHANNELS];
+    int extent_count;
+    SFPExportExtent * extents;
+} SFPExportReader;
+
+
+/** Creates an export file.
+ *
+ *	Accepts         SFPExporter pointer, file path and the number of rows per
+ *                  row group (0 for SFP_EXPORT_DEFAULT_GROUP_ROWS).
+ *
+ *	Returns         status flag.
+ */
+byte ExporterOpen(SFPExporter * exporter,
+                  const char * path,
+                  unsigned int group_rows);
+
+
+/** Adds a channel.
+ *
+ *	Accepts         SFPExporter pointer, channel name, register address,
+ *                  engineering scale and offset and an (optional) int
+ *                  pointer receiving the channel index.
+ *
+ *	Returns         status flag.
+ */
+byte ExporterAddChannel(SFPExporter * exporter,
+                        const char * name,
+                        byte SFP_reg_address,
+                        double scale,
+                        double offset,
+                        int * channel);
+
+
+/** Exports a sample of a channel.
+ *
+ *	Accepts         SFPExporter pointer, channel index and SFPSample pointer.
+ *
+ *	Returns         status flag. Failed samples (rc) are skipped.
+ */
+byte ExporterWrite(SFPExporter * exporter,
+                   int channel,
+                   const SFPSample * sample);
+
+
+/** Sample sink exporting samples (see SFPSampleSink).
+ *
+ *	ctx             SFPExporter pointer.
+ */
+void ExporterSink(void * ctx, int channel, const SFPSample * sample);
+
+
+/** Writes the buffered rows and the footer, and closes the file.
+ *
+ *	Accepts         SFPExporter pointer.
+ *
+ *	Returns         status flag. WRITE_FAIL is returned if any write failed.
+ */
+byte ExporterClose(SFPExporter * exporter);
+
+
+/** Reads the footer of an export file.
+ *
+ *	Accepts         SFPExportReader pointer and file path.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if the file is
+ *                  not an export file or was written with another byte order.
+ */
+byte ExportReaderOpen(SFPExportReader * reader, const char * path);
+
+
+/** Finds an array of a column.
+ *
+ *	Accepts         SFPExportReader pointer, channel index, column, array
+ *                  index (row group) and SFPExportExtent pointer.
+ *
+ *	Returns         status flag. READ_FAIL is returned past the last array.
+ */
+byte ExportReaderExtent(const SFPExportReader * reader,
+                        int channel,
+                        byte column,
+                        int index,
+                        SFPExportExtent * extent);
+
+
+/** Releases a reader.
+ *
+ *	Accepts         SFPExportReader pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ExportReaderClose(SFPExportReader * reader);
+
+
+#endif  // SFP10X_EXPORT_LIB
@@ -0,0 +1,203 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_GROUP.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_GROUP.h"
+#include <string.h>
+
+
+// I/O thread of a device.
+static SFP_THREAD_FUNC(GroupWorker, arg)
+{
+
+    SFPGroupWorker * worker = (SFPGroupWorker *)arg;
+    SFPGroup * group = worker->group;
+    SFPDevice * device = group->devices[worker->index];
+    unsigned int generation = 0;
+
+    SFPMutexLock(&group->lock);
+    for (;;)
+    {
+
+        while (group->running && group->generation == generation)
+            SFPCondWait(&group->start, &group->lock);
+        if (!group->running)
+            break;
+
+        generation = group->generation;
+        const byte reg_address = group->reg_address;
+        const byte number_of_bytes = group->number_of_bytes;
+        SFPSample * sample = &group->samples[worker->index];
+        SFPMutexUnlock(&group->lock);
+
+        ReadSample(device, reg_address, number_of_bytes, sample);
+
+        SFPMutexLock(&group->lock);
+        if (--group->pending == 0)
+            SFPCondSignal(&group->done);
+
+    }
+    SFPMutexUnlock(&group->lock);
+
+    SFP_THREAD_RETURN;
+
+}
+
+
+// Stops the first worker_count threads of a group.
+static void StopWorkers(SFPGroup * group, int worker_count)
+{
+
+    SFPMutexLock(&group->lock);
+    group->running = 0;
+    SFPCondBroadcast(&group->start);
+    SFPMutexUnlock(&group->lock);
+
+    for (int i = 0; i < worker_count; i++)
+        SFPThreadJoin(group->workers[i].thread);
+
+    SFPCondDestroy(&group->done);
+    SFPCondDestroy(&group->start);
+    SFPMutexDestroy(&group->lock);
+
+}
+
+
+// Starts a group of initialized devices.
+byte GroupStart(SFPGroup * group, SFPDevice ** devices, int device_count)
+{
+
+    if (group == NULL || devices == NULL)
+        return MEM_FAIL;
+
+    if (device_count <= 0 || device_count > SFP_GROUP_MAX_DEVICES)
+        return BYTES_INVALID;
+
+    memset(group, 0, sizeof(SFPGroup));
+    group->device_count = device_count;
+    for (int i = 0; i < device_count; i++)
+    {
+        if (devices[i] == NULL)
+            return MEM_FAIL;
+        group->devices[i] = devices[i];
+    }
+
+    SFPMutexInit(&group->lock);
+    SFPCondInit(&group->start);
+    SFPCondInit(&group->done);
+    group->running = 1;
+
+    for (int i = 0; i < device_count; i++)
+    {
+        group->workers[i].group = group;
+        group->workers[i].index = i;
+        if (SFPThreadStart(&group->workers[i].thread, GroupWorker,
+                           &group->workers[i]) != 0)
+        {
+            StopWorkers(group, i);
+            return MEM_FAIL;
+        }
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Stops a group.
+byte GroupStop(SFPGroup * group)
+{
+
+    if (group == NULL)
+        return MEM_FAIL;
+
+    if (!group->running)
+        return DEVICE_BUSY;
+
+    StopWorkers(group, group->device_count);
+
+    return SFP_OK;
+
+}
+
+
+// Reads the same register from every device of a group concurrently.
+byte GroupRead(SFPGroup * group,
+               byte SFP_reg_address,
+               byte number_of_bytes,
+               SFPSample * samples,
+               SFPGroupResult * result)
+{
+
+    if (group == NULL || samples == NULL)
+        return MEM_FAIL;
+
+    if (!group->running)
+        return DEVICE_BUSY;
+
+    const unsigned long long start_ns = SFPNowNs();
+
+    // Release all the threads at once.
+    SFPMutexLock(&group->lock);
+    group->reg_address = SFP_reg_address;
+    group->number_of_bytes = number_of_bytes;
+    group->samples = samples;
+    group->pending = group->device_count;
+    group->generation++;
+    SFPCondBroadcast(&group->start);
+    while (group->pending > 0)
+        SFPCondWait(&group->done, &group->lock);
+    group->samples = NULL;
+    SFPMutexUnlock(&group->lock);
+
+    // Summarize the successful reads.
+    int ok_count = 0;
+    unsigned long long first_ns = 0;
+    unsigned long long last_ns = 0;
+    for (int i = 0; i < group->device_count; i++)
+    {
+        if (samples[i].rc != SFP_OK)
+            continue;
+        const unsigned long long timestamp_ns = samples[i].timestamp_ns;
+        if (ok_count == 0 || timestamp_ns < first_ns)
+            first_ns = timestamp_ns;
+        if (ok_count == 0 || timestamp_ns > last_ns)
+            last_ns = timestamp_ns;
+        ok_count++;
+    }
+
+    if (result != NULL)
+    {
+        result->ok_count = ok_count;
+        result->start_ns = start_ns;
+        result->first_ns = first_ns;
+        result->last_ns = last_ns;
+        result->skew_ns = last_ns - first_ns;
+    }
+
+    return ok_count == group->device_count ? SFP_OK : READ_FAIL;
+
+}
@@ -0,0 +1,135 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_GROUP.h
+
+ Abstract:
+    Fan-out reads across a group of modules. A group owns one I/O thread
+    per device; a group read releases all the threads at once so that the
+    same register is read from every module concurrently, and returns when
+    all the reads have completed. The sampling skew between modules is then
+    bounded by the thread wake-up latency and the spread of the round trip
+    times instead of their sum.
+
+    The devices must not be used by other threads while they belong to a
+    group. Observers of the devices are notified from the I/O threads.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_GROUP_LIB
+#define SFP10X_GROUP_LIB
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_COM.h"
+
+
+// Maximum number of devices in a group.
+#define SFP_GROUP_MAX_DEVICES 64
+
+
+// Data structure for the summary of a group read.
+typedef struct SFPGroupResult_
+{
+    int ok_count;                       // Number of successful reads.
+    unsigned long long start_ns;        // Host time the read was issued.
+    unsigned long long first_ns;        // Earliest sample timestamp.
+    unsigned long long last_ns;         // Latest sample timestamp.
+    unsigned long long skew_ns;         // last_ns - first_ns.
+} SFPGroupResult;
+
+
+struct SFPGroup_;
+
+// Data structure for an I/O thread.
+typedef struct SFPGroupWorker_
+{
+    struct SFPGroup_ * group;           // Owning group.
+    int index;                          // Device index in the group.
+    SFPThread thread;
+} SFPGroupWorker;
+
+
+// Data structure for a device group.
+// Members are managed by the Group functions.
+typedef struct SFPGroup_
+{
+    SFPDevice * devices[SFP_GROUP_MAX_DEVICES];
+    SFPGroupWorker workers[SFP_GROUP_MAX_DEVICES];
+    int device_count;
+    SFPMutex lock;                      // Protects the members below.
+    SFPCond start;                      // Signaled when a read is issued.
+    SFPCond done;                       // Signaled when the last read completes.
+    int running;                        // Non-zero while the threads run.
+    unsigned int generation;            // Incremented for every group read.
+    int pending;                        // Reads not yet completed.
+    byte reg_address;                   // Register of the current read.
+    byte number_of_bytes;               // Size of the current read.
+    SFPSample * samples;                // Results of the current read.
+} SFPGroup;
+
+
+/** Starts a group of initialized devices.
+ *
+ *	Accepts         SFPGroup pointer, array of SFPDevice pointers and the
+ *                  number of devices (at most SFP_GROUP_MAX_DEVICES).
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if the number of
+ *                  devices is out of range.
+ */
+byte GroupStart(SFPGroup * group, SFPDevice ** devices, int device_count);
+
+
+/** Stops a group. The devices are left open.
+ *
+ *	Accepts         SFPGroup pointer.
+ *
+ *	Returns         status flag.
+ */
+byte GroupStop(SFPGroup * group);
+
+
+/** Reads the same register from every device of a group concurrently.
+ *
+ *	Accepts         SFPGroup pointer, register address, number of bytes, an
+ *                  array of SFPSample with one element per device and an
+ *                  (optional) SFPGroupResult pointer.
+ *
+ *	samples         element i receives the read of device i, with its own
+ *                  status flag (rc) and timestamp (see ReadSample()).
+ *
+ *	result          receives the number of successful reads and the skew
+ *                  between the timestamps of the successful reads.
+ *
+ *	Returns         status flag. READ_FAIL is returned if any of the reads
+ *                  failed; the other samples are still valid.
+ *
+ *  Must only be called by one thread at a time.
+ */
+byte GroupRead(SFPGroup * group,
+               byte SFP_reg_address,
+               byte number_of_bytes,
+               SFPSample * samples,
+               SFPGroupResult * result);
+
+
+#endif  // SFP10X_GROUP_LIB
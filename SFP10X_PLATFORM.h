@@ -0,0 +1,320 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_PLATFORM.h
+
+ Abstract:
+    Internal platform helpers shared by the SFP10X_COM modules: monotonic
+    clock, sleeping, mutexes, condition variables, threads and atomic
+    counters. This header is
+    not intended to be used directly by applications.
+
+    It must be included before any other header (on Windows, windows.h has to
+    precede ftd2xx.h; on POSIX platforms the feature test macro has to be set
+    before the first system header).
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_PLATFORM_LIB
+#define SFP10X_PLATFORM_LIB
+
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#endif
+
+
+// Number of nanoseconds in one second.
+#define SFP_NS_PER_S 1000000000ULL
+
+
+// Returns the host monotonic time in nanoseconds.
+// The origin is arbitrary; only differences are meaningful.
+static inline unsigned long long SFPNowNs(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = { 0 };
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (unsigned long long)
+        ((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * SFP_NS_PER_S
+        + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+
+// Sleeps until the monotonic time deadline_ns (as returned by SFPNowNs).
+// Returns immediately if the deadline is already in the past.
+static inline void SFPSleepUntilNs(unsigned long long deadline_ns)
+{
+#ifdef _WIN32
+    unsigned long long now = SFPNowNs();
+    if (deadline_ns > now)
+        Sleep((DWORD)((deadline_ns - now) / 1000000ULL));
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / SFP_NS_PER_S);
+    ts.tv_nsec = (long)(deadline_ns % SFP_NS_PER_S);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+#endif
+}
+
+
+// Mutex, condition variable and thread types.
+// On Windows, condition variables require Windows Vista or above.
+#ifdef _WIN32
+typedef CRITICAL_SECTION SFPMutex;
+typedef CONDITION_VARIABLE SFPCond;
+typedef HANDLE SFPThread;
+#define SFP_THREAD_FUNC(name, arg) DWORD WINAPI name(LPVOID arg)
+#define SFP_THREAD_RETURN return 0
+#else
+typedef pthread_mutex_t SFPMutex;
+typedef pthread_cond_t SFPCond;
+typedef pthread_t SFPThread;
+#define SFP_THREAD_FUNC(name, arg) void * name(void * arg)
+#define SFP_THREAD_RETURN return NULL
+#endif
+
+
+static inline void SFPMutexInit(SFPMutex * mutex)
+{
+#ifdef _WIN32
+    InitializeCriticalSection(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+
+static inline void SFPMutexDestroy(SFPMutex * mutex)
+{
+#ifdef _WIN32
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+
+static inline void SFPMutexLock(SFPMutex * mutex)
+{
+#ifdef _WIN32
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+
+static inline void SFPMutexUnlock(SFPMutex * mutex)
+{
+#ifdef _WIN32
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+
+// Condition variables wait on the monotonic clock (where supported) so that
+// deadlines computed with SFPNowNs() can be used directly.
+static inline void SFPCondInit(SFPCond * cond)
+{
+#ifdef _WIN32
+    InitializeConditionVariable(cond);
+#else
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+#ifndef __APPLE__
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+#endif
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+#endif
+}
+
+
+static inline void SFPCondDestroy(SFPCond * cond)
+{
+#ifdef _WIN32
+    (void)cond;
+#else
+    pthread_cond_destroy(cond);
+#endif
+}
+
+
+static inline void SFPCondWait(SFPCond * cond, SFPMutex * mutex)
+{
+#ifdef _WIN32
+    SleepConditionVariableCS(cond, mutex, INFINITE);
+#else
+    pthread_cond_wait(cond, mutex);
+#endif
+}
+
+
+// Waits on a condition variable until the monotonic time deadline_ns.
+// Returns 0 if the deadline has passed, non-zero otherwise (the caller must
+// check its predicate in both cases).
+static inline int SFPCondWaitUntil(SFPCond * cond,
+                                   SFPMutex * mutex,
+                                   unsigned long long deadline_ns)
+{
+    unsigned long long now = SFPNowNs();
+    if (now >= deadline_ns)
+        return 0;
+#ifdef _WIN32
+    SleepConditionVariableCS(cond, mutex,
+                             (DWORD)((deadline_ns - now + 999999ULL)
+                                     / 1000000ULL));
+#elif defined(__APPLE__)
+    struct timespec ts;
+    ts.tv_sec = (time_t)((deadline_ns - now) / SFP_NS_PER_S);
+    ts.tv_nsec = (long)((deadline_ns - now) % SFP_NS_PER_S);
+    pthread_cond_timedwait_relative_np(cond, mutex, &ts);
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / SFP_NS_PER_S);
+    ts.tv_nsec = (long)(deadline_ns % SFP_NS_PER_S);
+    pthread_cond_timedwait(cond, mutex, &ts);
+#endif
+    return SFPNowNs() < deadline_ns;
+}
+
+
+static inline void SFPCondSignal(SFPCond * cond)
+{
+#ifdef _WIN32
+    WakeConditionVariable(cond);
+#else
+    pthread_cond_signal(cond);
+#endif
+}
+
+
+static inline void SFPCondBroadcast(SFPCond * cond)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(cond);
+#else
+    pthread_cond_broadcast(cond);
+#endif
+}
+
+
+// Starts a thread running function(arg).
+// The function must be declared with SFP_THREAD_FUNC.
+// Returns 0 on success.
+#ifdef _WIN32
+static inline int SFPThreadStart(SFPThread * thread,
+                                 LPTHREAD_START_ROUTINE function,
+                                 void * arg)
+{
+    *thread = CreateThread(NULL, 0, function, arg, 0, NULL);
+    return *thread == NULL;
+}
+#else
+static inline int SFPThreadStart(SFPThread * thread,
+                                 void * (*function)(void *),
+                                 void * arg)
+{
+    return pthread_create(thread, NULL, function, arg);
+}
+#endif
+
+
+// Waits for a thread to terminate.
+static inline void SFPThreadJoin(SFPThread thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+
+// Atomically loads a 64-bit counter (acquire).
+static inline unsigned long long SFPAtomicLoad(
+    volatile unsigned long long * counter)
+{
+#ifdef _WIN32
+    return (unsigned long long)InterlockedCompareExchange64(
+        (volatile LONG64 *)counter, 0, 0);
+#else
+    return __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+// Atomically stores a 64-bit counter (release).
+static inline void SFPAtomicStore(volatile unsigned long long * counter,
+                                  unsigned long long value)
+{
+#ifdef _WIN32
+    InterlockedExchange64((volatile LONG64 *)counter, (LONG64)value);
+#else
+    __atomic_store_n(counter, value, __ATOMIC_RELEASE);
+#endif
+}
+
+
+// Orders the preceding loads before the following loads and stores.
+static inline void SFPFenceAcquire(void)
+{
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+
+// Orders the preceding loads and stores before the following stores.
+static inline void SFPFenceRelease(void)
+{
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+
+#endif  // SFP10X_PLATFORM_LIB
@@ -0,0 +1,663 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_POLL.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_POLL.h"
+#include <math.h>
+#include <string.h>
+
+
+// Bits on the wire per byte (start bit, 8 data bits and stop bit).
+#define BITS_PER_BYTE 10
+
+
+// Greatest common divisor.
+static unsigned long long GCD(unsigned long long a, unsigned long long b)
+{
+    while (b != 0)
+    {
+        unsigned long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+
+// Period of an entry in ns, once rounded to the minor frame (or at the
+// current rate for an adaptive entry).
+static unsigned long long EntryPeriodNs(const SFPPollSchedule * schedule,
+                                        const SFPPollEntry * entry)
+{
+    if (entry->adaptive)
+        return (unsigned long long)(1e9 / entry->effective_rate_hz + 0.5);
+    return entry->period_frames * schedule->frame_length_ns;
+}
+
+
+// Link utilization of the entries other than exclude (may be NULL).
+static double Utilization(const SFPPollSchedule * schedule,
+                          const SFPPollEntry * exclude)
+{
+    double utilization = 0.0;
+    for (int i = 0; i < schedule->entry_count; i++)
+    {
+        const SFPPollEntry * entry = &schedule->entries[i];
+        if (entry != exclude)
+            utilization += (double)entry->cost_ns
+                / (double)EntryPeriodNs(schedule, entry);
+    }
+    return utilization;
+}
+
+
+// Records the outcome of a read in the entry statistics.
+static void RecordSample(const SFPPollSchedule * schedule,
+                         SFPPollEntry * entry,
+                         const SFPSample * sample)
+{
+
+    if (sample->rc != SFP_OK)
+    {
+        entry->errors++;
+        return;
+    }
+
+    if (entry->count == 0)
+    {
+        entry->first_ns = sample->timestamp_ns;
+    }
+    else
+    {
+        // Deviation of the sampling interval from the target period.
+        double dev = (double)(sample->timestamp_ns - entry->last_ns)
+            - (double)EntryPeriodNs(schedule, entry);
+        entry->dev_sum2 += dev * dev;
+        if (fabs(dev) > entry->dev_max)
+            entry->dev_max = fabs(dev);
+    }
+
+    entry->last_ns = sample->timestamp_ns;
+    entry->count++;
+
+}
+
+
+// Adapts the rate of an entry to the dynamics of its signal.
+static void AdaptRate(SFPPollSchedule * schedule,
+                      SFPPollEntry * entry,
+                      const SFPSample * sample)
+{
+
+    if (sample->rc != SFP_OK)
+        return;
+
+    const SFPPollAdaptConfig * config = &entry->adapt;
+    const double value = (double)sample->value;
+    if (entry->last_value_ns == 0)
+    {
+        entry->signal_mean = value;
+        entry->signal_var = 0.0;
+        entry->last_value = sample->value;
+        entry->last_value_ns = sample->timestamp_ns;
+        return;
+    }
+    if (sample->timestamp_ns <= entry->last_value_ns)
+        return;
+
+    const double dt = (double)(sample->timestamp_ns - entry->last_value_ns)
+        / 1e9;
+    entry->last_value = sample->value;
+    entry->last_value_ns = sample->timestamp_ns;
+
+    // Exponentially weighted mean and variance over time.
+    const double a = 1.0 - exp(-dt / config->time_constant_s);
+    const double d = value - entry->signal_mean;
+    entry->signal_mean += a * d;
+    entry->signal_var = (1.0 - a) * (entry->signal_var + a * d * d);
+    const double slope = fabs(a * d) / dt;
+
+    // Time average of the rate in use until now.
+    double rate = entry->effective_rate_hz;
+    entry->rate_sum += rate * dt;
+    entry->rate_time_s += dt;
+
+    if ((config->slope_threshold > 0.0 && slope > config->slope_threshold)
+        || (config->sigma_threshold > 0.0
+            && sqrt(entry->signal_var) > config->sigma_threshold))
+        rate *= config->rise;
+    else
+        rate *= pow(0.5, dt / config->half_life_s);
+
+    // Bounds, then the link budget left by the other registers. The minimum
+    // rates always fit (see PollScheduleBuild()).
+    if (rate > config->max_rate_hz)
+        rate = config->max_rate_hz;
+    const double limit = (schedule->budget - Utilization(schedule, entry))
+        * 1e9 / (double)entry->cost_ns;
+    if (rate > limit)
+        rate = limit;
+    if (rate < config->min_rate_hz)
+        rate = config->min_rate_hz;
+
+    entry->effective_rate_hz = rate;
+    if (rate < entry->rate_low_hz)
+        entry->rate_low_hz = rate;
+    if (rate > entry->rate_high_hz)
+        entry->rate_high_hz = rate;
+    schedule->utilization = Utilization(schedule, NULL);
+
+}
+
+
+// Reads one entry and reports the sample.
+static void PollEntry(SFPDevice * device,
+                      SFPPollSchedule * schedule,
+                      int entry_id,
+                      SFPSampleSink sink,
+                      void * ctx)
+{
+
+    SFPPollEntry * entry = &schedule->entries[entry_id];
+    SFPSample sample;
+    ReadSample(device, entry->reg_address, entry->number_of_bytes, &sample);
+
+    RecordSample(schedule, entry, &sample);
+    if (entry->adaptive)
+        AdaptRate(schedule, entry, &sample);
+    if (sink != NULL)
+        sink(ctx, entry_id, &sample);
+
+}
+
+
+// Initializes an empty poll schedule.
+byte PollScheduleInit(SFPPollSchedule * schedule, byte strategy)
+{
+
+    if (schedule == NULL)
+        return MEM_FAIL;
+
+    if (strategy != SFP_POLL_CYCLIC && strategy != SFP_POLL_PRIORITY)
+        return SCHEDULE_FAIL;
+
+    memset(schedule, 0, sizeof(SFPPollSchedule));
+    schedule->strategy = strategy;
+    schedule->overhead_ns = SFP_POLL_DEFAULT_OVERHEAD_NS;
+    schedule->budget = SFP_POLL_DEFAULT_BUDGET;
+
+    return SFP_OK;
+
+}
+
+
+// Declares a register to be polled.
+byte PollScheduleAdd(SFPPollSchedule * schedule,
+                     byte SFP_reg_address,
+                     byte number_of_bytes,
+                     double rate_hz,
+                     int priority,
+                     int * entry_id)
+{
+
+    if (schedule == NULL)
+        return MEM_FAIL;
+
+    if (DataBytes(number_of_bytes) == 0)
+        return BYTES_INVALID;
+
+    if (!(rate_hz > 0.0) || schedule->entry_count >= SFP_POLL_MAX_ENTRIES)
+        return SCHEDULE_FAIL;
+
+    SFPPollEntry * entry = &schedule->entries[schedule->entry_count];
+    memset(entry, 0, sizeof(SFPPollEntry));
+    entry->reg_address = SFP_reg_address;
+    entry->number_of_bytes = number_of_bytes;
+    entry->priority = priority;
+    entry->rate_hz = rate_hz;
+
+    if (entry_id != NULL)
+        *entry_id = schedule->entry_count;
+    schedule->entry_count++;
+
+    // The schedule has to be rebuilt.
+    schedule->built = 0;
+
+    return SFP_OK;
+
+}
+
+
+// Lets the rate of a polled register follow the signal dynamics.
+byte PollScheduleAdapt(SFPPollSchedule * schedule,
+                       int entry_id,
+                       const SFPPollAdaptConfig * config)
+{
+
+    if (schedule == NULL)
+        return MEM_FAIL;
+
+    if (schedule->strategy != SFP_POLL_PRIORITY
+        || entry_id < 0 || entry_id >= schedule->entry_count)
+        return SCHEDULE_FAIL;
+
+    SFPPollEntry * entry = &schedule->entries[entry_id];
+    schedule->built = 0;
+    if (config == NULL)
+    {
+        entry->adaptive = 0;
+        return SFP_OK;
+    }
+
+    SFPPollAdaptConfig adapt = *config;
+    if (adapt.rise == 0.0)
+        adapt.rise = SFP_POLL_DEFAULT_RISE;
+    if (adapt.half_life_s == 0.0)
+        adapt.half_life_s = SFP_POLL_DEFAULT_HALF_LIFE_S;
+    if (adapt.time_constant_s == 0.0)
+        adapt.time_constant_s = SFP_POLL_DEFAULT_TIME_CONSTANT_S;
+    if (!(adapt.min_rate_hz > 0.0) || !(adapt.max_rate_hz >= adapt.min_rate_hz)
+        || !(adapt.rise > 1.0) || !(adapt.half_life_s > 0.0)
+        || !(adapt.time_constant_s > 0.0)
+        || adapt.slope_threshold < 0.0 || adapt.sigma_threshold < 0.0)
+        return SCHEDULE_FAIL;
+
+    entry->adapt = adapt;
+    entry->adaptive = 1;
+
+    return SFP_OK;
+
+}
+
+
+// Builds the schedule for the current baudrate of a device.
+byte PollScheduleBuild(SFPPollSchedule * schedule, const SFPDevice * device)
+{
+
+    if (schedule == NULL || device == NULL)
+        return MEM_FAIL;
+
+    schedule->built = 0;
+    if (schedule->entry_count == 0 || BaudRateBps(device->sfp_baud_rate) == 0)
+        return SCHEDULE_FAIL;
+    schedule->baud_rate = device->sfp_baud_rate;
+
+    // Minor frame: the requested one or the period of the fastest register.
+    unsigned long long frame_ns = schedule->frame_ns;
+    if (frame_ns == 0)
+    {
+        double max_rate = 0.0;
+        for (int i = 0; i < schedule->entry_count; i++)
+        {
+            const SFPPollEntry * entry = &schedule->entries[i];
+            const double rate = entry->adaptive
+                ? entry->adapt.max_rate_hz : entry->rate_hz;
+            if (rate > max_rate)
+                max_rate = rate;
+        }
+        frame_ns = (unsigned long long)(1e9 / max_rate + 0.5);
+    }
+    if (frame_ns == 0)
+        return SCHEDULE_FAIL;
+    schedule->frame_length_ns = frame_ns;
+
+    // Round the periods to whole minor frames and compute the major cycle.
+    unsigned long long frame_count = 1;
+    double utilization = 0.0;
+    for (int i = 0; i < schedule->entry_count; i++)
+    {
+        SFPPollEntry * entry = &schedule->entries[i];
+        entry->cost_ns = PollWireTimeNs((byte)device->sfp_baud_rate,
+                                        entry->number_of_bytes)
+            + schedule->overhead_ns;
+
+        // Adaptive entries are served at most once per minor frame and do
+        // not take part in the major cycle.
+        if (entry->adaptive)
+        {
+            if (entry->adapt.max_rate_hz * (double)frame_ns
+                > 1e9 * (1.0 + SFP_POLL_RATE_TOLERANCE))
+                return SCHEDULE_FAIL;
+            double rate = entry->rate_hz;
+            if (rate < entry->adapt.min_rate_hz)
+                rate = entry->adapt.min_rate_hz;
+            if (rate > entry->adapt.max_rate_hz)
+                rate = entry->adapt.max_rate_hz;
+            entry->effective_rate_hz = rate;
+            entry->period_frames = 1;
+            utilization += (double)entry->cost_ns
+                / (double)EntryPeriodNs(schedule, entry);
+            continue;
+        }
+
+        double period_ns = 1e9 / entry->rate_hz;
+        double frames = floor(period_ns / (double)frame_ns + 0.5);
+        if (frames < 1.0)
+            return SCHEDULE_FAIL;
+        if (fabs(frames * frame_ns - period_ns) > SFP_POLL_RATE_TOLERANCE
+            * period_ns)
+            return SCHEDULE_FAIL;
+        if (frames > SFP_POLL_MAX_FRAMES)
+            return SCHEDULE_FAIL;
+        entry->period_frames = (unsigned int)frames;
+
+        frame_count = frame_count / GCD(frame_count, entry->period_frames)
+            * entry->period_frames;
+        if (frame_count > SFP_POLL_MAX_FRAMES)
+            return SCHEDULE_FAIL;
+
+        utilization += (double)entry->cost_ns
+            / (double)(entry->period_frames * frame_ns);
+    }
+    schedule->frame_count = (unsigned int)frame_count;
+    schedule->utilization = utilization;
+
+    // Whole schedule has to fit in the link budget.
+    if (utilization > schedule->budget)
+        return SCHEDULE_FAIL;
+
+    // Execution order: priority first, then shortest period.
+    for (int i = 0; i < schedule->entry_count; i++)
+        schedule->order[i] = i;
+    for (int i = 1; i < schedule->entry_count; i++)
+    {
+        int k = schedule->order[i];
+        int j = i - 1;
+        while (j >= 0)
+        {
+            const SFPPollEntry * a = &schedule->entries[schedule->order[j]];
+            const SFPPollEntry * b = &schedule->entries[k];
+            if (a->priority < b->priority
+                || (a->priority == b->priority
+                    && a->period_frames <= b->period_frames))
+                break;
+            schedule->order[j + 1] = schedule->order[j];
+            j--;
+        }
+        schedule->order[j + 1] = k;
+    }
+
+    // Frame budget.
+    const double frame_budget = schedule->budget * (double)frame_ns;
+
+    if (schedule->strategy == SFP_POLL_CYCLIC)
+    {
+
+        // Place each register at the offset that minimizes the worst frame
+        // load. The most constrained (shortest period) registers go first.
+        unsigned long long load[SFP_POLL_MAX_FRAMES] = { 0 };
+        int placed[SFP_POLL_MAX_ENTRIES];
+        for (int i = 0; i < schedule->entry_count; i++)
+            placed[i] = schedule->order[i];
+        for (int i = 1; i < schedule->entry_count; i++)
+        {
+            int k = placed[i];
+            int j = i - 1;
+            while (j >= 0 && schedule->entries[placed[j]].period_frames
+                   > schedule->entries[k].period_frames)
+            {
+                placed[j + 1] = placed[j];
+                j--;
+            }
+            placed[j + 1] = k;
+        }
+
+        for (int i = 0; i < schedule->entry_count; i++)
+        {
+            SFPPollEntry * entry = &schedule->entries[placed[i]];
+            unsigned int best_offset = 0;
+            unsigned long long best_load = ~0ULL;
+            for (unsigned int o = 0; o < entry->period_frames; o++)
+            {
+                unsigned long long worst = 0;
+                for (unsigned int f = o; f < frame_count;
+                     f += entry->period_frames)
+                    if (load[f] > worst)
+                        worst = load[f];
+                if (worst < best_load)
+                {
+                    best_load = worst;
+                    best_offset = o;
+                }
+            }
+            entry->offset_frame = best_offset;
+            for (unsigned int f = best_offset; f < frame_count;
+                 f += entry->period_frames)
+            {
+                load[f] += entry->cost_ns;
+                if ((double)load[f] > frame_budget)
+                    return SCHEDULE_FAIL;
+            }
+        }
+
+    }
+    else
+    {
+
+        // Every single transaction has to fit within a minor frame.
+        for (int i = 0; i < schedule->entry_count; i++)
+            if ((double)schedule->entries[i].cost_ns > frame_budget)
+                return SCHEDULE_FAIL;
+
+    }
+
+    // Reset the run state and the statistics.
+    for (int i = 0; i < schedule->entry_count; i++)
+    {
+        SFPPollEntry * entry = &schedule->entries[i];
+        entry->next_due_ns = 0;
+        entry->count = 0;
+        entry->errors = 0;
+        entry->first_ns = 0;
+        entry->last_ns = 0;
+        entry->dev_sum2 = 0.0;
+        entry->dev_max = 0.0;
+        entry->last_value_ns = 0;
+        entry->rate_sum = 0.0;
+        entry->rate_time_s = 0.0;
+        entry->rate_low_hz = entry->effective_rate_hz;
+        entry->rate_high_hz = entry->effective_rate_hz;
+    }
+    schedule->frame_index = 0;
+    schedule->next_frame_ns = 0;
+    schedule->built = 1;
+
+    return SFP_OK;
+
+}
+
+
+// Executes the next minor frame of a schedule without waiting.
+byte PollScheduleStep(SFPDevice * device,
+                      SFPPollSchedule * schedule,
+                      SFPSampleSink sink,
+                      void * ctx)
+{
+
+    if (device == NULL || schedule == NULL)
+        return MEM_FAIL;
+
+    if (!schedule->built || schedule->baud_rate != device->sfp_baud_rate)
+        return SCHEDULE_FAIL;
+
+    if (schedule->strategy == SFP_POLL_CYCLIC)
+    {
+
+        // Read the registers of this frame in priority order.
+        const unsigned int frame = schedule->frame_index;
+        for (int i = 0; i < schedule->entry_count; i++)
+        {
+            const int k = schedule->order[i];
+            const SFPPollEntry * entry = &schedule->entries[k];
+            if (frame % entry->period_frames != entry->offset_frame)
+                continue;
+            PollEntry(device, schedule, k, sink, ctx);
+            if (device->sfp_device_num == -99)
+                return PORT_FAIL;
+        }
+        schedule->frame_index = (frame + 1) % schedule->frame_count;
+
+    }
+    else
+    {
+
+        // Serve due registers by priority while the frame budget allows it.
+        // Registers that do not fit remain due for the next frame.
+        const unsigned long long start = SFPNowNs();
+        const unsigned long long end = start + (unsigned long long)
+            (schedule->budget * (double)schedule->frame_length_ns);
+        int served = 0;
+        for (int i = 0; i < schedule->entry_count; i++)
+        {
+            const int k = schedule->order[i];
+            SFPPollEntry * entry = &schedule->entries[k];
+            if (entry->next_due_ns > start)
+                continue;
+            if (served && SFPNowNs() + entry->cost_ns > end)
+                continue;
+
+            PollEntry(device, schedule, k, sink, ctx);
+            if (device->sfp_device_num == -99)
+                return PORT_FAIL;
+            served++;
+
+            // Keep the phase unless we fell behind by a whole period.
+            const unsigned long long period = EntryPeriodNs(schedule, entry);
+            if (entry->next_due_ns == 0 || entry->next_due_ns + period < start)
+                entry->next_due_ns = start + period;
+            else
+                entry->next_due_ns += period;
+        }
+        schedule->frame_index = (schedule->frame_index + 1)
+            % schedule->frame_count;
+
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Runs a schedule for a number of minor frames.
+byte PollScheduleRun(SFPDevice * device,
+                     SFPPollSchedule * schedule,
+                     unsigned int frames,
+                     SFPSampleSink sink,
+                     void * ctx)
+{
+
+    if (device == NULL || schedule == NULL)
+        return MEM_FAIL;
+
+    if (!schedule->built)
+        return SCHEDULE_FAIL;
+
+    for (unsigned int i = 0; i < frames; i++)
+    {
+
+        // Resynchronize if we are more than one frame late.
+        const unsigned long long now = SFPNowNs();
+        if (schedule->next_frame_ns == 0
+            || schedule->next_frame_ns + schedule->frame_length_ns < now)
+            schedule->next_frame_ns = now;
+
+        SFPSleepUntilNs(schedule->next_frame_ns);
+        schedule->next_frame_ns += schedule->frame_length_ns;
+
+        byte rc = PollScheduleStep(device, schedule, sink, ctx);
+        if (rc != SFP_OK)
+            return rc;
+
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Gets the statistics of a polled register.
+byte PollScheduleStats(const SFPPollSchedule * schedule,
+                       int entry_id,
+                       SFPPollStats * stats)
+{
+
+    if (schedule == NULL || stats == NULL)
+        return MEM_FAIL;
+
+    if (entry_id < 0 || entry_id >= schedule->entry_count)
+        return SCHEDULE_FAIL;
+
+    const SFPPollEntry * entry = &schedule->entries[entry_id];
+    memset(stats, 0, sizeof(SFPPollStats));
+    stats->count = entry->count;
+    stats->errors = entry->errors;
+    if (schedule->built)
+    {
+        stats->target_rate_hz = 1e9 / (double)EntryPeriodNs(schedule, entry);
+        stats->effective_mean_hz = stats->target_rate_hz;
+        stats->effective_low_hz = stats->target_rate_hz;
+        stats->effective_high_hz = stats->target_rate_hz;
+        if (entry->adaptive)
+        {
+            if (entry->rate_time_s > 0.0)
+                stats->effective_mean_hz = entry->rate_sum
+                    / entry->rate_time_s;
+            stats->effective_low_hz = entry->rate_low_hz;
+            stats->effective_high_hz = entry->rate_high_hz;
+        }
+    }
+    if (entry->count > 1)
+    {
+        stats->achieved_rate_hz = (double)(entry->count - 1) * 1e9
+            / (double)(entry->last_ns - entry->first_ns);
+        stats->jitter_rms_us = sqrt(entry->dev_sum2
+                                    / (double)(entry->count - 1)) / 1e3;
+        stats->jitter_max_us = entry->dev_max / 1e3;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Theoretical wire time of a read transaction.
+unsigned long long PollWireTimeNs(byte baud_rate, byte number_of_bytes)
+{
+
+    const int bps = BaudRateBps(baud_rate);
+    const int data_bytes = DataBytes(number_of_bytes);
+    if (bps == 0 || data_bytes == 0)
+        return 0;
+
+    // 2 request bytes, then status, data and CRC bytes.
+    const unsigned long long bits = (unsigned long long)
+        (2 + data_bytes + 2) * BITS_PER_BYTE;
+    return bits * SFP_NS_PER_S / (unsigned long long)bps;
+
+}
+
+
+#undef BITS_PER_BYTE
@@ -0,0 +1,308 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_POLL.h
+
+ Abstract:
+    Periodic register polling. The user declares the registers to poll with
+    a target rate, a priority and a transaction size; the library builds a
+    cyclic schedule that fits the link budget for the device baudrate and
+    reports the achieved rate and the jitter for each register.
+
+    The schedule is divided in minor frames (by default the period of the
+    fastest register) repeated over a major cycle (the least common multiple
+    of the register periods). Schedules that cannot be executed within the
+    link budget are rejected by PollScheduleBuild().
+
+    With the priority strategy, the rate of a register can also adapt to the
+    signal (see PollScheduleAdapt()): it rises when the value changes fast
+    or is noisy and decays back when it is quiet, between bounds and within
+    the link budget of the current baudrate.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_POLL_LIB
+#define SFP10X_POLL_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum number of registers in a poll schedule.
+#define SFP_POLL_MAX_ENTRIES 32
+
+// Maximum number of minor frames in a major cycle.
+#define SFP_POLL_MAX_FRAMES 1000
+
+// Default per-transaction overhead (USB frame, host processing) in ns.
+#define SFP_POLL_DEFAULT_OVERHEAD_NS 1000000ULL
+
+// Default fraction of the link time that the schedule may use.
+#define SFP_POLL_DEFAULT_BUDGET 0.9
+
+// Maximum relative error between a requested period and the period rounded
+// to a whole number of minor frames.
+#define SFP_POLL_RATE_TOLERANCE 0.05
+
+// Default rate multiplier applied on each active sample of an adaptive
+// register.
+#define SFP_POLL_DEFAULT_RISE 2.0
+
+// Default time, in s, for the rate of a quiet adaptive register to halve.
+#define SFP_POLL_DEFAULT_HALF_LIFE_S 1.0
+
+// Default time constant, in s, of the smoothed value and variance.
+#define SFP_POLL_DEFAULT_TIME_CONSTANT_S 0.1
+
+
+// Enumeration type for the scheduling strategy.
+enum PollStrategy
+{
+    SFP_POLL_CYCLIC = 0x00,     // Static cyclic table with balanced offsets.
+    SFP_POLL_PRIORITY = 0x01    // Dynamic, due registers served by priority.
+};
+
+
+// Data structure for the statistics of one polled register.
+typedef struct SFPPollStats_
+{
+    unsigned long long count;   // Number of successful samples.
+    unsigned long long errors;  // Number of failed reads.
+    double target_rate_hz;      // Rate after rounding to the minor frame.
+    double achieved_rate_hz;    // Measured sampling rate.
+    double jitter_rms_us;       // RMS deviation of the sampling interval.
+    double jitter_max_us;       // Largest deviation of the sampling interval.
+    double effective_mean_hz;   // Time average of the scheduled rate.
+    double effective_low_hz;    // Lowest scheduled rate.
+    double effective_high_hz;   // Highest scheduled rate.
+} SFPPollStats;
+
+
+// Data structure for the rate adaptation of a polled register.
+// A threshold of 0 disables the corresponding criterion; rise, half_life_s
+// and time_constant_s use their default when 0. The value is smoothed over
+// time rather than over samples, so that the noise seen by the criteria
+// does not grow with the rate.
+typedef struct SFPPollAdaptConfig_
+{
+    double min_rate_hz;         // Rate of a quiet signal.
+    double max_rate_hz;         // Rate limit during transients.
+    double slope_threshold;     // Rate of change of the smoothed value, in
+                                // counts per second, above which the rate
+                                // rises.
+    double sigma_threshold;     // Smoothed standard deviation, in counts,
+                                // above which the rate rises.
+    double rise;                // Rate multiplier per active sample (> 1).
+    double half_life_s;         // Decay of the rate while quiet.
+    double time_constant_s;     // Smoothing of the value and variance.
+} SFPPollAdaptConfig;
+
+
+// Data structure for one polled register.
+// Members are managed by the PollSchedule functions.
+typedef struct SFPPollEntry_
+{
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    int priority;                       // 0 is the highest priority.
+    double rate_hz;                     // Requested rate.
+    unsigned int period_frames;         // Period in minor frames.
+    unsigned int offset_frame;          // Cyclic offset in minor frames.
+    unsigned long long cost_ns;         // Estimated transaction time.
+    unsigned long long next_due_ns;     // Next due time (priority strategy).
+    unsigned long long count;           // Successful samples.
+    unsigned long long errors;          // Failed reads.
+    unsigned long long first_ns;        // Time of the first sample.
+    unsigned long long last_ns;         // Time of the last sample.
+    double dev_sum2;                    // Sum of squared interval deviations.
+    double dev_max;                     // Largest interval deviation.
+    int adaptive;                       // Non-zero if the rate adapts.
+    SFPPollAdaptConfig adapt;           // Adaptation settings.
+    double effective_rate_hz;           // Current rate (adaptive entries).
+    double signal_mean;                 // Smoothed value, in counts.
+    double signal_var;                  // Smoothed variance, in counts^2.
+    long long last_value;               // Previous value.
+    unsigned long long last_value_ns;   // Time of the previous value.
+    double rate_sum;                    // Integral of the rate over time.
+    double rate_time_s;                 // Time covered by rate_sum.
+    double rate_low_hz;                 // Lowest effective rate.
+    double rate_high_hz;                // Highest effective rate.
+} SFPPollEntry;
+
+
+// Data structure for a poll schedule.
+// The overhead_ns, budget and frame_ns members may be changed after
+// PollScheduleInit() and before PollScheduleBuild().
+typedef struct SFPPollSchedule_
+{
+    SFPPollEntry entries[SFP_POLL_MAX_ENTRIES];     // Polled registers.
+    int order[SFP_POLL_MAX_ENTRIES];    // Entries sorted by priority.
+    int entry_count;                    // Number of polled registers.
+    byte strategy;                      // Strategy (PollStrategy enum).
+    int baud_rate;                      // Baudrate the schedule was built for.
+    unsigned long long overhead_ns;     // Per-transaction overhead.
+    double budget;                      // Usable fraction of the link time.
+    unsigned long long frame_ns;        // Requested minor frame (0: automatic).
+    unsigned long long frame_length_ns; // Minor frame length in use.
+    unsigned int frame_count;           // Minor frames per major cycle.
+    unsigned int frame_index;           // Next minor frame to execute.
+    unsigned long long next_frame_ns;   // Start time of the next minor frame.
+    double utilization;                 // Estimated link utilization (at
+                                        // the current adaptive rates).
+    int built;                          // Non-zero once successfully built.
+} SFPPollSchedule;
+
+
+/** Initializes an empty poll schedule.
+ *
+ *	Accepts         SFPPollSchedule pointer and a strategy.
+ *
+ *	strategy        scheduling strategy, see the PollStrategy enum.
+ *
+ *	Returns         status flag.
+ */
+byte PollScheduleInit(SFPPollSchedule * schedule, byte strategy);
+
+
+/** Declares a register to be polled.
+ *
+ *	Accepts         SFPPollSchedule pointer, register address, number of bytes,
+ *                  target rate, priority and an int pointer.
+ *
+ *	rate_hz         target sampling rate in Hz.
+ *
+ *	priority        0 is the highest priority. Within a minor frame, registers
+ *                  are read in priority order.
+ *
+ *	entry_id        (optional) receives the entry index, which is also the
+ *                  channel passed to the sample sink.
+ *
+ *	Returns         status flag.
+ */
+byte PollScheduleAdd(SFPPollSchedule * schedule,
+                     byte SFP_reg_address,
+                     byte number_of_bytes,
+                     double rate_hz,
+                     int priority,
+                     int * entry_id);
+
+
+/** Lets the rate of a polled register follow the signal dynamics.
+ *
+ *	Accepts         SFPPollSchedule pointer, entry index and a
+ *                  SFPPollAdaptConfig pointer.
+ *
+ *	config          adaptation settings, NULL for a fixed rate. The rate
+ *                  given to PollScheduleAdd() is the initial rate.
+ *
+ *	Returns         status flag. SCHEDULE_FAIL is returned if the schedule
+ *                  does not use the priority strategy or if the settings are
+ *                  invalid.
+ *
+ *  After each successful read, the rate is multiplied by rise if the rate of
+ *  change or the smoothed standard deviation of the value exceeds its
+ *  threshold, and decays otherwise. It is kept between the bounds and within
+ *  the link budget left by the other registers (first come, first served).
+ *  The schedule has to be rebuilt.
+ */
+byte PollScheduleAdapt(SFPPollSchedule * schedule,
+                       int entry_id,
+                       const SFPPollAdaptConfig * config);
+
+
+/** Builds the schedule for the current baudrate of a device.
+ *
+ *	Accepts         SFPPollSchedule pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag. SCHEDULE_FAIL is returned if a rate cannot be
+ *                  represented by the minor frame, if the major cycle is too
+ *                  long, or if a minor frame or the whole schedule does not
+ *                  fit within the link budget.
+ *
+ *  Building resets the statistics of all entries. Adaptive registers start
+ *  at their initial rate and must not be faster than the minor frame.
+ */
+byte PollScheduleBuild(SFPPollSchedule * schedule, const SFPDevice * device);
+
+
+/** Executes the next minor frame of a schedule without waiting.
+ *
+ *	Accepts         SFPDevice pointer, SFPPollSchedule pointer, a sample sink
+ *                  and its context.
+ *
+ *	sink            (optional) called for every read, including failed ones,
+ *                  with the entry index as channel.
+ *
+ *	Returns         status flag. Read failures are reported to the sink and
+ *                  counted in the statistics; only PORT_FAIL (the port has
+ *                  been closed) is returned.
+ */
+byte PollScheduleStep(SFPDevice * device,
+                      SFPPollSchedule * schedule,
+                      SFPSampleSink sink,
+                      void * ctx);
+
+
+/** Runs a schedule for a number of minor frames.
+ *
+ *	Accepts         SFPDevice pointer, SFPPollSchedule pointer, the number of
+ *                  minor frames to execute, a sample sink and its context.
+ *
+ *	Returns         status flag (see PollScheduleStep()).
+ *
+ *  The calling thread sleeps until the start of each minor frame.
+ */
+byte PollScheduleRun(SFPDevice * device,
+                     SFPPollSchedule * schedule,
+                     unsigned int frames,
+                     SFPSampleSink sink,
+                     void * ctx);
+
+
+/** Gets the statistics of a polled register.
+ *
+ *	Accepts         SFPPollSchedule pointer, entry index and a SFPPollStats
+ *                  pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  target_rate_hz is the current rate of an adaptive register; the effective
+ *  rates summarize its history since the schedule was built. Taking the
+ *  statistics periodically traces the rate over time.
+ */
+byte PollScheduleStats(const SFPPollSchedule * schedule,
+                       int entry_id,
+                       SFPPollStats * stats);
+
+
+/** Theoretical wire time of a read transaction.
+ *
+ *	Accepts         baudrate and number of bytes.
+ *
+ *	Returns         the time, in ns, needed to send the 2 byte request and
+ *                  receive the response at 10 bits per byte, or 0 if an
+ *                  argument is invalid.
+ */
+unsigned long long PollWireTimeNs(byte baud_rate, byte number_of_bytes);
+
+
+#endif  // SFP10X_POLL_LIB
@@ -0,0 +1,361 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_PROFILE.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_PROFILE.h"
+#include <string.h>
+
+
+// Bits on the wire per byte (start bit, 8 data bits and stop bit).
+#define BITS_PER_BYTE 10
+
+// Number of transaction sizes (DataLength enum).
+#define SIZES 4
+
+
+// Increments a counter read by other threads (single writer).
+static void Increment(volatile unsigned long long * counter,
+                      unsigned long long value)
+{
+    SFPAtomicStore(counter, *counter + value);
+}
+
+
+// Returns a duration over a count in microseconds, 0 if the count is 0.
+static double MeanUs(unsigned long long sum_ns, unsigned long long count)
+{
+    return count > 0 ? (double)sum_ns / (double)count / 1e3 : 0.0;
+}
+
+
+// Observer callback recording the reads of the device.
+static void ProfileOnRead(void * ctx,
+                          SFPDevice * device,
+                          const SFPSample * sample)
+{
+    (void)device;
+    ProfileRecord((SFPProfiler *)ctx, SFP_PROFILE_READ, sample);
+}
+
+
+// Starts profiling the transactions of a device.
+byte ProfileStart(SFPProfiler * profiler,
+                  SFPDevice * device,
+                  const SFPProfileConfig * config)
+{
+
+    if (profiler == NULL || device == NULL)
+        return MEM_FAIL;
+
+    if (config != NULL && config->decimation < 1)
+        return BYTES_INVALID;
+
+    memset(profiler, 0, sizeof(SFPProfiler));
+    profiler->config.decimation = 1;
+    profiler->config.idle_ns = SFP_PROFILE_DEFAULT_IDLE_NS;
+    if (config != NULL)
+        profiler->config = *config;
+    profiler->skip = 1;
+
+    profiler->observer.on_read = ProfileOnRead;
+    profiler->observer.ctx = profiler;
+    byte rc = AddObserver(device, &profiler->observer);
+    if (rc == SFP_OK)
+        profiler->device = device;
+
+    return rc;
+
+}
+
+
+// Stops profiling.
+byte ProfileStop(SFPProfiler * profiler)
+{
+
+    if (profiler == NULL)
+        return MEM_FAIL;
+
+    if (profiler->device == NULL)
+        return SFP_OK;
+
+    byte rc = RemoveObserver(profiler->device, &profiler->observer);
+    profiler->device = NULL;
+
+    return rc;
+
+}
+
+
+// Records a transaction of the device.
+byte ProfileRecord(SFPProfiler * profiler,
+                   byte type,
+                   const SFPSample * sample)
+{
+
+    if (profiler == NULL || sample == NULL || profiler->device == NULL)
+        return MEM_FAIL;
+
+    if (type > SFP_PROFILE_WRITE || DataBytes(sample->number_of_bytes) == 0)
+        return BYTES_INVALID;
+
+    // Transactions that did not reach the line take no link time.
+    if (sample->send_ns == 0 || sample->done_ns < sample->send_ns)
+        return SFP_OK;
+
+    Increment(&profiler->transactions, 1);
+    if (profiler->first_ns == 0)
+        SFPAtomicStore(&profiler->first_ns, sample->send_ns);
+    SFPAtomicStore(&profiler->last_ns, sample->done_ns);
+
+    // Gap since the previous transaction (overlapping ones have none).
+    if (profiler->previous_ns != 0 && sample->send_ns >= profiler->previous_ns)
+    {
+        const unsigned long long gap = sample->send_ns - profiler->previous_ns;
+        if (gap <= profiler->config.idle_ns)
+        {
+            Increment(&profiler->host_count, 1);
+            Increment(&profiler->host_sum_ns, gap);
+        }
+        else
+            Increment(&profiler->idle_sum_ns, gap);
+    }
+    profiler->previous_ns = sample->done_ns;
+
+    SFPProfileCounters * counters =
+        &profiler->classes[type * SIZES + sample->number_of_bytes];
+    const unsigned long long round = sample->done_ns - sample->send_ns;
+    if (sample->rc != SFP_OK)
+    {
+        Increment(&counters->errors, 1);
+        Increment(&counters->error_sum_ns, round);
+        return SFP_OK;
+    }
+
+    if (--profiler->skip > 0)
+        return SFP_OK;
+    profiler->skip = profiler->config.decimation;
+
+    if (counters->count == 0 || round < counters->round_min_ns)
+        SFPAtomicStore(&counters->round_min_ns, round);
+    if (round > counters->round_max_ns)
+        SFPAtomicStore(&counters->round_max_ns, round);
+    Increment(&counters->wire_sum_ns,
+              ProfileWireTimeNs((byte)profiler->device->sfp_baud_rate, type,
+                                sample->number_of_bytes));
+    Increment(&counters->round_sum_ns, round);
+    Increment(&counters->count, 1);
+
+    return SFP_OK;
+
+}
+
+
+// Writes a register and records the write.
+byte ProfileWriteRegister(SFPProfiler * profiler,
+                          byte SFP_reg_address,
+                          byte number_of_bytes,
+                          char * const data)
+{
+
+    if (profiler == NULL || profiler->device == NULL)
+        return MEM_FAIL;
+
+    SFPSample sample;
+    memset(&sample, 0, sizeof(SFPSample));
+    sample.reg_address = SFP_reg_address;
+    sample.number_of_bytes = number_of_bytes;
+    sample.send_ns = SFPNowNs();
+    sample.rc = WriteRegister(profiler->device, SFP_reg_address,
+                              number_of_bytes, data);
+    sample.done_ns = SFPNowNs();
+
+    // Invalid arguments are reported by WriteRegister().
+    if (DataBytes(number_of_bytes) != 0)
+        ProfileRecord(profiler, SFP_PROFILE_WRITE, &sample);
+
+    return sample.rc;
+
+}
+
+
+// Clears the accumulated data.
+byte ProfileReset(SFPProfiler * profiler)
+{
+
+    if (profiler == NULL)
+        return MEM_FAIL;
+
+    profiler->skip = 1;
+    profiler->previous_ns = 0;
+    SFPAtomicStore(&profiler->transactions, 0);
+    SFPAtomicStore(&profiler->first_ns, 0);
+    SFPAtomicStore(&profiler->last_ns, 0);
+    SFPAtomicStore(&profiler->host_count, 0);
+    SFPAtomicStore(&profiler->host_sum_ns, 0);
+    SFPAtomicStore(&profiler->idle_sum_ns, 0);
+    for (int c = 0; c < SFP_PROFILE_CLASSES; c++)
+    {
+        SFPProfileCounters * counters = &profiler->classes[c];
+        SFPAtomicStore(&counters->count, 0);
+        SFPAtomicStore(&counters->errors, 0);
+        SFPAtomicStore(&counters->error_sum_ns, 0);
+        SFPAtomicStore(&counters->wire_sum_ns, 0);
+        SFPAtomicStore(&counters->round_sum_ns, 0);
+        SFPAtomicStore(&counters->round_min_ns, 0);
+        SFPAtomicStore(&counters->round_max_ns, 0);
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Reports the link utilization.
+byte ProfileReport(SFPProfiler * profiler, SFPProfileReport * report)
+{
+
+    if (profiler == NULL || report == NULL)
+        return MEM_FAIL;
+
+    memset(report, 0, sizeof(SFPProfileReport));
+    report->bottleneck = SFP_BOTTLENECK_NONE;
+
+    // Timed transactions and their sums, over all classes.
+    unsigned long long timed = 0;
+    unsigned long long errors = 0;
+    double wire_ns = 0.0;
+    double usb_ns = 0.0;
+    double error_ns = 0.0;
+    for (int c = 0; c < SFP_PROFILE_CLASSES; c++)
+    {
+        SFPProfileCounters * counters = &profiler->classes[c];
+        SFPProfileClassStats * stats = &report->classes[c];
+        stats->type = (byte)(c / SIZES);
+        stats->number_of_bytes = (byte)(c % SIZES);
+        stats->errors = SFPAtomicLoad(&counters->errors);
+        errors += stats->errors;
+        error_ns += (double)SFPAtomicLoad(&counters->error_sum_ns);
+
+        const unsigned long long count = SFPAtomicLoad(&counters->count);
+        const unsigned long long wire = SFPAtomicLoad(&counters->wire_sum_ns);
+        const unsigned long long round =
+            SFPAtomicLoad(&counters->round_sum_ns);
+        stats->count = count;
+        if (count == 0)
+            continue;
+
+        // The USB latency is what the wire and the turnaround leave.
+        const unsigned long long fixed =
+            wire + profiler->config.turnaround_ns * count;
+        const unsigned long long usb = round > fixed ? round - fixed : 0;
+        stats->wire_us = MeanUs(wire, count);
+        stats->round_mean_us = MeanUs(round, count);
+        stats->round_min_us =
+            (double)SFPAtomicLoad(&counters->round_min_ns) / 1e3;
+        stats->round_max_us =
+            (double)SFPAtomicLoad(&counters->round_max_ns) / 1e3;
+        stats->usb_us = MeanUs(usb, count);
+        stats->efficiency = round > 0 ? (double)wire / (double)round : 0.0;
+
+        // A write may return before its frame is on the line: the line
+        // time is bounded by the round trip.
+        timed += count;
+        wire_ns += (double)(wire < round ? wire : round);
+        usb_ns += (double)usb;
+    }
+
+    report->transactions = SFPAtomicLoad(&profiler->transactions);
+    const unsigned long long first = SFPAtomicLoad(&profiler->first_ns);
+    const unsigned long long last = SFPAtomicLoad(&profiler->last_ns);
+    if (report->transactions == 0 || last <= first)
+        return SFP_OK;
+
+    const double elapsed_ns = (double)(last - first);
+    report->elapsed_s = elapsed_ns / 1e9;
+    report->rate_hz = (double)report->transactions / report->elapsed_s;
+
+    // Extrapolate the timed transactions to all the successful ones.
+    const double successful = report->transactions > errors
+                              ? (double)(report->transactions - errors) : 0.0;
+    const double scale = timed > 0 ? successful / (double)timed : 0.0;
+    report->wire_share = wire_ns * scale / elapsed_ns;
+    report->usb_share = usb_ns * scale / elapsed_ns;
+    report->turnaround_share = timed > 0
+        ? (double)profiler->config.turnaround_ns * successful / elapsed_ns
+        : 0.0;
+    report->error_share = error_ns / elapsed_ns;
+    report->host_share =
+        (double)SFPAtomicLoad(&profiler->host_sum_ns) / elapsed_ns;
+    report->idle_share =
+        (double)SFPAtomicLoad(&profiler->idle_sum_ns) / elapsed_ns;
+    report->host_mean_us = MeanUs(SFPAtomicLoad(&profiler->host_sum_ns),
+                                  SFPAtomicLoad(&profiler->host_count));
+
+    // Largest share; the USB latency and the turnaround are both latency.
+    const double latency = report->usb_share + report->turnaround_share;
+    double largest = report->wire_share;
+    report->bottleneck = SFP_BOTTLENECK_WIRE;
+    if (latency > largest)
+    {
+        largest = latency;
+        report->bottleneck = SFP_BOTTLENECK_LATENCY;
+    }
+    if (report->host_share > largest)
+    {
+        largest = report->host_share;
+        report->bottleneck = SFP_BOTTLENECK_HOST;
+    }
+    if (report->idle_share > largest)
+        report->bottleneck = SFP_BOTTLENECK_IDLE;
+
+    return SFP_OK;
+
+}
+
+
+// Theoretical wire time of a transaction.
+unsigned long long ProfileWireTimeNs(byte baud_rate,
+                                     byte type,
+                                     byte number_of_bytes)
+{
+
+    const int bps = BaudRateBps(baud_rate);
+    const int data_bytes = DataBytes(number_of_bytes);
+    if (bps == 0 || data_bytes == 0 || type > SFP_PROFILE_WRITE)
+        return 0;
+
+    // Reads: 2 request bytes, then status, data and CRC bytes. Writes:
+    // header, address, data and CRC bytes.
+    const int bytes = type == SFP_PROFILE_READ ? 2 + data_bytes + 2
+                                               : 2 + data_bytes + 1;
+    return (unsigned long long)bytes * BITS_PER_BYTE * SFP_NS_PER_S
+           / (unsigned long long)bps;
+
+}
+
+
+#undef BITS_PER_BYTE
+#undef SIZES
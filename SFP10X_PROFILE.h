@@ -0,0 +1,263 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_PROFILE.h
+
+ Abstract:
+    Link utilization profiler. The theoretical wire time of a transaction
+    follows from the baudrate and the transaction size (request and
+    response bytes at 10 bits per byte); a profiler compares it with the
+    measured transactions of a device and splits the elapsed time into:
+
+        wire        bits on the line (theoretical),
+        USB         measured round trip minus the wire time and the module
+                    turnaround (USB scheduling, FTDI latency timer, driver),
+        turnaround  module response delay (a setting: it cannot be told
+                    apart from the USB latency on the host),
+        host        gaps between consecutive transactions (host processing),
+        idle        gaps longer than the idle threshold (nothing to do),
+        errors      failed transactions (timeouts mostly).
+
+    The wire share is the line efficiency. The largest share tells where
+    the time goes: raising the baudrate only helps a wire bound link, a
+    latency bound link needs pipelining or latency tuning, and a host bound
+    link needs faster host code (see ProfileBottleneck).
+
+    Reads are recorded through the device observers, whatever issues them
+    (polling, queue, reactor...). Recording a transaction costs a few
+    additions; with decimation, the timings are accumulated for one
+    transaction out of N only, so that a profiler can stay attached in
+    production. The report can be taken from any thread.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_PROFILE_LIB
+#define SFP10X_PROFILE_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Number of transaction classes: reads, then writes, of each DataLength.
+#define SFP_PROFILE_CLASSES 8
+
+// Default gap above which the host is considered idle, in ns.
+#define SFP_PROFILE_DEFAULT_IDLE_NS 1000000ULL
+
+
+// Enumeration type for the transaction types.
+enum ProfileTransaction
+{
+    SFP_PROFILE_READ = 0x00,        // Register read.
+    SFP_PROFILE_WRITE = 0x01        // Register write.
+};
+
+
+// Enumeration type for the dominant share of the elapsed time.
+enum ProfileBottleneck
+{
+    SFP_BOTTLENECK_NONE = 0x00,     // Nothing recorded.
+    SFP_BOTTLENECK_WIRE = 0x01,     // Line bound: raise the baudrate.
+    SFP_BOTTLENECK_LATENCY = 0x02,  // USB and turnaround bound: pipeline
+                                    // requests or tune the latency.
+    SFP_BOTTLENECK_HOST = 0x03,     // Host bound: speed up the host code.
+    SFP_BOTTLENECK_IDLE = 0x04      // The link is mostly unused.
+};
+
+
+// Data structure for the profiler settings.
+typedef struct SFPProfileConfig_
+{
+    int decimation;                     // Timings of one transaction out of
+                                        // decimation (1: all).
+    unsigned long long turnaround_ns;   // Module turnaround (0: counted in
+                                        // the USB latency).
+    unsigned long long idle_ns;         // Longer gaps are idle time.
+} SFPProfileConfig;
+
+
+// Data structure for the accumulators of a transaction class.
+// Members are managed by the Profile functions.
+typedef struct SFPProfileCounters_
+{
+    volatile unsigned long long count;          // Timed transactions.
+    volatile unsigned long long errors;         // Failed transactions.
+    volatile unsigned long long error_sum_ns;
+    volatile unsigned long long wire_sum_ns;
+    volatile unsigned long long round_sum_ns;
+    volatile unsigned long long round_min_ns;
+    volatile unsigned long long round_max_ns;
+} SFPProfileCounters;
+
+
+// Data structure for the report of a transaction class.
+typedef struct SFPProfileClassStats_
+{
+    byte type;                          // ProfileTransaction enum.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    unsigned long long count;           // Timed transactions.
+    unsigned long long errors;          // Failed transactions (not timed).
+    double wire_us;                     // Theoretical wire time.
+    double round_mean_us;               // Measured round trip.
+    double round_min_us;
+    double round_max_us;
+    double usb_us;                      // Mean USB latency.
+    double efficiency;                  // Wire time over round trip.
+} SFPProfileClassStats;
+
+
+// Data structure for a profiler report.
+typedef struct SFPProfileReport_
+{
+    unsigned long long transactions;    // Transactions recorded.
+    double elapsed_s;                   // First request to last response.
+    double rate_hz;                     // Transactions per second.
+    double wire_share;                  // Line efficiency.
+    double usb_share;                   // Shares of the elapsed time.
+    double turnaround_share;
+    double host_share;
+    double idle_share;
+    double error_share;
+    double host_mean_us;                // Mean gap between transactions.
+    byte bottleneck;                    // ProfileBottleneck enum.
+    SFPProfileClassStats classes[SFP_PROFILE_CLASSES];
+} SFPProfileReport;
+
+
+// Data structure for a profiler.
+// Members are managed by the Profile functions.
+typedef struct SFPProfiler_
+{
+    SFPDevice * device;                 // Profiled device.
+    SFPProfileConfig config;
+    SFPObserver observer;               // Read observer of the device.
+    int skip;                           // Transactions until the next timed
+                                        // one.
+    unsigned long long previous_ns;     // End of the previous transaction.
+    volatile unsigned long long transactions;
+    volatile unsigned long long first_ns;
+    volatile unsigned long long last_ns;
+    volatile unsigned long long host_count;
+    volatile unsigned long long host_sum_ns;
+    volatile unsigned long long idle_sum_ns;
+    SFPProfileCounters classes[SFP_PROFILE_CLASSES];
+} SFPProfiler;
+
+
+/** Starts profiling the transactions of a device.
+ *
+ *	Accepts         SFPProfiler pointer, SFPDevice pointer and an (optional)
+ *                  SFPProfileConfig pointer.
+ *
+ *	config          settings, NULL for every transaction timed, no
+ *                  turnaround and the default idle threshold.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if the decimation
+ *                  is below 1.
+ *
+ *  Reads are recorded from then on; writes are recorded by
+ *  ProfileWriteRegister() or ProfileRecord().
+ */
+byte ProfileStart(SFPProfiler * profiler,
+                  SFPDevice * device,
+                  const SFPProfileConfig * config);
+
+
+/** Stops profiling. The accumulated data can still be reported.
+ *
+ *	Accepts         SFPProfiler pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ProfileStop(SFPProfiler * profiler);
+
+
+/** Records a transaction of the device.
+ *
+ *	Accepts         SFPProfiler pointer, transaction type and SFPSample
+ *                  pointer.
+ *
+ *	type            ProfileTransaction enum.
+ *
+ *	Returns         status flag.
+ *
+ *  Must be called from the thread doing the transactions.
+ */
+byte ProfileRecord(SFPProfiler * profiler,
+                   byte type,
+                   const SFPSample * sample);
+
+
+/** Writes a register and records the write (see WriteRegister()).
+ *
+ *	Accepts         SFPProfiler pointer, register address, number of bytes
+ *                  and the data to write.
+ *
+ *	Returns         status flag.
+ *
+ *  A write completes once the host driver accepted the frame, possibly
+ *  before it is on the line.
+ */
+byte ProfileWriteRegister(SFPProfiler * profiler,
+                          byte SFP_reg_address,
+                          byte number_of_bytes,
+                          char * const data);
+
+
+/** Clears the accumulated data.
+ *
+ *	Accepts         SFPProfiler pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  Must be called from the thread doing the transactions.
+ */
+byte ProfileReset(SFPProfiler * profiler);
+
+
+/** Reports the link utilization (any thread).
+ *
+ *	Accepts         SFPProfiler pointer and SFPProfileReport pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  With decimation, the shares are extrapolated from the timed
+ *  transactions.
+ */
+byte ProfileReport(SFPProfiler * profiler, SFPProfileReport * report);
+
+
+/** Theoretical wire time of a transaction.
+ *
+ *	Accepts         baudrate, transaction type and number of bytes.
+ *
+ *	Returns         the time, in ns, of the request and response bytes
+ *                  (2 bytes, then status, data and CRC for a read; header,
+ *                  data and CRC for a write) at 10 bits per byte, or 0 if an
+ *                  argument is invalid.
+ */
+unsigned long long ProfileWireTimeNs(byte baud_rate,
+                                     byte type,
+                                     byte number_of_bytes);
+
+
+#endif  // SFP10X_PROFILE_LIB
@@ -0,0 +1,548 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_QUEUE.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_QUEUE.h"
+#include <string.h>
+
+
+// Request states.
+#define REQUEST_IDLE 0
+#define REQUEST_PENDING 1
+#define REQUEST_ACTIVE 2
+#define REQUEST_DONE 3
+
+
+// Returns the histogram bin of a latency in ns.
+static int HistogramBin(unsigned long long latency_ns)
+{
+    unsigned long long us = latency_ns / 1000ULL;
+    int bin = 0;
+    while (us > 1 && bin < SFP_QUEUE_HISTOGRAM_BINS - 1)
+    {
+        us >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+
+// Removes and returns the oldest request of the highest non-empty class.
+// Must be called with the lock held.
+static SFPRequest * PopRequest(SFPRequestQueue * queue)
+{
+    for (int c = 0; c < SFP_QUEUE_CLASSES; c++)
+    {
+        if (queue->count[c] == 0)
+            continue;
+        SFPRequest * request = queue->pending[c][queue->head[c]];
+        queue->head[c] = (queue->head[c] + 1) % SFP_QUEUE_CAPACITY;
+        queue->count[c]--;
+        return request;
+    }
+    return NULL;
+}
+
+
+// Removes a pending request from its class.
+// Must be called with the lock held. Returns non-zero if it was found.
+static int RemoveRequest(SFPRequestQueue * queue, SFPRequest * request)
+{
+    const int c = request->priority;
+    for (int i = 0; i < queue->count[c]; i++)
+    {
+        int k = (queue->head[c] + i) % SFP_QUEUE_CAPACITY;
+        if (queue->pending[c][k] != request)
+            continue;
+
+        // Shift the younger requests down.
+        for (int j = i; j < queue->count[c] - 1; j++)
+        {
+            int from = (queue->head[c] + j + 1) % SFP_QUEUE_CAPACITY;
+            int to = (queue->head[c] + j) % SFP_QUEUE_CAPACITY;
+            queue->pending[c][to] = queue->pending[c][from];
+        }
+        queue->count[c]--;
+        return 1;
+    }
+    return 0;
+}
+
+
+// Executes a request on the device.
+static void ExecuteRequest(SFPDevice * device, SFPRequest * request)
+{
+    switch (request->type)
+    {
+    case SFP_REQUEST_READ:
+        request->rc = ReadRegister(device, request->reg_address,
+                                   request->number_of_bytes, request->data);
+        break;
+    case SFP_REQUEST_READ_SIGNED:
+        request->rc = ReadSignedRegister(device, request->reg_address,
+                                         request->number_of_bytes,
+                                         &request->signed_data);
+        break;
+    case SFP_REQUEST_WRITE:
+        request->rc = WriteRegister(device, request->reg_address,
+                                    request->number_of_bytes, request->data);
+        break;
+    default:
+        request->rc = BYTES_INVALID;
+        break;
+    }
+}
+
+
+// Executes a request, recovering the device through the watchdog (if any)
+// before it and, if the request failed on a lost device, once after it.
+// Writes are not recorded for replay: only configuration writes are, and
+// these are recorded through the watchdog.
+static void ExecuteGuarded(SFPDevice * device,
+                           SFPWatchdog * watchdog,
+                           SFPRequest * request)
+{
+
+    if (watchdog == NULL)
+    {
+        ExecuteRequest(device, request);
+        return;
+    }
+
+    WatchdogRecover(watchdog);
+    ExecuteRequest(device, request);
+    if (request->rc != SFP_OK && WatchdogCheck(watchdog) != SFP_OK
+        && WatchdogRecover(watchdog) == SFP_OK)
+        ExecuteRequest(device, request);
+
+}
+
+
+// Worker thread.
+// Requests are taken one at a time so that the priority is re-evaluated
+// between transactions.
+static SFP_THREAD_FUNC(QueueWorker, arg)
+{
+
+    SFPRequestQueue * queue = (SFPRequestQueue *)arg;
+
+    SFPMutexLock(&queue->lock);
+    while (queue->running)
+    {
+
+        SFPRequest * request = PopRequest(queue);
+        if (request == NULL)
+        {
+            SFPCondWait(&queue->work, &queue->lock);
+            continue;
+        }
+
+        request->state = REQUEST_ACTIVE;
+        request->start_ns = SFPNowNs();
+        SFPWatchdog * watchdog = queue->watchdog;
+        SFPMutexUnlock(&queue->lock);
+
+        ExecuteGuarded(queue->device, watchdog, request);
+        const unsigned long long done_ns = SFPNowNs();
+
+        SFPMutexLock(&queue->lock);
+
+        // Update the statistics of the class.
+        const int c = request->priority;
+        const unsigned long long wait = request->start_ns - request->submit_ns;
+        const unsigned long long service = done_ns - request->start_ns;
+        queue->completed[c]++;
+        queue->wait_sum_ns[c] += wait;
+        if (wait > queue->wait_max_ns[c])
+            queue->wait_max_ns[c] = wait;
+        queue->service_sum_ns[c] += service;
+        if (service > queue->service_max_ns[c])
+            queue->service_max_ns[c] = service;
+        queue->histogram[c][HistogramBin(wait + service)]++;
+
+        request->done_ns = done_ns;
+        request->state = REQUEST_DONE;
+        SFPCondBroadcast(&queue->done);
+
+    }
+    SFPMutexUnlock(&queue->lock);
+
+    SFP_THREAD_RETURN;
+
+}
+
+
+// Starts a request queue for an initialized device.
+byte QueueStart(SFPRequestQueue * queue, SFPDevice * device)
+{
+
+    if (queue == NULL || device == NULL)
+        return MEM_FAIL;
+
+    memset(queue, 0, sizeof(SFPRequestQueue));
+    queue->device = device;
+    SFPMutexInit(&queue->lock);
+    SFPCondInit(&queue->work);
+    SFPCondInit(&queue->done);
+
+    queue->running = 1;
+    if (SFPThreadStart(&queue->thread, QueueWorker, queue) != 0)
+    {
+        queue->running = 0;
+        SFPCondDestroy(&queue->done);
+        SFPCondDestroy(&queue->work);
+        SFPMutexDestroy(&queue->lock);
+        return MEM_FAIL;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Stops a request queue.
+byte QueueStop(SFPRequestQueue * queue)
+{
+
+    if (queue == NULL)
+        return MEM_FAIL;
+
+    SFPMutexLock(&queue->lock);
+    if (!queue->running)
+    {
+        SFPMutexUnlock(&queue->lock);
+        return DEVICE_BUSY;
+    }
+    queue->running = 0;
+    SFPCondBroadcast(&queue->work);
+    SFPMutexUnlock(&queue->lock);
+
+    SFPThreadJoin(queue->thread);
+
+    // Complete the requests that were not executed.
+    SFPMutexLock(&queue->lock);
+    SFPRequest * request;
+    while ((request = PopRequest(queue)) != NULL)
+    {
+        request->rc = DEVICE_BUSY;
+        request->done_ns = SFPNowNs();
+        request->state = REQUEST_DONE;
+    }
+    SFPCondBroadcast(&queue->done);
+
+    // The synchronization objects are released once no thread waits.
+    while (queue->waiters > 0)
+        SFPCondWait(&queue->done, &queue->lock);
+    SFPMutexUnlock(&queue->lock);
+    SFPCondDestroy(&queue->done);
+    SFPCondDestroy(&queue->work);
+    SFPMutexDestroy(&queue->lock);
+
+    return SFP_OK;
+
+}
+
+
+// Submits a request without waiting.
+byte QueueSubmit(SFPRequestQueue * queue, SFPRequest * request)
+{
+
+    if (queue == NULL || request == NULL)
+        return MEM_FAIL;
+
+    if (request->priority >= SFP_QUEUE_CLASSES)
+        return BYTES_INVALID;
+
+    const int c = request->priority;
+    SFPMutexLock(&queue->lock);
+    if (!queue->running || queue->count[c] == SFP_QUEUE_CAPACITY)
+    {
+        if (queue->running)
+            queue->rejected[c]++;
+        SFPMutexUnlock(&queue->lock);
+        return DEVICE_BUSY;
+    }
+
+    request->rc = RESERVED;
+    request->state = REQUEST_PENDING;
+    request->submit_ns = SFPNowNs();
+    request->start_ns = 0;
+    request->done_ns = 0;
+    queue->pending[c][(queue->head[c] + queue->count[c])
+                      % SFP_QUEUE_CAPACITY] = request;
+    queue->count[c]++;
+    SFPCondSignal(&queue->work);
+    SFPMutexUnlock(&queue->lock);
+
+    return SFP_OK;
+
+}
+
+
+// Ends a wait with a status flag (the queue lock is held).
+static byte EndWait(SFPRequestQueue * queue, byte rc)
+{
+
+    queue->waiters--;
+    if (!queue->running && queue->waiters == 0)
+        SFPCondBroadcast(&queue->done);
+    SFPMutexUnlock(&queue->lock);
+
+    return rc;
+
+}
+
+
+// Waits for the completion of a submitted request.
+byte QueueWait(SFPRequestQueue * queue, SFPRequest * request, int timeout_ms)
+{
+
+    if (queue == NULL || request == NULL)
+        return MEM_FAIL;
+
+    const unsigned long long deadline = SFPNowNs()
+        + (unsigned long long)(timeout_ms < 0 ? 0 : timeout_ms) * 1000000ULL;
+
+    SFPMutexLock(&queue->lock);
+    queue->waiters++;
+    while (request->state != REQUEST_DONE)
+    {
+
+        if (request->state == REQUEST_IDLE)
+            return EndWait(queue, BYTES_INVALID);
+
+        // Once started, the transaction is bounded by the device timeout.
+        if (request->state == REQUEST_ACTIVE)
+        {
+            SFPCondWait(&queue->done, &queue->lock);
+            continue;
+        }
+
+        if (!SFPCondWaitUntil(&queue->done, &queue->lock, deadline)
+            && request->state == REQUEST_PENDING)
+        {
+            RemoveRequest(queue, request);
+            request->state = REQUEST_IDLE;
+            return EndWait(queue, RESPONSE_TIMEOUT);
+        }
+
+    }
+    request->state = REQUEST_IDLE;
+
+    return EndWait(queue, request->rc);
+
+}
+
+
+// Submits a request and waits for it without timeout.
+static byte QueueExecute(SFPRequestQueue * queue, SFPRequest * request)
+{
+
+    byte rc = QueueSubmit(queue, request);
+    if (rc != SFP_OK)
+        return rc;
+
+    SFPMutexLock(&queue->lock);
+    while (request->state != REQUEST_DONE)
+        SFPCondWait(&queue->done, &queue->lock);
+    request->state = REQUEST_IDLE;
+    SFPMutexUnlock(&queue->lock);
+
+    return request->rc;
+
+}
+
+
+// Reads a register through the queue.
+byte QueueReadRegister(SFPRequestQueue * queue,
+                       byte priority,
+                       byte SFP_reg_address,
+                       byte number_of_bytes,
+                       char * const data)
+{
+
+    if (data == NULL)
+        return MEM_FAIL;
+
+    SFPRequest request;
+    memset(&request, 0, sizeof(SFPRequest));
+    request.type = SFP_REQUEST_READ;
+    request.priority = priority;
+    request.reg_address = SFP_reg_address;
+    request.number_of_bytes = number_of_bytes;
+
+    byte rc = QueueExecute(queue, &request);
+    for (int i = 0; i < 8; i++)
+        data[i] = request.data[i];
+
+    return rc;
+
+}
+
+
+// Reads a signed register through the queue.
+byte QueueReadSignedRegister(SFPRequestQueue * queue,
+                             byte priority,
+                             byte SFP_reg_address,
+                             byte number_of_bytes,
+                             long long * signed_data)
+{
+
+    if (signed_data == NULL)
+        return MEM_FAIL;
+
+    SFPRequest request;
+    memset(&request, 0, sizeof(SFPRequest));
+    request.type = SFP_REQUEST_READ_SIGNED;
+    request.priority = priority;
+    request.reg_address = SFP_reg_address;
+    request.number_of_bytes = number_of_bytes;
+
+    byte rc = QueueExecute(queue, &request);
+    *signed_data = request.signed_data;
+
+    return rc;
+
+}
+
+
+// Writes a register through the queue.
+byte QueueWriteRegister(SFPRequestQueue * queue,
+                        byte priority,
+                        byte SFP_reg_address,
+                        byte number_of_bytes,
+                        char * const data)
+{
+
+    if (data == NULL)
+        return MEM_FAIL;
+
+    SFPRequest request;
+    memset(&request, 0, sizeof(SFPRequest));
+    request.type = SFP_REQUEST_WRITE;
+    request.priority = priority;
+    request.reg_address = SFP_reg_address;
+    request.number_of_bytes = number_of_bytes;
+    for (int i = 0; i < 6; i++)
+        request.data[i] = data[i];
+
+    return QueueExecute(queue, &request);
+
+}
+
+
+// Gets the latency statistics of a priority class.
+byte QueueStats(SFPRequestQueue * queue, byte priority, SFPQueueStats * stats)
+{
+
+    if (queue == NULL || stats == NULL)
+        return MEM_FAIL;
+
+    if (priority >= SFP_QUEUE_CLASSES)
+        return BYTES_INVALID;
+
+    memset(stats, 0, sizeof(SFPQueueStats));
+
+    SFPMutexLock(&queue->lock);
+    const int c = priority;
+    stats->count = queue->completed[c];
+    stats->rejected = queue->rejected[c];
+    for (int i = 0; i < SFP_QUEUE_HISTOGRAM_BINS; i++)
+        stats->histogram[i] = queue->histogram[c][i];
+    if (stats->count > 0)
+    {
+        stats->wait_mean_us = (double)queue->wait_sum_ns[c]
+            / (double)stats->count / 1e3;
+        stats->service_mean_us = (double)queue->service_sum_ns[c]
+            / (double)stats->count / 1e3;
+    }
+    stats->wait_max_us = (double)queue->wait_max_ns[c] / 1e3;
+    stats->service_max_us = (double)queue->service_max_ns[c] / 1e3;
+    SFPMutexUnlock(&queue->lock);
+
+    // 99th percentile from the histogram.
+    unsigned long long cumulative = 0;
+    for (int i = 0; i < SFP_QUEUE_HISTOGRAM_BINS && stats->count > 0; i++)
+    {
+        cumulative += stats->histogram[i];
+        if ((double)cumulative >= 0.99 * (double)stats->count)
+        {
+            stats->latency_p99_us = (double)(2ULL << i);
+            break;
+        }
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Resets the latency statistics of all priority classes.
+byte QueueResetStats(SFPRequestQueue * queue)
+{
+
+    if (queue == NULL)
+        return MEM_FAIL;
+
+    SFPMutexLock(&queue->lock);
+    for (int c = 0; c < SFP_QUEUE_CLASSES; c++)
+    {
+        queue->wait_sum_ns[c] = 0;
+        queue->wait_max_ns[c] = 0;
+        queue->service_sum_ns[c] = 0;
+        queue->service_max_ns[c] = 0;
+        queue->completed[c] = 0;
+        queue->rejected[c] = 0;
+        for (int i = 0; i < SFP_QUEUE_HISTOGRAM_BINS; i++)
+            queue->histogram[c][i] = 0;
+    }
+    SFPMutexUnlock(&queue->lock);
+
+    return SFP_OK;
+
+}
+
+
+// Recovers the device of a queue through a watchdog.
+byte QueueSetWatchdog(SFPRequestQueue * queue, SFPWatchdog * watchdog)
+{
+
+    if (queue == NULL)
+        return MEM_FAIL;
+
+    SFPMutexLock(&queue->lock);
+    queue->watchdog = watchdog;
+    SFPMutexUnlock(&queue->lock);
+
+    return SFP_OK;
+
+}
+
+
+#undef REQUEST_IDLE
+#undef REQUEST_PENDING
+#undef REQUEST_ACTIVE
+#undef REQUEST_DONE
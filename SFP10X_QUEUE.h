@@ -0,0 +1,261 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_QUEUE.h
+
+ Abstract:
+    Per-device prioritized request queue. A worker thread owns the device
+    and executes one transaction at a time, always taking the oldest request
+    of the highest non-empty priority class. A high priority request thus
+    waits for at most the transaction in progress, regardless of how many
+    low priority requests are queued.
+
+    Latency statistics (queue wait, service time and a log2 histogram of the
+    total latency) are kept per priority class.
+
+    Once a queue is started, the device must only be accessed through the
+    queue.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_QUEUE_LIB
+#define SFP10X_QUEUE_LIB
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_COM.h"
+#include "SFP10X_WATCHDOG.h"
+
+
+// Number of pending requests per priority class.
+#define SFP_QUEUE_CAPACITY 64
+
+// Number of priority classes.
+#define SFP_QUEUE_CLASSES 2
+
+// Number of latency histogram bins. Bin i counts the latencies in
+// [2^i, 2^(i+1)) microseconds, the last bin counts everything above.
+#define SFP_QUEUE_HISTOGRAM_BINS 24
+
+
+// Enumeration type for the request priority classes.
+enum RequestPriority
+{
+    SFP_PRIORITY_HIGH = 0x00,   // Critical reads (e.g. overcurrent detection).
+    SFP_PRIORITY_LOW = 0x01     // Housekeeping, configuration, diagnostics.
+};
+
+
+// Enumeration type for the request types.
+enum RequestType
+{
+    SFP_REQUEST_READ = 0x00,        // ReadRegister().
+    SFP_REQUEST_READ_SIGNED = 0x01, // ReadSignedRegister().
+    SFP_REQUEST_WRITE = 0x02        // WriteRegister().
+};
+
+
+// Data structure for a queued request.
+// The request is owned by the caller and must stay valid until completion.
+typedef struct SFPRequest_
+{
+    byte type;                      // Request type (RequestType enum).
+    byte priority;                  // Priority class (RequestPriority enum).
+    byte reg_address;               // SFP register address.
+    byte number_of_bytes;           // Transaction size (DataLength enum).
+    char data[10];                  // Response (reads) or data (writes).
+    long long signed_data;          // Signed data (signed reads).
+    byte rc;                        // Status flag once completed.
+    int state;                      // Internal state, managed by the queue.
+    unsigned long long submit_ns;   // Host time of the submission.
+    unsigned long long start_ns;    // Host time the transaction started.
+    unsigned long long done_ns;     // Host time the transaction completed.
+} SFPRequest;
+
+
+// Data structure for the latency statistics of a priority class.
+typedef struct SFPQueueStats_
+{
+    unsigned long long count;       // Number of completed requests.
+    unsigned long long rejected;    // Number of requests refused (queue full).
+    double wait_mean_us;            // Mean time spent in the queue.
+    double wait_max_us;             // Largest time spent in the queue.
+    double service_mean_us;         // Mean transaction time.
+    double service_max_us;          // Largest transaction time.
+    double latency_p99_us;          // 99th percentile of the total latency
+                                    // (upper bound of the histogram bin).
+    unsigned long long histogram[SFP_QUEUE_HISTOGRAM_BINS]; // Total latency.
+} SFPQueueStats;
+
+
+// Data structure for a request queue.
+// Members are managed by the Queue functions.
+typedef struct SFPRequestQueue_
+{
+    SFPDevice * device;                 // Device owned by the queue.
+    SFPMutex lock;                      // Protects the members below.
+    SFPCond work;                       // Signaled on new requests.
+    SFPCond done;                       // Signaled on completions.
+    SFPThread thread;                   // Worker thread.
+    int running;                        // Non-zero while the worker runs.
+    int waiters;                        // Threads in QueueWait().
+    SFPWatchdog * watchdog;             // Recovers the device, if set.
+    SFPRequest * pending[SFP_QUEUE_CLASSES][SFP_QUEUE_CAPACITY];
+    int head[SFP_QUEUE_CLASSES];        // Oldest pending request.
+    int count[SFP_QUEUE_CLASSES];       // Number of pending requests.
+    unsigned long long wait_sum_ns[SFP_QUEUE_CLASSES];
+    unsigned long long wait_max_ns[SFP_QUEUE_CLASSES];
+    unsigned long long service_sum_ns[SFP_QUEUE_CLASSES];
+    unsigned long long service_max_ns[SFP_QUEUE_CLASSES];
+    unsigned long long completed[SFP_QUEUE_CLASSES];
+    unsigned long long rejected[SFP_QUEUE_CLASSES];
+    unsigned long long histogram[SFP_QUEUE_CLASSES][SFP_QUEUE_HISTOGRAM_BINS];
+} SFPRequestQueue;
+
+
+/** Starts a request queue for an initialized device.
+ *
+ *	Accepts         SFPRequestQueue pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ */
+byte QueueStart(SFPRequestQueue * queue, SFPDevice * device);
+
+
+/** Stops a request queue.
+ *
+ *	Accepts         SFPRequestQueue pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  The transaction in progress is completed; pending requests complete with
+ *  DEVICE_BUSY. The device is not closed. Returns once the waits in progress
+ *  have returned; the queue must then not be used until it is started again.
+ */
+byte QueueStop(SFPRequestQueue * queue);
+
+
+/** Submits a request without waiting.
+ *
+ *	Accepts         SFPRequestQueue pointer and SFPRequest pointer.
+ *
+ *	request         type, priority, reg_address, number_of_bytes and, for
+ *                  writes, data must be set by the caller.
+ *
+ *	Returns         status flag. DEVICE_BUSY is returned if the priority class
+ *                  is full or the queue is stopping.
+ */
+byte QueueSubmit(SFPRequestQueue * queue, SFPRequest * request);
+
+
+/** Waits for the completion of a submitted request.
+ *
+ *	Accepts         SFPRequestQueue pointer, SFPRequest pointer and a timeout
+ *                  in milliseconds.
+ *
+ *	Returns         the status flag of the request, or RESPONSE_TIMEOUT if the
+ *                  request did not start before the timeout (it is then
+ *                  removed from the queue).
+ *
+ *  A request that has started is always waited for, which is bounded by the
+ *  device timeout (and the recovery timeout of the watchdog, if any).
+ */
+byte QueueWait(SFPRequestQueue * queue, SFPRequest * request, int timeout_ms);
+
+
+/** Reads a register through the queue (see ReadRegister()).
+ *
+ *	Accepts         SFPRequestQueue pointer, priority class, register address,
+ *                  number of bytes and a char array of length 8.
+ *
+ *	Returns         status flag.
+ */
+byte QueueReadRegister(SFPRequestQueue * queue,
+                       byte priority,
+                       byte SFP_reg_address,
+                       byte number_of_bytes,
+                       char * const data);
+
+
+/** Reads a signed register through the queue (see ReadSignedRegister()).
+ *
+ *	Accepts         SFPRequestQueue pointer, priority class, register address,
+ *                  number of bytes and a long long pointer.
+ *
+ *	Returns         status flag.
+ */
+byte QueueReadSignedRegister(SFPRequestQueue * queue,
+                             byte priority,
+                             byte SFP_reg_address,
+                             byte number_of_bytes,
+                             long long * signed_data);
+
+
+/** Writes a register through the queue (see WriteRegister()).
+ *
+ *	Accepts         SFPRequestQueue pointer, priority class, register address,
+ *                  number of bytes and a char array with the data.
+ *
+ *	Returns         status flag.
+ */
+byte QueueWriteRegister(SFPRequestQueue * queue,
+                        byte priority,
+                        byte SFP_reg_address,
+                        byte number_of_bytes,
+                        char * const data);
+
+
+/** Gets the latency statistics of a priority class.
+ *
+ *	Accepts         SFPRequestQueue pointer, priority class and a SFPQueueStats
+ *                  pointer.
+ *
+ *	Returns         status flag.
+ */
+byte QueueStats(SFPRequestQueue * queue, byte priority, SFPQueueStats * stats);
+
+
+/** Resets the latency statistics of all priority classes.
+ *
+ *	Accepts         SFPRequestQueue pointer.
+ *
+ *	Returns         status flag.
+ */
+byte QueueResetStats(SFPRequestQueue * queue);
+
+
+/** Recovers the device of a queue through a watchdog.
+ *
+ *	Accepts         SFPRequestQueue pointer and (optional) SFPWatchdog pointer.
+ *
+ *	watchdog        watchdog of the queue device, NULL to remove it. The
+ *                  worker then recovers a lost device before a request and
+ *                  executes again a request that failed on a lost device.
+ *                  Queued writes are not replayed; configuration writes are
+ *                  recorded through the watchdog before it is set.
+ *
+ *	Returns         status flag.
+ */
+byte QueueSetWatchdog(SFPRequestQueue * queue, SFPWatchdog * watchdog);
+
+
+#endif  // SFP10X_QUEUE_LIB
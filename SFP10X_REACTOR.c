@@ -0,0 +1,484 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_REACTOR.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_REACTOR.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+
+// CRC8 of the SFP frames (see SFP10X_COM.c).
+byte CRC(int, const byte * const);
+
+
+// Transfer states.
+#define STATE_QUEUED 0
+#define STATE_SENDING 1
+#define STATE_RECEIVING 2
+#define STATE_DONE 3
+
+// Device number of a device closed on an error (see FTHasError()).
+#define CLOSED_DEVICE -99
+
+
+// Finds the slot of a device, -1 if it was not added.
+static int FindDevice(const SFPReactor * reactor, const SFPDevice * device)
+{
+    for (int i = 0; i < reactor->device_count; i++)
+        if (reactor->devices[i].device == device)
+            return i;
+    return -1;
+}
+
+
+// Sets or clears the non-blocking mode of a file descriptor.
+static int SetNonBlocking(int fd, int enable)
+{
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags < 0)
+        return -1;
+    return fcntl(fd, F_SETFL, enable ? (flags | O_NONBLOCK)
+                                     : (flags & ~O_NONBLOCK));
+}
+
+
+static void Start(SFPReactor * reactor, SFPReactorDevice * slot);
+
+
+// Completes the transfer in progress of a device and starts the next one.
+static void Complete(SFPReactor * reactor, SFPReactorDevice * slot, byte rc)
+{
+
+    SFPTransfer * transfer = slot->head;
+    slot->head = transfer->next;
+    if (slot->head == NULL)
+        slot->tail = NULL;
+
+    // Abandoned or corrupted responses are discarded, as by ReadRegister().
+    if (rc != SFP_OK && rc != PORT_FAIL && transfer->state != STATE_QUEUED
+        && slot->device->sfp_fd >= 0)
+        tcflush(slot->device->sfp_fd, TCIOFLUSH);
+
+    SFPSample * sample = &transfer->sample;
+    sample->done_ns = SFPNowNs();
+    sample->timestamp_ns = sample->send_ns != 0
+        ? sample->send_ns + (sample->done_ns - sample->send_ns) / 2
+        : sample->done_ns;
+    sample->reg_address = transfer->reg_address;
+    sample->number_of_bytes = transfer->number_of_bytes;
+    sample->rc = rc;
+    sample->status = 0;
+    sample->value = 0;
+    if (rc == SFP_OK && transfer->type == SFP_TRANSFER_READ)
+    {
+        memcpy(transfer->data, transfer->frame + 2, transfer->length);
+        sample->status = transfer->frame[2];
+        sample->value = SignExtend(transfer->frame + 2,
+                                   transfer->number_of_bytes);
+    }
+    transfer->rc = rc;
+    transfer->state = STATE_DONE;
+    transfer->next = NULL;
+
+    if (rc == DEVICE_BUSY)
+        reactor->cancelled++;
+    else if (rc == RESPONSE_TIMEOUT)
+        reactor->timeouts++;
+    reactor->completed++;
+
+    if (transfer->type == SFP_TRANSFER_READ)
+        for (SFPObserver * observer = slot->device->sfp_observers;
+             observer != NULL;
+             observer = observer->next)
+            observer->on_read(observer->ctx, slot->device, sample);
+
+    if (slot->head != NULL)
+        Start(reactor, slot);
+
+    transfer->callback(transfer->ctx, transfer);
+
+}
+
+
+// Closes a device whose port failed and completes its transfer.
+static void Fail(SFPReactor * reactor, SFPReactorDevice * slot, byte rc)
+{
+    ClosePort(slot->device);
+    slot->device->sfp_device_num = CLOSED_DEVICE;
+    Complete(reactor, slot, rc);
+}
+
+
+// Sends what the port accepts of the request in progress.
+static void Send(SFPReactor * reactor, SFPReactorDevice * slot)
+{
+
+    SFPTransfer * transfer = slot->head;
+    while (transfer->count < transfer->length)
+    {
+        const ssize_t n = write(slot->device->sfp_fd,
+                                transfer->frame + transfer->count,
+                                transfer->length - transfer->count);
+        if (n > 0)
+        {
+            if (transfer->sample.send_ns == 0)
+                transfer->sample.send_ns = SFPNowNs();
+            transfer->count += (int)n;
+        }
+        else if (n < 0 && errno == EAGAIN)
+            return;
+        else if (n < 0 && errno != EINTR)
+        {
+            Fail(reactor, slot, WRITE_FAIL);
+            return;
+        }
+    }
+
+    if (transfer->type == SFP_TRANSFER_WRITE)
+    {
+        Complete(reactor, slot, SFP_OK);
+        return;
+    }
+
+    // The response (status, data, CRC) follows the request in the frame.
+    transfer->state = STATE_RECEIVING;
+    transfer->length = DataBytes(transfer->number_of_bytes) + 2;
+    transfer->count = 0;
+
+}
+
+
+// Receives what is available of the response in progress.
+static void Receive(SFPReactor * reactor, SFPReactorDevice * slot)
+{
+
+    SFPTransfer * transfer = slot->head;
+    while (transfer->count < transfer->length)
+    {
+        const ssize_t n = read(slot->device->sfp_fd,
+                               transfer->frame + 2 + transfer->count,
+                               transfer->length - transfer->count);
+        if (n > 0)
+            transfer->count += (int)n;
+        else if (n == 0 || errno == EAGAIN)
+            return;
+        else if (errno != EINTR)
+        {
+            Fail(reactor, slot, READ_FAIL);
+            return;
+        }
+    }
+
+    Complete(reactor, slot, CRC(transfer->length + 2, transfer->frame) == 0
+                            ? SFP_OK : CRC_ERROR);
+
+}
+
+
+// Starts the transfer at the head of a device.
+static void Start(SFPReactor * reactor, SFPReactorDevice * slot)
+{
+
+    SFPTransfer * transfer = slot->head;
+    SFPDevice * device = slot->device;
+    const int size = DataBytes(transfer->number_of_bytes);
+
+    transfer->frame[1] = transfer->reg_address;
+    if (transfer->type == SFP_TRANSFER_READ)
+    {
+        transfer->frame[0] = (byte)(0x80 | transfer->number_of_bytes);
+        transfer->length = 2;
+    }
+    else
+    {
+        transfer->frame[0] = transfer->number_of_bytes;
+        memcpy(transfer->frame + 2, transfer->data, size);
+        transfer->frame[size + 2] = CRC(size + 2, transfer->frame);
+        transfer->length = size + 3;
+    }
+    transfer->count = 0;
+    transfer->sample.send_ns = 0;
+    transfer->deadline_ns = SFPNowNs() + (transfer->timeout_ns != 0
+        ? transfer->timeout_ns
+        : (unsigned long long)device->sfp_timeout_ms * 1000000ULL);
+
+    if (device->sfp_fd < 0)
+    {
+        Complete(reactor, slot, PORT_FAIL);
+        return;
+    }
+
+    transfer->state = STATE_SENDING;
+    Send(reactor, slot);
+
+}
+
+
+// Initializes a reactor.
+byte ReactorInit(SFPReactor * reactor)
+{
+
+    if (reactor == NULL)
+        return MEM_FAIL;
+
+    memset(reactor, 0, sizeof(SFPReactor));
+
+    return SFP_OK;
+
+}
+
+
+// Adds a device to a reactor.
+byte ReactorAdd(SFPReactor * reactor, SFPDevice * device)
+{
+
+    if (reactor == NULL || device == NULL)
+        return MEM_FAIL;
+
+    if (device->sfp_backend != SFP_BACKEND_TTY || device->sfp_fd < 0)
+        return PORT_FAIL;
+
+    if (FindDevice(reactor, device) >= 0)
+        return DEVICE_BUSY;
+
+    int slot = FindDevice(reactor, NULL);
+    if (slot < 0)
+    {
+        if (reactor->device_count == SFP_REACTOR_MAX_DEVICES)
+            return MEM_FAIL;
+        slot = reactor->device_count++;
+    }
+
+    if (SetNonBlocking(device->sfp_fd, 1) != 0)
+        return PORT_FAIL;
+
+    reactor->devices[slot].device = device;
+    reactor->devices[slot].head = NULL;
+    reactor->devices[slot].tail = NULL;
+
+    return SFP_OK;
+
+}
+
+
+// Removes a device from a reactor.
+byte ReactorRemove(SFPReactor * reactor, SFPDevice * device)
+{
+
+    if (reactor == NULL || device == NULL)
+        return MEM_FAIL;
+
+    const int slot = FindDevice(reactor, device);
+    if (slot < 0)
+        return SFP_OK;
+
+    while (reactor->devices[slot].head != NULL)
+        Complete(reactor, &reactor->devices[slot], DEVICE_BUSY);
+    if (device->sfp_fd >= 0)
+        SetNonBlocking(device->sfp_fd, 0);
+    reactor->devices[slot].device = NULL;
+
+    return SFP_OK;
+
+}
+
+
+// Submits a transfer.
+byte ReactorSubmit(SFPReactor * reactor,
+                   SFPDevice * device,
+                   SFPTransfer * transfer)
+{
+
+    if (reactor == NULL || device == NULL || transfer == NULL
+        || transfer->callback == NULL)
+        return MEM_FAIL;
+
+    if (transfer->type > SFP_TRANSFER_WRITE
+        || DataBytes(transfer->number_of_bytes) == 0)
+        return BYTES_INVALID;
+
+    const int index = FindDevice(reactor, device);
+    if (index < 0)
+        return PORT_FAIL;
+
+    SFPReactorDevice * slot = &reactor->devices[index];
+    transfer->device = device;
+    transfer->state = STATE_QUEUED;
+    transfer->rc = RESERVED;
+    transfer->next = NULL;
+    memset(&transfer->sample, 0, sizeof(SFPSample));
+
+    if (slot->tail != NULL)
+    {
+        slot->tail->next = transfer;
+        slot->tail = transfer;
+        return SFP_OK;
+    }
+
+    slot->head = transfer;
+    slot->tail = transfer;
+    Start(reactor, slot);
+
+    return SFP_OK;
+
+}
+
+
+// Cancels a transfer.
+byte ReactorCancel(SFPReactor * reactor, SFPTransfer * transfer)
+{
+
+    if (reactor == NULL || transfer == NULL)
+        return MEM_FAIL;
+
+    if (transfer->state == STATE_DONE)
+        return SFP_OK;
+
+    const int index = FindDevice(reactor, transfer->device);
+    if (index < 0)
+        return PORT_FAIL;
+
+    SFPReactorDevice * slot = &reactor->devices[index];
+    if (slot->head == transfer)
+    {
+        Complete(reactor, slot, DEVICE_BUSY);
+        return SFP_OK;
+    }
+
+    // Unlink a waiting transfer; the one in progress is not affected.
+    SFPTransfer * previous = slot->head;
+    while (previous != NULL && previous->next != transfer)
+        previous = previous->next;
+    if (previous == NULL)
+        return SFP_OK;
+    previous->next = transfer->next;
+    if (slot->tail == transfer)
+        slot->tail = previous;
+
+    transfer->rc = DEVICE_BUSY;
+    transfer->sample.rc = DEVICE_BUSY;
+    transfer->state = STATE_DONE;
+    transfer->next = NULL;
+    reactor->cancelled++;
+    reactor->completed++;
+    transfer->callback(transfer->ctx, transfer);
+
+    return SFP_OK;
+
+}
+
+
+// Drives the transfers for at most a timeout.
+byte ReactorRun(SFPReactor * reactor, unsigned long long timeout_ns)
+{
+
+    if (reactor == NULL)
+        return MEM_FAIL;
+
+    const unsigned long long completed = reactor->completed;
+    struct pollfd fds[SFP_REACTOR_MAX_DEVICES];
+    int slots[SFP_REACTOR_MAX_DEVICES];
+    const SFPTransfer * polled[SFP_REACTOR_MAX_DEVICES];
+    int count = 0;
+
+    // Wait until the first deadline at most.
+    unsigned long long now = SFPNowNs();
+    unsigned long long deadline_ns = now + timeout_ns;
+    for (int i = 0; i < reactor->device_count; i++)
+    {
+        const SFPTransfer * transfer = reactor->devices[i].head;
+        if (transfer == NULL)
+            continue;
+        fds[count].fd = reactor->devices[i].device->sfp_fd;
+        fds[count].events = transfer->state == STATE_SENDING ? POLLOUT
+                                                             : POLLIN;
+        fds[count].revents = 0;
+        polled[count] = transfer;
+        slots[count++] = i;
+        if (transfer->deadline_ns < deadline_ns)
+            deadline_ns = transfer->deadline_ns;
+    }
+
+    const int wait_ms = deadline_ns > now
+        ? (int)((deadline_ns - now + 999999ULL) / 1000000ULL) : 0;
+    const int ready = poll(fds, count, wait_ms);
+    if (ready < 0 && errno != EINTR)
+        return PORT_FAIL;
+
+    // Callbacks may complete or start other transfers on the way.
+    for (int k = 0; k < count && ready > 0; k++)
+    {
+        SFPReactorDevice * slot = &reactor->devices[slots[k]];
+        if (fds[k].revents == 0 || slot->head != polled[k])
+            continue;
+        if (fds[k].revents & (POLLERR | POLLHUP | POLLNVAL))
+            Fail(reactor, slot, slot->head->state == STATE_SENDING
+                                ? WRITE_FAIL : READ_FAIL);
+        else if (slot->head->state == STATE_SENDING
+                 && (fds[k].revents & POLLOUT))
+            Send(reactor, slot);
+        else if (slot->head->state == STATE_RECEIVING
+                 && (fds[k].revents & POLLIN))
+            Receive(reactor, slot);
+    }
+
+    // Time out the transfers in progress.
+    now = SFPNowNs();
+    for (int i = 0; i < reactor->device_count; i++)
+    {
+        SFPReactorDevice * slot = &reactor->devices[i];
+        if (slot->head != NULL && slot->head->state != STATE_QUEUED
+            && slot->head->deadline_ns <= now)
+            Complete(reactor, slot, RESPONSE_TIMEOUT);
+    }
+
+    return reactor->completed != completed ? SFP_OK : RESPONSE_TIMEOUT;
+
+}
+
+
+// Returns the number of transfers not completed yet.
+int ReactorPending(const SFPReactor * reactor)
+{
+    int pending = 0;
+    for (int i = 0; i < reactor->device_count; i++)
+        for (const SFPTransfer * transfer = reactor->devices[i].head;
+             transfer != NULL;
+             transfer = transfer->next)
+            pending++;
+    return pending;
+}
+
+
+#undef STATE_QUEUED
+#undef STATE_SENDING
+#undef STATE_RECEIVING
+#undef STATE_DONE
+#undef CLOSED_DEVICE
@@ -0,0 +1,208 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_REACTOR.h
+
+ Abstract:
+    Non-blocking transactions. A reactor multiplexes the serial ports of
+    many devices (serial port backend, see InitializeTTY()) on one thread:
+    transfers (register reads and writes) are submitted without blocking,
+    the reactor drives all ports with a single poll() and calls the
+    completion callback of each transfer when its response is received,
+    when it times out or when it is cancelled.
+
+    Transfers are owned by the caller and nothing is allocated by the
+    reactor. Each device executes one transfer at a time, the others wait
+    in submission order. Reads are decoded and timestamped as by
+    ReadSample() and notified to the device observers.
+
+    A reactor is used by a single thread; callbacks are made from
+    ReactorRun() and may submit new transfers. Available on POSIX platforms
+    only. See SFP10X_CORO.hpp for the C++20 coroutine interface.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_REACTOR_LIB
+#define SFP10X_REACTOR_LIB
+
+
+#include "SFP10X_COM.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Maximum number of devices of a reactor.
+#define SFP_REACTOR_MAX_DEVICES 64
+
+
+// Enumeration type for the transfer types.
+enum TransferType
+{
+    SFP_TRANSFER_READ = 0x00,       // Register read (see ReadSample()).
+    SFP_TRANSFER_WRITE = 0x01       // Register write (see WriteRegister()).
+};
+
+
+typedef struct SFPTransfer_ SFPTransfer;
+
+
+// Transfer completion callback.
+typedef void (*SFPTransferCallback)(void * ctx, SFPTransfer * transfer);
+
+
+// Data structure for a transfer.
+// The first members are set by the caller, the others are managed by the
+// Reactor functions. The transfer must stay valid until completion.
+struct SFPTransfer_
+{
+    byte type;                          // TransferType enum.
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    char data[10];                      // Data (writes) or response frame
+                                        // (reads: status, data and CRC).
+    unsigned long long timeout_ns;      // Timeout, 0 for the device timeout.
+    SFPTransferCallback callback;       // Called on completion.
+    void * ctx;
+    SFPSample sample;                   // Outcome (reads: decoded value).
+    byte rc;                            // Status flag once completed.
+    SFPDevice * device;
+    int state;
+    byte frame[12];                     // Request, then response.
+    int length;                         // Bytes to send or to receive.
+    int count;                          // Bytes sent or received.
+    unsigned long long deadline_ns;
+    SFPTransfer * next;                 // Next transfer of the device.
+};
+
+
+// Data structure for a device of a reactor.
+typedef struct SFPReactorDevice_
+{
+    SFPDevice * device;                 // NULL if the slot is free.
+    SFPTransfer * head;                 // Transfer in progress.
+    SFPTransfer * tail;                 // Last submitted transfer.
+} SFPReactorDevice;
+
+
+// Data structure for a reactor.
+// Members are managed by the Reactor functions.
+typedef struct SFPReactor_
+{
+    SFPReactorDevice devices[SFP_REACTOR_MAX_DEVICES];
+    int device_count;                   // Slots in use, free ones included.
+    unsigned long long completed;       // Transfers completed.
+    unsigned long long timeouts;        // Transfers timed out.
+    unsigned long long cancelled;       // Transfers cancelled.
+} SFPReactor;
+
+
+/** Initializes a reactor.
+ *
+ *	Accepts         SFPReactor pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ReactorInit(SFPReactor * reactor);
+
+
+/** Adds a device (serial port backend) to a reactor.
+ *
+ *	Accepts         SFPReactor pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag. PORT_FAIL is returned if the device does not
+ *                  use the serial port backend, MEM_FAIL if there are too
+ *                  many devices.
+ *
+ *  The device may still be used with the blocking functions when it has no
+ *  transfer in progress.
+ */
+byte ReactorAdd(SFPReactor * reactor, SFPDevice * device);
+
+
+/** Removes a device from a reactor. Its transfers are cancelled.
+ *
+ *	Accepts         SFPReactor pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ReactorRemove(SFPReactor * reactor, SFPDevice * device);
+
+
+/** Submits a transfer.
+ *
+ *	Accepts         SFPReactor pointer, SFPDevice pointer and SFPTransfer
+ *                  pointer.
+ *
+ *	transfer        type, reg_address, number_of_bytes, data (writes),
+ *                  timeout_ns and callback must be set by the caller.
+ *
+ *	Returns         status flag. The callback is only called if SFP_OK is
+ *                  returned.
+ */
+byte ReactorSubmit(SFPReactor * reactor,
+                   SFPDevice * device,
+                   SFPTransfer * transfer);
+
+
+/** Cancels a transfer. It completes with DEVICE_BUSY (nothing is done if it
+ *  already completed).
+ *
+ *	Accepts         SFPReactor pointer and SFPTransfer pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  A read cancelled while its response is being received discards the rest
+ *  of the response.
+ */
+byte ReactorCancel(SFPReactor * reactor, SFPTransfer * transfer);
+
+
+/** Drives the transfers for at most a timeout.
+ *
+ *	Accepts         SFPReactor pointer and timeout in nanoseconds.
+ *
+ *	timeout_ns      maximum wait if no transfer makes progress, 0 to only
+ *                  process what is ready.
+ *
+ *	Returns         status flag. RESPONSE_TIMEOUT is returned if no transfer
+ *                  completed.
+ */
+byte ReactorRun(SFPReactor * reactor, unsigned long long timeout_ns);
+
+
+/** Returns the number of transfers not completed yet.
+ *
+ *	Accepts         SFPReactor pointer.
+ *
+ *	Returns         number of submitted transfers not completed.
+ */
+int ReactorPending(const SFPReactor * reactor);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif  // SFP10X_REACTOR_LIB
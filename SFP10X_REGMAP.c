@@ -0,0 +1,444 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_REGMAP.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_REGMAP.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Maximum length of a description line.
+#define LINE_SIZE 256
+
+// Number of fields of a register line.
+#define FIELD_COUNT 8
+
+// Number of seeds tried per hash bucket.
+#define MAX_SEED 65535
+
+
+// Seeded FNV-1a hash of a name.
+static unsigned int Hash(const char * name, unsigned int seed)
+{
+    unsigned int h = 2166136261u ^ (seed * 0x9E3779B9u);
+    while (*name)
+    {
+        h ^= (byte)*name++;
+        h *= 16777619u;
+    }
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 13;
+    return h;
+}
+
+
+// Copies a field into a fixed size string. Returns zero if it is too long.
+static int CopyField(char * destination, size_t size, const char * field)
+{
+    if (strlen(field) >= size)
+        return 0;
+    strcpy(destination, field);
+    return 1;
+}
+
+
+// Parses a register line split in fields.
+static byte ParseRegister(SFPRegisterMap * map, char ** fields)
+{
+
+    if (map->count == SFP_REGMAP_MAX_REGISTERS)
+        return MEM_FAIL;
+
+    SFPRegisterInfo * info = &map->registers[map->count];
+    memset(info, 0, sizeof(SFPRegisterInfo));
+
+    char * end;
+    const long address = strtol(fields[1], &end, 0);
+    if (*end != '\0' || address < 0 || address > 0xFF)
+        return BYTES_INVALID;
+    info->address = (byte)address;
+
+    info->length = DataLengthFor((int)strtol(fields[2], &end, 10));
+    if (*end != '\0' || info->length == 0xFF)
+        return BYTES_INVALID;
+
+    if (strcmp(fields[3], "signed") == 0)
+        info->is_signed = 1;
+    else if (strcmp(fields[3], "unsigned") != 0)
+        return BYTES_INVALID;
+
+    info->scale = strtod(fields[4], &end);
+    if (*end != '\0')
+        return BYTES_INVALID;
+
+    if (strcmp(fields[6], "r") == 0)
+        info->access = SFP_ACCESS_READ;
+    else if (strcmp(fields[6], "w") == 0)
+        info->access = SFP_ACCESS_WRITE;
+    else if (strcmp(fields[6], "rw") == 0)
+        info->access = SFP_ACCESS_READ_WRITE;
+    else
+        return BYTES_INVALID;
+
+    if (strcmp(fields[7], "static") == 0)
+        info->cacheable = 1;
+    else if (strcmp(fields[7], "volatile") != 0)
+        return BYTES_INVALID;
+
+    if (!CopyField(info->name, sizeof(info->name), fields[0])
+        || !CopyField(info->unit, sizeof(info->unit), fields[5]))
+        return BYTES_INVALID;
+
+    // Names and addresses are unique.
+    if (map->by_address[info->address] != SFP_REGMAP_NONE)
+        return BYTES_INVALID;
+    for (int i = 0; i < map->count; i++)
+        if (strcmp(map->registers[i].name, info->name) == 0)
+            return BYTES_INVALID;
+
+    map->by_address[info->address] = (byte)map->count;
+    map->count++;
+
+    return SFP_OK;
+
+}
+
+
+// Parses a description line (comments and blank lines are skipped).
+static byte ParseLine(SFPRegisterMap * map, char * line)
+{
+
+    char * comment = strchr(line, '#');
+    if (comment != NULL)
+        *comment = '\0';
+
+    char * fields[FIELD_COUNT + 1];
+    int count = 0;
+    for (char * field = strtok(line, " \t\r\n");
+         field != NULL && count <= FIELD_COUNT;
+         field = strtok(NULL, " \t\r\n"))
+        fields[count++] = field;
+
+    if (count == 0)
+        return SFP_OK;
+
+    if (strcmp(fields[0], "product") == 0)
+    {
+        if (count != 2
+            || !CopyField(map->product, sizeof(map->product), fields[1]))
+            return BYTES_INVALID;
+        return SFP_OK;
+    }
+
+    if (count != FIELD_COUNT)
+        return BYTES_INVALID;
+
+    return ParseRegister(map, fields);
+
+}
+
+
+// Resets a map before parsing.
+static void Clear(SFPRegisterMap * map)
+{
+    memset(map, 0, sizeof(SFPRegisterMap));
+    memset(map->by_address, SFP_REGMAP_NONE, sizeof(map->by_address));
+}
+
+
+// Builds the perfect hash of the names (hash and displace): the names are
+// spread in buckets by a first hash, then, from the largest bucket down,
+// each bucket gets the first seed that places all of its names in free
+// slots of the table.
+static byte BuildHash(SFPRegisterMap * map)
+{
+
+    const int size = map->count;
+    map->bucket_count = size / 2 + 1;
+
+    byte bucket_of[SFP_REGMAP_MAX_REGISTERS];
+    int bucket_size[SFP_REGMAP_MAX_BUCKETS] = { 0 };
+    for (int i = 0; i < size; i++)
+    {
+        bucket_of[i] = (byte)(Hash(map->registers[i].name, 0)
+                              % map->bucket_count);
+        bucket_size[bucket_of[i]]++;
+    }
+
+    byte used[SFP_REGMAP_MAX_REGISTERS] = { 0 };
+    byte done[SFP_REGMAP_MAX_BUCKETS] = { 0 };
+    for (int b = 0; b < map->bucket_count; b++)
+    {
+        // Largest remaining bucket.
+        int bucket = -1;
+        for (int c = 0; c < map->bucket_count; c++)
+            if (!done[c] && (bucket < 0 || bucket_size[c] > bucket_size[bucket]))
+                bucket = c;
+        done[bucket] = 1;
+        if (bucket_size[bucket] == 0)
+            continue;
+
+        int members[SFP_REGMAP_MAX_REGISTERS];
+        int member_count = 0;
+        for (int i = 0; i < size; i++)
+            if (bucket_of[i] == bucket)
+                members[member_count++] = i;
+
+        unsigned int seed;
+        int slots[SFP_REGMAP_MAX_REGISTERS];
+        for (seed = 1; seed <= MAX_SEED; seed++)
+        {
+            int fits = 1;
+            for (int m = 0; m < member_count && fits; m++)
+            {
+                slots[m] = (int)(Hash(map->registers[members[m]].name, seed)
+                                 % size);
+                fits = !used[slots[m]];
+                for (int n = 0; n < m && fits; n++)
+                    fits = slots[n] != slots[m];
+            }
+            if (fits)
+                break;
+        }
+        // No seed places the bucket: the table cannot be built.
+        if (seed > MAX_SEED)
+            return MEM_FAIL;
+
+        map->seeds[bucket] = (unsigned short)seed;
+        for (int m = 0; m < member_count; m++)
+        {
+            used[slots[m]] = 1;
+            map->slots[slots[m]] = (byte)members[m];
+        }
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Loads a register description file.
+byte RegMapLoad(SFPRegisterMap * map, const char * path, int * error_line)
+{
+
+    if (map == NULL || path == NULL)
+        return MEM_FAIL;
+
+    Clear(map);
+    if (error_line != NULL)
+        *error_line = 0;
+
+    FILE * file = fopen(path, "r");
+    if (file == NULL)
+        return PORT_FAIL;
+
+    char line[LINE_SIZE];
+    int line_number = 0;
+    byte rc = SFP_OK;
+    while (rc == SFP_OK && fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+        if (strchr(line, '\n') == NULL && !feof(file))
+            rc = BYTES_INVALID;
+        else
+            rc = ParseLine(map, line);
+    }
+    fclose(file);
+
+    if (rc != SFP_OK)
+    {
+        if (error_line != NULL)
+            *error_line = line_number;
+        return rc;
+    }
+
+    return BuildHash(map);
+
+}
+
+
+// Parses a register description held in memory.
+byte RegMapParse(SFPRegisterMap * map, const char * text, int * error_line)
+{
+
+    if (map == NULL || text == NULL)
+        return MEM_FAIL;
+
+    Clear(map);
+    if (error_line != NULL)
+        *error_line = 0;
+
+    char line[LINE_SIZE];
+    int line_number = 0;
+    while (*text != '\0')
+    {
+        const size_t length = strcspn(text, "\n");
+        line_number++;
+        byte rc = BYTES_INVALID;
+        if (length < sizeof(line))
+        {
+            memcpy(line, text, length);
+            line[length] = '\0';
+            rc = ParseLine(map, line);
+        }
+        text += length;
+        if (*text == '\n')
+            text++;
+
+        if (rc != SFP_OK)
+        {
+            if (error_line != NULL)
+                *error_line = line_number;
+            return rc;
+        }
+    }
+
+    return BuildHash(map);
+
+}
+
+
+// Finds a register by name.
+const SFPRegisterInfo * RegMapFind(const SFPRegisterMap * map,
+                                   const char * name)
+{
+
+    if (map == NULL || name == NULL || map->count == 0)
+        return NULL;
+
+    const unsigned int bucket = Hash(name, 0) % map->bucket_count;
+    const unsigned int slot = Hash(name, map->seeds[bucket]) % map->count;
+    const SFPRegisterInfo * info = &map->registers[map->slots[slot]];
+
+    return strcmp(info->name, name) == 0 ? info : NULL;
+
+}
+
+
+// Finds a register by address.
+const SFPRegisterInfo * RegMapAt(const SFPRegisterMap * map,
+                                 byte SFP_reg_address)
+{
+
+    if (map == NULL)
+        return NULL;
+
+    const byte index = map->by_address[SFP_reg_address];
+
+    return index == SFP_REGMAP_NONE ? NULL : &map->registers[index];
+
+}
+
+
+// Converts the data of a read to counts.
+long long RegMapCounts(const SFPRegisterInfo * info, long long data)
+{
+    if (info->is_signed)
+        return data;
+    const int bits = 8 * DataBytes(info->length);
+    return (long long)((unsigned long long)data & ((1ULL << bits) - 1));
+}
+
+
+// Converts a sample to its engineering value.
+double RegMapValue(const SFPRegisterMap * map, const SFPSample * sample)
+{
+    const SFPRegisterInfo * info = RegMapAt(map, sample->reg_address);
+    if (info == NULL)
+        return (double)sample->value;
+    return (double)RegMapCounts(info, sample->value) * info->scale;
+}
+
+
+// Reads a register in its engineering unit.
+byte RegMapRead(SFPDevice * device,
+                const SFPRegisterInfo * info,
+                double * value,
+                SFPSample * sample)
+{
+
+    if (info == NULL || value == NULL)
+        return MEM_FAIL;
+
+    if (!(info->access & SFP_ACCESS_READ))
+        return READ_FAIL;
+
+    long long data;
+    byte rc;
+    if (sample != NULL)
+    {
+        rc = ReadSample(device, info->address, info->length, sample);
+        data = sample->value;
+    }
+    else
+    {
+        rc = ReadSignedRegister(device, info->address, info->length, &data);
+    }
+
+    if (rc == SFP_OK)
+        *value = (double)RegMapCounts(info, data) * info->scale;
+
+    return rc;
+
+}
+
+
+// Writes a register from its engineering unit.
+byte RegMapWrite(SFPDevice * device,
+                 const SFPRegisterInfo * info,
+                 double value)
+{
+
+    if (info == NULL)
+        return MEM_FAIL;
+
+    if (!(info->access & SFP_ACCESS_WRITE) || info->scale == 0.0)
+        return WRITE_FAIL;
+
+    // Range of the register, in counts.
+    const int size = DataBytes(info->length);
+    const double span = ldexp(1.0, 8 * size);
+    const double counts = floor(value / info->scale + 0.5);
+    const double low = info->is_signed ? -span / 2.0 : 0.0;
+    if (!(counts >= low && counts < low + span))
+        return BYTES_INVALID;
+
+    const long long data = (long long)counts;
+    char bytes[8] = { 0 };
+    for (int i = 0; i < size; i++)
+        bytes[i] = (char)((unsigned long long)data >> (8 * i));
+
+    return WriteRegister(device, info->address, info->length, bytes);
+
+}
+
+
+#undef LINE_SIZE
+#undef FIELD_COUNT
+#undef MAX_SEED
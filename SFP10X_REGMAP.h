@@ -0,0 +1,199 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_REGMAP.h
+
+ Abstract:
+    Register descriptions loaded at runtime. A description file lists the
+    registers of a product, one per line:
+
+        # Comment.
+        product SFP101
+        # name          address width sign      scale       unit  access cache
+        current         0x32    3     signed    0.00006119  A     r      volatile
+        serial_number   0x1E    3     unsigned  1           count r      static
+
+    width is the number of data bytes (1, 2, 3 or 6), sign is signed or
+    unsigned, value = counts * scale in unit, access is r, w or rw and cache
+    is static (the register does not change, its value may be cached) or
+    volatile. Names and units are at most SFP_REGMAP_NAME_SIZE - 1 and
+    SFP_REGMAP_UNIT_SIZE - 1 characters.
+
+    The file is parsed once into an immutable table. Names are looked up
+    with a minimal perfect hash built at load time (two hashes and one
+    string comparison, no probing) and addresses with a direct index. The
+    hot path resolves a register once and then reads, writes and decodes
+    through the SFPRegisterInfo pointer.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_REGMAP_LIB
+#define SFP10X_REGMAP_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum number of registers of a product.
+#define SFP_REGMAP_MAX_REGISTERS 128
+
+// Number of hash buckets (one displacement seed per bucket).
+#define SFP_REGMAP_MAX_BUCKETS (SFP_REGMAP_MAX_REGISTERS / 2 + 1)
+
+// Name and unit sizes, including the terminating NUL.
+#define SFP_REGMAP_NAME_SIZE 32
+#define SFP_REGMAP_UNIT_SIZE 8
+
+// Index of an address without a register.
+#define SFP_REGMAP_NONE 0xFF
+
+
+// Enumeration type for the register access modes.
+enum RegisterAccess
+{
+    SFP_ACCESS_READ = 0x01,
+    SFP_ACCESS_WRITE = 0x02,
+    SFP_ACCESS_READ_WRITE = 0x03
+};
+
+
+// Data structure for the description of a register.
+typedef struct SFPRegisterInfo_
+{
+    char name[SFP_REGMAP_NAME_SIZE];    // Register name.
+    char unit[SFP_REGMAP_UNIT_SIZE];    // Engineering unit.
+    double scale;                       // Unit per count.
+    byte address;                       // SFP register address.
+    byte length;                        // Transaction size (DataLength enum).
+    byte is_signed;                     // Non-zero for two's complement data.
+    byte access;                        // RegisterAccess enum.
+    byte cacheable;                     // Non-zero for static registers.
+} SFPRegisterInfo;
+
+
+// Data structure for the register map of a product.
+// Members are managed by the RegMap functions and must not be modified.
+typedef struct SFPRegisterMap_
+{
+    char product[SFP_REGMAP_NAME_SIZE]; // Product name.
+    SFPRegisterInfo registers[SFP_REGMAP_MAX_REGISTERS];
+    int count;                          // Number of registers.
+    int bucket_count;                   // Number of hash buckets.
+    unsigned short seeds[SFP_REGMAP_MAX_BUCKETS];
+    byte slots[SFP_REGMAP_MAX_REGISTERS];   // Register of each hash slot.
+    byte by_address[256];               // Register of each address.
+} SFPRegisterMap;
+
+
+/** Loads a register description file.
+ *
+ *	Accepts         SFPRegisterMap pointer, file path and an (optional) int
+ *                  pointer receiving the line of the first error.
+ *
+ *	Returns         status flag. PORT_FAIL is returned if the file cannot be
+ *                  opened, BYTES_INVALID if a line is malformed or a name or
+ *                  an address is defined twice and MEM_FAIL if there are too
+ *                  many registers or their names cannot be hashed.
+ */
+byte RegMapLoad(SFPRegisterMap * map, const char * path, int * error_line);
+
+
+/** Parses a register description held in memory (see RegMapLoad()).
+ *
+ *	Accepts         SFPRegisterMap pointer, NUL-terminated description and
+ *                  an (optional) int pointer receiving the line of the first
+ *                  error.
+ *
+ *	Returns         status flag.
+ */
+byte RegMapParse(SFPRegisterMap * map, const char * text, int * error_line);
+
+
+/** Finds a register by name.
+ *
+ *	Accepts         SFPRegisterMap pointer and register name.
+ *
+ *	Returns         register description, NULL if the name is unknown.
+ */
+const SFPRegisterInfo * RegMapFind(const SFPRegisterMap * map,
+                                   const char * name);
+
+
+/** Finds a register by address.
+ *
+ *	Accepts         SFPRegisterMap pointer and register address.
+ *
+ *	Returns         register description, NULL if the address is unknown.
+ */
+const SFPRegisterInfo * RegMapAt(const SFPRegisterMap * map,
+                                 byte SFP_reg_address);
+
+
+/** Converts the data of a read to counts.
+ *
+ *	Accepts         register description and signed data as returned by
+ *                  ReadSignedRegister() or in SFPSample.
+ *
+ *	Returns         counts, zero extended for unsigned registers.
+ */
+long long RegMapCounts(const SFPRegisterInfo * info, long long data);
+
+
+/** Converts a sample to its engineering value.
+ *
+ *	Accepts         SFPRegisterMap pointer and SFPSample pointer.
+ *
+ *	Returns         counts * scale of the sample register, the counts if
+ *                  the register is unknown.
+ */
+double RegMapValue(const SFPRegisterMap * map, const SFPSample * sample);
+
+
+/** Reads a register in its engineering unit.
+ *
+ *	Accepts         SFPDevice pointer, register description, double pointer
+ *                  receiving the value and an (optional) SFPSample pointer
+ *                  receiving the sample.
+ *
+ *	Returns         status flag. READ_FAIL is returned if the register cannot
+ *                  be read.
+ */
+byte RegMapRead(SFPDevice * device,
+                const SFPRegisterInfo * info,
+                double * value,
+                SFPSample * sample);
+
+
+/** Writes a register from its engineering unit.
+ *
+ *	Accepts         SFPDevice pointer, register description and value.
+ *
+ *	Returns         status flag. WRITE_FAIL is returned if the register
+ *                  cannot be written and BYTES_INVALID if the value does
+ *                  not fit in the register.
+ */
+byte RegMapWrite(SFPDevice * device,
+                 const SFPRegisterInfo * info,
+                 double value);
+
+
+#endif  // SFP10X_REGMAP_LIB
@@ -0,0 +1,589 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_SESSION.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_SESSION.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Maximum length of a cache file line.
+#define LINE_SIZE 320
+
+// Device number of a closed device.
+#define CLOSED_DEVICE -99
+
+
+// Finds the entry of a module, NULL if it is not cached.
+static SFPSessionEntry * FindEntry(SFPSessionCache * cache, const char * name)
+{
+    for (int i = 0; i < cache->count; i++)
+        if (strcmp(cache->entries[i].name, name) == 0)
+            return &cache->entries[i];
+    return NULL;
+}
+
+
+// Parses a line of a cache file; entry is the module being parsed.
+static byte ParseLine(SFPSessionCache * cache,
+                      const char * line,
+                      SFPSessionEntry ** entry)
+{
+
+    char keyword[16];
+    if (sscanf(line, "%15s", keyword) != 1 || keyword[0] == '#')
+        return SFP_OK;
+
+    if (strcmp(keyword, "device") == 0)
+    {
+        SFPSessionEntry * parsed = &cache->entries[cache->count];
+        int bps;
+        char extra;
+        if (cache->count == SFP_SESSION_MAX_DEVICES
+            || sscanf(line, "device %255s %d %d %d %c", parsed->name, &bps,
+                      &parsed->timeout_ms, &parsed->latency_ms, &extra) != 4
+            || parsed->timeout_ms <= 0 || parsed->latency_ms < 0
+            || parsed->latency_ms > 255)
+            return BYTES_INVALID;
+
+        int baud = SFP_BAUD_9600;
+        while (baud <= SFP_BAUD_115200 && BaudRateBps(baud) != bps)
+            baud++;
+        if (baud > SFP_BAUD_115200)
+            return BYTES_INVALID;
+        parsed->baud_rate = (byte)baud;
+
+        cache->count++;
+        *entry = parsed;
+        return SFP_OK;
+    }
+
+    // Registers belong to the last module.
+    if (*entry == NULL)
+        return BYTES_INVALID;
+
+    int address;
+    int size;
+    if (strcmp(keyword, "static") == 0)
+    {
+        long long value;
+        char extra;
+        if ((*entry)->static_count == SFP_SESSION_MAX_STATICS
+            || sscanf(line, "static %i %d %lld %c", &address, &size, &value,
+                      &extra) != 3
+            || address < 0 || address > 0xFF || DataLengthFor(size) == 0xFF)
+            return BYTES_INVALID;
+
+        SFPSessionStatic * cached =
+            &(*entry)->statics[(*entry)->static_count++];
+        cached->reg_address = (byte)address;
+        cached->number_of_bytes = DataLengthFor(size);
+        cached->value = value;
+        return SFP_OK;
+    }
+
+    if (strcmp(keyword, "write") == 0)
+    {
+        char hex[16];
+        char extra;
+        if ((*entry)->write_count == SFP_SESSION_MAX_WRITES
+            || sscanf(line, "write %i %d %15s %c", &address, &size, hex,
+                      &extra) != 3
+            || address < 0 || address > 0xFF || DataLengthFor(size) == 0xFF
+            || strlen(hex) != (size_t)(2 * size))
+            return BYTES_INVALID;
+
+        SFPSessionWrite * write = &(*entry)->writes[(*entry)->write_count++];
+        write->reg_address = (byte)address;
+        write->number_of_bytes = DataLengthFor(size);
+        memset(write->data, 0, sizeof(write->data));
+        for (int i = 0; i < size; i++)
+        {
+            char digits[3] = { hex[2 * i], hex[2 * i + 1], '\0' };
+            char * end;
+            write->data[i] = (char)strtoul(digits, &end, 16);
+            if (*end != '\0')
+                return BYTES_INVALID;
+        }
+        return SFP_OK;
+    }
+
+    return BYTES_INVALID;
+
+}
+
+
+// Opens a module, by enumeration (discovery) or directly by serial number.
+static byte OpenModule(const SFPSessionEntry * entry,
+                       SFPDevice * device,
+                       int direct)
+{
+
+    if (entry->name[0] == '/')
+        return InitializeTTY(entry->name, device);
+
+    if (direct)
+        return InitializeSerial(entry->name, device);
+
+    char buffer[64];
+    const int count = GetFTDIDeviceCount();
+    for (int i = 0; i < count; i++)
+    {
+        if (GetFTDIDeviceInfo(i, buffer) != SFP_OK)
+            continue;
+        buffer[sizeof(buffer) - 1] = '\0';
+        if (strcmp(buffer, entry->name) == 0)
+            return Initialize(i, device);
+    }
+
+    // Not connected.
+    device->sfp_device_num = CLOSED_DEVICE;
+    return PORT_FAIL;
+
+}
+
+
+// Replays the configuration writes and sets the latency timer.
+static byte Restore(const SFPSessionEntry * entry, SFPDevice * device)
+{
+
+    if (entry->latency_ms != 0)
+    {
+        byte rc = ChangeLatencyTimer(device, entry->latency_ms);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    for (int i = 0; i < entry->write_count; i++)
+    {
+        const SFPSessionWrite * write = &entry->writes[i];
+        char data[8];
+        memcpy(data, write->data, sizeof(data));
+        byte rc = WriteRegister(device, write->reg_address,
+                                write->number_of_bytes, data);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Opens a module directly in its cached state, validated by one read.
+static byte WarmOpen(const SFPSessionEntry * entry, SFPDevice * device)
+{
+
+    byte rc = OpenModule(entry, device, 1);
+    if (rc != SFP_OK)
+        return rc;
+
+    rc = ChangeTimeout(device, entry->timeout_ms);
+    if (rc == SFP_OK && entry->baud_rate != SFP_BAUD_19200)
+        rc = ChangeOnlyHostBaudRate(device, entry->baud_rate);
+    if (rc != SFP_OK)
+        return rc;
+
+    const SFPSessionStatic * check = &entry->statics[0];
+    long long value;
+    rc = ReadSignedRegister(device, check->reg_address,
+                            check->number_of_bytes, &value);
+    if (rc != SFP_OK)
+        return rc;
+    if (value != check->value)
+        return READ_FAIL;
+
+    return Restore(entry, device);
+
+}
+
+
+// Finds the module and its baudrate, then restores the cached state and
+// reads the static registers again.
+static byte Discover(SFPSessionEntry * entry, SFPDevice * device, int known)
+{
+
+    byte rc = OpenModule(entry, device, 0);
+    if (rc != SFP_OK)
+        return rc;
+
+    // A new module keeps the default timeout.
+    if (entry->timeout_ms == 0)
+        entry->timeout_ms = device->sfp_timeout_ms;
+    else
+    {
+        rc = ChangeTimeout(device, entry->timeout_ms);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    // Probe the baudrates, starting with the one after a reset (the one the
+    // device is opened at) then the cached one.
+    byte order[SFP_BAUD_115200 + 1];
+    int order_count = 0;
+    order[order_count++] = SFP_BAUD_19200;
+    if (entry->baud_rate != SFP_BAUD_19200)
+        order[order_count++] = entry->baud_rate;
+    for (int baud = SFP_BAUD_9600; baud <= SFP_BAUD_115200; baud++)
+        if (baud != SFP_BAUD_19200 && baud != entry->baud_rate)
+            order[order_count++] = (byte)baud;
+
+    const SFPSessionStatic * check = &entry->statics[0];
+    int found = -1;
+    for (int i = 0; i < order_count && found < 0; i++)
+    {
+        if (device->sfp_baud_rate != order[i])
+        {
+            rc = ChangeOnlyHostBaudRate(device, order[i]);
+            if (rc != SFP_OK)
+                return rc;
+        }
+
+        long long value;
+        if (ReadSignedRegister(device, check->reg_address,
+                               check->number_of_bytes, &value) == SFP_OK)
+            found = order[i];
+        else if (device->sfp_device_num == CLOSED_DEVICE)
+            return PORT_FAIL;
+    }
+    if (found < 0)
+        return RESPONSE_TIMEOUT;
+
+    // A new module stays at the baudrate it was found at.
+    if (!known)
+        entry->baud_rate = (byte)found;
+    else if (found != entry->baud_rate)
+    {
+        rc = ChangeBaudRate(device, entry->baud_rate);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    for (int i = 0; i < entry->static_count; i++)
+    {
+        SFPSessionStatic * cached = &entry->statics[i];
+        rc = ReadSignedRegister(device, cached->reg_address,
+                                cached->number_of_bytes, &cached->value);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    return Restore(entry, device);
+
+}
+
+
+// Loads a session cache file.
+byte SessionLoad(SFPSessionCache * cache, const char * path)
+{
+
+    if (cache == NULL || path == NULL)
+        return MEM_FAIL;
+
+    memset(cache, 0, sizeof(SFPSessionCache));
+
+    FILE * file = fopen(path, "r");
+    if (file == NULL)
+        return PORT_FAIL;
+
+    char line[LINE_SIZE];
+    SFPSessionEntry * entry = NULL;
+    byte rc = SFP_OK;
+    while (rc == SFP_OK && fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strchr(line, '\n') == NULL && !feof(file))
+            rc = BYTES_INVALID;
+        else
+            rc = ParseLine(cache, line, &entry);
+    }
+    fclose(file);
+
+    // Every module needs its validation register.
+    for (int i = 0; i < cache->count && rc == SFP_OK; i++)
+        if (cache->entries[i].static_count == 0)
+            rc = BYTES_INVALID;
+
+    if (rc != SFP_OK)
+    {
+        memset(cache, 0, sizeof(SFPSessionCache));
+        return rc;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Saves a session cache file.
+byte SessionSave(const SFPSessionCache * cache, const char * path)
+{
+
+    if (cache == NULL || path == NULL)
+        return MEM_FAIL;
+
+    char temporary[LINE_SIZE];
+    if (strlen(path) + 5 > sizeof(temporary))
+        return MEM_FAIL;
+    strcpy(temporary, path);
+    strcat(temporary, ".tmp");
+
+    FILE * file = fopen(temporary, "w");
+    if (file == NULL)
+        return PORT_FAIL;
+
+    fprintf(file, "# SFP10X session cache\n");
+    for (int i = 0; i < cache->count; i++)
+    {
+        const SFPSessionEntry * entry = &cache->entries[i];
+        fprintf(file, "device %s %d %d %d\n", entry->name,
+                BaudRateBps(entry->baud_rate), entry->timeout_ms,
+                entry->latency_ms);
+        for (int k = 0; k < entry->static_count; k++)
+        {
+            const SFPSessionStatic * cached = &entry->statics[k];
+            fprintf(file, "static 0x%02X %d %lld\n", cached->reg_address,
+                    DataBytes(cached->number_of_bytes), cached->value);
+        }
+        for (int k = 0; k < entry->write_count; k++)
+        {
+            const SFPSessionWrite * write = &entry->writes[k];
+            const int size = DataBytes(write->number_of_bytes);
+            fprintf(file, "write 0x%02X %d ", write->reg_address, size);
+            for (int b = 0; b < size; b++)
+                fprintf(file, "%02X", (byte)write->data[b]);
+            fprintf(file, "\n");
+        }
+    }
+
+    // Replace the previous file only once the new one is complete.
+    const int failed = ferror(file);
+    if (fclose(file) != 0 || failed)
+    {
+        remove(temporary);
+        return PORT_FAIL;
+    }
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (rename(temporary, path) != 0)
+    {
+        remove(temporary);
+        return PORT_FAIL;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Opens a module in its cached state.
+byte SessionOpen(SFPSessionCache * cache,
+                 const char * name,
+                 SFPDevice * device,
+                 SFPSessionEntry ** entry,
+                 int * warm)
+{
+
+    if (entry != NULL)
+        *entry = NULL;
+    if (warm != NULL)
+        *warm = 0;
+
+    if (cache == NULL || name == NULL || device == NULL)
+        return MEM_FAIL;
+
+    if (strlen(name) >= SFP_SESSION_MAX_NAME)
+        return MEM_FAIL;
+    if (name[0] == '\0' || strcspn(name, " \t\r\n") != strlen(name))
+        return BYTES_INVALID;
+
+    SFPSessionEntry * cached = FindEntry(cache, name);
+    const int known = cached != NULL;
+    if (known)
+    {
+        if (WarmOpen(cached, device) == SFP_OK)
+        {
+            if (entry != NULL)
+                *entry = cached;
+            if (warm != NULL)
+                *warm = 1;
+            return SFP_OK;
+        }
+        if (device->sfp_device_num != CLOSED_DEVICE)
+            ClosePort(device);
+    }
+    else
+    {
+        if (cache->count == SFP_SESSION_MAX_DEVICES)
+            return MEM_FAIL;
+
+        // The serial number register validates a new module.
+        cached = &cache->entries[cache->count];
+        memset(cached, 0, sizeof(SFPSessionEntry));
+        strcpy(cached->name, name);
+        cached->baud_rate = SFP_BAUD_19200;
+        cached->statics[0].reg_address = SFP_SESSION_SERIAL_REGISTER;
+        cached->statics[0].number_of_bytes = SFP_SESSION_SERIAL_LENGTH;
+        cached->static_count = 1;
+    }
+
+    byte rc = Discover(cached, device, known);
+    if (rc != SFP_OK)
+    {
+        if (device->sfp_device_num != CLOSED_DEVICE)
+            ClosePort(device);
+        return rc;
+    }
+
+    // A new module is only kept once discovered.
+    if (!known)
+        cache->count++;
+    if (entry != NULL)
+        *entry = cached;
+
+    return SFP_OK;
+
+}
+
+
+// Records the current baudrate and timeout of a device.
+byte SessionUpdate(SFPSessionEntry * entry, const SFPDevice * device)
+{
+
+    if (entry == NULL || device == NULL)
+        return MEM_FAIL;
+
+    entry->baud_rate = (byte)device->sfp_baud_rate;
+    entry->timeout_ms = device->sfp_timeout_ms;
+
+    return SFP_OK;
+
+}
+
+
+// Changes the USB latency timer of a device and records it.
+byte SessionChangeLatency(SFPSessionEntry * entry,
+                          SFPDevice * device,
+                          int latency_ms)
+{
+
+    if (entry == NULL || device == NULL)
+        return MEM_FAIL;
+
+    byte rc = ChangeLatencyTimer(device, latency_ms);
+    if (rc != SFP_OK)
+        return rc;
+
+    entry->latency_ms = latency_ms;
+
+    return SFP_OK;
+
+}
+
+
+// Writes a configuration register and records the write.
+byte SessionWriteRegister(SFPSessionEntry * entry,
+                          SFPDevice * device,
+                          byte SFP_reg_address,
+                          byte number_of_bytes,
+                          char * const data)
+{
+
+    if (entry == NULL || device == NULL || data == NULL)
+        return MEM_FAIL;
+
+    const int size = DataBytes(number_of_bytes);
+    if (size == 0)
+        return BYTES_INVALID;
+
+    // The last write of a register replaces the previous ones.
+    int slot = 0;
+    while (slot < entry->write_count
+           && entry->writes[slot].reg_address != SFP_reg_address)
+        slot++;
+    if (slot == SFP_SESSION_MAX_WRITES)
+        return MEM_FAIL;
+
+    byte rc = WriteRegister(device, SFP_reg_address, number_of_bytes, data);
+    if (rc != SFP_OK)
+        return rc;
+
+    if (slot == entry->write_count)
+        entry->write_count++;
+    SFPSessionWrite * write = &entry->writes[slot];
+    write->reg_address = SFP_reg_address;
+    write->number_of_bytes = number_of_bytes;
+    memset(write->data, 0, sizeof(write->data));
+    memcpy(write->data, data, size);
+
+    return SFP_OK;
+
+}
+
+
+// Reads a static register, from the cache when possible.
+byte SessionReadStatic(SFPSessionEntry * entry,
+                       SFPDevice * device,
+                       byte SFP_reg_address,
+                       byte number_of_bytes,
+                       long long * signed_data)
+{
+
+    if (entry == NULL || device == NULL || signed_data == NULL)
+        return MEM_FAIL;
+
+    for (int i = 0; i < entry->static_count; i++)
+    {
+        const SFPSessionStatic * cached = &entry->statics[i];
+        if (cached->reg_address == SFP_reg_address
+            && cached->number_of_bytes == number_of_bytes)
+        {
+            *signed_data = cached->value;
+            return SFP_OK;
+        }
+    }
+
+    if (entry->static_count == SFP_SESSION_MAX_STATICS)
+        return MEM_FAIL;
+
+    byte rc = ReadSignedRegister(device, SFP_reg_address, number_of_bytes,
+                                 signed_data);
+    if (rc != SFP_OK)
+        return rc;
+
+    SFPSessionStatic * cached = &entry->statics[entry->static_count++];
+    cached->reg_address = SFP_reg_address;
+    cached->number_of_bytes = number_of_bytes;
+    cached->value = *signed_data;
+
+    return SFP_OK;
+
+}
+
+
+#undef LINE_SIZE
+#undef CLOSED_DEVICE
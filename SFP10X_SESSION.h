@@ -0,0 +1,226 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_SESSION.h
+
+ Abstract:
+    Warm-start session cache. Opening a module normally enumerates the FTDI
+    devices to find it, opens it at 19200 baud, negotiates the baudrate
+    again and reads its static registers (serial number...). A session
+    cache keeps, for each module, the last known state of the link (keyed by
+    FTDI serial number or tty path) in a small text file:
+
+        baudrate, timeout and USB latency timer,
+        values of static registers (the first one validates the module),
+        configuration writes, replayed on open.
+
+    SessionOpen() opens a known module directly by its serial number at its
+    last baudrate and checks it with a single CRC checked read of the
+    validation register. If the read fails or returns another value, the
+    module is discovered as without cache: enumeration, baudrate probing,
+    then the cached state is restored and the static registers are read
+    again. The cache is only an optimization; a missing or corrupted file
+    gives an empty cache.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_SESSION_LIB
+#define SFP10X_SESSION_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum number of modules in a session cache.
+#define SFP_SESSION_MAX_DEVICES 16
+
+// Maximum number of static registers and of configuration writes per module.
+#define SFP_SESSION_MAX_STATICS 8
+#define SFP_SESSION_MAX_WRITES 16
+
+// Maximum length of a serial number or tty path.
+#define SFP_SESSION_MAX_NAME 256
+
+// Register validating a module (serial number) and its size.
+#define SFP_SESSION_SERIAL_REGISTER 0x1E
+#define SFP_SESSION_SERIAL_LENGTH BYTES_3
+
+
+// Data structure for a cached static register.
+typedef struct SFPSessionStatic_
+{
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    long long value;                    // Signed register data, in counts.
+} SFPSessionStatic;
+
+
+// Data structure for a replayed configuration write.
+typedef struct SFPSessionWrite_
+{
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    char data[8];                       // Last written data.
+} SFPSessionWrite;
+
+
+// Data structure for the cached state of a module.
+// Members are managed by the Session functions.
+typedef struct SFPSessionEntry_
+{
+    char name[SFP_SESSION_MAX_NAME];    // Serial number or tty path.
+    byte baud_rate;                     // Last baudrate (Baudrate enum).
+    int timeout_ms;                     // Device timeout.
+    int latency_ms;                     // USB latency timer (0: unchanged).
+    SFPSessionStatic statics[SFP_SESSION_MAX_STATICS];
+    int static_count;                   // statics[0] validates the module.
+    SFPSessionWrite writes[SFP_SESSION_MAX_WRITES];
+    int write_count;
+} SFPSessionEntry;
+
+
+// Data structure for a session cache.
+// Members are managed by the Session functions.
+typedef struct SFPSessionCache_
+{
+    SFPSessionEntry entries[SFP_SESSION_MAX_DEVICES];
+    int count;
+} SFPSessionCache;
+
+
+/** Loads a session cache file.
+ *
+ *	Accepts         SFPSessionCache pointer and the file path.
+ *
+ *	Returns         status flag. PORT_FAIL is returned if the file cannot
+ *                  be opened (e.g. on the first start) and BYTES_INVALID if
+ *                  it is corrupted; the cache is then empty and usable.
+ */
+byte SessionLoad(SFPSessionCache * cache, const char * path);
+
+
+/** Saves a session cache file.
+ *
+ *	Accepts         SFPSessionCache pointer and the file path.
+ *
+ *	Returns         status flag. PORT_FAIL is returned if the file cannot be
+ *                  written.
+ *
+ *  The file is written next to the path, then renamed over it, so that an
+ *  interrupted save leaves the previous cache.
+ */
+byte SessionSave(const SFPSessionCache * cache, const char * path);
+
+
+/** Opens a module in its cached state.
+ *
+ *	Accepts         SFPSessionCache pointer, the name of the module, an
+ *                  SFPDevice pointer, an SFPSessionEntry pointer pointer and
+ *                  an int pointer.
+ *
+ *	name            FTDI serial number (D2XX backend) or tty path (serial
+ *                  port backend, starting with '/'), without whitespace.
+ *
+ *	device          is an allocated SFPDevice structure pointer which is
+ *                  initialized upon return.
+ *
+ *	entry           (optional) receives the cache entry of the module, used
+ *                  by the other Session functions.
+ *
+ *	warm            (optional) receives 1 if the cached state was valid, 0
+ *                  if the module was discovered.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if the name is too
+ *                  long or if the cache is full, BYTES_INVALID if it is
+ *                  empty or contains whitespace.
+ *
+ *  An unknown module is added to the cache with the serial number register
+ *  as validation register; the cache has to be saved to keep it.
+ */
+byte SessionOpen(SFPSessionCache * cache,
+                 const char * name,
+                 SFPDevice * device,
+                 SFPSessionEntry ** entry,
+                 int * warm);
+
+
+/** Records the current baudrate and timeout of a device.
+ *
+ *	Accepts         SFPSessionEntry pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  To be called after ChangeBaudRate() or ChangeTimeout().
+ */
+byte SessionUpdate(SFPSessionEntry * entry, const SFPDevice * device);
+
+
+/** Changes the USB latency timer of a device and records it.
+ *
+ *	Accepts         SFPSessionEntry pointer, SFPDevice pointer and latency in
+ *                  milliseconds (see ChangeLatencyTimer()).
+ *
+ *	Returns         status flag.
+ */
+byte SessionChangeLatency(SFPSessionEntry * entry,
+                          SFPDevice * device,
+                          int latency_ms);
+
+
+/** Writes a configuration register and records the write.
+ *
+ *	Accepts         SFPSessionEntry pointer, SFPDevice pointer, register
+ *                  address, number of bytes and the data to write.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if too many registers
+ *                  are recorded.
+ *
+ *  The last write of each register is replayed by SessionOpen().
+ */
+byte SessionWriteRegister(SFPSessionEntry * entry,
+                          SFPDevice * device,
+                          byte SFP_reg_address,
+                          byte number_of_bytes,
+                          char * const data);
+
+
+/** Reads a static register, from the cache when possible.
+ *
+ *	Accepts         SFPSessionEntry pointer, SFPDevice pointer, register
+ *                  address, number of bytes and a long long pointer.
+ *
+ *	signed_data     receives the signed register data.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if too many registers
+ *                  are cached.
+ *
+ *  The register is read from the module the first time only; its value must
+ *  not change while the module is powered.
+ */
+byte SessionReadStatic(SFPSessionEntry * entry,
+                       SFPDevice * device,
+                       byte SFP_reg_address,
+                       byte number_of_bytes,
+                       long long * signed_data);
+
+
+#endif  // SFP10X_SESSION_LIB
@@ -0,0 +1,318 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_SHM.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_SHM.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// Atomic accessors (GCC and Clang builtins).
+#define LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELAXED(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+
+// Observer callback publishing the reads of the attached device.
+static void ShmOnRead(void * ctx, SFPDevice * device, const SFPSample * sample)
+{
+    (void)device;
+    if (sample->rc == SFP_OK)
+        ShmPublish((SFPShmPublisher *)ctx, sample);
+}
+
+
+// Creates (or reopens) a shared memory segment for publication.
+byte ShmPublisherOpen(SFPShmPublisher * publisher, const char * name)
+{
+
+    if (publisher == NULL || name == NULL)
+        return MEM_FAIL;
+
+    if (strlen(name) >= sizeof(publisher->name))
+        return PORT_FAIL;
+
+    memset(publisher, 0, sizeof(SFPShmPublisher));
+    strcpy(publisher->name, name);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return PORT_FAIL;
+
+    if (ftruncate(fd, sizeof(SFPShmSegment)) != 0)
+    {
+        close(fd);
+        return PORT_FAIL;
+    }
+
+    void * map = mmap(NULL, sizeof(SFPShmSegment), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return MEM_FAIL;
+
+    // A new segment is zero filled; the sequences of a reopened segment are
+    // kept so that readers never see them go backwards. A publisher that
+    // died while writing a slot left its sequence odd, which would stall the
+    // readers of that slot: such a sequence is moved to the next even value.
+    SFPShmSegment * segment = (SFPShmSegment *)map;
+    for (int i = 0; i < SFP_SHM_SLOTS; i++)
+    {
+        const unsigned int sequence =
+            LOAD_RELAXED(&segment->slots[i].sequence);
+        if ((sequence & 1u) != 0)
+            STORE_RELEASE(&segment->slots[i].sequence, sequence + 1);
+    }
+    segment->header.version = SFP_SHM_VERSION;
+    segment->header.slot_count = SFP_SHM_SLOTS;
+    segment->header.slot_size = sizeof(SFPShmSlot);
+    STORE_RELEASE(&segment->header.magic, SFP_SHM_MAGIC);
+
+    publisher->segment = segment;
+    publisher->observer.on_read = ShmOnRead;
+    publisher->observer.ctx = publisher;
+
+    return SFP_OK;
+
+}
+
+
+// Publishes every read of a device.
+byte ShmPublisherAttach(SFPShmPublisher * publisher, SFPDevice * device)
+{
+
+    if (publisher == NULL || device == NULL || publisher->segment == NULL)
+        return MEM_FAIL;
+
+    if (publisher->device != NULL)
+        return DEVICE_BUSY;
+
+    byte rc = AddObserver(device, &publisher->observer);
+    if (rc == SFP_OK)
+        publisher->device = device;
+
+    return rc;
+
+}
+
+
+// Stops publishing the reads of the attached device.
+byte ShmPublisherDetach(SFPShmPublisher * publisher)
+{
+
+    if (publisher == NULL)
+        return MEM_FAIL;
+
+    if (publisher->device == NULL)
+        return SFP_OK;
+
+    byte rc = RemoveObserver(publisher->device, &publisher->observer);
+    publisher->device = NULL;
+
+    return rc;
+
+}
+
+
+// Publishes a sample.
+byte ShmPublish(SFPShmPublisher * publisher, const SFPSample * sample)
+{
+
+    if (publisher == NULL || sample == NULL || publisher->segment == NULL)
+        return MEM_FAIL;
+
+    SFPShmSlot * slot = &publisher->segment->slots[sample->reg_address];
+
+    // Odd sequence: readers retry until the update is complete.
+    const unsigned int sequence = LOAD_RELAXED(&slot->sequence);
+    STORE_RELAXED(&slot->sequence, sequence + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    STORE_RELAXED(&slot->reg_address, sample->reg_address);
+    STORE_RELAXED(&slot->number_of_bytes, sample->number_of_bytes);
+    STORE_RELAXED(&slot->status, sample->status);
+    STORE_RELAXED(&slot->rc, sample->rc);
+    STORE_RELAXED(&slot->value, sample->value);
+    STORE_RELAXED(&slot->timestamp_ns, sample->timestamp_ns);
+    STORE_RELAXED(&slot->send_ns, sample->send_ns);
+    STORE_RELAXED(&slot->done_ns, sample->done_ns);
+    STORE_RELAXED(&slot->updates, LOAD_RELAXED(&slot->updates) + 1);
+
+    STORE_RELEASE(&slot->sequence, sequence + 2);
+
+    return SFP_OK;
+
+}
+
+
+// Sample sink publishing samples.
+void ShmPublisherSink(void * ctx, int channel, const SFPSample * sample)
+{
+    (void)channel;
+    if (sample->rc == SFP_OK)
+        ShmPublish((SFPShmPublisher *)ctx, sample);
+}
+
+
+// Detaches and unmaps a publisher.
+byte ShmPublisherClose(SFPShmPublisher * publisher, int unlink_segment)
+{
+
+    if (publisher == NULL)
+        return MEM_FAIL;
+
+    ShmPublisherDetach(publisher);
+
+    if (publisher->segment != NULL)
+    {
+        munmap(publisher->segment, sizeof(SFPShmSegment));
+        publisher->segment = NULL;
+    }
+
+    if (unlink_segment && shm_unlink(publisher->name) != 0)
+        return PORT_FAIL;
+
+    return SFP_OK;
+
+}
+
+
+// Maps an existing shared memory segment for reading.
+byte ShmReaderOpen(SFPShmReader * reader, const char * name)
+{
+
+    if (reader == NULL || name == NULL)
+        return MEM_FAIL;
+
+    reader->segment = NULL;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return PORT_FAIL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SFPShmSegment))
+    {
+        close(fd);
+        return PORT_FAIL;
+    }
+
+    void * map = mmap(NULL, sizeof(SFPShmSegment), PROT_READ, MAP_SHARED,
+                      fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return MEM_FAIL;
+
+    const SFPShmSegment * segment = (const SFPShmSegment *)map;
+    if (LOAD_ACQUIRE(&segment->header.magic) != SFP_SHM_MAGIC
+        || segment->header.version != SFP_SHM_VERSION
+        || segment->header.slot_count != SFP_SHM_SLOTS
+        || segment->header.slot_size != sizeof(SFPShmSlot))
+    {
+        munmap(map, sizeof(SFPShmSegment));
+        return PORT_FAIL;
+    }
+
+    reader->segment = segment;
+
+    return SFP_OK;
+
+}
+
+
+// Reads a consistent snapshot of the latest value of a register.
+byte ShmRead(const SFPShmReader * reader,
+             byte SFP_reg_address,
+             SFPSample * sample,
+             unsigned long long * updates)
+{
+
+    if (reader == NULL || sample == NULL || reader->segment == NULL)
+        return MEM_FAIL;
+
+    const SFPShmSlot * slot = &reader->segment->slots[SFP_reg_address];
+
+    for (int attempt = 0; attempt < SFP_SHM_READ_RETRIES; attempt++)
+    {
+
+        const unsigned int before = LOAD_ACQUIRE(&slot->sequence);
+        if (before == 0)
+            return READ_FAIL;
+        if (before & 1)
+            continue;
+
+        sample->reg_address = LOAD_RELAXED(&slot->reg_address);
+        sample->number_of_bytes = LOAD_RELAXED(&slot->number_of_bytes);
+        sample->status = LOAD_RELAXED(&slot->status);
+        sample->rc = LOAD_RELAXED(&slot->rc);
+        sample->value = LOAD_RELAXED(&slot->value);
+        sample->timestamp_ns = LOAD_RELAXED(&slot->timestamp_ns);
+        sample->send_ns = LOAD_RELAXED(&slot->send_ns);
+        sample->done_ns = LOAD_RELAXED(&slot->done_ns);
+        const unsigned long long count = LOAD_RELAXED(&slot->updates);
+
+        // The copy is consistent if no update started in the meantime.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (LOAD_RELAXED(&slot->sequence) == before)
+        {
+            if (updates != NULL)
+                *updates = count;
+            return SFP_OK;
+        }
+
+    }
+
+    return DEVICE_BUSY;
+
+}
+
+
+// Unmaps a reader.
+byte ShmReaderClose(SFPShmReader * reader)
+{
+
+    if (reader == NULL)
+        return MEM_FAIL;
+
+    if (reader->segment != NULL)
+    {
+        munmap((void *)reader->segment, sizeof(SFPShmSegment));
+        reader->segment = NULL;
+    }
+
+    return SFP_OK;
+
+}
+
+
+#undef LOAD_RELAXED
+#undef LOAD_ACQUIRE
+#undef STORE_RELAXED
+#undef STORE_RELEASE
@@ -0,0 +1,220 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_SHM.h
+
+ Abstract:
+    Latest-value publication through POSIX shared memory. The process that
+    owns a device publishes every decoded read into a shared memory segment
+    holding one slot per register address; any number of local processes
+    can then read the latest value of a register at memory speed.
+
+    Each slot is a cache line protected by a sequence lock: the writer makes
+    the sequence odd while updating the slot, and readers retry until they
+    observe the same even sequence before and after copying the slot. Reads
+    never make a system call or take a lock.
+
+    Timestamps come from the host monotonic clock (SFPNowNs()), which is
+    shared by all the processes of a host.
+
+    Available on POSIX platforms only (link with -lrt on older Linux
+    systems).
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_SHM_LIB
+#define SFP10X_SHM_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Segment identification.
+#define SFP_SHM_MAGIC 0x31504653u   // "SFP1"
+#define SFP_SHM_VERSION 2
+
+// Number of slots, one per register address.
+#define SFP_SHM_SLOTS 256
+
+// Cache line size.
+#define SFP_SHM_LINE 64
+
+// Number of attempts of a reader before giving up on a slot that is being
+// updated continuously.
+#define SFP_SHM_READ_RETRIES 1000
+
+
+// Data structure for a register slot (one cache line).
+// The members are accessed atomically; use ShmRead() to read a slot.
+typedef struct SFPShmSlot_
+{
+    unsigned int sequence;              // Odd while the slot is written.
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    byte status;                        // Module status byte.
+    byte rc;                            // Status flag of the read.
+    long long value;                    // Signed register data, in counts.
+    unsigned long long timestamp_ns;    // Estimated sampling instant.
+    unsigned long long send_ns;         // Host time the request was sent.
+    unsigned long long done_ns;         // Host time the response completed.
+    unsigned long long updates;         // Number of publications.
+    byte reserved[SFP_SHM_LINE - 48];
+} __attribute__((aligned(SFP_SHM_LINE))) SFPShmSlot;
+
+
+// Data structure for the segment header (one cache line).
+typedef struct SFPShmHeader_
+{
+    unsigned int magic;                 // SFP_SHM_MAGIC.
+    unsigned int version;               // SFP_SHM_VERSION.
+    unsigned int slot_count;            // SFP_SHM_SLOTS.
+    unsigned int slot_size;             // sizeof(SFPShmSlot).
+    byte reserved[SFP_SHM_LINE - 16];
+} __attribute__((aligned(SFP_SHM_LINE))) SFPShmHeader;
+
+
+// Data structure for the shared memory segment.
+typedef struct SFPShmSegment_
+{
+    SFPShmHeader header;
+    SFPShmSlot slots[SFP_SHM_SLOTS];
+} SFPShmSegment;
+
+
+// Data structure for a publisher (single writer).
+typedef struct SFPShmPublisher_
+{
+    SFPShmSegment * segment;            // Mapped segment.
+    SFPObserver observer;               // Device observer.
+    SFPDevice * device;                 // Attached device, if any.
+    char name[64];                      // Segment name.
+} SFPShmPublisher;
+
+
+// Data structure for a reader.
+typedef struct SFPShmReader_
+{
+    const SFPShmSegment * segment;      // Mapped segment (read only).
+} SFPShmReader;
+
+
+/** Creates (or reopens) a shared memory segment for publication.
+ *
+ *	Accepts         SFPShmPublisher pointer and a segment name.
+ *
+ *	name            POSIX shared memory name, e.g. "/sfp10x_FT123456".
+ *
+ *	Returns         status flag.
+ */
+byte ShmPublisherOpen(SFPShmPublisher * publisher, const char * name);
+
+
+/** Publishes every read of a device.
+ *
+ *	Accepts         SFPShmPublisher pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  Successful reads are published into the slot of their register address.
+ *  The value is the register data sign extended for its transaction size.
+ */
+byte ShmPublisherAttach(SFPShmPublisher * publisher, SFPDevice * device);
+
+
+/** Stops publishing the reads of the attached device.
+ *
+ *	Accepts         SFPShmPublisher pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ShmPublisherDetach(SFPShmPublisher * publisher);
+
+
+/** Publishes a sample.
+ *
+ *	Accepts         SFPShmPublisher pointer and SFPSample pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  Must only be called by one thread at a time.
+ */
+byte ShmPublish(SFPShmPublisher * publisher, const SFPSample * sample);
+
+
+/** Sample sink publishing samples (see SFPSampleSink).
+ *
+ *	ctx             SFPShmPublisher pointer.
+ */
+void ShmPublisherSink(void * ctx, int channel, const SFPSample * sample);
+
+
+/** Detaches and unmaps a publisher.
+ *
+ *	Accepts         SFPShmPublisher pointer and an unlink flag.
+ *
+ *	unlink_segment  if non-zero the segment name is removed; readers keep
+ *                  their mapping.
+ *
+ *	Returns         status flag.
+ */
+byte ShmPublisherClose(SFPShmPublisher * publisher, int unlink_segment);
+
+
+/** Maps an existing shared memory segment for reading.
+ *
+ *	Accepts         SFPShmReader pointer and a segment name.
+ *
+ *	Returns         status flag. PORT_FAIL is returned if the segment does not
+ *                  exist or has an incompatible layout.
+ */
+byte ShmReaderOpen(SFPShmReader * reader, const char * name);
+
+
+/** Reads a consistent snapshot of the latest value of a register.
+ *
+ *	Accepts         SFPShmReader pointer, register address, a SFPSample
+ *                  pointer and an (optional) update counter pointer.
+ *
+ *	updates         receives the number of publications of the slot, which
+ *                  lets a reader detect new values.
+ *
+ *	Returns         status flag. READ_FAIL is returned if the register has
+ *                  never been published and DEVICE_BUSY if no consistent
+ *                  snapshot could be taken within SFP_SHM_READ_RETRIES
+ *                  attempts.
+ */
+byte ShmRead(const SFPShmReader * reader,
+             byte SFP_reg_address,
+             SFPSample * sample,
+             unsigned long long * updates);
+
+
+/** Unmaps a reader.
+ *
+ *	Accepts         SFPShmReader pointer.
+ *
+ *	Returns         status flag.
+ */
+byte ShmReaderClose(SFPShmReader * reader);
+
+
+#endif  // SFP10X_SHM_LIB
@@ -0,0 +1,284 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_STATUS.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_STATUS.h"
+#include <stdio.h>
+#include <string.h>
+
+
+// Default fields: the eight bits of the status byte.
+static const SFPStatusField bit_fields[SFP_STATUS_MAX_FIELDS] =
+{
+    { "bit0", 0x01 }, { "bit1", 0x02 }, { "bit2", 0x04 }, { "bit3", 0x08 },
+    { "bit4", 0x10 }, { "bit5", 0x20 }, { "bit6", 0x40 }, { "bit7", 0x80 }
+};
+
+
+// Notifies the subscribers interested in a status change.
+static void Notify(SFPStatusMonitor * monitor, const SFPStatusEvent * event)
+{
+    for (int i = 0; i < SFP_STATUS_MAX_SUBSCRIBERS; i++)
+    {
+        const SFPStatusSubscription * sub = &monitor->subscriptions[i];
+        if (sub->callback != NULL
+            && (event->first || (event->changed & sub->mask)))
+            sub->callback(sub->ctx, event);
+    }
+}
+
+
+// Observer callback following the status byte of a device.
+static void StatusOnRead(void * ctx,
+                         SFPDevice * device,
+                         const SFPSample * sample)
+{
+
+    SFPStatusDevice * tracked = (SFPStatusDevice *)ctx;
+    if (sample->rc != SFP_OK)
+        return;
+
+    tracked->responses++;
+    if (tracked->known && sample->status == tracked->status)
+        return;
+
+    SFPStatusEvent event;
+    event.device = device;
+    event.sample = sample;
+    event.first = !tracked->known;
+    event.previous = tracked->known ? tracked->status : sample->status;
+    event.status = sample->status;
+    event.changed = tracked->known ? (byte)(tracked->status ^ sample->status)
+                                   : 0xFF;
+
+    tracked->status = sample->status;
+    tracked->known = 1;
+    tracked->transitions += !event.first;
+    tracked->changed_ns = sample->timestamp_ns;
+
+    Notify(tracked->monitor, &event);
+
+}
+
+
+// Finds the slot of an attached device.
+static int FindDevice(const SFPStatusMonitor * monitor,
+                      const SFPDevice * device)
+{
+    for (int i = 0; i < SFP_STATUS_MAX_DEVICES; i++)
+        if (monitor->devices[i].device == device)
+            return i;
+    return -1;
+}
+
+
+// Initializes a status monitor.
+byte StatusMonitorInit(SFPStatusMonitor * monitor,
+                       const SFPStatusField * fields,
+                       int field_count)
+{
+
+    if (monitor == NULL)
+        return MEM_FAIL;
+
+    if (fields == NULL)
+    {
+        fields = bit_fields;
+        field_count = SFP_STATUS_MAX_FIELDS;
+    }
+
+    if (field_count <= 0 || field_count > SFP_STATUS_MAX_FIELDS)
+        return BYTES_INVALID;
+
+    for (int i = 0; i < field_count; i++)
+        if (fields[i].name == NULL || fields[i].mask == 0)
+            return BYTES_INVALID;
+
+    memset(monitor, 0, sizeof(SFPStatusMonitor));
+    memcpy(monitor->fields, fields, field_count * sizeof(SFPStatusField));
+    monitor->field_count = field_count;
+    for (int i = 0; i < field_count; i++)
+        while (!((fields[i].mask >> monitor->shifts[i]) & 1))
+            monitor->shifts[i]++;
+
+    return SFP_OK;
+
+}
+
+
+// Follows the status byte of the responses of a device.
+byte StatusAttach(SFPStatusMonitor * monitor, SFPDevice * device)
+{
+
+    if (monitor == NULL || device == NULL)
+        return MEM_FAIL;
+
+    if (FindDevice(monitor, device) >= 0)
+        return DEVICE_BUSY;
+
+    const int slot = FindDevice(monitor, NULL);
+    if (slot < 0)
+        return MEM_FAIL;
+
+    SFPStatusDevice * tracked = &monitor->devices[slot];
+    memset(tracked, 0, sizeof(SFPStatusDevice));
+    tracked->monitor = monitor;
+    tracked->observer.on_read = StatusOnRead;
+    tracked->observer.ctx = tracked;
+
+    byte rc = AddObserver(device, &tracked->observer);
+    if (rc == SFP_OK)
+        tracked->device = device;
+
+    return rc;
+
+}
+
+
+// Stops following a device.
+byte StatusDetach(SFPStatusMonitor * monitor, SFPDevice * device)
+{
+
+    if (monitor == NULL || device == NULL)
+        return MEM_FAIL;
+
+    const int slot = FindDevice(monitor, device);
+    if (slot < 0)
+        return SFP_OK;
+
+    byte rc = RemoveObserver(device, &monitor->devices[slot].observer);
+    monitor->devices[slot].device = NULL;
+
+    return rc;
+
+}
+
+
+// Subscribes to the status changes of the attached devices.
+byte StatusSubscribe(SFPStatusMonitor * monitor,
+                     byte mask,
+                     SFPStatusCallback callback,
+                     void * ctx,
+                     int * subscription)
+{
+
+    if (monitor == NULL || callback == NULL)
+        return MEM_FAIL;
+
+    for (int i = 0; i < SFP_STATUS_MAX_SUBSCRIBERS; i++)
+    {
+        SFPStatusSubscription * sub = &monitor->subscriptions[i];
+        if (sub->callback != NULL)
+            continue;
+
+        sub->ctx = ctx;
+        sub->mask = mask;
+        sub->callback = callback;
+        if (subscription != NULL)
+            *subscription = i;
+        return SFP_OK;
+    }
+
+    return MEM_FAIL;
+
+}
+
+
+// Cancels a subscription.
+byte StatusUnsubscribe(SFPStatusMonitor * monitor, int subscription)
+{
+
+    if (monitor == NULL)
+        return MEM_FAIL;
+
+    if (subscription < 0 || subscription >= SFP_STATUS_MAX_SUBSCRIBERS)
+        return BYTES_INVALID;
+
+    monitor->subscriptions[subscription].callback = NULL;
+
+    return SFP_OK;
+
+}
+
+
+// Gets the last status of an attached device.
+byte StatusCurrent(const SFPStatusMonitor * monitor,
+                   const SFPDevice * device,
+                   byte * status)
+{
+
+    if (monitor == NULL || device == NULL || status == NULL)
+        return MEM_FAIL;
+
+    const int slot = FindDevice(monitor, device);
+    if (slot < 0)
+        return PORT_FAIL;
+
+    if (!monitor->devices[slot].known)
+        return READ_FAIL;
+
+    *status = monitor->devices[slot].status;
+
+    return SFP_OK;
+
+}
+
+
+// Decodes a field of a status byte.
+byte StatusField(const SFPStatusMonitor * monitor, int field, byte status)
+{
+    if (field < 0 || field >= monitor->field_count)
+        return 0;
+    return (byte)((status & monitor->fields[field].mask)
+                  >> monitor->shifts[field]);
+}
+
+
+// Formats a status byte as "name=value" pairs.
+byte StatusFormat(const SFPStatusMonitor * monitor,
+                  byte status,
+                  char * buffer,
+                  size_t size)
+{
+
+    if (monitor == NULL || buffer == NULL || size == 0)
+        return MEM_FAIL;
+
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (int i = 0; i < monitor->field_count; i++)
+    {
+        const int n = snprintf(buffer + length, size - length, "%s%s=%u",
+                               i == 0 ? "" : " ", monitor->fields[i].name,
+                               (unsigned int)StatusField(monitor, i, status));
+        if (n < 0 || (size_t)n >= size - length)
+            return MEM_FAIL;
+        length += (size_t)n;
+    }
+
+    return SFP_OK;
+
+}
@@ -0,0 +1,219 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_STATUS.h
+
+ Abstract:
+    Status byte events. Every read response starts with the module status
+    byte; a status monitor attached to devices follows that byte on every
+    successful response and notifies its subscribers when it changes, with
+    the previous and new status, the changed bits and the transaction that
+    carried it (register, timestamps). Applications then react to module
+    events without polling the status register.
+
+    The status byte is decoded with a table of bit fields (name and mask,
+    see the module datasheet for their meaning). Without a table, the eight
+    bits are reported as single-bit fields bit0 to bit7.
+
+    Notifications are made from the thread performing the read. Devices may
+    be read from different threads; subscriptions, attachments and
+    detachments must not be changed while the attached devices are read.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_STATUS_LIB
+#define SFP10X_STATUS_LIB
+
+
+#include "SFP10X_COM.h"
+#include <stddef.h>
+
+
+// Maximum number of status fields, attached devices and subscribers.
+#define SFP_STATUS_MAX_FIELDS 8
+#define SFP_STATUS_MAX_DEVICES 16
+#define SFP_STATUS_MAX_SUBSCRIBERS 8
+
+
+// Data structure for a bit field of the status byte.
+typedef struct SFPStatusField_
+{
+    const char * name;                  // Field name.
+    byte mask;                          // Bits of the field (contiguous).
+} SFPStatusField;
+
+
+// Data structure for a status change event.
+typedef struct SFPStatusEvent_
+{
+    SFPDevice * device;                 // Device of the response.
+    const SFPSample * sample;           // Transaction that carried the new
+                                        // status (register, timestamps).
+    byte previous;                      // Previous status.
+    byte status;                        // New status.
+    byte changed;                       // Changed bits (0xFF for the first
+                                        // status of a device).
+    byte first;                         // Non-zero for the first status.
+} SFPStatusEvent;
+
+
+// Status event consumer callback.
+typedef void (*SFPStatusCallback)(void * ctx, const SFPStatusEvent * event);
+
+
+// Data structure for a subscription.
+typedef struct SFPStatusSubscription_
+{
+    SFPStatusCallback callback;         // NULL if the slot is free.
+    void * ctx;
+    byte mask;                          // Bits of interest.
+} SFPStatusSubscription;
+
+
+typedef struct SFPStatusMonitor_ SFPStatusMonitor;
+
+
+// Data structure for the status of an attached device.
+// Members are managed by the Status functions.
+typedef struct SFPStatusDevice_
+{
+    SFPObserver observer;               // Read observer of the device.
+    SFPDevice * device;                 // NULL if the slot is free.
+    SFPStatusMonitor * monitor;
+    byte status;                        // Last status.
+    int known;                          // Non-zero once a status was read.
+    unsigned long long responses;       // Responses decoded.
+    unsigned long long transitions;     // Status changes.
+    unsigned long long changed_ns;      // Time of the last change.
+} SFPStatusDevice;
+
+
+// Data structure for a status monitor.
+// Members are managed by the Status functions.
+struct SFPStatusMonitor_
+{
+    SFPStatusField fields[SFP_STATUS_MAX_FIELDS];
+    byte shifts[SFP_STATUS_MAX_FIELDS]; // Position of each field.
+    int field_count;
+    SFPStatusDevice devices[SFP_STATUS_MAX_DEVICES];
+    SFPStatusSubscription subscriptions[SFP_STATUS_MAX_SUBSCRIBERS];
+};
+
+
+/** Initializes a status monitor.
+ *
+ *	Accepts         SFPStatusMonitor pointer, field table and its size.
+ *
+ *	fields          status byte fields, NULL for the eight single bits. The
+ *                  names must stay valid while the monitor is used.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if the field
+ *                  table is invalid.
+ */
+byte StatusMonitorInit(SFPStatusMonitor * monitor,
+                       const SFPStatusField * fields,
+                       int field_count);
+
+
+/** Follows the status byte of the responses of a device.
+ *
+ *	Accepts         SFPStatusMonitor pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if there are too many
+ *                  devices.
+ */
+byte StatusAttach(SFPStatusMonitor * monitor, SFPDevice * device);
+
+
+/** Stops following a device.
+ *
+ *	Accepts         SFPStatusMonitor pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ */
+byte StatusDetach(SFPStatusMonitor * monitor, SFPDevice * device);
+
+
+/** Subscribes to the status changes of the attached devices.
+ *
+ *	Accepts         SFPStatusMonitor pointer, bit mask, callback, its context
+ *                  and an (optional) int pointer receiving the subscription.
+ *
+ *	mask            the callback is only called when one of these bits
+ *                  changed (and for the first status of a device).
+ *
+ *	Returns         status flag. MEM_FAIL is returned if there are too many
+ *                  subscriptions.
+ */
+byte StatusSubscribe(SFPStatusMonitor * monitor,
+                     byte mask,
+                     SFPStatusCallback callback,
+                     void * ctx,
+                     int * subscription);
+
+
+/** Cancels a subscription.
+ *
+ *	Accepts         SFPStatusMonitor pointer and subscription.
+ *
+ *	Returns         status flag.
+ */
+byte StatusUnsubscribe(SFPStatusMonitor * monitor, int subscription);
+
+
+/** Gets the last status of an attached device.
+ *
+ *	Accepts         SFPStatusMonitor pointer, SFPDevice pointer and byte
+ *                  pointer receiving the status.
+ *
+ *	Returns         status flag. READ_FAIL is returned if no response was
+ *                  received yet and PORT_FAIL if the device is not attached.
+ */
+byte StatusCurrent(const SFPStatusMonitor * monitor,
+                   const SFPDevice * device,
+                   byte * status);
+
+
+/** Decodes a field of a status byte.
+ *
+ *	Accepts         SFPStatusMonitor pointer, field index and status byte.
+ *
+ *	Returns         value of the field (shifted down to bit 0).
+ */
+byte StatusField(const SFPStatusMonitor * monitor, int field, byte status);
+
+
+/** Formats a status byte as "name=value" pairs (e.g. for logging).
+ *
+ *	Accepts         SFPStatusMonitor pointer, status byte, character buffer
+ *                  and its size.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if the buffer is too
+ *                  small (the text is truncated).
+ */
+byte StatusFormat(const SFPStatusMonitor * monitor,
+                  byte status,
+                  char * buffer,
+                  size_t size);
+
+
+#endif  // SFP10X_STATUS_LIB
@@ -0,0 +1,415 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_TRIGGER.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_TRIGGER.h"
+#include <string.h>
+
+
+// Trigger states.
+#define STATE_ARMED 0
+#define STATE_POST 1
+#define STATE_HOLDOFF 2
+
+// Buffer states.
+#define BUFFER_FREE 0
+#define BUFFER_RECORDING 1
+#define BUFFER_READY 2
+#define BUFFER_TAKEN 3
+
+
+// Observer callback processing the reads of the attached device.
+static void TriggerOnRead(void * ctx,
+                          SFPDevice * device,
+                          const SFPSample * sample)
+{
+    (void)device;
+    TriggerProcess((SFPTrigger *)ctx, sample);
+}
+
+
+// Stores a sample in the pre-trigger history.
+static void RecordHistory(SFPTrigger * trigger, const SFPSample * sample)
+{
+    const int capacity = trigger->config.pre_samples;
+    if (capacity == 0)
+        return;
+    trigger->samples[trigger->ring][trigger->ring_head] = *sample;
+    trigger->ring_head = trigger->ring_head + 1 < capacity
+                         ? trigger->ring_head + 1 : 0;
+    if (trigger->ring_count < capacity)
+        trigger->ring_count++;
+}
+
+
+// Evaluates the trigger condition and updates the previous value.
+static int Condition(SFPTrigger * trigger, const SFPSample * sample)
+{
+
+    const SFPTriggerConfig * config = &trigger->config;
+    const long long value = sample->value;
+    const long long previous = trigger->previous;
+    const int has_previous = trigger->has_previous;
+    const unsigned long long dt_ns = sample->timestamp_ns
+                                     - trigger->previous_ns;
+    trigger->previous = value;
+    trigger->previous_ns = sample->timestamp_ns;
+    trigger->has_previous = 1;
+
+    const int rising = config->direction != SFP_TRIGGER_FALLING;
+    const int falling = config->direction != SFP_TRIGGER_RISING;
+    switch (config->type)
+    {
+    case SFP_TRIGGER_LEVEL:
+        return rising ? value >= config->level : value <= config->level;
+    case SFP_TRIGGER_EDGE:
+        return has_previous
+               && ((rising && previous < config->level
+                    && value >= config->level)
+                   || (falling && previous > config->level
+                       && value <= config->level));
+    case SFP_TRIGGER_SLOPE:
+    {
+        if (!has_previous || dt_ns == 0)
+            return 0;
+        const double rate = (double)(value - previous)
+                            * (double)SFP_NS_PER_S / (double)dt_ns;
+        return (rising && rate >= config->slope)
+               || (falling && rate <= -config->slope);
+    }
+    default:
+        return (rising && value > config->high)
+               || (falling && value < config->low);
+    }
+
+}
+
+
+// Hands a completed capture to the consumers and starts the hold-off.
+static void Complete(SFPTrigger * trigger, unsigned long long now_ns)
+{
+
+    SFPMutexLock(&trigger->lock);
+    trigger->buffer_state[trigger->capture] = BUFFER_READY;
+    trigger->ready[(trigger->ready_head + trigger->ready_count)
+                   % SFP_TRIGGER_BUFFERS] = trigger->capture;
+    trigger->ready_count++;
+    trigger->stats.captures++;
+    SFPCondSignal(&trigger->ready_cond);
+    SFPMutexUnlock(&trigger->lock);
+
+    trigger->state = STATE_HOLDOFF;
+    trigger->rearm_ns = now_ns + trigger->config.holdoff_ns;
+
+}
+
+
+// Turns the recording buffer into a capture and records in a free buffer.
+static void Fire(SFPTrigger * trigger, const SFPSample * sample)
+{
+
+    const int pre_capacity = trigger->config.pre_samples;
+
+    SFPMutexLock(&trigger->lock);
+    trigger->stats.fired++;
+    if (trigger->free_count == 0)
+    {
+        trigger->stats.missed++;
+        SFPMutexUnlock(&trigger->lock);
+        RecordHistory(trigger, sample);
+        trigger->state = STATE_HOLDOFF;
+        trigger->rearm_ns = sample->timestamp_ns + trigger->config.holdoff_ns;
+        return;
+    }
+    const int next = trigger->free_list[--trigger->free_count];
+    trigger->buffer_state[next] = BUFFER_RECORDING;
+    SFPMutexUnlock(&trigger->lock);
+
+    const int buffer = trigger->ring;
+    SFPCapture * capture = &trigger->captures[buffer];
+    capture->samples = trigger->samples[buffer];
+    capture->pre_capacity = pre_capacity;
+    capture->pre_count = trigger->ring_count;
+    capture->pre_start = trigger->ring_count < pre_capacity
+                         ? 0 : trigger->ring_head;
+    capture->count = trigger->ring_count + 1;
+    capture->trigger_ns = sample->timestamp_ns;
+    capture->sequence = trigger->stats.fired;
+    trigger->samples[buffer][pre_capacity] = *sample;
+
+    // The next history starts with the samples of this capture.
+    trigger->capture = buffer;
+    trigger->ring = next;
+    trigger->ring_head = 0;
+    trigger->ring_count = 0;
+    RecordHistory(trigger, sample);
+
+    if (trigger->config.post_samples == 0)
+        Complete(trigger, sample->timestamp_ns);
+    else
+        trigger->state = STATE_POST;
+
+}
+
+
+// Initializes and arms a trigger.
+byte TriggerInit(SFPTrigger * trigger, const SFPTriggerConfig * config)
+{
+
+    if (trigger == NULL || config == NULL)
+        return MEM_FAIL;
+
+    if (config->type > SFP_TRIGGER_WINDOW
+        || config->direction > SFP_TRIGGER_EITHER
+        || (config->type == SFP_TRIGGER_LEVEL
+            && config->direction == SFP_TRIGGER_EITHER)
+        || (config->type == SFP_TRIGGER_WINDOW && config->low > config->high)
+        || (config->type == SFP_TRIGGER_SLOPE && !(config->slope > 0.0))
+        || config->pre_samples < 0 || config->post_samples < 0
+        || config->pre_samples + config->post_samples + 1
+           > SFP_TRIGGER_MAX_SAMPLES)
+        return BYTES_INVALID;
+
+    memset(trigger, 0, sizeof(SFPTrigger) - sizeof(trigger->samples));
+    trigger->config = *config;
+    trigger->state = STATE_ARMED;
+    trigger->ring = 0;
+    trigger->buffer_state[0] = BUFFER_RECORDING;
+    for (int i = 1; i < SFP_TRIGGER_BUFFERS; i++)
+        trigger->free_list[trigger->free_count++] = i;
+    trigger->observer.on_read = TriggerOnRead;
+    trigger->observer.ctx = trigger;
+    SFPMutexInit(&trigger->lock);
+    SFPCondInit(&trigger->ready_cond);
+
+    return SFP_OK;
+
+}
+
+
+// Releases the resources of a trigger.
+byte TriggerClose(SFPTrigger * trigger)
+{
+
+    if (trigger == NULL)
+        return MEM_FAIL;
+
+    byte rc = TriggerDetach(trigger);
+    SFPCondDestroy(&trigger->ready_cond);
+    SFPMutexDestroy(&trigger->lock);
+
+    return rc;
+
+}
+
+
+// Processes a sample.
+byte TriggerProcess(SFPTrigger * trigger, const SFPSample * sample)
+{
+
+    if (trigger == NULL || sample == NULL)
+        return MEM_FAIL;
+
+    if (sample->reg_address != trigger->config.SFP_reg_address)
+        return SFP_OK;
+
+    trigger->stats.samples++;
+    const int valid = sample->rc == SFP_OK;
+    const int met = valid && Condition(trigger, sample);
+
+    if (trigger->state == STATE_POST)
+    {
+        SFPCapture * capture = &trigger->captures[trigger->capture];
+        trigger->samples[trigger->capture][capture->pre_capacity
+                                           + capture->count
+                                           - capture->pre_count] = *sample;
+        capture->count++;
+        RecordHistory(trigger, sample);
+        if (capture->count - capture->pre_count
+            > trigger->config.post_samples)
+            Complete(trigger, sample->timestamp_ns);
+        return SFP_OK;
+    }
+
+    if (trigger->state == STATE_HOLDOFF
+        && sample->timestamp_ns >= trigger->rearm_ns)
+        trigger->state = STATE_ARMED;
+
+    if (trigger->state == STATE_ARMED && met)
+        Fire(trigger, sample);
+    else
+        RecordHistory(trigger, sample);
+
+    return SFP_OK;
+
+}
+
+
+// Sample sink processing samples.
+void TriggerSink(void * ctx, int channel, const SFPSample * sample)
+{
+    (void)channel;
+    TriggerProcess((SFPTrigger *)ctx, sample);
+}
+
+
+// Waits for the next capture.
+byte TriggerNextCapture(SFPTrigger * trigger,
+                        unsigned long long timeout_ns,
+                        const SFPCapture ** capture)
+{
+
+    if (trigger == NULL || capture == NULL)
+        return MEM_FAIL;
+
+    const unsigned long long deadline_ns = SFPNowNs() + timeout_ns;
+
+    SFPMutexLock(&trigger->lock);
+    while (trigger->ready_count == 0)
+    {
+        if (!SFPCondWaitUntil(&trigger->ready_cond, &trigger->lock,
+                              deadline_ns)
+            && trigger->ready_count == 0)
+        {
+            SFPMutexUnlock(&trigger->lock);
+            return RESPONSE_TIMEOUT;
+        }
+    }
+    const int buffer = trigger->ready[trigger->ready_head];
+    trigger->buffer_state[buffer] = BUFFER_TAKEN;
+    *capture = &trigger->captures[buffer];
+    trigger->ready_head = (trigger->ready_head + 1) % SFP_TRIGGER_BUFFERS;
+    trigger->ready_count--;
+    SFPMutexUnlock(&trigger->lock);
+
+    return SFP_OK;
+
+}
+
+
+// Gives the buffer of a capture back to the trigger.
+byte TriggerReleaseCapture(SFPTrigger * trigger, const SFPCapture * capture)
+{
+
+    if (trigger == NULL || capture == NULL)
+        return MEM_FAIL;
+
+    if (capture < trigger->captures
+        || capture >= trigger->captures + SFP_TRIGGER_BUFFERS)
+        return BYTES_INVALID;
+
+    // Only a capture held by a consumer goes back to the free list; a
+    // second release would hand the buffer out twice.
+    const int buffer = (int)(capture - trigger->captures);
+    SFPMutexLock(&trigger->lock);
+    if (capture != &trigger->captures[buffer]
+        || trigger->buffer_state[buffer] != BUFFER_TAKEN)
+    {
+        SFPMutexUnlock(&trigger->lock);
+        return BYTES_INVALID;
+    }
+    trigger->buffer_state[buffer] = BUFFER_FREE;
+    trigger->free_list[trigger->free_count++] = buffer;
+    SFPMutexUnlock(&trigger->lock);
+
+    return SFP_OK;
+
+}
+
+
+// Gets a sample of a capture, in time order.
+const SFPSample * CaptureSample(const SFPCapture * capture, int index)
+{
+    if (capture == NULL || index < 0 || index >= capture->count)
+        return NULL;
+    if (index < capture->pre_count)
+        return &capture->samples[(capture->pre_start + index)
+                                 % capture->pre_capacity];
+    return &capture->samples[capture->pre_capacity + index
+                             - capture->pre_count];
+}
+
+
+// Gets the statistics of a trigger.
+byte TriggerStats(SFPTrigger * trigger, SFPTriggerStats * stats)
+{
+
+    if (trigger == NULL || stats == NULL)
+        return MEM_FAIL;
+
+    SFPMutexLock(&trigger->lock);
+    *stats = trigger->stats;
+    SFPMutexUnlock(&trigger->lock);
+
+    return SFP_OK;
+
+}
+
+
+// Processes every read of a device.
+byte TriggerAttach(SFPTrigger * trigger, SFPDevice * device)
+{
+
+    if (trigger == NULL || device == NULL)
+        return MEM_FAIL;
+
+    if (trigger->device != NULL)
+        return DEVICE_BUSY;
+
+    byte rc = AddObserver(device, &trigger->observer);
+    if (rc == SFP_OK)
+        trigger->device = device;
+
+    return rc;
+
+}
+
+
+// Stops processing the reads of the attached device.
+byte TriggerDetach(SFPTrigger * trigger)
+{
+
+    if (trigger == NULL)
+        return MEM_FAIL;
+
+    if (trigger->device == NULL)
+        return SFP_OK;
+
+    byte rc = RemoveObserver(trigger->device, &trigger->observer);
+    trigger->device = NULL;
+
+    return rc;
+
+}
+
+
+#undef STATE_ARMED
+#undef STATE_POST
+#undef STATE_HOLDOFF
+#undef BUFFER_FREE
+#undef BUFFER_RECORDING
+#undef BUFFER_READY
+#undef BUFFER_TAKEN
@@ -0,0 +1,261 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_TRIGGER.h
+
+ Abstract:
+    Triggered capture. A trigger follows the samples of one register and
+    keeps the last pre-trigger samples in a circular buffer. When its
+    condition is met (level, edge, slope or window, see TriggerType), the
+    history and the following post-trigger samples form a capture, which is
+    handed to a consumer thread. After a capture, the trigger is re-armed
+    once the hold-off time has elapsed.
+
+    All buffers are allocated with the trigger: the samples are stored in
+    place and a capture is the buffer they were recorded in, so neither the
+    acquisition nor the hand-off copies a capture. While armed, a sample
+    costs one store and one comparison. The consumer releases each capture
+    to give its buffer back; if no buffer is free when the condition is met,
+    the event is counted as missed.
+
+    Samples are processed by a single thread (one sink, or one device
+    observer with all reads of that device made from one thread). Captures
+    may be consumed by any thread.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_TRIGGER_LIB
+#define SFP10X_TRIGGER_LIB
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_COM.h"
+
+
+// Samples per capture buffer (pre-trigger, trigger and post-trigger).
+#define SFP_TRIGGER_MAX_SAMPLES 2048
+
+// Number of capture buffers (one is always recording).
+#define SFP_TRIGGER_BUFFERS 4
+
+
+// Enumeration type for the trigger conditions.
+enum TriggerType
+{
+    SFP_TRIGGER_LEVEL = 0x00,           // Value above or below the level.
+    SFP_TRIGGER_EDGE = 0x01,            // Value crossing the level.
+    SFP_TRIGGER_SLOPE = 0x02,           // Rate of change beyond the slope.
+    SFP_TRIGGER_WINDOW = 0x03           // Value leaving [low, high].
+};
+
+
+// Enumeration type for the trigger directions.
+enum TriggerDirection
+{
+    SFP_TRIGGER_RISING = 0x00,          // Above, upwards, above high.
+    SFP_TRIGGER_FALLING = 0x01,         // Below, downwards, below low.
+    SFP_TRIGGER_EITHER = 0x02           // Both (not for level triggers).
+};
+
+
+// Data structure for the configuration of a trigger.
+typedef struct SFPTriggerConfig_
+{
+    byte SFP_reg_address;               // Register followed.
+    byte type;                          // TriggerType enum.
+    byte direction;                     // TriggerDirection enum.
+    long long level;                    // Level and edge threshold, counts.
+    long long low;                      // Window bounds, counts.
+    long long high;
+    double slope;                       // Slope threshold, counts per
+                                        // second (positive).
+    int pre_samples;                    // Samples kept before the trigger.
+    int post_samples;                   // Samples recorded after it.
+    unsigned long long holdoff_ns;      // Time between the end of a capture
+                                        // and the re-arm.
+} SFPTriggerConfig;
+
+
+// Data structure for a capture.
+// The samples are only valid until the capture is released.
+typedef struct SFPCapture_
+{
+    const SFPSample * samples;          // Capture buffer.
+    int pre_start;                      // Oldest pre-trigger sample.
+    int pre_count;                      // Pre-trigger samples.
+    int pre_capacity;                   // Size of the pre-trigger ring.
+    int count;                          // Samples, trigger sample included.
+    unsigned long long trigger_ns;      // Timestamp of the trigger sample.
+    unsigned long long sequence;        // Capture number.
+} SFPCapture;
+
+
+// Data structure for the statistics of a trigger.
+typedef struct SFPTriggerStats_
+{
+    unsigned long long samples;         // Samples of the register.
+    unsigned long long fired;           // Conditions met while armed.
+    unsigned long long captures;        // Completed captures.
+    unsigned long long missed;          // Conditions met without a free
+                                        // buffer.
+} SFPTriggerStats;
+
+
+// Data structure for a trigger.
+// Members are managed by the Trigger functions.
+typedef struct SFPTrigger_
+{
+    SFPTriggerConfig config;
+    byte state;                         // Armed, post-trigger or hold-off.
+    int ring;                           // Buffer recording the history.
+    int ring_head;                      // Next history slot.
+    int ring_count;                     // History samples.
+    int capture;                        // Capture being completed.
+    unsigned long long rearm_ns;        // End of the hold-off.
+    int has_previous;                   // Non-zero once a value was seen.
+    long long previous;                 // Previous value and timestamp
+    unsigned long long previous_ns;     // (edge and slope triggers).
+    SFPTriggerStats stats;
+    SFPMutex lock;                      // Protects the members below.
+    SFPCond ready_cond;                 // Signaled on completed captures.
+    byte buffer_state[SFP_TRIGGER_BUFFERS]; // Free, recording, ready
+                                            // or held by a consumer.
+    int free_list[SFP_TRIGGER_BUFFERS]; // Free buffers.
+    int free_count;
+    int ready[SFP_TRIGGER_BUFFERS];     // Completed captures, oldest first.
+    int ready_head;
+    int ready_count;
+    SFPCapture captures[SFP_TRIGGER_BUFFERS];
+    SFPObserver observer;               // Used by TriggerAttach().
+    SFPDevice * device;                 // Attached device, if any.
+    SFPSample samples[SFP_TRIGGER_BUFFERS][SFP_TRIGGER_MAX_SAMPLES];
+} SFPTrigger;
+
+
+/** Initializes and arms a trigger.
+ *
+ *	Accepts         SFPTrigger pointer and SFPTriggerConfig pointer.
+ *
+ *	config          pre_samples + post_samples + 1 must be at most
+ *                  SFP_TRIGGER_MAX_SAMPLES.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if the settings
+ *                  are invalid.
+ */
+byte TriggerInit(SFPTrigger * trigger, const SFPTriggerConfig * config);
+
+
+/** Releases the resources of a trigger (it is detached first).
+ *
+ *	Accepts         SFPTrigger pointer.
+ *
+ *	Returns         status flag.
+ */
+byte TriggerClose(SFPTrigger * trigger);
+
+
+/** Processes a sample (acquisition thread only).
+ *
+ *	Accepts         SFPTrigger pointer and SFPSample pointer.
+ *
+ *	Returns         status flag.
+ *
+ *  Samples of other registers are ignored. Failed reads are recorded but
+ *  never fire the trigger.
+ */
+byte TriggerProcess(SFPTrigger * trigger, const SFPSample * sample);
+
+
+/** Sample sink processing samples (see SFPSampleSink).
+ *
+ *	ctx             SFPTrigger pointer.
+ */
+void TriggerSink(void * ctx, int channel, const SFPSample * sample);
+
+
+/** Waits for the next capture.
+ *
+ *	Accepts         SFPTrigger pointer, timeout in nanoseconds and an
+ *                  SFPCapture pointer receiving the capture.
+ *
+ *	timeout_ns      maximum wait for a capture if none is ready, 0 to return
+ *                  immediately.
+ *
+ *	Returns         status flag. RESPONSE_TIMEOUT is returned if no capture
+ *                  completed within the timeout.
+ */
+byte TriggerNextCapture(SFPTrigger * trigger,
+                        unsigned long long timeout_ns,
+                        const SFPCapture ** capture);
+
+
+/** Gives the buffer of a capture back to the trigger.
+ *
+ *	Accepts         SFPTrigger pointer and SFPCapture pointer.
+ *
+ *	capture         a capture returned by TriggerNextCapture() and not yet
+ *                  released.
+ *
+ *	Returns         status flag. BYTES_INVALID is returned for any other
+ *                  capture (e.g. a capture released twice).
+ */
+byte TriggerReleaseCapture(SFPTrigger * trigger, const SFPCapture * capture);
+
+
+/** Gets a sample of a capture, in time order.
+ *
+ *	Accepts         SFPCapture pointer and sample index, from 0 to count - 1.
+ *
+ *	Returns         SFPSample pointer, NULL if the index is out of range.
+ *                  The trigger sample has the index pre_count.
+ */
+const SFPSample * CaptureSample(const SFPCapture * capture, int index);
+
+
+/** Gets the statistics of a trigger.
+ *
+ *	Accepts         SFPTrigger pointer and SFPTriggerStats pointer.
+ *
+ *	Returns         status flag.
+ */
+byte TriggerStats(SFPTrigger * trigger, SFPTriggerStats * stats);
+
+
+/** Processes every read of a device.
+ *
+ *	Accepts         SFPTrigger pointer and SFPDevice pointer.
+ *
+ *	Returns         status flag.
+ */
+byte TriggerAttach(SFPTrigger * trigger, SFPDevice * device);
+
+
+/** Stops processing the reads of the attached device.
+ *
+ *	Accepts         SFPTrigger pointer.
+ *
+ *	Returns         status flag.
+ */
+byte TriggerDetach(SFPTrigger * trigger);
+
+
+#endif  // SFP10X_TRIGGER_LIB
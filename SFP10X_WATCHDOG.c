@@ -0,0 +1,364 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_WATCHDOG.c
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "SFP10X_PLATFORM.h"
+#include "SFP10X_WATCHDOG.h"
+#include <string.h>
+
+
+// Device number of a device closed on an error (see FTHasError()).
+#define CLOSED_DEVICE -99
+
+
+// Observer callback following the reads of the device.
+static void WatchdogOnRead(void * ctx,
+                           SFPDevice * device,
+                           const SFPSample * sample)
+{
+
+    SFPWatchdog * watchdog = (SFPWatchdog *)ctx;
+    (void)device;
+
+    if (sample->rc == SFP_OK)
+    {
+        watchdog->last_ok_ns = sample->done_ns;
+        return;
+    }
+
+    if (!watchdog->stalled && watchdog->config.stall_ns != 0
+        && sample->done_ns - watchdog->last_ok_ns >= watchdog->config.stall_ns)
+    {
+        watchdog->stalled = 1;
+        watchdog->stats.stalls++;
+    }
+
+}
+
+
+// Finds the device number of the module by its serial number.
+// Returns -1 if it is not connected.
+static int FindSerial(const char * serial)
+{
+    char buffer[64];
+    const int count = GetFTDIDeviceCount();
+    for (int i = 0; i < count; i++)
+    {
+        if (GetFTDIDeviceInfo(i, buffer) != SFP_OK)
+            continue;
+        buffer[sizeof(buffer) - 1] = '\0';
+        if (strcmp(buffer, serial) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+// Makes one attempt at reopening and restoring the device.
+static byte Reconnect(SFPWatchdog * watchdog)
+{
+
+    SFPDevice * device = watchdog->device;
+    const int tty = device->sfp_backend == SFP_BACKEND_TTY;
+    SFPObserver * observers = device->sfp_observers;
+
+    // A stalled device is still open.
+    if (device->sfp_device_num != CLOSED_DEVICE)
+        ClosePort(device);
+
+    byte rc;
+    if (tty)
+    {
+        rc = InitializeTTY(watchdog->name, device);
+    }
+    else
+    {
+        const int device_num = FindSerial(watchdog->name);
+        rc = device_num < 0 ? PORT_FAIL : Initialize(device_num, device);
+    }
+    device->sfp_observers = observers;
+    if (rc != SFP_OK)
+        return rc;
+
+    rc = ChangeTimeout(device, watchdog->timeout_ms);
+    if (rc != SFP_OK)
+        return rc;
+
+    // A module that was reset is back at 19200 baud; a module that only lost
+    // the USB link kept the negotiated baudrate.
+    if (watchdog->baud_rate != SFP_BAUD_19200)
+    {
+        rc = ChangeBaudRate(device, watchdog->baud_rate);
+        if (rc != SFP_OK && device->sfp_device_num != CLOSED_DEVICE)
+        {
+            rc = ChangeOnlyHostBaudRate(device, watchdog->baud_rate);
+            if (rc == SFP_OK)
+                rc = ChangeBaudRate(device, watchdog->baud_rate);
+        }
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    for (int i = 0; i < watchdog->write_count; i++)
+    {
+        SFPWatchdogWrite * write = &watchdog->writes[i];
+        rc = WriteRegister(device, write->reg_address, write->number_of_bytes,
+                           write->data);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    return SFP_OK;
+
+}
+
+
+// Starts watching an initialized device.
+byte WatchdogInit(SFPWatchdog * watchdog,
+                  SFPDevice * device,
+                  const SFPWatchdogConfig * config,
+                  const char * name)
+{
+
+    if (watchdog == NULL || device == NULL)
+        return MEM_FAIL;
+
+    // The name can only be looked up from a D2XX device number; devices
+    // opened by tty path or by serial number (InitializeSerial()) need it.
+    if (name == NULL && (device->sfp_backend == SFP_BACKEND_TTY
+                         || device->sfp_device_num < 0))
+        return BYTES_INVALID;
+
+    memset(watchdog, 0, sizeof(SFPWatchdog));
+    watchdog->device = device;
+    watchdog->config.stall_ns = SFP_WATCHDOG_DEFAULT_STALL_NS;
+    watchdog->config.retry_ns = SFP_WATCHDOG_DEFAULT_RETRY_NS;
+    watchdog->config.timeout_ns = SFP_WATCHDOG_DEFAULT_TIMEOUT_NS;
+    if (config != NULL)
+        watchdog->config = *config;
+    watchdog->baud_rate = (byte)device->sfp_baud_rate;
+    watchdog->timeout_ms = device->sfp_timeout_ms;
+    watchdog->last_ok_ns = SFPNowNs();
+
+    if (name != NULL)
+    {
+        if (strlen(name) >= SFP_WATCHDOG_MAX_NAME)
+            return MEM_FAIL;
+        strcpy(watchdog->name, name);
+    }
+    else
+    {
+        byte rc = GetFTDIDeviceInfo(device->sfp_device_num, watchdog->name);
+        if (rc != SFP_OK)
+            return rc;
+    }
+
+    watchdog->observer.on_read = WatchdogOnRead;
+    watchdog->observer.ctx = watchdog;
+
+    return AddObserver(device, &watchdog->observer);
+
+}
+
+
+// Stops watching the device.
+byte WatchdogClose(SFPWatchdog * watchdog)
+{
+
+    if (watchdog == NULL)
+        return MEM_FAIL;
+
+    if (watchdog->device == NULL)
+        return SFP_OK;
+
+    byte rc = RemoveObserver(watchdog->device, &watchdog->observer);
+    watchdog->device = NULL;
+
+    return rc;
+
+}
+
+
+// Checks the connection.
+byte WatchdogCheck(SFPWatchdog * watchdog)
+{
+
+    if (watchdog == NULL || watchdog->device == NULL)
+        return MEM_FAIL;
+
+    if (watchdog->device->sfp_device_num == CLOSED_DEVICE
+        || watchdog->stalled)
+        return PORT_FAIL;
+
+    return SFP_OK;
+
+}
+
+
+// Recovers a lost connection.
+byte WatchdogRecover(SFPWatchdog * watchdog)
+{
+
+    byte rc = WatchdogCheck(watchdog);
+    if (rc != PORT_FAIL)
+        return rc;
+
+    const unsigned long long start_ns = SFPNowNs();
+    if (watchdog->down_ns == 0)
+    {
+        watchdog->down_ns = start_ns;
+        if (watchdog->device->sfp_device_num == CLOSED_DEVICE)
+            watchdog->stats.disconnects++;
+    }
+
+    // Attempt until the deadline, at most one attempt per retry interval.
+    const unsigned long long deadline_ns = start_ns
+                                           + watchdog->config.timeout_ns;
+    unsigned long long attempt_ns = start_ns;
+    for (;;)
+    {
+        watchdog->stats.attempts++;
+        if (Reconnect(watchdog) == SFP_OK)
+            break;
+
+        attempt_ns += watchdog->config.retry_ns;
+        if (attempt_ns >= deadline_ns)
+            return RESPONSE_TIMEOUT;
+        SFPSleepUntilNs(attempt_ns);
+    }
+
+    const unsigned long long now_ns = SFPNowNs();
+    watchdog->stalled = 0;
+    watchdog->last_ok_ns = now_ns;
+    watchdog->stats.recoveries++;
+    watchdog->stats.last_outage_ns = now_ns - watchdog->down_ns;
+    if (watchdog->stats.last_outage_ns > watchdog->stats.max_outage_ns)
+        watchdog->stats.max_outage_ns = watchdog->stats.last_outage_ns;
+    watchdog->down_ns = 0;
+
+    return SFP_OK;
+
+}
+
+
+// Gets the slot recording the writes of a register, -1 if the table is full.
+// The last write of a register replaces the previous ones.
+static int WriteSlot(const SFPWatchdog * watchdog, byte reg_address)
+{
+    int slot = 0;
+    while (slot < watchdog->write_count
+           && watchdog->writes[slot].reg_address != reg_address)
+        slot++;
+    return slot < SFP_WATCHDOG_MAX_WRITES ? slot : -1;
+}
+
+
+// Records a configuration write.
+byte WatchdogRecordWrite(SFPWatchdog * watchdog,
+                         byte SFP_reg_address,
+                         byte number_of_bytes,
+                         const char * data)
+{
+
+    if (watchdog == NULL || data == NULL)
+        return MEM_FAIL;
+
+    const int size = DataBytes(number_of_bytes);
+    if (size == 0)
+        return BYTES_INVALID;
+
+    const int slot = WriteSlot(watchdog, SFP_reg_address);
+    if (slot < 0)
+        return MEM_FAIL;
+    if (slot == watchdog->write_count)
+        watchdog->write_count++;
+
+    SFPWatchdogWrite * write = &watchdog->writes[slot];
+    write->reg_address = SFP_reg_address;
+    write->number_of_bytes = number_of_bytes;
+    memset(write->data, 0, sizeof(write->data));
+    memcpy(write->data, data, size);
+
+    return SFP_OK;
+
+}
+
+
+// Writes a configuration register and records the write.
+byte WatchdogWriteRegister(SFPWatchdog * watchdog,
+                           byte SFP_reg_address,
+                           byte number_of_bytes,
+                           char * const data)
+{
+
+    if (watchdog == NULL || watchdog->device == NULL)
+        return MEM_FAIL;
+
+    // A write that could not be replayed is not made.
+    if (WriteSlot(watchdog, SFP_reg_address) < 0)
+        return MEM_FAIL;
+
+    byte rc = WriteRegister(watchdog->device, SFP_reg_address,
+                            number_of_bytes, data);
+    if (rc != SFP_OK)
+        return rc;
+
+    return WatchdogRecordWrite(watchdog, SFP_reg_address, number_of_bytes,
+                               data);
+
+}
+
+
+// Changes the baudrate and records it.
+byte WatchdogChangeBaudRate(SFPWatchdog * watchdog, byte baud_rate)
+{
+
+    if (watchdog == NULL || watchdog->device == NULL)
+        return MEM_FAIL;
+
+    byte rc = ChangeBaudRate(watchdog->device, baud_rate);
+    if (rc == SFP_OK)
+        watchdog->baud_rate = baud_rate;
+
+    return rc;
+
+}
+
+
+// Gets the watchdog statistics.
+byte WatchdogStats(const SFPWatchdog * watchdog, SFPWatchdogStats * stats)
+{
+
+    if (watchdog == NULL || stats == NULL)
+        return MEM_FAIL;
+
+    *stats = watchdog->stats;
+
+    return SFP_OK;
+
+}
+
+
+#undef CLOSED_DEVICE
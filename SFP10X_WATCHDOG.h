@@ -0,0 +1,214 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    SFP10X_WATCHDOG.h
+
+ Abstract:
+    Connection watchdog. When a module is unplugged or resets, the library
+    closes the device (sfp_device_num is set to -99) and every later call
+    fails. A watchdog follows the reads of a device to detect these
+    disconnections as well as stalls (reads failing for longer than the
+    stall time), and recovers the device in place: it finds the same module
+    again by its FTDI serial number (or tty path), reopens it, restores the
+    device timeout and the negotiated baudrate, and replays the last write
+    of every configuration register recorded through the watchdog (other
+    writes, such as commands, are never replayed). The device observers are
+    kept.
+
+    A watchdog is used by the thread that owns the device. With a request
+    queue (see QueueSetWatchdog()), the worker recovers the device before
+    executing a request and retries a request that failed on a lost link,
+    so that requests wait for the recovery (bounded by the recovery timeout)
+    instead of failing.
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#ifndef SFP10X_WATCHDOG_LIB
+#define SFP10X_WATCHDOG_LIB
+
+
+#include "SFP10X_COM.h"
+
+
+// Maximum number of replayed configuration registers.
+#define SFP_WATCHDOG_MAX_WRITES 32
+
+// Maximum length of a serial number or tty path.
+#define SFP_WATCHDOG_MAX_NAME 256
+
+// Default stall time, interval between attempts and recovery timeout.
+#define SFP_WATCHDOG_DEFAULT_STALL_NS 500000000ULL
+#define SFP_WATCHDOG_DEFAULT_RETRY_NS 50000000ULL
+#define SFP_WATCHDOG_DEFAULT_TIMEOUT_NS 2000000000ULL
+
+
+// Data structure for the watchdog settings.
+typedef struct SFPWatchdogConfig_
+{
+    unsigned long long stall_ns;        // Reads failing for this time since
+                                        // the last success (0: never).
+    unsigned long long retry_ns;        // Interval between attempts.
+    unsigned long long timeout_ns;      // Maximum duration of a recovery.
+} SFPWatchdogConfig;
+
+
+// Data structure for a replayed configuration write.
+typedef struct SFPWatchdogWrite_
+{
+    byte reg_address;                   // SFP register address.
+    byte number_of_bytes;               // Transaction size (DataLength enum).
+    char data[8];                       // Last written data.
+} SFPWatchdogWrite;
+
+
+// Data structure for the watchdog statistics.
+typedef struct SFPWatchdogStats_
+{
+    unsigned long long disconnects;     // Devices found closed.
+    unsigned long long stalls;          // Stalls detected.
+    unsigned long long recoveries;      // Successful recoveries.
+    unsigned long long attempts;        // Reconnection attempts.
+    unsigned long long last_outage_ns;  // Duration of the last outage.
+    unsigned long long max_outage_ns;   // Longest outage.
+} SFPWatchdogStats;
+
+
+// Data structure for a watchdog.
+// Members are managed by the Watchdog functions.
+typedef struct SFPWatchdog_
+{
+    SFPDevice * device;                 // Watched device.
+    SFPWatchdogConfig config;
+    char name[SFP_WATCHDOG_MAX_NAME];   // Serial number or tty path.
+    byte baud_rate;                     // Baudrate to restore.
+    int timeout_ms;                     // Device timeout to restore.
+    SFPWatchdogWrite writes[SFP_WATCHDOG_MAX_WRITES];
+    int write_count;
+    SFPObserver observer;               // Read observer of the device.
+    unsigned long long last_ok_ns;      // Last successful read.
+    int stalled;                        // Non-zero once a stall is seen.
+    unsigned long long down_ns;         // Start of the outage, 0 if none.
+    SFPWatchdogStats stats;
+} SFPWatchdog;
+
+
+/** Starts watching an initialized device.
+ *
+ *	Accepts         SFPWatchdog pointer, SFPDevice pointer, an (optional)
+ *                  SFPWatchdogConfig pointer and the name of the module.
+ *
+ *	config          settings, NULL for the defaults.
+ *
+ *	name            FTDI serial number (D2XX backend, NULL to read it from
+ *                  the device number of a device opened by Initialize())
+ *                  or tty path (serial port backend, a stable path such as
+ *                  /dev/serial/by-id/... is preferred).
+ *
+ *	Returns         status flag. BYTES_INVALID is returned if name is NULL
+ *                  and cannot be read from the device.
+ *
+ *  The current baudrate and timeout of the device are restored after a
+ *  reconnection.
+ */
+byte WatchdogInit(SFPWatchdog * watchdog,
+                  SFPDevice * device,
+                  const SFPWatchdogConfig * config,
+                  const char * name);
+
+
+/** Stops watching the device.
+ *
+ *	Accepts         SFPWatchdog pointer.
+ *
+ *	Returns         status flag.
+ */
+byte WatchdogClose(SFPWatchdog * watchdog);
+
+
+/** Checks the connection.
+ *
+ *	Accepts         SFPWatchdog pointer.
+ *
+ *	Returns         status flag. PORT_FAIL is returned if the device was
+ *                  closed on an error or if its reads are stalled.
+ */
+byte WatchdogCheck(SFPWatchdog * watchdog);
+
+
+/** Recovers a lost connection (does nothing if the connection is fine).
+ *
+ *	Accepts         SFPWatchdog pointer.
+ *
+ *	Returns         status flag. RESPONSE_TIMEOUT is returned if the module
+ *                  could not be recovered within the recovery timeout.
+ */
+byte WatchdogRecover(SFPWatchdog * watchdog);
+
+
+/** Records a configuration write, to be replayed after a reconnection.
+ *
+ *	Accepts         SFPWatchdog pointer, register address, number of bytes
+ *                  and the written data.
+ *
+ *	Returns         status flag. MEM_FAIL is returned if too many registers
+ *                  are recorded.
+ */
+byte WatchdogRecordWrite(SFPWatchdog * watchdog,
+                         byte SFP_reg_address,
+                         byte number_of_bytes,
+                         const char * data);
+
+
+/** Writes a configuration register and records the write (see
+ *  WriteRegister()).
+ *
+ *	Accepts         SFPWatchdog pointer, register address, number of bytes
+ *                  and the data to write.
+ *
+ *	Returns         status flag. MEM_FAIL is returned, and nothing written,
+ *                  if too many registers are recorded.
+ */
+byte WatchdogWriteRegister(SFPWatchdog * watchdog,
+                           byte SFP_reg_address,
+                           byte number_of_bytes,
+                           char * const data);
+
+
+/** Changes the baudrate and records it (see ChangeBaudRate()).
+ *
+ *	Accepts         SFPWatchdog pointer and baudrate.
+ *
+ *	Returns         status flag.
+ */
+byte WatchdogChangeBaudRate(SFPWatchdog * watchdog, byte baud_rate);
+
+
+/** Gets the watchdog statistics.
+ *
+ *	Accepts         SFPWatchdog pointer and SFPWatchdogStats pointer.
+ *
+ *	Returns         status flag.
+ */
+byte WatchdogStats(const SFPWatchdog * watchdog, SFPWatchdogStats * stats);
+
+
+#endif  // SFP10X_WATCHDOG_LIB
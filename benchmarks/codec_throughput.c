@@ -0,0 +1,172 @@
+/*
+ 
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+ 
+ SFP10X_COM library benchmark.
+ 
+ Authors:
+ Damian Glinojecki (Sendyne Corp.)
+ Nicolas Clauvelin (Sendyne Corp.)
+ 
+ File:
+    codec_throughput.c
+ 
+ Abstract:
+    Measures the encoder and decoder throughput and the compression ratio
+    of the sample stream codec on a synthetic 24-bit current recording
+    (1 kHz with timing jitter, slow signal plus noise). Throughputs are in
+    MB/s of raw samples (8 byte timestamp and 8 byte value). No module is
+    needed.
+ 
+    Usage: codec_throughput [samples] [resolution ns]
+ 
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ 
+*/
+
+
+#include "../SFP10X_PLATFORM.h"
+#include "../SFP10X_CODEC.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Encoded recording.
+typedef struct Recording_
+{
+    byte * data;
+    size_t size;
+    size_t capacity;
+} Recording;
+
+
+// Block sink appending blocks to a recording.
+static void Append(void * ctx, const byte * block, size_t size)
+{
+    Recording * recording = (Recording *)ctx;
+    if (recording->size + size <= recording->capacity)
+    {
+        memcpy(recording->data + recording->size, block, size);
+        recording->size += size;
+    }
+}
+
+
+// Encodes and decodes the recording with one value mode.
+static int Run(byte mode,
+               const unsigned long long * timestamps,
+               const long long * values,
+               int samples,
+               unsigned int resolution_ns)
+{
+
+    Recording recording;
+    recording.capacity = (size_t)samples * SFP_CODEC_MAX_SAMPLE_SIZE
+                         + SFP_CODEC_MAX_BLOCK_SIZE;
+    recording.data = malloc(recording.capacity);
+    recording.size = 0;
+    unsigned long long * decoded_timestamps = malloc(samples * sizeof(*timestamps));
+    long long * decoded_values = malloc(samples * sizeof(*values));
+    if (recording.data == NULL || decoded_timestamps == NULL
+        || decoded_values == NULL)
+        return -1;
+
+    static SFPCodecEncoder encoder;
+    CodecEncoderInit(&encoder, mode, resolution_ns, 256, Append, &recording);
+    unsigned long long start_ns = SFPNowNs();
+    for (int i = 0; i < samples; i++)
+        CodecEncode(&encoder, timestamps[i], values[i]);
+    CodecEncoderFlush(&encoder);
+    const double encode_s = (SFPNowNs() - start_ns) / 1e9;
+
+    // Decode block by block, as a reader seeking a recording would.
+    int decoded = 0;
+    size_t offset = 0;
+    start_ns = SFPNowNs();
+    while (offset < recording.size)
+    {
+        int count = 0;
+        SFPCodecBlockInfo info;
+        if (CodecBlockInfo(recording.data + offset, recording.size - offset,
+                           &info) != SFP_OK
+            || CodecDecodeBlock(recording.data + offset,
+                                recording.size - offset,
+                                decoded_timestamps + decoded,
+                                decoded_values + decoded,
+                                samples - decoded, &count) != SFP_OK)
+            break;
+        decoded += count;
+        offset += info.size;
+    }
+    const double decode_s = (SFPNowNs() - start_ns) / 1e9;
+
+    int errors = decoded != samples;
+    for (int i = 0; i < decoded; i++)
+        if (decoded_values[i] != values[i]
+            || timestamps[i] - decoded_timestamps[i] >= resolution_ns)
+            errors++;
+
+    const double raw_mb = samples * 16.0 / 1e6;
+    printf("%-6s  encode %7.1f MB/s  decode %7.1f MB/s  "
+           "%.2f bytes/sample  ratio %.1f  %s\n",
+           mode == SFP_CODEC_DELTA ? "delta" : "delta2",
+           raw_mb / encode_s, raw_mb / decode_s,
+           (double)recording.size / samples,
+           samples * 16.0 / recording.size,
+           errors ? "MISMATCH" : "ok");
+
+    free(decoded_values);
+    free(decoded_timestamps);
+    free(recording.data);
+
+    return errors ? -1 : 0;
+
+}
+
+
+int main(int argc, char ** argv)
+{
+
+    const int samples = argc > 1 ? atoi(argv[1]) : 10000000;
+    const unsigned int resolution_ns = argc > 2 ? (unsigned int)atoi(argv[2])
+                                                : 1000;
+    if (samples <= 0 || resolution_ns == 0)
+    {
+        printf("Usage: %s [samples] [resolution ns]\n", argv[0]);
+        return -1;
+    }
+
+    unsigned long long * timestamps = malloc(samples * sizeof(*timestamps));
+    long long * values = malloc(samples * sizeof(*values));
+    if (timestamps == NULL || values == NULL)
+        return -1;
+
+    srand(1);
+    unsigned long long t = 1000000000ULL;
+    for (int i = 0; i < samples; i++)
+    {
+        t += 1000000ULL + (unsigned long long)(rand() % 50000);
+        timestamps[i] = t;
+        values[i] = (long long)(2000000.0 * sin(i / 20000.0)) + rand() % 64;
+    }
+
+    printf("%d samples, timestamp resolution %u ns\n", samples, resolution_ns);
+    int rc = Run(SFP_CODEC_DELTA, timestamps, values, samples, resolution_ns);
+    rc |= Run(SFP_CODEC_DELTA2, timestamps, values, samples, resolution_ns);
+
+    free(values);
+    free(timestamps);
+
+    return rc;
+
+}
@@ -0,0 +1,171 @@
+/*
+ 
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+ 
+ SFP10X_COM library benchmark.
+ 
+ Authors:
+ Damian Glinojecki (Sendyne Corp.)
+ Nicolas Clauvelin (Sendyne Corp.)
+ 
+ File:
+    derive_bulk.c
+ 
+ Abstract:
+    Compares the frame by frame and bulk evaluation of a derived channel
+    plan (power, energy, charge and resistance from current and voltage)
+    over synthetic recorded data, then checks that both modes give the same
+    values on every frame. No module is needed.
+ 
+    Usage: derive_bulk [frames]
+ 
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ 
+*/
+
+
+#include "../SFP10X_PLATFORM.h"
+#include "../SFP10X_DERIVE.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// Number of frames per bulk block.
+#define BLOCK 4096
+
+// Number of slots of the plan.
+#define SLOTS 6
+
+
+// Declares the plan: slots 0 current (A), 1 voltage (V), 2 power (W),
+// 3 energy (J), 4 charge (Ah) and 5 resistance (Ohm).
+static void DeclarePlan(SFPDeriveEngine * engine)
+{
+    int current, voltage, power;
+    DeriveInit(engine, NULL, NULL);
+    DeriveInput(engine, 0, SFP_AMPS_PER_COUNT, 0.0, &current);
+    DeriveInput(engine, 1, SFP_VOLTS_PER_COUNT, 0.0, &voltage);
+    DeriveBinary(engine, SFP_DERIVE_MUL, voltage, current, &power);
+    DeriveIntegral(engine, power, 1.0, NULL);
+    DeriveIntegral(engine, current, 1.0 / SFP_SECONDS_PER_HOUR, NULL);
+    DeriveBinary(engine, SFP_DERIVE_DIV, voltage, current, NULL);
+}
+
+
+// Checks a bulk value against a frame by frame value and its validity.
+static int Agree(int valid, double value, double bulk)
+{
+    if (!valid)
+        return isnan(bulk);
+    return fabs(bulk - value) <= 1e-9 * fmax(1.0, fabs(value));
+}
+
+
+int main(int argc, char ** argv)
+{
+
+    const int frames = argc > 1 ? atoi(argv[1]) : 10000000;
+    if (frames < BLOCK)
+    {
+        printf("Usage: %s [frames >= %d]\n", argv[0], BLOCK);
+        return -1;
+    }
+
+    // Synthetic recording at 1 kHz.
+    unsigned long long * timestamps = malloc(frames * sizeof(*timestamps));
+    double * counts[2];
+    counts[0] = malloc(frames * sizeof(double));
+    counts[1] = malloc(frames * sizeof(double));
+    if (timestamps == NULL || counts[0] == NULL || counts[1] == NULL)
+        return -1;
+    for (int i = 0; i < frames; i++)
+    {
+        timestamps[i] = 1000000ULL * (i + 1);
+        counts[0][i] = i % 1000 != 0 ? 160000.0 + (i % 1000) : 0.0;
+        counts[1][i] = 400000.0 - (i % 500);
+    }
+
+    // Frame by frame.
+    SFPDeriveEngine engine;
+    DeclarePlan(&engine);
+    SFPAlignedFrame frame;
+    frame.channel_count = 2;
+    frame.valid[0] = frame.valid[1] = 1;
+    unsigned long long start_ns = SFPNowNs();
+    for (int i = 0; i < frames; i++)
+    {
+        frame.timestamp_ns = timestamps[i];
+        frame.values[0] = counts[0][i];
+        frame.values[1] = counts[1][i];
+        DeriveUpdate(&engine, &frame);
+    }
+    const double frame_s = (SFPNowNs() - start_ns) / 1e9;
+    const double frame_energy = engine.values[3];
+
+    // Bulk, block by block; the last block may be shorter.
+    DeclarePlan(&engine);
+    double * outputs[SLOTS];
+    for (int s = 0; s < SLOTS; s++)
+        outputs[s] = malloc(BLOCK * sizeof(double));
+    start_ns = SFPNowNs();
+    for (int i = 0; i < frames; i += BLOCK)
+    {
+        const double * inputs[2] = { counts[0] + i, counts[1] + i };
+        const int count = frames - i < BLOCK ? frames - i : BLOCK;
+        DeriveBulk(&engine, timestamps + i, inputs, count, outputs);
+    }
+    const double bulk_s = (SFPNowNs() - start_ns) / 1e9;
+    const double bulk_energy = engine.steps[3].integral;
+
+    printf("Frame by frame  %8.1f Mframes/s  energy %.6f J\n",
+           frames / frame_s / 1e6, frame_energy);
+    printf("Bulk            %8.1f Mframes/s  energy %.6f J\n",
+           frames / bulk_s / 1e6, bulk_energy);
+
+    // Both modes must give the same values on every frame, and NaN in bulk
+    // where the frame by frame value is invalid.
+    SFPDeriveEngine check;
+    DeclarePlan(&check);
+    DeclarePlan(&engine);
+    long long mismatches = 0;
+    for (int i = 0; i < frames; i += BLOCK)
+    {
+        const double * inputs[2] = { counts[0] + i, counts[1] + i };
+        const int count = frames - i < BLOCK ? frames - i : BLOCK;
+        DeriveBulk(&engine, timestamps + i, inputs, count, outputs);
+        for (int j = 0; j < count; j++)
+        {
+            frame.timestamp_ns = timestamps[i + j];
+            frame.values[0] = counts[0][i + j];
+            frame.values[1] = counts[1][i + j];
+            DeriveUpdate(&check, &frame);
+            for (int s = 0; s < SLOTS; s++)
+                if (!Agree(check.valid[s], check.values[s], outputs[s][j]))
+                    mismatches++;
+        }
+    }
+
+    for (int s = 0; s < SLOTS; s++)
+        free(outputs[s]);
+    free(counts[1]);
+    free(counts[0]);
+    free(timestamps);
+
+    if (mismatches != 0)
+    {
+        printf("Modes disagree on %lld values\n", mismatches);
+        return -1;
+    }
+
+    return 0;
+
+}
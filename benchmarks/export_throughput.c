@@ -0,0 +1,219 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ SFP10X_COM library benchmark.
+
+ Authors:
+ Damian Glinojecki (Sendyne Corp.)
+ Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    export_throughput.c
+
+ Abstract:
+    Compares the columnar export with a CSV export of the same synthetic
+    recording (one 24-bit channel at 1 kHz): write throughput, file size and
+    the time needed to load the value column back (reading one array from
+    the footer extents versus parsing every CSV line). The loaded values are
+    checked against the recording. No module is needed.
+
+    Usage: export_throughput [samples] [directory]
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "../SFP10X_PLATFORM.h"
+#include "../SFP10X_EXPORT.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// Engineering scale of the channel (A per count).
+#define SCALE 0.00006119
+
+
+// Returns the size of a file.
+static long long FileSize(const char * path)
+{
+    FILE * file = fopen(path, "rb");
+    if (file == NULL)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    const long long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+
+// Counts the loaded values that differ from the recording.
+static int Compare(const double * loaded, const SFPSample * samples, int count)
+{
+    int errors = 0;
+    for (int i = 0; i < count; i++)
+        if (fabs(loaded[i] - samples[i].value * SCALE) > 1e-9)
+            errors++;
+    return errors;
+}
+
+
+// Writes and loads the columnar file.
+static int RunColumnar(const char * path, const SFPSample * samples, int count)
+{
+
+    static SFPExporter exporter;
+    int channel = 0;
+    unsigned long long start_ns = SFPNowNs();
+    if (ExporterOpen(&exporter, path, 0) != SFP_OK
+        || ExporterAddChannel(&exporter, "current", 0x32, SCALE, 0.0,
+                              &channel) != SFP_OK)
+        return -1;
+    for (int i = 0; i < count; i++)
+        ExporterWrite(&exporter, channel, &samples[i]);
+    if (ExporterClose(&exporter) != SFP_OK)
+        return -1;
+    const double write_s = (SFPNowNs() - start_ns) / 1e9;
+
+    // Load the value column: footer lookup, then one read per row group.
+    double * values = malloc(count * sizeof(double));
+    if (values == NULL)
+        return -1;
+    start_ns = SFPNowNs();
+    SFPExportReader reader;
+    if (ExportReaderOpen(&reader, path) != SFP_OK)
+        return -1;
+    FILE * file = fopen(path, "rb");
+    SFPExportExtent extent;
+    int loaded = 0;
+    for (int index = 0;
+         file != NULL
+         && ExportReaderExtent(&reader, channel, SFP_EXPORT_VALUE, index,
+                               &extent) == SFP_OK;
+         index++)
+    {
+        if (extent.first_row + extent.count > (unsigned long long)count)
+            break;
+        fseek(file, (long)extent.offset, SEEK_SET);
+        loaded += (int)fread(values + extent.first_row, sizeof(double),
+                             (size_t)extent.count, file);
+    }
+    if (file != NULL)
+        fclose(file);
+    ExportReaderClose(&reader);
+    const double load_s = (SFPNowNs() - start_ns) / 1e9;
+
+    const int errors = (loaded != count) + Compare(values, samples, loaded);
+    printf("columnar  write %7.1f Mrows/s  %6.1f MB  load %7.1f Mrows/s  %s\n",
+           count / write_s / 1e6, FileSize(path) / 1e6,
+           count / load_s / 1e6, errors ? "MISMATCH" : "ok");
+    free(values);
+
+    return errors ? -1 : 0;
+
+}
+
+
+// Writes and parses the CSV file.
+static int RunCsv(const char * path, const SFPSample * samples, int count)
+{
+
+    unsigned long long start_ns = SFPNowNs();
+    FILE * file = fopen(path, "w");
+    if (file == NULL)
+        return -1;
+    fprintf(file, "timestamp_ns,raw,value,status\n");
+    for (int i = 0; i < count; i++)
+        fprintf(file, "%llu,%lld,%.9f,%u\n", samples[i].timestamp_ns,
+                samples[i].value, samples[i].value * SCALE,
+                (unsigned int)samples[i].status);
+    if (fclose(file) != 0)
+        return -1;
+    const double write_s = (SFPNowNs() - start_ns) / 1e9;
+
+    double * values = malloc(count * sizeof(double));
+    if (values == NULL)
+        return -1;
+    start_ns = SFPNowNs();
+    file = fopen(path, "r");
+    if (file == NULL)
+        return -1;
+    char line[128];
+    int loaded = 0;
+    fgets(line, sizeof(line), file);
+    while (loaded < count && fgets(line, sizeof(line), file) != NULL)
+    {
+        const char * field = strchr(line, ',');
+        field = field != NULL ? strchr(field + 1, ',') : NULL;
+        if (field == NULL)
+            break;
+        values[loaded++] = strtod(field + 1, NULL);
+    }
+    fclose(file);
+    const double load_s = (SFPNowNs() - start_ns) / 1e9;
+
+    const int errors = (loaded != count) + Compare(values, samples, loaded);
+    printf("csv       write %7.1f Mrows/s  %6.1f MB  load %7.1f Mrows/s  %s\n",
+           count / write_s / 1e6, FileSize(path) / 1e6,
+           count / load_s / 1e6, errors ? "MISMATCH" : "ok");
+    free(values);
+
+    return errors ? -1 : 0;
+
+}
+
+
+int main(int argc, char ** argv)
+{
+
+    const int count = argc > 1 ? atoi(argv[1]) : 5000000;
+    const char * directory = argc > 2 ? argv[2] : ".";
+    if (count <= 0)
+    {
+        printf("Usage: %s [samples] [directory]\n", argv[0]);
+        return -1;
+    }
+
+    SFPSample * samples = calloc(count, sizeof(SFPSample));
+    if (samples == NULL)
+        return -1;
+
+    srand(1);
+    unsigned long long t = 1000000000ULL;
+    for (int i = 0; i < count; i++)
+    {
+        t += 1000000ULL + (unsigned long long)(rand() % 50000);
+        samples[i].rc = SFP_OK;
+        samples[i].reg_address = 0x32;
+        samples[i].timestamp_ns = t;
+        samples[i].value = (long long)(2000000.0 * sin(i / 20000.0))
+                           + rand() % 64;
+    }
+
+    char columnar_path[512], csv_path[512];
+    snprintf(columnar_path, sizeof(columnar_path), "%s/export.sfpcols",
+             directory);
+    snprintf(csv_path, sizeof(csv_path), "%s/export.csv", directory);
+
+    printf("%d samples\n", count);
+    int rc = RunColumnar(columnar_path, samples, count);
+    rc |= RunCsv(csv_path, samples, count);
+
+    remove(columnar_path);
+    remove(csv_path);
+    free(samples);
+
+    return rc;
+
+}
@@ -0,0 +1,135 @@
+/*
+ 
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+ 
+ SFP10X_COM library benchmark.
+ 
+ Authors:
+ Damian Glinojecki (Sendyne Corp.)
+ Nicolas Clauvelin (Sendyne Corp.)
+ 
+ File:
+    poll_jitter.c
+ 
+ Abstract:
+    Compares the jitter of the poll scheduling strategies on a real module.
+    Current (0x32) is polled at 100 Hz, voltage (0x52) at 50 Hz and the
+    serial number (0x1E) at 1 Hz, first with the cyclic strategy and then with
+    the priority strategy.
+ 
+    Usage: poll_jitter <device number> [seconds per strategy] [baud code]
+ 
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+ 
+*/
+
+
+#include "../SFP10X_POLL.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+// Runs one strategy and prints the per-register statistics.
+static int RunStrategy(SFPDevice * device, byte strategy, double seconds)
+{
+
+    SFPPollSchedule schedule;
+    PollScheduleInit(&schedule, strategy);
+    PollScheduleAdd(&schedule, 0x32, BYTES_3, 100.0, 0, NULL);
+    PollScheduleAdd(&schedule, 0x52, BYTES_3, 50.0, 1, NULL);
+    PollScheduleAdd(&schedule, 0x1E, BYTES_3, 1.0, 2, NULL);
+
+    byte rc = PollScheduleBuild(&schedule, device);
+    if (rc != SFP_OK)
+    {
+        printf("Schedule rejected - %s\n", FlagLookup(rc));
+        return -1;
+    }
+
+    printf("%s strategy: utilization %.1f %%, minor frame %.3f ms, "
+           "%u frames per cycle\n",
+           strategy == SFP_POLL_CYCLIC ? "Cyclic" : "Priority",
+           schedule.utilization * 100.0,
+           schedule.frame_length_ns / 1e6,
+           schedule.frame_count);
+
+    const unsigned int frames = (unsigned int)
+        (seconds * 1e9 / (double)schedule.frame_length_ns);
+    rc = PollScheduleRun(device, &schedule, frames, NULL, NULL);
+    if (rc != SFP_OK)
+    {
+        printf("Run failed - %s\n", FlagLookup(rc));
+        return -1;
+    }
+
+    printf("  reg    target Hz  achieved Hz   rms us   max us  errors\n");
+    for (int i = 0; i < schedule.entry_count; i++)
+    {
+        SFPPollStats stats;
+        PollScheduleStats(&schedule, i, &stats);
+        printf("  0x%02x %10.2f %12.3f %8.1f %8.1f %7llu\n",
+               schedule.entries[i].reg_address,
+               stats.target_rate_hz,
+               stats.achieved_rate_hz,
+               stats.jitter_rms_us,
+               stats.jitter_max_us,
+               stats.errors);
+    }
+    printf("\n");
+
+    return 0;
+
+}
+
+
+int main(int argc, char ** argv)
+{
+
+    if (argc < 2)
+    {
+        printf("Usage: %s <device number> [seconds] [baud code]\n", argv[0]);
+        return -1;
+    }
+
+    const int device_num = atoi(argv[1]);
+    const double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+    const byte baud_rate = argc > 3 ? (byte)atoi(argv[3]) : SFP_BAUD_115200;
+
+    SFPDevice device;
+    byte rc = Initialize(device_num, &device);
+    if (rc != SFP_OK)
+    {
+        printf("Failed to open the device - %s\n", FlagLookup(rc));
+        return -1;
+    }
+
+    if (baud_rate != SFP_BAUD_19200)
+    {
+        rc = ChangeBaudRate(&device, baud_rate);
+        if (rc != SFP_OK)
+        {
+            printf("Failed to change baudrate - %s\n", FlagLookup(rc));
+            ClosePort(&device);
+            return -1;
+        }
+    }
+
+    RunStrategy(&device, SFP_POLL_CYCLIC, seconds);
+    RunStrategy(&device, SFP_POLL_PRIORITY, seconds);
+
+    // Restore the default baudrate.
+    if (baud_rate != SFP_BAUD_19200)
+        ChangeBaudRate(&device, SFP_BAUD_19200);
+    ClosePort(&device);
+
+    return 0;
+
+}
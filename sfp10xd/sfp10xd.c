@@ -0,0 +1,574 @@
+/*
+
+ Copyright 2015-2016 Sendyne Corp., New York, USA
+ http://www.sendyne.com
+
+ C library for FTDI-based serial communication with Sendyne's SFP products.
+
+ Authors:
+    Damian Glinojecki (Sendyne Corp.)
+    Nicolas Clauvelin (Sendyne Corp.)
+
+ File:
+    sfp10xd.c
+
+ Abstract:
+    Local multiplexing daemon. The daemon owns one or more modules and
+    serves register reads and writes to local clients over a Unix domain
+    socket (see SFP10X_CLIENT.h for the protocol and the client API).
+
+    The requests received from all the clients during one poll cycle form a
+    batch which is executed back to back. Identical reads (same device,
+    register and size) within a batch are performed once and their response
+    is sent to every requester; a write to a device ends the coalescing of
+    the reads of that device that precede it.
+
+    Each client is rate limited by a token bucket. The requests of a client
+    without tokens are left in its socket, so that the kernel applies back
+    pressure to the client instead of the daemon buffering them.
+
+    Usage: sfp10xd [-s socket] [-r rate] [-b burst] device [device ...]
+
+    device          D2XX device number, or serial port path (e.g.
+                    /dev/ttyUSB0) for the serial port backend.
+    -s socket       socket path, ClientDefaultSocket() by default
+                    ($XDG_RUNTIME_DIR/sfp10xd.sock, or
+                    /run/sfp10xd/sfp10xd.sock when it is not set).
+    -r rate         per-client request rate in requests per second, 0 (the
+                    default) for no limit.
+    -b burst        per-client burst size, in requests (default 16).
+
+    The socket is created with mode 0660, so that only the owner and the
+    group of the daemon may connect.
+
+    Counters are printed when the daemon exits (SIGINT or SIGTERM).
+
+ THE SOFTWARE IS PROVIDED AS IS, WITHOUT WARRANTY OF ANY KIND,
+ EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include "../SFP10X_PLATFORM.h"
+#include "../SFP10X_CLIENT.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+// Limits.
+#define MAX_DEVICES 16
+#define MAX_CLIENTS 64
+
+// Maximum number of requests taken from one client per batch.
+#define CLIENT_BATCH 16
+
+// Maximum number of requests in a batch.
+#define MAX_BATCH (MAX_CLIENTS * CLIENT_BATCH)
+
+// Size of the output buffer of a client (responses not yet sent).
+#define OUTPUT_SIZE (4 * CLIENT_BATCH * sizeof(SFPProtoResponse))
+
+
+// Data structure for a client connection.
+typedef struct Client_
+{
+    int fd;                             // Socket, -1 if the slot is free.
+    char input[sizeof(SFPProtoRequest)];// Partially received request.
+    size_t input_length;
+    char output[OUTPUT_SIZE];           // Responses not yet sent.
+    size_t output_length;
+    double tokens;                      // Token bucket.
+    unsigned long long refill_ns;       // Time of the last refill.
+    int throttled;                      // Out of tokens.
+} Client;
+
+
+// Data structure for a batched request.
+typedef struct BatchEntry_
+{
+    int client;                         // Client slot.
+    SFPProtoRequest request;
+} BatchEntry;
+
+
+// Data structure for a read performed in the current batch.
+typedef struct BatchRead_
+{
+    byte device;
+    byte reg_address;
+    byte number_of_bytes;
+    byte valid;                         // Cleared by a write to the device.
+    SFPProtoResponse response;
+} BatchRead;
+
+
+// Daemon state.
+static SFPDevice devices[MAX_DEVICES];
+static int device_count = 0;
+static Client clients[MAX_CLIENTS];
+static BatchEntry batch[MAX_BATCH];
+static BatchRead reads[MAX_BATCH];
+static double rate = 0.0;
+static double burst = 16.0;
+static volatile sig_atomic_t running = 1;
+
+// Counters.
+static unsigned long long requests = 0;
+static unsigned long long transactions = 0;
+static unsigned long long coalesced = 0;
+static unsigned long long throttled = 0;
+static unsigned long long connections = 0;
+
+
+// Signal handler stopping the daemon.
+static void Stop(int signal_number)
+{
+    (void)signal_number;
+    running = 0;
+}
+
+
+// Closes a client connection.
+static void CloseClient(int slot)
+{
+    close(clients[slot].fd);
+    clients[slot].fd = -1;
+}
+
+
+// Adds tokens to the bucket of a client.
+static void Refill(Client * client, unsigned long long now_ns)
+{
+    if (rate <= 0.0)
+        return;
+    client->tokens += rate * (double)(now_ns - client->refill_ns) / SFP_NS_PER_S;
+    if (client->tokens > burst)
+        client->tokens = burst;
+    client->refill_ns = now_ns;
+}
+
+
+// Returns the number of requests a client may submit now.
+static int Allowance(const Client * client)
+{
+    const size_t space = (OUTPUT_SIZE - client->output_length)
+                         / sizeof(SFPProtoResponse);
+    int allowance = space < CLIENT_BATCH ? (int)space : CLIENT_BATCH;
+    if (rate > 0.0 && client->tokens < allowance)
+        allowance = (int)client->tokens;
+    return allowance;
+}
+
+
+// Accepts the pending connections.
+static void AcceptClients(int listener)
+{
+    for (;;)
+    {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0)
+            return;
+
+        int slot = 0;
+        while (slot < MAX_CLIENTS && clients[slot].fd >= 0)
+            slot++;
+        if (slot == MAX_CLIENTS)
+        {
+            close(fd);
+            continue;
+        }
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        memset(&clients[slot], 0, sizeof(Client));
+        clients[slot].fd = fd;
+        clients[slot].tokens = burst;
+        clients[slot].refill_ns = SFPNowNs();
+        connections++;
+    }
+}
+
+
+// Receives up to the allowance of a client into the batch.
+// Returns the new batch length.
+static int ReceiveRequests(int slot, int length)
+{
+
+    Client * client = &clients[slot];
+    const int allowance = Allowance(client);
+    if (allowance <= 0)
+        return length;
+
+    // Only whole allowed requests are taken from the socket.
+    char buffer[CLIENT_BATCH * sizeof(SFPProtoRequest)];
+    memcpy(buffer, client->input, client->input_length);
+    const size_t wanted = allowance * sizeof(SFPProtoRequest);
+    ssize_t n = recv(client->fd, buffer + client->input_length,
+                     wanted - client->input_length, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        CloseClient(slot);
+        return length;
+    }
+    if (n < 0)
+        return length;
+
+    const size_t received = client->input_length + (size_t)n;
+    size_t offset = 0;
+    while (received - offset >= sizeof(SFPProtoRequest))
+    {
+        batch[length].client = slot;
+        memcpy(&batch[length].request, buffer + offset,
+               sizeof(SFPProtoRequest));
+        length++;
+        offset += sizeof(SFPProtoRequest);
+        if (rate > 0.0)
+            client->tokens -= 1.0;
+    }
+
+    client->input_length = received - offset;
+    memcpy(client->input, buffer + offset, client->input_length);
+
+    return length;
+
+}
+
+
+// Executes a request, coalescing identical reads within the batch.
+static void Execute(const SFPProtoRequest * request,
+                    SFPProtoResponse * response,
+                    int * read_count)
+{
+
+    memset(response, 0, sizeof(SFPProtoResponse));
+    response->tag = request->tag;
+    response->device = request->device;
+    response->reg_address = request->reg_address;
+    response->number_of_bytes = request->number_of_bytes;
+
+    if (request->device >= device_count)
+    {
+        response->rc = BYTES_INVALID;
+        return;
+    }
+
+    SFPDevice * device = &devices[request->device];
+
+    if (request->op == SFP_OP_WRITE)
+    {
+        // Later reads of the device must observe the write.
+        for (int i = 0; i < *read_count; i++)
+            if (reads[i].device == request->device)
+                reads[i].valid = 0;
+
+        char data[8];
+        memcpy(data, request->data, sizeof(data));
+        response->rc = WriteRegister(device, request->reg_address,
+                                     request->number_of_bytes, data);
+        response->timestamp_ns = SFPNowNs();
+        transactions++;
+        return;
+    }
+
+    if (request->op != SFP_OP_READ)
+    {
+        response->rc = READ_FAIL;
+        return;
+    }
+
+    for (int i = 0; i < *read_count; i++)
+    {
+        const BatchRead * read = &reads[i];
+        if (read->valid
+            && read->device == request->device
+            && read->reg_address == request->reg_address
+            && read->number_of_bytes == request->number_of_bytes)
+        {
+            *response = read->response;
+            response->tag = request->tag;
+            coalesced++;
+            return;
+        }
+    }
+
+    response->rc = ReadRegister(device, request->reg_address,
+                                request->number_of_bytes, response->data);
+    response->timestamp_ns = SFPNowNs();
+    transactions++;
+
+    BatchRead * read = &reads[(*read_count)++];
+    read->device = request->device;
+    read->reg_address = request->reg_address;
+    read->number_of_bytes = request->number_of_bytes;
+    read->valid = 1;
+    read->response = *response;
+
+}
+
+
+// Sends the buffered responses of a client.
+static void Flush(int slot)
+{
+
+    Client * client = &clients[slot];
+    if (client->fd < 0 || client->output_length == 0)
+        return;
+
+    ssize_t n = send(client->fd, client->output, client->output_length, 0);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EINTR)
+            CloseClient(slot);
+        return;
+    }
+
+    client->output_length -= (size_t)n;
+    memmove(client->output, client->output + n, client->output_length);
+
+}
+
+
+// Opens the listening socket.
+static int Listen(const char * socket_path)
+{
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+        return -1;
+    strcpy(address.sun_path, socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    // The socket is created with mode 0660 (its mode grants the right to
+    // connect).
+    unlink(socket_path);
+    const mode_t mask = umask(0117);
+    const int bound = bind(fd, (struct sockaddr *)&address, sizeof(address));
+    umask(mask);
+    if (bound != 0 || listen(fd, MAX_CLIENTS) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    return fd;
+
+}
+
+
+// Opens a device given its number or serial port path.
+static byte OpenDevice(const char * name, SFPDevice * device)
+{
+    if (name[0] >= '0' && name[0] <= '9')
+        return Initialize(atoi(name), device);
+    return InitializeTTY(name, device);
+}
+
+
+int main(int argc, char ** argv)
+{
+
+    char default_path[256];
+    const char * socket_path = NULL;
+
+    int option;
+    while ((option = getopt(argc, argv, "s:r:b:")) != -1)
+    {
+        switch (option)
+        {
+        case 's':
+            socket_path = optarg;
+            break;
+        case 'r':
+            rate = atof(optarg);
+            break;
+        case 'b':
+            burst = atof(optarg);
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
+    if (optind >= argc || argc - optind > MAX_DEVICES || burst < 1.0)
+    {
+        printf("Usage: %s [-s socket] [-r rate] [-b burst] "
+               "device [device ...]\n", argv[0]);
+        return -1;
+    }
+
+    // The default runtime directory is created if needed (a daemon started
+    // by a service manager usually gets it from there).
+    if (socket_path == NULL)
+    {
+        if (ClientDefaultSocket(default_path, sizeof(default_path)) != SFP_OK)
+        {
+            printf("Socket path too long\n");
+            return -1;
+        }
+        if (strncmp(default_path, SFP_CLIENT_RUNTIME_DIR "/",
+                    sizeof(SFP_CLIENT_RUNTIME_DIR)) == 0)
+            mkdir(SFP_CLIENT_RUNTIME_DIR, 0755);
+        socket_path = default_path;
+    }
+
+    for (int i = optind; i < argc; i++)
+    {
+        byte rc = OpenDevice(argv[i], &devices[device_count]);
+        if (rc != SFP_OK)
+        {
+            printf("Failed to open %s - %s\n", argv[i], FlagLookup(rc));
+            for (int j = 0; j < device_count; j++)
+                ClosePort(&devices[j]);
+            return -1;
+        }
+        device_count++;
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    const int listener = Listen(socket_path);
+    if (listener < 0)
+    {
+        printf("Failed to listen on %s\n", socket_path);
+        for (int i = 0; i < device_count; i++)
+            ClosePort(&devices[i]);
+        return -1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = Stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, NULL);
+
+    printf("Serving %d device(s) on %s\n", device_count, socket_path);
+
+    struct pollfd fds[MAX_CLIENTS + 1];
+    int first = 0;
+
+    while (running)
+    {
+
+        // Wait for connections, requests within the allowances and room in
+        // the socket buffers.
+        const unsigned long long now_ns = SFPNowNs();
+        int timeout_ms = -1;
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < MAX_CLIENTS; i++)
+        {
+            Client * client = &clients[i];
+            fds[i + 1].fd = client->fd;
+            fds[i + 1].events = 0;
+            fds[i + 1].revents = 0;
+            if (client->fd < 0)
+                continue;
+
+            Refill(client, now_ns);
+            if (Allowance(client) > 0)
+                fds[i + 1].events |= POLLIN;
+            else if (rate > 0.0 && client->tokens < 1.0)
+            {
+                // Wake up when the next token is available.
+                const int wait_ms = 1 + (int)((1.0 - client->tokens)
+                                              * 1000.0 / rate);
+                if (timeout_ms < 0 || wait_ms < timeout_ms)
+                    timeout_ms = wait_ms;
+            }
+            if (client->output_length > 0)
+                fds[i + 1].events |= POLLOUT;
+        }
+
+        if (poll(fds, MAX_CLIENTS + 1, timeout_ms) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+            AcceptClients(listener);
+
+        // Gather the batch, starting with a different client every cycle so
+        // that no client is always served first.
+        int length = 0;
+        for (int k = 0; k < MAX_CLIENTS; k++)
+        {
+            const int i = (first + k) % MAX_CLIENTS;
+            if (clients[i].fd < 0 || fds[i + 1].fd != clients[i].fd)
+                continue;
+            if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+                length = ReceiveRequests(i, length);
+
+            // Count the times a client runs out of tokens.
+            const int empty = rate > 0.0 && clients[i].tokens < 1.0;
+            if (empty && !clients[i].throttled)
+                throttled++;
+            clients[i].throttled = empty;
+        }
+        first = (first + 1) % MAX_CLIENTS;
+
+        // Execute the batch.
+        int read_count = 0;
+        for (int b = 0; b < length; b++)
+        {
+            SFPProtoResponse response;
+            Execute(&batch[b].request, &response, &read_count);
+            requests++;
+
+            Client * client = &clients[batch[b].client];
+            if (client->fd < 0)
+                continue;
+            memcpy(client->output + client->output_length, &response,
+                   sizeof(response));
+            client->output_length += sizeof(response);
+        }
+
+        for (int i = 0; i < MAX_CLIENTS; i++)
+            Flush(i);
+
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        if (clients[i].fd >= 0)
+            CloseClient(i);
+    close(listener);
+    unlink(socket_path);
+
+    for (int i = 0; i < device_count; i++)
+        ClosePort(&devices[i]);
+
+    printf("Connections   %llu\n", connections);
+    printf("Requests      %llu\n", requests);
+    printf("Transactions  %llu\n", transactions);
+    printf("Coalesced     %llu\n", coalesced);
+    printf("Throttled     %llu\n", throttled);
+
+    return 0;
+
+}